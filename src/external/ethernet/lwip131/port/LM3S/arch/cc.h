@@ -53,6 +53,12 @@ typedef u32_t               mem_ptr_t;
 
 #define PACK_STRUCT_FIELD(x) x
 
+/* word-wise checksum with the carry arithmetic of the M3 (port/chksum.c) */
+u16_t lm3s_chksum(void *dataptr, u16_t len);
+u16_t lm3s_chksum_copy(void *dst, const void *src, u16_t len);
+#define LWIP_CHKSUM lm3s_chksum
+#define LWIP_CHKSUM_COPY(dst, src, len) lm3s_chksum_copy(dst, src, len)
+
 
 #ifdef DEBUG
 extern void __error__(char *pcFilename, unsigned long ulLine);
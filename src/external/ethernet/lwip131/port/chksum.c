@@ -0,0 +1,304 @@
+/*
+ * Copyright (c) 2001-2003 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+/*
+ * Internet checksum for the Cortex-M3 (LWIP_CHKSUM and LWIP_CHKSUM_COPY in
+ * arch/cc.h).
+ *
+ * The checksum is a one's complement sum, so it can be built from 32-bit
+ * words with the carry of every add fed into the next one (adcs) and folded
+ * to 16 bits at the end. The byte order doesn't matter as long as the
+ * result is swapped back, both functions return the same value as
+ * lwip_standard_chksum() in inet_chksum.c.
+ *
+ * lm3s_chksum_copy() sums the words while it copies them, tcp_enqueue()
+ * uses it for TCP_WRITE_FLAG_COPY so the data isn't read a second time by
+ * tcp_output_segment().
+ *
+ * Without Thumb-2 (the host test tools/chksumbench.c) the word loops are
+ * plain C.
+ */
+
+#include <string.h>
+
+#include "arch/cc.h"
+
+/** adds a word to a one's complement sum, the carry goes around */
+#define CHKSUM_ADD(acc, w)		do { (acc) += (w); if ((acc) < (w)) (acc)++; } while (0)
+
+/** folds a 32-bit one's complement sum to 16 bits */
+#define CHKSUM_FOLD(acc)		do { (acc) = ((acc) >> 16) + ((acc) & 0xffffUL); \
+								(acc) = ((acc) >> 16) + ((acc) & 0xffffUL); } while (0)
+
+/** swaps the bytes of the folded sum */
+#define CHKSUM_SWAP(acc)		((((acc) & 0xffUL) << 8) | (((acc) & 0xff00UL) >> 8))
+
+/*-----------------------------------------------------------------------------------*/
+//  Adds ulBlocks blocks of four words to acc, pw must be word aligned.
+static u32_t
+chksum_blocks(const u32_t **pw, u32_t ulBlocks, u32_t acc)
+{
+#if defined(__GNUC__) && defined(__thumb2__)
+	const u32_t *p = *pw;
+
+	//
+	// adds with #0 clears the carry, teq doesn't touch it. The carry of the
+	// last add goes around twice, the first one can carry again.
+	//
+	__asm volatile(
+			"	adds	%[acc], %[acc], #0\n"
+			"1:	ldmia	%[p]!, {r2-r5}\n"
+			"	adcs	%[acc], %[acc], r2\n"
+			"	adcs	%[acc], %[acc], r3\n"
+			"	adcs	%[acc], %[acc], r4\n"
+			"	adcs	%[acc], %[acc], r5\n"
+			"	sub		%[n], %[n], #1\n"
+			"	teq		%[n], #0\n"
+			"	bne		1b\n"
+			"	adcs	%[acc], %[acc], #0\n"
+			"	adc		%[acc], %[acc], #0\n"
+			: [acc] "+r" (acc), [p] "+r" (p), [n] "+r" (ulBlocks)
+			:
+			: "r2", "r3", "r4", "r5", "cc", "memory");
+
+	*pw = p;
+#else
+	const u32_t *p = *pw;
+
+	while (ulBlocks--)
+	{
+		CHKSUM_ADD(acc, p[0]);
+		CHKSUM_ADD(acc, p[1]);
+		CHKSUM_ADD(acc, p[2]);
+		CHKSUM_ADD(acc, p[3]);
+		p += 4;
+	}
+
+	*pw = p;
+#endif
+
+	return acc;
+}
+
+/*-----------------------------------------------------------------------------------*/
+//  Copies ulBlocks blocks of four words to pd and adds them to acc. pd must
+//  be word aligned, ps may be unaligned (ldr handles that on the M3, ldm
+//  doesn't).
+static u32_t
+chksum_copy_blocks(u32_t **pd, const u8_t **ps, u32_t ulBlocks, u32_t acc)
+{
+#if defined(__GNUC__) && defined(__thumb2__)
+	u32_t *d = *pd;
+	const u8_t *s = *ps;
+
+	__asm volatile(
+			"	adds	%[acc], %[acc], #0\n"
+			"1:	ldr		r2, [%[s]]\n"
+			"	ldr		r3, [%[s], #4]\n"
+			"	ldr		r4, [%[s], #8]\n"
+			"	ldr		r5, [%[s], #12]\n"
+			"	add		%[s], %[s], #16\n"
+			"	stmia	%[d]!, {r2-r5}\n"
+			"	adcs	%[acc], %[acc], r2\n"
+			"	adcs	%[acc], %[acc], r3\n"
+			"	adcs	%[acc], %[acc], r4\n"
+			"	adcs	%[acc], %[acc], r5\n"
+			"	sub		%[n], %[n], #1\n"
+			"	teq		%[n], #0\n"
+			"	bne		1b\n"
+			"	adcs	%[acc], %[acc], #0\n"
+			"	adc		%[acc], %[acc], #0\n"
+			: [acc] "+r" (acc), [d] "+r" (d), [s] "+r" (s), [n] "+r" (ulBlocks)
+			:
+			: "r2", "r3", "r4", "r5", "cc", "memory");
+
+	*pd = d;
+	*ps = s;
+#else
+	u32_t *d = *pd;
+	const u8_t *s = *ps;
+	u32_t w;
+
+	while (ulBlocks--)
+	{
+		memcpy(d, s, 16);
+		w = d[0]; CHKSUM_ADD(acc, w);
+		w = d[1]; CHKSUM_ADD(acc, w);
+		w = d[2]; CHKSUM_ADD(acc, w);
+		w = d[3]; CHKSUM_ADD(acc, w);
+		d += 4;
+		s += 16;
+	}
+
+	*pd = d;
+	*ps = s;
+#endif
+
+	return acc;
+}
+
+/*-----------------------------------------------------------------------------------*/
+//  Checksum of len bytes at dataptr, the same value as lwip_standard_chksum().
+u16_t
+lm3s_chksum(void *dataptr, u16_t len)
+{
+	const u8_t *pb = (const u8_t *) dataptr;
+	const u32_t *pw;
+	u32_t acc = 0;
+	u32_t w;
+	int odd;
+
+	//
+	// an odd start is summed one byte shifted and swapped at the end
+	//
+	odd = ((mem_ptr_t) pb & 1);
+	if (odd && len > 0)
+	{
+		acc = (u32_t) *pb++ << 8;
+		len--;
+	}
+
+	if (((mem_ptr_t) pb & 2) && len >= 2)
+	{
+		acc += *(const u16_t *) pb;
+		pb += 2;
+		len -= 2;
+	}
+
+	pw = (const u32_t *) pb;
+	if (len >= 16)
+	{
+		acc = chksum_blocks(&pw, len >> 4, acc);
+		len &= 15;
+	}
+	while (len >= 4)
+	{
+		w = *pw++;
+		CHKSUM_ADD(acc, w);
+		len -= 4;
+	}
+
+	pb = (const u8_t *) pw;
+	if (len >= 2)
+	{
+		w = *(const u16_t *) pb;
+		CHKSUM_ADD(acc, w);
+		pb += 2;
+		len -= 2;
+	}
+	if (len > 0)
+	{
+		w = *pb;
+		CHKSUM_ADD(acc, w);
+	}
+
+	CHKSUM_FOLD(acc);
+	if (odd)
+	{
+		acc = CHKSUM_SWAP(acc);
+	}
+
+	return (u16_t) acc;
+}
+
+/*-----------------------------------------------------------------------------------*/
+//  Copies len bytes from src to dst and returns the checksum of them, the
+//  same value as lm3s_chksum(dst, len) after the copy. The words are aligned
+//  to dst, src may have any alignment.
+u16_t
+lm3s_chksum_copy(void *dst, const void *src, u16_t len)
+{
+	u8_t *pd = (u8_t *) dst;
+	const u8_t *ps = (const u8_t *) src;
+	u32_t *pw;
+	u32_t acc = 0;
+	u32_t w;
+	u16_t h;
+	int odd;
+
+	odd = ((mem_ptr_t) pd & 1);
+	if (odd && len > 0)
+	{
+		*pd++ = *ps;
+		acc = (u32_t) *ps++ << 8;
+		len--;
+	}
+
+	if (((mem_ptr_t) pd & 2) && len >= 2)
+	{
+		memcpy(&h, ps, 2);
+		*(u16_t *) pd = h;
+		acc += h;
+		pd += 2;
+		ps += 2;
+		len -= 2;
+	}
+
+	pw = (u32_t *) pd;
+	if (len >= 16)
+	{
+		acc = chksum_copy_blocks(&pw, &ps, len >> 4, acc);
+		len &= 15;
+	}
+	while (len >= 4)
+	{
+		memcpy(&w, ps, 4);
+		*pw++ = w;
+		CHKSUM_ADD(acc, w);
+		ps += 4;
+		len -= 4;
+	}
+
+	pd = (u8_t *) pw;
+	if (len >= 2)
+	{
+		memcpy(&h, ps, 2);
+		*(u16_t *) pd = h;
+		w = h;
+		CHKSUM_ADD(acc, w);
+		pd += 2;
+		ps += 2;
+		len -= 2;
+	}
+	if (len > 0)
+	{
+		*pd = *ps;
+		w = *ps;
+		CHKSUM_ADD(acc, w);
+	}
+
+	CHKSUM_FOLD(acc);
+	if (odd)
+	{
+		acc = CHKSUM_SWAP(acc);
+	}
+
+	return (u16_t) acc;
+}
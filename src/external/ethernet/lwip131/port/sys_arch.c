@@ -304,6 +304,42 @@ void sys_sem_free(sys_sem_t sem)
 	vQueueDelete( sem );
 }
 
+/*-----------------------------------------------------------------------------------*/
+//  Creates a mutex (LOCK_TCPIP_CORE). Unlike a binary semaphore it has an
+//  owner: a low priority task holding the lwIP core is raised to the
+//  priority of tcpip_thread while tcpip_thread waits for it.
+sys_mutex_t sys_mutex_new(void)
+{
+	xSemaphoreHandle xMutex;
+
+	xMutex = xSemaphoreCreateMutex();
+
+	if( xMutex == NULL )
+	{
+#if SYS_STATS
+		++lwip_stats.sys.sem.err;
+#endif /* SYS_STATS */
+		return SYS_MUTEX_NULL;
+	}
+
+	return xMutex;
+}
+
+/*-----------------------------------------------------------------------------------*/
+//  Takes a mutex, blocks without a timeout. Timeouts are not processed while
+//  waiting (sys_sem_wait() would call them without the lock).
+void sys_mutex_lock(sys_mutex_t mutex)
+{
+	while( xSemaphoreTake( mutex, portMAX_DELAY ) != pdTRUE ){}
+}
+
+/*-----------------------------------------------------------------------------------*/
+//  Gives a mutex back, only the task holding it may do so.
+void sys_mutex_unlock(sys_mutex_t mutex)
+{
+	xSemaphoreGive( mutex );
+}
+
 /*-----------------------------------------------------------------------------------*/
 // Initialize sys arch
 void sys_init(void)
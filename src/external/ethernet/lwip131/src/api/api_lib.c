@@ -111,7 +111,7 @@ netconn_delete(struct netconn *conn)
 
   msg.function = do_delconn;
   msg.msg.conn = conn;
-  tcpip_apimsg(&msg);
+  TCPIP_APIMSG_WAIT(&msg);
 
   conn->pcb.tcp = NULL;
   netconn_free(conn);
@@ -193,7 +193,10 @@ netconn_connect(struct netconn *conn, struct ip_addr *addr, u16_t port)
   msg.msg.conn = conn;
   msg.msg.msg.bc.ipaddr = addr;
   msg.msg.msg.bc.port = port;
-  /* This is the only function which need to not block tcpip_thread */
+  /* This is the only function which need to not block tcpip_thread.
+     It always runs in tcpip_thread, also with LWIP_TCPIP_CORE_LOCKING:
+     tcp_connect() may start the TCP timer, and sys_timeout() only keeps
+     timeouts for threads created by lwIP. */
   tcpip_apimsg(&msg);
   return conn->err;
 }
@@ -480,7 +483,7 @@ netconn_close(struct netconn *conn)
 
   msg.function = do_close;
   msg.msg.conn = conn;
-  tcpip_apimsg(&msg);
+  TCPIP_APIMSG_WAIT(&msg);
   return conn->err;
 }
 
@@ -802,7 +802,12 @@ do_connect(struct api_msg_msg *msg)
     setup_tcp(msg->conn);
     msg->conn->err = tcp_connect(msg->conn->pcb.tcp, msg->msg.bc.ipaddr, msg->msg.bc.port,
                                  do_connected);
-    /* sys_sem_signal() is called from do_connected (or err_tcp()),
+    if (msg->conn->err != ERR_OK) {
+      /* no SYN sent, do_connected won't be called */
+      msg->conn->state = NETCONN_NONE;
+      sys_sem_signal(msg->conn->op_completed);
+    }
+    /* otherwise sys_sem_signal() is called from do_connected (or err_tcp()),
      * when the connection is established! */
     break;
 #endif /* LWIP_TCP */
@@ -1149,7 +1154,8 @@ do_close(struct api_msg_msg *msg)
 #endif /* LWIP_TCP */
   {
     msg->conn->err = ERR_VAL;
-    TCPIP_APIMSG_ACK(msg);
+    /* called by TCPIP_APIMSG_WAIT, so signal also with LWIP_TCPIP_CORE_LOCKING */
+    sys_sem_signal(msg->conn->op_completed);
   }
 }
 
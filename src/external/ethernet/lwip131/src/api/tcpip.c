@@ -62,8 +62,8 @@ static void *tcpip_init_done_arg;
 static sys_mbox_t mbox = SYS_MBOX_NULL;
 
 #if LWIP_TCPIP_CORE_LOCKING
-/** The global semaphore to lock the stack. */
-sys_sem_t lock_tcpip_core;
+/** The global mutex to lock the stack. */
+sys_mutex_t lock_tcpip_core;
 #endif /* LWIP_TCPIP_CORE_LOCKING */
 
 #if LWIP_TCP
@@ -481,6 +481,25 @@ tcpip_apimsg_lock(struct api_msg *apimsg)
   return ERR_OK;
 
 }
+
+/**
+ * Call the lower part of a netconn_* function which signals op_completed
+ * itself, maybe later from a callback of tcpip_thread (do_connect, do_close,
+ * do_delconn). The core is unlocked while waiting, so tcpip_thread can
+ * finish the operation.
+ *
+ * @param apimsg a struct containing the function to call and its parameters
+ * @return ERR_OK (only for compatibility fo tcpip_apimsg())
+ */
+err_t
+tcpip_apimsg_lock_wait(struct api_msg *apimsg)
+{
+  LOCK_TCPIP_CORE();
+  apimsg->function(&(apimsg->msg));
+  UNLOCK_TCPIP_CORE();
+  sys_arch_sem_wait(apimsg->msg.conn->op_completed, 0);
+  return ERR_OK;
+}
 #endif /* LWIP_TCPIP_CORE_LOCKING */
 #endif /* LWIP_NETCONN */
 
@@ -551,7 +570,7 @@ tcpip_init(void (* initfunc)(void *), void *arg)
   tcpip_init_done_arg = arg;
   mbox = sys_mbox_new(TCPIP_MBOX_SIZE);
 #if LWIP_TCPIP_CORE_LOCKING
-  lock_tcpip_core = sys_sem_new(1);
+  lock_tcpip_core = sys_mutex_new();
 #endif /* LWIP_TCPIP_CORE_LOCKING */
 
   sys_thread_new(TCPIP_THREAD_NAME, tcpip_thread, NULL, TCPIP_THREAD_STACKSIZE, TCPIP_THREAD_PRIO);
@@ -108,6 +108,7 @@ static void dhcp_handle_offer(struct netif *netif);
 
 static err_t dhcp_discover(struct netif *netif);
 static err_t dhcp_select(struct netif *netif);
+static err_t dhcp_reboot(struct netif *netif);
 static void dhcp_check(struct netif *netif);
 static void dhcp_bind(struct netif *netif);
 #if DHCP_DOES_ARP_CHECK
@@ -384,6 +385,14 @@ dhcp_timeout(struct netif *netif)
   if ((dhcp->state == DHCP_BACKING_OFF) || (dhcp->state == DHCP_SELECTING)) {
     LWIP_DEBUGF(DHCP_DEBUG | LWIP_DBG_TRACE, ("dhcp_timeout(): restarting discovery\n"));
     dhcp_discover(netif);
+  /* nobody confirmed the previous lease, retry, then fall back to discovery */
+  } else if (dhcp->state == DHCP_REBOOTING) {
+    LWIP_DEBUGF(DHCP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, ("dhcp_timeout(): REBOOTING, DHCP request timed out\n"));
+    if (dhcp->tries < DHCP_REBOOT_TRIES) {
+      dhcp_reboot(netif);
+    } else {
+      dhcp_discover(netif);
+    }
   /* receiving the requested lease timed out */
   } else if (dhcp->state == DHCP_REQUESTING) {
     LWIP_DEBUGF(DHCP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, ("dhcp_timeout(): REQUESTING, DHCP request timed out\n"));
@@ -571,6 +580,25 @@ dhcp_handle_ack(struct netif *netif)
  */
 err_t
 dhcp_start(struct netif *netif)
+{
+  return dhcp_start_reboot(netif, NULL);
+}
+
+/**
+ * Start DHCP negotiation for a network interface, asking to keep
+ * a previously bound address.
+ *
+ * The address is requested in INIT-REBOOT state (RFC 2131, 3.2), which
+ * needs a single REQUEST/ACK exchange instead of DISCOVER, OFFER, REQUEST
+ * and ACK. If the server answers with a NAK or does not answer at all,
+ * a normal discovery is started.
+ *
+ * @param netif The lwIP network interface
+ * @param ipaddr The previous address, NULL or IP_ADDR_ANY to discover
+ * @return lwIP error code, see dhcp_start()
+ */
+err_t
+dhcp_start_reboot(struct netif *netif, struct ip_addr *ipaddr)
 {
   struct dhcp *dhcp;
   err_t result = ERR_OK;
@@ -630,7 +658,12 @@ dhcp_start(struct netif *netif)
   udp_recv(dhcp->pcb, dhcp_recv, netif);
   LWIP_DEBUGF(DHCP_DEBUG | LWIP_DBG_TRACE, ("dhcp_start(): starting DHCP configuration\n"));
   /* (re)start the DHCP negotiation */
-  result = dhcp_discover(netif);
+  if ((ipaddr != NULL) && !ip_addr_isany(ipaddr)) {
+    ip_addr_set(&dhcp->offered_ip_addr, ipaddr);
+    result = dhcp_reboot(netif);
+  } else {
+    result = dhcp_discover(netif);
+  }
   if (result != ERR_OK) {
     /* free resources allocated above */
     dhcp_stop(netif);
@@ -778,6 +811,60 @@ dhcp_decline(struct netif *netif)
 #endif
 
 
+/**
+ * Ask for the address in dhcp->offered_ip_addr again (INIT-REBOOT).
+ *
+ * The REQUEST carries no server identifier, any server which knows
+ * the lease answers with an ACK or a NAK.
+ *
+ * @param netif the netif under DHCP control
+ * @return lwIP specific error (see error.h)
+ */
+static err_t
+dhcp_reboot(struct netif *netif)
+{
+  struct dhcp *dhcp = netif->dhcp;
+  err_t result;
+  u16_t msecs;
+  LWIP_DEBUGF(DHCP_DEBUG | LWIP_DBG_TRACE | 3, ("dhcp_reboot()\n"));
+  dhcp_set_state(dhcp, DHCP_REBOOTING);
+
+  /* create and initialize the DHCP message header */
+  result = dhcp_create_request(netif);
+  if (result == ERR_OK) {
+    dhcp_option(dhcp, DHCP_OPTION_MESSAGE_TYPE, DHCP_OPTION_MESSAGE_TYPE_LEN);
+    dhcp_option_byte(dhcp, DHCP_REQUEST);
+
+    dhcp_option(dhcp, DHCP_OPTION_MAX_MSG_SIZE, DHCP_OPTION_MAX_MSG_SIZE_LEN);
+    dhcp_option_short(dhcp, DHCP_MAX_MSG_LEN(netif));
+
+    dhcp_option(dhcp, DHCP_OPTION_REQUESTED_IP, 4);
+    dhcp_option_long(dhcp, ntohl(dhcp->offered_ip_addr.addr));
+
+    dhcp_option(dhcp, DHCP_OPTION_PARAMETER_REQUEST_LIST, 4/*num options*/);
+    dhcp_option_byte(dhcp, DHCP_OPTION_SUBNET_MASK);
+    dhcp_option_byte(dhcp, DHCP_OPTION_ROUTER);
+    dhcp_option_byte(dhcp, DHCP_OPTION_BROADCAST);
+    dhcp_option_byte(dhcp, DHCP_OPTION_DNS_SERVER);
+
+    dhcp_option_trailer(dhcp);
+    /* shrink the pbuf to the actual content length */
+    pbuf_realloc(dhcp->p_out, sizeof(struct dhcp_msg) - DHCP_OPTIONS_LEN + dhcp->options_out_len);
+
+    /* broadcast to any DHCP server, we do not have an address yet */
+    udp_sendto_if(dhcp->pcb, dhcp->p_out, IP_ADDR_BROADCAST, DHCP_SERVER_PORT, netif);
+    dhcp_delete_request(netif);
+    LWIP_DEBUGF(DHCP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, ("dhcp_reboot: REBOOTING\n"));
+  } else {
+    LWIP_DEBUGF(DHCP_DEBUG | LWIP_DBG_TRACE | 2, ("dhcp_reboot: could not allocate DHCP request\n"));
+  }
+  dhcp->tries++;
+  msecs = dhcp->tries < 10 ? dhcp->tries * 1000 : 10 * 1000;
+  dhcp->request_timeout = (msecs + DHCP_FINE_TIMER_MSECS - 1) / DHCP_FINE_TIMER_MSECS;
+  LWIP_DEBUGF(DHCP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, ("dhcp_reboot(): set request timeout %"U16_F" msecs\n", msecs));
+  return result;
+}
+
 /**
  * Start the DHCP process, discover a DHCP server.
  *
@@ -1334,8 +1421,8 @@ static void dhcp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, struct ip_
   /* message type is DHCP ACK? */
   if (msg_type == DHCP_ACK) {
     LWIP_DEBUGF(DHCP_DEBUG | LWIP_DBG_TRACE | 1, ("DHCP_ACK received\n"));
-    /* in requesting state? */
-    if (dhcp->state == DHCP_REQUESTING) {
+    /* in requesting or rebooting state? */
+    if ((dhcp->state == DHCP_REQUESTING) || (dhcp->state == DHCP_REBOOTING)) {
       dhcp_handle_ack(netif);
       dhcp->request_timeout = 0;
 #if DHCP_DOES_ARP_CHECK
@@ -1347,7 +1434,7 @@ static void dhcp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, struct ip_
 #endif
     }
     /* already bound to the given lease address? */
-    else if ((dhcp->state == DHCP_REBOOTING) || (dhcp->state == DHCP_REBINDING) || (dhcp->state == DHCP_RENEWING)) {
+    else if ((dhcp->state == DHCP_REBINDING) || (dhcp->state == DHCP_RENEWING)) {
       dhcp->request_timeout = 0;
       dhcp_bind(netif);
     }
@@ -336,8 +336,9 @@ inet_chksum_pseudo(struct pbuf *p,
  * @param proto_len length of the ip data part (used for checksum of pseudo header)
  * @return checksum (as u16_t) to be saved directly in the protocol header
  */
-/* Currently only used by UDPLITE, although this could change in the future. */
-#if LWIP_UDPLITE
+/* Used by UDPLITE and by TCP for the header of segments whose data sum is
+ * known (TCP_CHECKSUM_ON_COPY). */
+#if LWIP_UDPLITE || TCP_CHECKSUM_ON_COPY
 u16_t
 inet_chksum_pseudo_partial(struct pbuf *p,
        struct ip_addr *src, struct ip_addr *dest,
@@ -364,7 +365,8 @@ inet_chksum_pseudo_partial(struct pbuf *p,
     /*LWIP_DEBUGF(INET_DEBUG, ("inet_chksum_pseudo(): unwrapped lwip_chksum()=%"X32_F" \n", acc));*/
     /* fold the upper bit down */
     acc = FOLD_U32T(acc);
-    if (q->len % 2 != 0) {
+    /* only the summed part counts, the pbuf may go on behind chksum_len */
+    if (chklen % 2 != 0) {
       swapped = 1 - swapped;
       acc = SWAP_BYTES_IN_WORD(acc);
     }
@@ -388,7 +390,7 @@ inet_chksum_pseudo_partial(struct pbuf *p,
   LWIP_DEBUGF(INET_DEBUG, ("inet_chksum_pseudo(): pbuf chain lwip_chksum()=%"X32_F"\n", acc));
   return (u16_t)~(acc & 0xffffUL);
 }
-#endif /* LWIP_UDPLITE */
+#endif /* LWIP_UDPLITE || TCP_CHECKSUM_ON_COPY */
 
 /* inet_chksum:
  *
@@ -74,6 +74,10 @@ struct tcp_pcb *tcp_tw_pcbs;
 
 struct tcp_pcb *tcp_tmp_pcb;
 
+#if TCP_KILL_STATS
+struct tcp_kill_stats tcp_kill_stats;
+#endif /* TCP_KILL_STATS */
+
 static u8_t tcp_timer;
 static u16_t tcp_new_port(void);
 
@@ -942,10 +946,48 @@ tcp_kill_prio(u8_t prio)
   if (inactive != NULL) {
     LWIP_DEBUGF(TCP_DEBUG, ("tcp_kill_prio: killing oldest PCB %p (%"S32_F")\n",
            (void *)inactive, inactivity));
+    TCP_KILL_STATS_INC(active);
     tcp_abort(inactive);
   }      
 }
 
+/**
+ * Kills the oldest connection that is in a specific state.
+ * Called from tcp_alloc() for LAST_ACK and CLOSING if no more connections are
+ * available: the application has closed them already, so no data is lost
+ * (backport of lwIP 1.4/2.0).
+ *
+ * @param state LAST_ACK or CLOSING
+ */
+static void
+tcp_kill_state(enum tcp_state state)
+{
+  struct tcp_pcb *pcb, *inactive;
+  u32_t inactivity;
+
+  LWIP_ASSERT("invalid state", (state == CLOSING) || (state == LAST_ACK));
+
+  inactivity = 0;
+  inactive = NULL;
+  /* Go through the list of active pcbs and get the oldest pcb that is in state
+     CLOSING/LAST_ACK. */
+  for(pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
+    if (pcb->state == state) {
+      if ((u32_t)(tcp_ticks - pcb->tmr) >= inactivity) {
+        inactivity = tcp_ticks - pcb->tmr;
+        inactive = pcb;
+      }
+    }
+  }
+  if (inactive != NULL) {
+    LWIP_DEBUGF(TCP_DEBUG, ("tcp_kill_state: killing oldest PCB %p in state %d (%"S32_F")\n",
+           (void *)inactive, (int)state, inactivity));
+    TCP_KILL_STATS_INC(closing);
+    /* Don't send a RST, since no data is lost. */
+    tcp_abandon(inactive, 0);
+  }
+}
+
 /**
  * Kills the oldest connection that is in TIME_WAIT state.
  * Called from tcp_alloc() if no more connections are available.
@@ -968,6 +1010,7 @@ tcp_kill_timewait(void)
   if (inactive != NULL) {
     LWIP_DEBUGF(TCP_DEBUG, ("tcp_kill_timewait: killing oldest TIME-WAIT PCB %p (%"S32_F")\n",
            (void *)inactive, inactivity));
+    TCP_KILL_STATS_INC(timewait);
     tcp_abort(inactive);
   }      
 }
@@ -992,10 +1035,22 @@ tcp_alloc(u8_t prio)
     /* Try to allocate a tcp_pcb again. */
     pcb = memp_malloc(MEMP_TCP_PCB);
     if (pcb == NULL) {
-      /* Try killing active connections with lower priority than the new one. */
-      tcp_kill_prio(prio);
+      /* Try killing oldest connection in LAST-ACK (these wouldn't go to TIME-WAIT). */
+      tcp_kill_state(LAST_ACK);
       /* Try to allocate a tcp_pcb again. */
       pcb = memp_malloc(MEMP_TCP_PCB);
+      if (pcb == NULL) {
+        /* Try killing oldest connection in CLOSING. */
+        tcp_kill_state(CLOSING);
+        /* Try to allocate a tcp_pcb again. */
+        pcb = memp_malloc(MEMP_TCP_PCB);
+        if (pcb == NULL) {
+          /* Try killing active connections with lower priority than the new one. */
+          tcp_kill_prio(prio);
+          /* Try to allocate a tcp_pcb again. */
+          pcb = memp_malloc(MEMP_TCP_PCB);
+        }
+      }
     }
   }
   if (pcb != NULL) {
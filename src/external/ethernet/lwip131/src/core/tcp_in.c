@@ -419,6 +419,7 @@ tcp_listen_input(struct tcp_pcb_listen *pcb)
     if (npcb == NULL) {
       LWIP_DEBUGF(TCP_DEBUG, ("tcp_listen_input: could not allocate PCB\n"));
       TCP_STATS_INC(tcp.memerr);
+      TCP_KILL_STATS_INC(refused);
       return ERR_MEM;
     }
 #if TCP_LISTEN_BACKLOG
@@ -59,6 +59,35 @@
 /* Forward declarations.*/
 static void tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb);
 
+#if TCP_CHECKSUM_ON_COPY
+#ifndef LWIP_CHKSUM_COPY
+#error "TCP_CHECKSUM_ON_COPY needs LWIP_CHKSUM_COPY(dst, src, len) in arch/cc.h"
+#endif
+
+/**
+ * Adds the data sum of a segment to the data sum of the segment it is
+ * appended to. Data starting at an odd offset has its bytes swapped in the
+ * 16-bit words of the sum.
+ *
+ * @param sum data sum of the first segment
+ * @param chksum data sum of the appended segment
+ * @param offset length of the data of the first segment
+ * @return data sum of both
+ */
+static u16_t
+tcp_seg_add_chksum(u16_t sum, u16_t chksum, u16_t offset)
+{
+  u32_t acc;
+
+  if (offset & 1) {
+    chksum = (u16_t)(((chksum & 0xff) << 8) | ((chksum & 0xff00) >> 8));
+  }
+  acc = (u32_t)sum + chksum;
+  acc = (acc >> 16) + (acc & 0x0000ffffUL);
+  return (u16_t)acc;
+}
+#endif /* TCP_CHECKSUM_ON_COPY */
+
 static struct tcp_hdr *
 tcp_output_set_header(struct tcp_pcb *pcb, struct pbuf *p, int optlen,
                       u32_t seqno_be /* already in network byte order */)
@@ -162,6 +191,9 @@ tcp_enqueue(struct tcp_pcb *pcb, void *arg, u16_t len,
   void *ptr;
   u16_t queuelen;
   u8_t optlen;
+#if TCP_CHECKSUM_ON_COPY
+  u16_t chksum;
+#endif /* TCP_CHECKSUM_ON_COPY */
 
   LWIP_DEBUGF(TCP_OUTPUT_DEBUG, 
               ("tcp_enqueue(pcb=%p, arg=%p, len=%"U16_F", flags=%"X16_F", apiflags=%"U16_F")\n",
@@ -250,9 +282,17 @@ tcp_enqueue(struct tcp_pcb *pcb, void *arg, u16_t len,
       LWIP_ASSERT("check that first pbuf can hold the complete seglen",
                   (seg->p->len >= seglen + optlen));
       queuelen += pbuf_clen(seg->p);
+#if TCP_CHECKSUM_ON_COPY
+      /* the checksum of the data falls out of the copy */
+      chksum = 0;
+      if (arg != NULL) {
+        chksum = LWIP_CHKSUM_COPY((char *)seg->p->payload + optlen, ptr, seglen);
+      }
+#else /* TCP_CHECKSUM_ON_COPY */
       if (arg != NULL) {
         MEMCPY((char *)seg->p->payload + optlen, ptr, seglen);
       }
+#endif /* TCP_CHECKSUM_ON_COPY */
       seg->dataptr = seg->p->payload;
     }
     /* do not copy data */
@@ -314,6 +354,12 @@ tcp_enqueue(struct tcp_pcb *pcb, void *arg, u16_t len,
     /* don't fill in tcphdr->ackno and tcphdr->wnd until later */
 
     seg->flags = optflags;
+#if TCP_CHECKSUM_ON_COPY
+    if (apiflags & TCP_WRITE_FLAG_COPY) {
+      seg->chksum = chksum;
+      seg->flags |= TF_SEG_DATA_CHECKSUMMED;
+    }
+#endif /* TCP_CHECKSUM_ON_COPY */
 
     /* Set the length of the header */
     TCPH_HDRLEN_SET(seg->tcphdr, (5 + optlen / 4));
@@ -347,7 +393,8 @@ tcp_enqueue(struct tcp_pcb *pcb, void *arg, u16_t len,
     /* fit within max seg size */
     (useg->len + queue->len <= pcb->mss) &&
     /* only concatenate segments with the same options */
-    (useg->flags == queue->flags)) {
+    ((useg->flags & ~TF_SEG_DATA_CHECKSUMMED) ==
+     (queue->flags & ~TF_SEG_DATA_CHECKSUMMED))) {
     /* Remove TCP header from first segment of our to-be-queued list */
     if(pbuf_header(queue->p, -(TCP_HLEN + optlen))) {
       /* Can we cope with this failing?  Just assert for now */
@@ -365,6 +412,14 @@ tcp_enqueue(struct tcp_pcb *pcb, void *arg, u16_t len,
     }
     LWIP_ASSERT("zero-length pbuf", (queue->p != NULL) && (queue->p->len > 0));
     pbuf_cat(useg->p, queue->p);
+#if TCP_CHECKSUM_ON_COPY
+    /* the data sum stays valid only if both parts have one */
+    if (useg->flags & queue->flags & TF_SEG_DATA_CHECKSUMMED) {
+      useg->chksum = tcp_seg_add_chksum(useg->chksum, queue->chksum, useg->len);
+    } else {
+      useg->flags &= ~TF_SEG_DATA_CHECKSUMMED;
+    }
+#endif /* TCP_CHECKSUM_ON_COPY */
     useg->len += queue->len;
     useg->next = queue->next;
 
@@ -707,6 +762,23 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb)
 
   seg->tcphdr->chksum = 0;
 #if CHECKSUM_GEN_TCP
+#if TCP_CHECKSUM_ON_COPY
+  if (seg->flags & TF_SEG_DATA_CHECKSUMMED) {
+    u32_t acc;
+
+    /* only the header and options are summed here, the data sum was
+       calculated by tcp_enqueue() while copying */
+    acc = inet_chksum_pseudo_partial(seg->p,
+             &(pcb->local_ip),
+             &(pcb->remote_ip),
+             IP_PROTO_TCP, seg->p->tot_len, TCPH_HDRLEN(seg->tcphdr) * 4);
+    acc = (u16_t)~acc;
+    acc += seg->chksum;
+    acc = (acc >> 16) + (acc & 0x0000ffffUL);
+    acc = (acc >> 16) + (acc & 0x0000ffffUL);
+    seg->tcphdr->chksum = (u16_t)~acc;
+  } else
+#endif /* TCP_CHECKSUM_ON_COPY */
   seg->tcphdr->chksum = inet_chksum_pseudo(seg->p,
              &(pcb->local_ip),
              &(pcb->remote_ip),
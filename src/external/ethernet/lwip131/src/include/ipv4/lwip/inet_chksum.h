@@ -46,7 +46,7 @@ u16_t inet_chksum_pbuf(struct pbuf *p);
 u16_t inet_chksum_pseudo(struct pbuf *p,
        struct ip_addr *src, struct ip_addr *dest,
        u8_t proto, u16_t proto_len);
-#if LWIP_UDPLITE
+#if LWIP_UDPLITE || TCP_CHECKSUM_ON_COPY
 u16_t inet_chksum_pseudo_partial(struct pbuf *p,
        struct ip_addr *src, struct ip_addr *dest,
        u8_t proto, u16_t proto_len, u16_t chksum_len);
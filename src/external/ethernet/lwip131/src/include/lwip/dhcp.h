@@ -21,6 +21,8 @@ extern "C" {
 #define DHCP_COARSE_TIMER_MSECS (DHCP_COARSE_TIMER_SECS * 1000UL)
 /** period (in milliseconds) of the application calling dhcp_fine_tmr() */
 #define DHCP_FINE_TIMER_MSECS 500 
+/** number of INIT-REBOOT requests before falling back to discovery */
+#define DHCP_REBOOT_TRIES 2
 
 struct dhcp
 {
@@ -116,6 +118,8 @@ PACK_STRUCT_END
 
 /** start DHCP configuration */
 err_t dhcp_start(struct netif *netif);
+/** start DHCP configuration, confirm a previous lease first (INIT-REBOOT) */
+err_t dhcp_start_reboot(struct netif *netif, struct ip_addr *ipaddr);
 /** enforce early lease renewal (not needed normally)*/
 err_t dhcp_renew(struct netif *netif);
 /** release the DHCP lease, usually called before dhcp_stop()*/
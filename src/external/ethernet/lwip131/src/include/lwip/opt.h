@@ -885,6 +885,15 @@
 #define PBUF_POOL_BUFSIZE               LWIP_MEM_ALIGN_SIZE(TCP_MSS+40+PBUF_LINK_HLEN)
 #endif
 
+/**
+ * LWIP_SUPPORT_CUSTOM_PBUF==1: Support pbufs whose memory belongs to the
+ * netif driver (struct pbuf_custom, pbuf_alloced_custom()). pbuf_free()
+ * hands them back to the driver's free function.
+ */
+#ifndef LWIP_SUPPORT_CUSTOM_PBUF
+#define LWIP_SUPPORT_CUSTOM_PBUF        0
+#endif
+
 /*
    ------------------------------------------------
    ---------- Network Interfaces options ----------
@@ -1356,6 +1365,16 @@
 
 #endif /* LWIP_STATS */
 
+/**
+ * TCP_KILL_STATS==1: Count the pcbs tcp_alloc() takes from other connections
+ * when the pool is empty (TIME_WAIT, LAST_ACK/CLOSING, active) and the SYNs
+ * dropped because there was none (struct tcp_kill_stats, tcp.h). Works
+ * without LWIP_STATS.
+ */
+#ifndef TCP_KILL_STATS
+#define TCP_KILL_STATS                  0
+#endif
+
 /*
    ---------------------------------
    ---------- PPP options ----------
@@ -1564,6 +1583,16 @@
 #define CHECKSUM_CHECK_TCP              1
 #endif
 
+/**
+ * TCP_CHECKSUM_ON_COPY==1: Calculate the checksum of the data while it is
+ * copied into a segment (TCP_WRITE_FLAG_COPY), tcp_output_segment() then
+ * only sums up the header. Needs LWIP_CHKSUM_COPY(dst, src, len) in
+ * arch/cc.h, returning the same value as LWIP_CHKSUM(dst, len).
+ */
+#ifndef TCP_CHECKSUM_ON_COPY
+#define TCP_CHECKSUM_ON_COPY            0
+#endif
+
 /*
    ---------------------------------------
    ---------- Debugging options ----------
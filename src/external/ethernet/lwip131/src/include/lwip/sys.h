@@ -114,6 +114,13 @@ void sys_sem_free(sys_sem_t sem);
 void sys_sem_wait(sys_sem_t sem);
 int sys_sem_wait_timeout(sys_sem_t sem, u32_t timeout);
 
+#if LWIP_TCPIP_CORE_LOCKING
+/* Mutex functions (only needed for LOCK_TCPIP_CORE). */
+sys_mutex_t sys_mutex_new(void);
+void sys_mutex_lock(sys_mutex_t mutex);
+void sys_mutex_unlock(sys_mutex_t mutex);
+#endif /* LWIP_TCPIP_CORE_LOCKING */
+
 /* Time functions. */
 #ifndef sys_msleep
 void sys_msleep(u32_t ms); /* only has a (close to) 1 jiffy resolution. */
@@ -526,7 +526,11 @@ struct tcp_seg {
   u8_t  flags;
 #define TF_SEG_OPTS_MSS   (u8_t)0x01U   /* Include MSS option. */
 #define TF_SEG_OPTS_TS    (u8_t)0x02U   /* Include timestamp option. */
+#define TF_SEG_DATA_CHECKSUMMED (u8_t)0x04U /* chksum holds the sum of the data */
   struct tcp_hdr *tcphdr;  /* the TCP header */
+#if TCP_CHECKSUM_ON_COPY
+  u16_t chksum;            /* LWIP_CHKSUM of the data, if TF_SEG_DATA_CHECKSUMMED */
+#endif /* TCP_CHECKSUM_ON_COPY */
 };
 
 #define LWIP_TCP_OPT_LENGTH(flags)              \
@@ -619,6 +623,20 @@ extern struct tcp_pcb *tcp_active_pcbs;  /* List of all TCP PCBs that are in a
               data. */
 extern struct tcp_pcb *tcp_tw_pcbs;      /* List of all TCP PCBs in TIME-WAIT. */
 
+#if TCP_KILL_STATS
+/** pcbs taken from other connections by tcp_alloc() */
+struct tcp_kill_stats {
+  u32_t timewait; /* oldest TIME_WAIT pcb recycled */
+  u32_t closing;  /* oldest LAST_ACK or CLOSING pcb dropped */
+  u32_t active;   /* oldest active pcb aborted (tcp_kill_prio()) */
+  u32_t refused;  /* SYN dropped by tcp_listen_input(), no pcb left */
+};
+extern struct tcp_kill_stats tcp_kill_stats;
+#define TCP_KILL_STATS_INC(x) (++tcp_kill_stats.x)
+#else
+#define TCP_KILL_STATS_INC(x)
+#endif /* TCP_KILL_STATS */
+
 extern struct tcp_pcb *tcp_tmp_pcb;      /* Only used for temporary storage. */
 
 /* Axioms about the above lists:   
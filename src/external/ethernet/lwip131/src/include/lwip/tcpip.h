@@ -48,11 +48,12 @@ extern "C" {
 #endif
 
 #if LWIP_TCPIP_CORE_LOCKING
-/** The global semaphore to lock the stack. */
-extern sys_sem_t lock_tcpip_core;
-#define LOCK_TCPIP_CORE()     sys_sem_wait(lock_tcpip_core)
-#define UNLOCK_TCPIP_CORE()   sys_sem_signal(lock_tcpip_core)
+/** The global mutex to lock the stack. */
+extern sys_mutex_t lock_tcpip_core;
+#define LOCK_TCPIP_CORE()     sys_mutex_lock(lock_tcpip_core)
+#define UNLOCK_TCPIP_CORE()   sys_mutex_unlock(lock_tcpip_core)
 #define TCPIP_APIMSG(m)       tcpip_apimsg_lock(m)
+#define TCPIP_APIMSG_WAIT(m)  tcpip_apimsg_lock_wait(m)
 #define TCPIP_APIMSG_ACK(m)
 #define TCPIP_NETIFAPI(m)     tcpip_netifapi_lock(m)
 #define TCPIP_NETIFAPI_ACK(m)
@@ -60,6 +61,7 @@ extern sys_sem_t lock_tcpip_core;
 #define LOCK_TCPIP_CORE()
 #define UNLOCK_TCPIP_CORE()
 #define TCPIP_APIMSG(m)       tcpip_apimsg(m)
+#define TCPIP_APIMSG_WAIT(m)  tcpip_apimsg(m)
 #define TCPIP_APIMSG_ACK(m)   sys_sem_signal(m->conn->op_completed)
 #define TCPIP_NETIFAPI(m)     tcpip_netifapi(m)
 #define TCPIP_NETIFAPI_ACK(m) sys_sem_signal(m->sem)
@@ -71,6 +73,7 @@ void tcpip_init(void (* tcpip_init_done)(void *), void *arg);
 err_t tcpip_apimsg(struct api_msg *apimsg);
 #if LWIP_TCPIP_CORE_LOCKING
 err_t tcpip_apimsg_lock(struct api_msg *apimsg);
+err_t tcpip_apimsg_lock_wait(struct api_msg *apimsg);
 #endif /* LWIP_TCPIP_CORE_LOCKING */
 #endif /* LWIP_NETCONN */
 
@@ -0,0 +1,498 @@
+/**
+ * \addtogroup System
+ * @{
+ *
+ * \author Anziner, Hahn
+ * \brief Sector cache between FatFs and the SD Card driver
+ *
+ * Implements disk_read() and disk_write() for FatFs on top of the raw
+ * driver functions mmc_disk_read() and mmc_disk_write().
+ *
+ * Single sector reads are kept in a LRU pool. Sectors in front of the data
+ * area (FAT, root directory) are pinned, so the lookups of every f_open are
+ * served from RAM. Without _FS_TINY reads into the window of the file system
+ * object are pinned too, with _FS_TINY the window also carries file data.
+ * If a read continues the previous one, the following sectors are fetched
+ * with one CMD18 into the read-ahead window. Writes go to the card
+ * immediately, cached copies are updated.
+ *
+ */
+
+/* std lib includes */
+#include <string.h>
+
+#include "diskio.h"
+#include "diskcache.h"
+
+#include "ssiBus.h"
+#include "setup.h"
+
+#if DISK_CACHE_PINNED >= DISK_CACHE_SECTORS
+#error "DISK_CACHE_PINNED must be lower than DISK_CACHE_SECTORS"
+#endif
+
+/// slot contains a valid sector
+#define CACHE_VALID			0x01
+/// slot contains a FAT or directory sector
+#define CACHE_PINNED		0x02
+
+/** statistics, also kept if the cache is disabled */
+static tDiskCacheStats xCacheStats;
+
+/** called for every written sector */
+static tDiskWriteHook pfnWriteHook = NULL;
+
+/**
+ * Reports written sectors to the write hook
+ */
+static void vCacheNotifyWrite(DWORD sector, BYTE count)
+{
+	if (pfnWriteHook != NULL)
+	{
+		while (count--)
+		{
+			pfnWriteHook(sector++);
+		}
+	}
+}
+
+#if ENABLE_DISK_CACHE
+
+/** LRU pool */
+static BYTE ucCacheData[DISK_CACHE_SECTORS][512];
+static DWORD ulCacheSector[DISK_CACHE_SECTORS];
+static unsigned long ulCacheUsed[DISK_CACHE_SECTORS];
+static BYTE ucCacheFlags[DISK_CACHE_SECTORS];
+
+/** LRU clock */
+static unsigned long ulCacheClock = 0;
+
+/** number of pinned slots */
+static int iCachePinned = 0;
+
+/** read-ahead window, contiguous for the multi block read */
+static BYTE ucAheadData[DISK_CACHE_READAHEAD][512];
+static DWORD ulAheadBase = 0;
+static int iAheadCount = 0;
+
+/** sector following the last read, used to detect sequential reads */
+static DWORD ulCacheNext = 0xFFFFFFFF;
+
+/** registered file system */
+static FATFS *pxCacheFs = NULL;
+
+/**
+ * Checks if a read fetches a FAT or directory sector
+ */
+static int iCacheIsMeta(const BYTE *buff, DWORD sector)
+{
+	if (pxCacheFs == NULL)
+	{
+		return 0;
+	}
+
+	//
+	// FAT area and the root directory of FAT12/16
+	//
+	if (pxCacheFs->fs_type && sector < pxCacheFs->database)
+	{
+		return 1;
+	}
+
+#if !_FS_TINY
+	//
+	// without _FS_TINY the window only holds FAT and directory sectors
+	//
+	if (buff == pxCacheFs->win)
+	{
+		return 1;
+	}
+#endif
+
+	return 0;
+}
+
+/**
+ * Returns the slot of a sector in the LRU pool, -1 if not cached
+ */
+static int iCacheFind(DWORD sector)
+{
+	int i;
+
+	for (i = 0; i < DISK_CACHE_SECTORS; i++)
+	{
+		if ((ucCacheFlags[i] & CACHE_VALID) && ulCacheSector[i] == sector)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+/**
+ * Returns the address of a sector in the read-ahead window, NULL if not
+ * cached
+ */
+static BYTE* pucAheadFind(DWORD sector)
+{
+	if (iAheadCount && sector >= ulAheadBase
+			&& sector - ulAheadBase < (DWORD) iAheadCount)
+	{
+		return ucAheadData[sector - ulAheadBase];
+	}
+
+	return NULL;
+}
+
+/**
+ * Selects the slot for a new sector. Pinned sectors only replace unpinned
+ * slots as long as less than DISK_CACHE_PINNED slots are pinned.
+ *
+ * @param bPin 1 if the new sector gets pinned
+ * @return slot, already flagged for the new sector
+ */
+static int iCacheVictim(int bPin)
+{
+	int i, iVictim = -1;
+
+	for (i = 0; i < DISK_CACHE_SECTORS; i++)
+	{
+		if (bPin && iCachePinned >= DISK_CACHE_PINNED)
+		{
+			//
+			// pinned budget used up: replace the oldest pinned sector
+			//
+			if (!(ucCacheFlags[i] & CACHE_PINNED))
+			{
+				continue;
+			}
+		}
+		else
+		{
+			if (!(ucCacheFlags[i] & CACHE_VALID))
+			{
+				iVictim = i;
+				break;
+			}
+			if (ucCacheFlags[i] & CACHE_PINNED)
+			{
+				continue;
+			}
+		}
+
+		if (iVictim < 0 || ulCacheUsed[i] < ulCacheUsed[iVictim])
+		{
+			iVictim = i;
+		}
+	}
+
+	if (ucCacheFlags[iVictim] & CACHE_PINNED)
+	{
+		iCachePinned--;
+	}
+
+	ucCacheFlags[iVictim] = 0;
+	if (bPin)
+	{
+		ucCacheFlags[iVictim] = CACHE_PINNED;
+		iCachePinned++;
+	}
+
+	return iVictim;
+}
+
+/**
+ * Reads the next DISK_CACHE_READAHEAD sectors with one command into the
+ * read-ahead window
+ *
+ * @return RES_OK if at least the first sector is in the window
+ */
+static DRESULT xCacheReadAhead(BYTE drv, DWORD sector)
+{
+	iAheadCount = 0;
+
+	if (mmc_disk_read(drv, ucAheadData[0], sector, DISK_CACHE_READAHEAD)
+			!= RES_OK)
+	{
+		//
+		// e.g. the window runs over the end of the card
+		//
+		xCacheStats.ulCardCmds++;
+		return RES_ERROR;
+	}
+
+	ulAheadBase = sector;
+	iAheadCount = DISK_CACHE_READAHEAD;
+
+	xCacheStats.ulCardCmds++;
+	xCacheStats.ulReadAheads++;
+
+	return RES_OK;
+}
+
+/**
+ * Reads one sector through the cache
+ */
+static DRESULT xCacheReadSector(BYTE drv, BYTE *buff, DWORD sector)
+{
+	BYTE *pucData;
+	DRESULT res;
+	int i, bMeta;
+
+	xCacheStats.ulReads++;
+
+	//
+	// hit in the LRU pool or the read-ahead window
+	//
+	i = iCacheFind(sector);
+	if (i >= 0)
+	{
+		ulCacheUsed[i] = ++ulCacheClock;
+		memcpy(buff, ucCacheData[i], 512);
+		xCacheStats.ulHits++;
+		xCacheStats.ulCmdSaved++;
+		return RES_OK;
+	}
+
+	pucData = pucAheadFind(sector);
+	if (pucData != NULL)
+	{
+		memcpy(buff, pucData, 512);
+		xCacheStats.ulHits++;
+		xCacheStats.ulCmdSaved++;
+		return RES_OK;
+	}
+
+	xCacheStats.ulMisses++;
+	bMeta = iCacheIsMeta(buff, sector);
+
+	//
+	// sequential data read: fetch the following sectors too
+	//
+	if (!bMeta && sector == ulCacheNext && DISK_CACHE_READAHEAD > 1)
+	{
+		if (xCacheReadAhead(drv, sector) == RES_OK)
+		{
+			memcpy(buff, ucAheadData[0], 512);
+			return RES_OK;
+		}
+	}
+
+	i = iCacheVictim(bMeta);
+	res = mmc_disk_read(drv, ucCacheData[i], sector, 1);
+	xCacheStats.ulCardCmds++;
+
+	if (res != RES_OK)
+	{
+		if (bMeta)
+		{
+			iCachePinned--;
+		}
+		ucCacheFlags[i] = 0;
+		return res;
+	}
+
+	ulCacheSector[i] = sector;
+	ulCacheUsed[i] = ++ulCacheClock;
+	ucCacheFlags[i] |= CACHE_VALID;
+	memcpy(buff, ucCacheData[i], 512);
+
+	return RES_OK;
+}
+
+/**
+ * Registers the file system object. Reads into fs->win and sectors in front
+ * of the data area are pinned.
+ *
+ * @param fs file system object passed to f_mount
+ */
+void disk_cache_register(FATFS *fs)
+{
+	pxCacheFs = fs;
+}
+
+/**
+ * Drops all cached sectors, e.g. after a card change
+ */
+void disk_cache_invalidate(void)
+{
+	int i;
+
+	for (i = 0; i < DISK_CACHE_SECTORS; i++)
+	{
+		ucCacheFlags[i] = 0;
+	}
+
+	iCachePinned = 0;
+	iAheadCount = 0;
+	ulCacheNext = 0xFFFFFFFF;
+}
+
+/*-----------------------------------------------------------------------*/
+/* Read Sector(s)                                                        */
+/*-----------------------------------------------------------------------*/
+DRESULT disk_read(BYTE drv, BYTE *buff, DWORD sector, BYTE count)
+{
+	DRESULT res = RES_OK;
+
+	if (drv || !count)
+	{
+		return RES_PARERR;
+	}
+
+	//
+	// the bus mutex also protects the cache
+	//
+	vSSIBusAcquire(SSI_DEVICE_SD_DATA);
+
+	if (count == 1)
+	{
+		res = xCacheReadSector(drv, buff, sector);
+	}
+	else
+	{
+		//
+		// whole sectors of a file go directly into the caller's buffer,
+		// the cache is write through, so the card is always up to date
+		//
+		res = mmc_disk_read(drv, buff, sector, count);
+		xCacheStats.ulReads += count;
+		xCacheStats.ulMisses += count;
+		xCacheStats.ulCardCmds++;
+	}
+
+	ulCacheNext = sector + count;
+
+	vSSIBusRelease();
+
+	return res;
+}
+
+#if _READONLY == 0
+/*-----------------------------------------------------------------------*/
+/* Write Sector(s)                                                       */
+/*-----------------------------------------------------------------------*/
+DRESULT disk_write(BYTE drv, const BYTE *buff, DWORD sector, BYTE count)
+{
+	DRESULT res;
+	BYTE *pucData;
+	BYTE n;
+	int i;
+
+	if (drv || !count)
+	{
+		return RES_PARERR;
+	}
+
+	vSSIBusAcquire(SSI_DEVICE_SD_DATA);
+
+	res = mmc_disk_write(drv, buff, sector, count);
+	xCacheStats.ulWrites += count;
+	vCacheNotifyWrite(sector, count);
+
+	//
+	// update the cached copies, drop them if the card write failed
+	//
+	for (n = 0; n < count; n++, sector++, buff += 512)
+	{
+		i = iCacheFind(sector);
+		if (i >= 0)
+		{
+			if (res == RES_OK)
+			{
+				memcpy(ucCacheData[i], buff, 512);
+			}
+			else
+			{
+				if (ucCacheFlags[i] & CACHE_PINNED)
+				{
+					iCachePinned--;
+				}
+				ucCacheFlags[i] = 0;
+			}
+		}
+
+		pucData = pucAheadFind(sector);
+		if (pucData != NULL)
+		{
+			if (res == RES_OK)
+			{
+				memcpy(pucData, buff, 512);
+			}
+			else
+			{
+				iAheadCount = 0;
+			}
+		}
+	}
+
+	vSSIBusRelease();
+
+	return res;
+}
+#endif /* _READONLY */
+
+#else /* ENABLE_DISK_CACHE */
+
+void disk_cache_register(FATFS *fs)
+{
+	(void) fs;
+}
+
+void disk_cache_invalidate(void)
+{
+}
+
+DRESULT disk_read(BYTE drv, BYTE *buff, DWORD sector, BYTE count)
+{
+	xCacheStats.ulReads += count;
+	xCacheStats.ulMisses += count;
+	xCacheStats.ulCardCmds++;
+
+	return mmc_disk_read(drv, buff, sector, count);
+}
+
+#if _READONLY == 0
+DRESULT disk_write(BYTE drv, const BYTE *buff, DWORD sector, BYTE count)
+{
+	DRESULT res;
+
+	res = mmc_disk_write(drv, buff, sector, count);
+	xCacheStats.ulWrites += count;
+	vCacheNotifyWrite(sector, count);
+
+	return res;
+}
+#endif /* _READONLY */
+
+#endif /* ENABLE_DISK_CACHE */
+
+/**
+ * Sets the hook which is called for every written sector (also if the
+ * write failed, the content on the card is unknown then)
+ *
+ * @param pfnHook hook or NULL
+ */
+void disk_cache_set_write_hook(tDiskWriteHook pfnHook)
+{
+	pfnWriteHook = pfnHook;
+}
+
+/**
+ * Returns the counters of the cache. The hit rate is ulHits / ulReads,
+ * ulCmdSaved counts the read commands the card didn't get.
+ *
+ * @return pointer to the statistics
+ */
+const tDiskCacheStats* disk_cache_stats(void)
+{
+	return &xCacheStats;
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
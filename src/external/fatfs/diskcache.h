@@ -0,0 +1,87 @@
+/**
+ * \addtogroup System
+ * @{
+ *
+ * \author Anziner, Hahn
+ * \brief Sector cache between FatFs and the SD Card driver
+ *
+ */
+
+#ifndef DISKCACHE_H_
+#define DISKCACHE_H_
+
+#include "integer.h"
+#include "diskio.h"
+#include "ff.h"
+
+//*****************************************************************************
+//
+// Cache configuration
+//
+//*****************************************************************************
+/// number of cached 512 byte sectors
+#define DISK_CACHE_SECTORS		8
+/// max. number of slots used by pinned FAT and directory sectors
+#define DISK_CACHE_PINNED		4
+/// sectors fetched with one CMD18 if a sequential read is detected
+#define DISK_CACHE_READAHEAD	4
+
+/**
+ * Hit and command counters of the cache
+ */
+typedef struct
+{
+	unsigned long ulReads;			///< sectors requested by FatFs
+	unsigned long ulHits;			///< sectors served from the cache
+	unsigned long ulMisses;			///< sectors read from the card
+	unsigned long ulReadAheads;		///< CMD18 read-aheads issued
+	unsigned long ulCardCmds;		///< read commands sent to the card
+	unsigned long ulCmdSaved;		///< read commands saved by the cache
+	unsigned long ulWrites;			///< sectors written (write through)
+} tDiskCacheStats;
+
+/**
+ * Registers the file system object, reads into its window and sectors in
+ * front of the data area are FAT and directory sectors and get pinned
+ */
+void disk_cache_register(FATFS *fs);
+
+/**
+ * Drops all cached sectors
+ */
+void disk_cache_invalidate(void);
+
+/**
+ * Hook called for every written sector, e.g. to invalidate directory
+ * lookups cached above FatFs
+ */
+typedef void (*tDiskWriteHook)(DWORD sector);
+
+/**
+ * Sets the write hook, NULL removes it
+ */
+void disk_cache_set_write_hook(tDiskWriteHook pfnHook);
+
+/**
+ * Returns the counters of the cache
+ */
+const tDiskCacheStats* disk_cache_stats(void);
+
+//*****************************************************************************
+//
+// Raw card access of the SD Card driver, used by the cache
+//
+//*****************************************************************************
+DRESULT mmc_disk_read(BYTE drv, BYTE *buff, DWORD sector, BYTE count);
+#if _READONLY == 0
+DRESULT mmc_disk_write(BYTE drv, const BYTE *buff, DWORD sector, BYTE count);
+#endif
+
+#endif /* DISKCACHE_H_ */
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
@@ -54,7 +54,7 @@
 /   3: f_lseek is removed in addition to level 2. */
 
 
-#define	_FS_TINY	0
+#define	_FS_TINY	1
 /* When _FS_TINY is set to 1, FatFs uses the sector buffer in the file system
 /  object instead of the sector buffer in the individual file object for file
 /  data transfer. This reduces memory consumption 512 bytes each file object. */
@@ -68,7 +68,7 @@
 /* To enable f_mkfs function, set _USE_MKFS to 1 and set _FS_READONLY to 0 */
 
 
-#define	_USE_FORWARD	0
+#define	_USE_FORWARD	1
 /* To enable f_forward function, set _USE_FORWARD to 1 and set _FS_TINY to 1. */
 
 
@@ -123,9 +123,10 @@
 /  Note that output of the f_readdir fnction is affected by this option. */
 
 
-#define _FS_REENTRANT	0
+#define _FS_REENTRANT	1
 #define _TIMEOUT		1000	/* Timeout period in unit of time ticks of the OS */
-#define	_SYNC_t			HANDLE	/* Type of sync object used on the OS. e.g. HANDLE, OS_EVENT*, ID and etc.. */
+#define	_SYNC_t			void*	/* Type of sync object used on the OS. e.g. HANDLE, OS_EVENT*, ID and etc.. */
+/* The sync object is a FreeRTOS mutex (xSemaphoreHandle), see syscall.c */
 /* To make the FatFs module re-entrant, set _FS_REENTRANT to 1 and add user
 /  provided synchronization handlers, ff_req_grant, ff_rel_grant, ff_del_syncobj
 /  and ff_cre_syncobj function to the project. */
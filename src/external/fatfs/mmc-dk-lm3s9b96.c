@@ -26,6 +26,18 @@
  */
 #include "ssi_hw.h"
 
+/*
+ * SSI0 is also wired to the serial flash (always deselected), the clock is
+ * set by the bus manager.
+ */
+#include "ssiBus.h"
+
+/*
+ * disk_read() and disk_write() are implemented by the sector cache, which
+ * calls the raw functions below.
+ */
+#include "diskcache.h"
+
 /* Definitions for MMC/SDC command */
 #define CMD0    (0x40+0)    /* GO_IDLE_STATE */
 #define CMD1    (0x40+1)    /* SEND_OP_COND */
@@ -213,10 +225,8 @@ void power_on (void)
     GPIOPinWrite(SDCARD_CS_BASE, SDCARD_CS_PIN, SDCARD_CS_PIN);
     GPIOPinWrite(SFLASH_CS_BASE, SFLASH_CS_PIN, SFLASH_CS_PIN);
 
-    /* Configure the SSI0 port */
-    SSIConfigSetExpClk(SDC_SSI_BASE, SysCtlClockGet(), SSI_FRF_MOTO_MODE_0,
-                       SSI_MODE_MASTER, 400000, 8);
-    SSIEnable(SDC_SSI_BASE);
+    /* Configure the SSI0 port for card identification (400 kHz) */
+    vSSIBusSelect(SSI_DEVICE_SD_INIT);
 
     /* Set DI and CS high and apply more than 74 pulses to SCLK for the card */
     /* to be able to accept a native command. */
@@ -229,24 +239,8 @@ void power_on (void)
 
 void set_max_speed(void)
 {
-    unsigned long i;
-
-    /* Disable the SSI */
-    SSIDisable(SDC_SSI_BASE);
-
-    /* Set the maximum speed as half the system clock, with a max of 12.5 MHz. */
-    i = SysCtlClockGet() / 2;
-    if(i > 12500000)
-    {
-        i = 12500000;
-    }
-
-    /* Configure the SSI0 port */
-    SSIConfigSetExpClk(SDC_SSI_BASE, SysCtlClockGet(), SSI_FRF_MOTO_MODE_0,
-                       SSI_MODE_MASTER, i, 8);
-
-    /* Enable the SSI */
-    SSIEnable(SDC_SSI_BASE);
+    /* Half the system clock, with a max of 12.5 MHz (see vSSIBusInit()). */
+    vSSIBusSelect(SSI_DEVICE_SD_DATA);
 }
 
 
@@ -389,6 +383,10 @@ DSTATUS disk_initialize (
     if (drv) return STA_NOINIT;            /* Supports only single drive */
     if (Stat & STA_NODISK) return Stat;    /* No card in the socket */
 
+    vSSIBusAcquire(SSI_DEVICE_SD_INIT);
+
+    disk_cache_invalidate();               /* The card may have been changed */
+
     power_on();                            /* Force socket power on */
     send_initial_clock_train();
 
@@ -431,6 +429,8 @@ DSTATUS disk_initialize (
         power_off();
     }
 
+    vSSIBusRelease();
+
     return Stat;
 }
 
@@ -454,7 +454,7 @@ DSTATUS disk_status (
 /* Read Sector(s)                                                        */
 /*-----------------------------------------------------------------------*/
 
-DRESULT disk_read (
+DRESULT mmc_disk_read (
     BYTE drv,            /* Physical drive nmuber (0) */
     BYTE *buff,            /* Pointer to the data buffer to store read data */
     DWORD sector,        /* Start sector number (LBA) */
@@ -466,6 +466,7 @@ DRESULT disk_read (
 
     if (!(CardType & 4)) sector *= 512;    /* Convert to byte address if needed */
 
+    vSSIBusAcquire(SSI_DEVICE_SD_DATA);
     SELECT();            /* CS = L */
 
     if (count == 1) {    /* Single block read */
@@ -485,6 +486,7 @@ DRESULT disk_read (
 
     DESELECT();            /* CS = H */
     rcvr_spi();            /* Idle (Release DO) */
+    vSSIBusRelease();
 
     return count ? RES_ERROR : RES_OK;
 }
@@ -496,7 +498,7 @@ DRESULT disk_read (
 /*-----------------------------------------------------------------------*/
 
 #if _READONLY == 0
-DRESULT disk_write (
+DRESULT mmc_disk_write (
     BYTE drv,            /* Physical drive nmuber (0) */
     const BYTE *buff,    /* Pointer to the data to be written */
     DWORD sector,        /* Start sector number (LBA) */
@@ -509,6 +511,7 @@ DRESULT disk_write (
 
     if (!(CardType & 4)) sector *= 512;    /* Convert to byte address if needed */
 
+    vSSIBusAcquire(SSI_DEVICE_SD_DATA);
     SELECT();            /* CS = L */
 
     if (count == 1) {    /* Single block write */
@@ -532,6 +535,7 @@ DRESULT disk_write (
 
     DESELECT();            /* CS = H */
     rcvr_spi();            /* Idle (Release DO) */
+    vSSIBusRelease();
 
     return count ? RES_ERROR : RES_OK;
 }
@@ -566,7 +570,9 @@ DRESULT disk_ioctl (
             res = RES_OK;
             break;
         case 1:        /* Sub control code == 1 (POWER_ON) */
+            vSSIBusAcquire(SSI_DEVICE_SD_INIT);
             power_on();                /* Power on */
+            vSSIBusRelease();
             res = RES_OK;
             break;
         case 2:        /* Sub control code == 2 (POWER_GET) */
@@ -580,6 +586,7 @@ DRESULT disk_ioctl (
     else {
         if (Stat & STA_NOINIT) return RES_NOTRDY;
 
+        vSSIBusAcquire(SSI_DEVICE_SD_DATA);
         SELECT();        /* CS = L */
 
         switch (ctrl) {
@@ -637,6 +644,7 @@ DRESULT disk_ioctl (
 
         DESELECT();            /* CS = H */
         rcvr_spi();            /* Idle (Release DO) */
+        vSSIBusRelease();
     }
 
     return res;
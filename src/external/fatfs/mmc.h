@@ -23,12 +23,12 @@ int chk_power(void);
 BOOL rcvr_datablock(BYTE *buff, UINT btr);
 #if _READONLY == 0
 BOOL xmit_datablock(const BYTE *buff, BYTE token);
-DRESULT disk_write(BYTE drv, const BYTE *buff, DWORD sector, BYTE count);
+DRESULT mmc_disk_write(BYTE drv, const BYTE *buff, DWORD sector, BYTE count);
 #endif /* _READONLY */
 BYTE send_cmd(BYTE cmd, DWORD arg);
 DSTATUS disk_initialize(BYTE drv);
 DSTATUS disk_status(BYTE drv);
-DRESULT disk_read(BYTE drv, BYTE *buff, DWORD sector, BYTE count);
+DRESULT mmc_disk_read(BYTE drv, BYTE *buff, DWORD sector, BYTE count);
 DRESULT disk_ioctl(BYTE drv, BYTE ctrl, void *buff);
 void disk_timerproc(void);
 DWORD get_fattime(void);
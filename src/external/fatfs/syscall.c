@@ -0,0 +1,81 @@
+/**
+ * \addtogroup System
+ * @{
+ *
+ * \author Anziner, Hahn
+ * \brief FreeRTOS synchronization for the reentrant FatFs (_FS_REENTRANT)
+ *
+ * Every mounted volume gets a mutex, FatFs takes it on entry of each API
+ * function. Only tasks which use the same volume wait for each other, the
+ * scheduler keeps running during SD Card accesses.
+ *
+ */
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#include "ff.h"
+
+#if _FS_REENTRANT
+
+/**
+ * Creates the sync object of a volume, called by f_mount()
+ *
+ * @param vol logical drive number
+ * @param sobj returns the mutex
+ * @return TRUE if the mutex was created
+ */
+BOOL ff_cre_syncobj(BYTE vol, _SYNC_t *sobj)
+{
+	(void) vol;
+
+	*sobj = xSemaphoreCreateMutex();
+
+	return (*sobj != NULL) ? TRUE : FALSE;
+}
+
+/**
+ * Deletes the sync object of a volume, called by f_mount()
+ *
+ * @param sobj mutex
+ * @return TRUE
+ */
+BOOL ff_del_syncobj(_SYNC_t sobj)
+{
+	vQueueDelete((xQueueHandle) sobj);
+
+	return TRUE;
+}
+
+/**
+ * Takes the mutex of a volume
+ *
+ * @param sobj mutex
+ * @return TRUE if the volume was granted within _TIMEOUT ticks
+ */
+BOOL ff_req_grant(_SYNC_t sobj)
+{
+	return (xSemaphoreTake((xSemaphoreHandle) sobj, _TIMEOUT) == pdTRUE)
+			? TRUE : FALSE;
+}
+
+/**
+ * Gives the mutex of a volume back
+ *
+ * @param sobj mutex
+ */
+void ff_rel_grant(_SYNC_t sobj)
+{
+	xSemaphoreGive((xSemaphoreHandle) sobj);
+}
+
+#endif /* _FS_REENTRANT */
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
@@ -356,6 +356,39 @@ void *pvPortMalloc( size_t xSize ) PRIVILEGED_FUNCTION;
 void vPortFree( void *pv ) PRIVILEGED_FUNCTION;
 void vPortInitialiseBlocks( void ) PRIVILEGED_FUNCTION;
 size_t xPortGetFreeHeapSize( void ) PRIVILEGED_FUNCTION;
+size_t xPortGetMinimumEverFreeHeapSize( void ) PRIVILEGED_FUNCTION;
+
+/*
+ * Statistics of the heap, filled by vPortGetHeapStats() (heap_tlsf.c).
+ */
+typedef struct xHEAP_STATS
+{
+	size_t xFreeBytes;				/*<< Free bytes including the block headers. */
+	size_t xMinimumEverFreeBytes;	/*<< Lowest value of xFreeBytes since the start. */
+	size_t xLargestFreeBlock;		/*<< Largest size pvPortMalloc() can return now. */
+	unsigned long ulFreeBlocks;
+	unsigned long ulUsedBlocks;
+	unsigned long ulAllocations;
+	unsigned long ulFrees;
+	unsigned long ulFailed;
+} xHeapStats;
+
+/*
+ * Allocations of one call site of pvPortMalloc() (heap_tlsf.c).  The last
+ * entry of the table collects the call sites which didn't fit.
+ */
+typedef struct xHEAP_SITE
+{
+	void *pvCaller;					/*<< Return address of the call, NULL if unused. */
+	unsigned long ulAllocations;
+	unsigned long ulFrees;
+	unsigned long ulFailed;
+	size_t xBytes;					/*<< Bytes allocated now, with the block headers. */
+	size_t xPeakBytes;				/*<< Highest value of xBytes. */
+} xHeapSite;
+
+void vPortGetHeapStats( xHeapStats *pxStats ) PRIVILEGED_FUNCTION;
+const xHeapSite *pxPortGetHeapSites( unsigned portBASE_TYPE *puxCount ) PRIVILEGED_FUNCTION;
 
 /*
  * Setup the hardware ready for the scheduler to take control.  This generally
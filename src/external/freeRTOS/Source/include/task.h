@@ -1217,6 +1217,12 @@ void vTaskSwitchContext( void ) PRIVILEGED_FUNCTION;
  */
 xTaskHandle xTaskGetCurrentTaskHandle( void ) PRIVILEGED_FUNCTION;
 
+/*
+ * Return the name given to the task when it was created, NULL queries the
+ * calling task.
+ */
+signed char *pcTaskGetTaskName( xTaskHandle xTaskToQuery ) PRIVILEGED_FUNCTION;
+
 /*
  * Capture the current time status for future reference.
  */
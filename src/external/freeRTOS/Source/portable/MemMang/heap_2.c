@@ -104,6 +104,9 @@ static xBlockLink xStart, xEnd;
 fragmentation. */
 static size_t xFreeBytesRemaining;
 
+/* The lowest value xFreeBytesRemaining had since the heap was initialised. */
+static size_t xMinimumEverFreeBytesRemaining;
+
 /* STATIC FUNCTIONS ARE DEFINED AS MACROS TO MINIMIZE THE FUNCTION CALL DEPTH. */
 
 /*
@@ -152,6 +155,7 @@ xBlockLink *pxFirstFreeBlock;														\
 	pxFirstFreeBlock->pxNextFreeBlock = &xEnd;										\
 																					\
 	xFreeBytesRemaining = configTOTAL_HEAP_SIZE;									\
+	xMinimumEverFreeBytesRemaining = configTOTAL_HEAP_SIZE;						\
 }
 /*-----------------------------------------------------------*/
 
@@ -225,7 +229,13 @@ void *pvReturn = NULL;
 					prvInsertBlockIntoFreeList( ( pxNewBlockLink ) );
 				}
 				
-				xFreeBytesRemaining -= xWantedSize;
+				/* The block may be larger than wanted if it wasn't split, vPortFree()
+				gives back the whole block. */
+				xFreeBytesRemaining -= pxBlock->xBlockSize;
+				if( xFreeBytesRemaining < xMinimumEverFreeBytesRemaining )
+				{
+					xMinimumEverFreeBytesRemaining = xFreeBytesRemaining;
+				}
 			}
 		}
 	}
@@ -282,6 +292,12 @@ size_t xPortGetFreeHeapSize( void )
 }
 /*-----------------------------------------------------------*/
 
+size_t xPortGetMinimumEverFreeHeapSize( void )
+{
+	return xMinimumEverFreeBytesRemaining;
+}
+/*-----------------------------------------------------------*/
+
 void vPortInitialiseBlocks( void )
 {
 	/* This just exists to keep the linker quiet. */
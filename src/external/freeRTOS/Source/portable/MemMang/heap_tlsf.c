@@ -0,0 +1,516 @@
+/*
+ * An implementation of pvPortMalloc() and vPortFree() after the TLSF (two
+ * level segregated fit) scheme: malloc and free take constant time and
+ * adjacent free blocks are combined immediately.
+ *
+ * The free blocks are kept in lists by size class. The first level splits
+ * the sizes by powers of two, the second level splits every power of two
+ * into heapSL_COUNT ranges. Two bitmaps tell which lists hold blocks, so a
+ * fitting block is found with two count leading zeros instructions.
+ *
+ * Every block starts with a header of two words: the size with the flags and
+ * the call site index, and a pointer to the previous block in memory which
+ * is only valid while that block is free. Free blocks hold the links of
+ * their list behind the header.
+ *
+ * Every call site of pvPortMalloc() (the return address) gets an entry in
+ * a small table with the number of allocations and the allocated bytes, see
+ * pxPortGetHeapSites(). vPortGetHeapStats() gives the fragmentation.
+ * With ENABLE_HEAP_TRACE every call is also recorded by log/heaptrace.c.
+ *
+ * See heap_2.c for the implementation used before and the memory management
+ * pages of http://www.FreeRTOS.org for more information.
+ */
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+all the API functions to use the MPU wrappers.  That should only be done when
+task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "setup.h"
+
+#if ENABLE_HEAP_TRACE
+#include "log/heaptrace.h"
+#endif
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+/* Number of second level lists per power of two (log2). */
+#define heapSL_COUNT_LOG2		( 3 )
+#define heapSL_COUNT			( 1 << heapSL_COUNT_LOG2 )
+
+/* Blocks are multiples of 8 bytes. */
+#define heapALIGN_LOG2			( 3 )
+#define heapALIGN				( 1 << heapALIGN_LOG2 )
+
+/* Blocks below heapSMALL_BLOCK are all in the first level list 0, split in
+heapSL_COUNT lists of heapALIGN bytes. */
+#define heapFL_SHIFT			( heapSL_COUNT_LOG2 + heapALIGN_LOG2 )
+#define heapSMALL_BLOCK			( 1 << heapFL_SHIFT )
+
+/* The largest block is below 2^(heapFL_MAX + 1) bytes. */
+#define heapFL_MAX				( 16 )
+#define heapFL_COUNT			( heapFL_MAX - heapFL_SHIFT + 2 )
+
+/* Lock around the heap, FreeRTOSConfig.h can replace the scheduler lock. */
+#ifndef configHEAP_LOCK
+	#define configHEAP_LOCK()		vTaskSuspendAll()
+	#define configHEAP_UNLOCK()		( void ) xTaskResumeAll()
+#endif
+
+/* Number of call sites with own accounting, the last one collects the
+calls which don't fit into the table. */
+#ifndef configHEAP_CALL_SITES
+	#define configHEAP_CALL_SITES	24
+#endif
+
+/* Layout of the size word: flags in the low bits (the size is a multiple of
+heapALIGN), the call site index in the high byte. */
+#define heapFLAG_FREE			( ( size_t ) 0x01 )
+#define heapFLAG_PREV_FREE		( ( size_t ) 0x02 )
+#define heapSIZE_MASK			( ( size_t ) 0x00FFFFF8 )
+#define heapSITE_SHIFT			( 24 )
+#define heapSITE_MASK			( ( size_t ) 0xFF << heapSITE_SHIFT )
+
+/* Fails to compile if configTOTAL_HEAP_SIZE is too large for heapFL_MAX. */
+typedef char heapSIZE_CHECK[ ( configTOTAL_HEAP_SIZE < ( 2 << heapFL_MAX ) ) ? 1 : -1 ];
+
+/* A block of the heap.  pxNextFree and pxPrevFree are only used while the
+block is free, otherwise they are part of the allocated memory. */
+typedef struct A_HEAP_BLOCK
+{
+	struct A_HEAP_BLOCK *pxPrevPhys;	/*<< The block before, only valid if heapFLAG_PREV_FREE is set. */
+	size_t xSize;						/*<< Size of the block with header, flags and site index. */
+	struct A_HEAP_BLOCK *pxNextFree;	/*<< The next block in the same free list. */
+	struct A_HEAP_BLOCK *pxPrevFree;	/*<< The previous block in the same free list. */
+} xHeapBlock;
+
+/* The header of an allocated block, the memory follows it. */
+#define heapHEADER_SIZE			( offsetof( xHeapBlock, pxNextFree ) )
+
+/* A free block must hold the list links. */
+#define heapMINIMUM_BLOCK_SIZE	( ( sizeof( xHeapBlock ) + heapALIGN - 1 ) & ~( heapALIGN - 1 ) )
+
+/* Allocate the memory for the heap.  The struct is used to force byte
+alignment without using any non-portable code. */
+static union xTLSF_HEAP
+{
+	volatile portDOUBLE dDummy;
+	unsigned char ucHeap[ configTOTAL_HEAP_SIZE ];
+} xTlsfHeap;
+
+/* The bitmaps of the non empty lists and the list heads. */
+static unsigned long ulFlBitmap;
+static unsigned long ulSlBitmap[ heapFL_COUNT ];
+static xHeapBlock *pxFreeLists[ heapFL_COUNT ][ heapSL_COUNT ];
+
+/* Statistics. */
+static xHeapStats xTlsfStats;
+static xHeapSite xTlsfSites[ configHEAP_CALL_SITES ];
+
+static portBASE_TYPE xTlsfInitialised = pdFALSE;
+/*-----------------------------------------------------------*/
+
+/* Index of the most significant set bit, ulValue must not be 0. */
+static int prvFls( unsigned long ulValue )
+{
+	return 31 - __builtin_clz( ulValue );
+}
+
+/* Index of the least significant set bit, ulValue must not be 0. */
+static int prvFfs( unsigned long ulValue )
+{
+	return prvFls( ulValue & ( ~ulValue + 1 ) );
+}
+
+static size_t prvBlockSize( const xHeapBlock *pxBlock )
+{
+	return pxBlock->xSize & heapSIZE_MASK;
+}
+
+static xHeapBlock *prvNextPhys( const xHeapBlock *pxBlock )
+{
+	return ( xHeapBlock * ) ( ( ( unsigned char * ) pxBlock ) + prvBlockSize( pxBlock ) );
+}
+/*-----------------------------------------------------------*/
+
+/* The lists a block of xSize bytes is stored in. */
+static void prvMappingInsert( size_t xSize, int *piFl, int *piSl )
+{
+int iFl, iSl;
+
+	if( xSize < heapSMALL_BLOCK )
+	{
+		iFl = 0;
+		iSl = ( int ) xSize / ( heapSMALL_BLOCK / heapSL_COUNT );
+	}
+	else
+	{
+		iFl = prvFls( ( unsigned long ) xSize );
+		iSl = ( int ) ( xSize >> ( iFl - heapSL_COUNT_LOG2 ) ) ^ heapSL_COUNT;
+		iFl -= heapFL_SHIFT - 1;
+	}
+
+	*piFl = iFl;
+	*piSl = iSl;
+}
+
+/* The first list whose blocks are all large enough for xSize bytes. */
+static void prvMappingSearch( size_t xSize, int *piFl, int *piSl )
+{
+	if( xSize >= heapSMALL_BLOCK )
+	{
+		xSize += ( ( size_t ) 1 << ( prvFls( ( unsigned long ) xSize ) - heapSL_COUNT_LOG2 ) ) - 1;
+	}
+
+	prvMappingInsert( xSize, piFl, piSl );
+}
+/*-----------------------------------------------------------*/
+
+static void prvInsertFree( xHeapBlock *pxBlock )
+{
+int iFl, iSl;
+
+	prvMappingInsert( prvBlockSize( pxBlock ), &iFl, &iSl );
+
+	pxBlock->pxPrevFree = NULL;
+	pxBlock->pxNextFree = pxFreeLists[ iFl ][ iSl ];
+	if( pxBlock->pxNextFree != NULL )
+	{
+		pxBlock->pxNextFree->pxPrevFree = pxBlock;
+	}
+	pxFreeLists[ iFl ][ iSl ] = pxBlock;
+
+	ulFlBitmap |= 1UL << iFl;
+	ulSlBitmap[ iFl ] |= 1UL << iSl;
+
+	xTlsfStats.ulFreeBlocks++;
+}
+
+static void prvRemoveFree( xHeapBlock *pxBlock )
+{
+int iFl, iSl;
+
+	prvMappingInsert( prvBlockSize( pxBlock ), &iFl, &iSl );
+
+	if( pxBlock->pxNextFree != NULL )
+	{
+		pxBlock->pxNextFree->pxPrevFree = pxBlock->pxPrevFree;
+	}
+	if( pxBlock->pxPrevFree != NULL )
+	{
+		pxBlock->pxPrevFree->pxNextFree = pxBlock->pxNextFree;
+	}
+	else
+	{
+		pxFreeLists[ iFl ][ iSl ] = pxBlock->pxNextFree;
+		if( pxFreeLists[ iFl ][ iSl ] == NULL )
+		{
+			ulSlBitmap[ iFl ] &= ~( 1UL << iSl );
+			if( ulSlBitmap[ iFl ] == 0 )
+			{
+				ulFlBitmap &= ~( 1UL << iFl );
+			}
+		}
+	}
+
+	xTlsfStats.ulFreeBlocks--;
+}
+
+/* A free block of at least xSize bytes, NULL if there is none. */
+static xHeapBlock *prvFindFree( size_t xSize )
+{
+int iFl, iSl;
+unsigned long ulMap;
+
+	prvMappingSearch( xSize, &iFl, &iSl );
+	if( iFl >= heapFL_COUNT )
+	{
+		return NULL;
+	}
+
+	ulMap = ulSlBitmap[ iFl ] & ( ~0UL << iSl );
+	if( ulMap == 0 )
+	{
+		/* No block in this power of two, take the smallest larger one. */
+		ulMap = ( iFl + 1 < heapFL_COUNT ) ? ( ulFlBitmap & ( ~0UL << ( iFl + 1 ) ) ) : 0;
+		if( ulMap == 0 )
+		{
+			return NULL;
+		}
+		iFl = prvFfs( ulMap );
+		ulMap = ulSlBitmap[ iFl ];
+	}
+	iSl = prvFfs( ulMap );
+
+	return pxFreeLists[ iFl ][ iSl ];
+}
+/*-----------------------------------------------------------*/
+
+/* The site table entry of a caller, open addressing on the return
+address. */
+static int prvSiteIndex( void *pvCaller )
+{
+unsigned long ulHash;
+int i, iSite;
+
+	ulHash = ( ( unsigned long ) pvCaller >> 1 ) * 2654435761UL;
+	for( i = 0; i < configHEAP_CALL_SITES - 1; i++ )
+	{
+		iSite = ( int ) ( ( ulHash + i ) % ( configHEAP_CALL_SITES - 1 ) );
+		if( xTlsfSites[ iSite ].pvCaller == pvCaller )
+		{
+			return iSite;
+		}
+		if( xTlsfSites[ iSite ].pvCaller == NULL )
+		{
+			xTlsfSites[ iSite ].pvCaller = pvCaller;
+			return iSite;
+		}
+	}
+
+	return configHEAP_CALL_SITES - 1;
+}
+/*-----------------------------------------------------------*/
+
+static void prvHeapInit( void )
+{
+xHeapBlock *pxBlock, *pxEnd;
+size_t xSize;
+
+	/* One free block over the whole heap, followed by an allocated block
+	without memory which ends the heap. */
+	xSize = ( configTOTAL_HEAP_SIZE - heapHEADER_SIZE ) & ~( heapALIGN - 1 );
+
+	pxBlock = ( xHeapBlock * ) xTlsfHeap.ucHeap;
+	pxBlock->pxPrevPhys = NULL;
+	pxBlock->xSize = xSize | heapFLAG_FREE;
+
+	pxEnd = prvNextPhys( pxBlock );
+	pxEnd->pxPrevPhys = pxBlock;
+	pxEnd->xSize = heapFLAG_PREV_FREE;
+
+	prvInsertFree( pxBlock );
+
+	xTlsfStats.xFreeBytes = xSize;
+	xTlsfStats.xMinimumEverFreeBytes = xSize;
+}
+/*-----------------------------------------------------------*/
+
+void *pvPortMalloc( size_t xWantedSize )
+{
+xHeapBlock *pxBlock, *pxRest;
+size_t xSize;
+int iSite;
+void *pvReturn = NULL;
+
+	configHEAP_LOCK();
+	{
+		if( xTlsfInitialised == pdFALSE )
+		{
+			prvHeapInit();
+			xTlsfInitialised = pdTRUE;
+		}
+
+		iSite = prvSiteIndex( __builtin_return_address( 0 ) );
+
+		if( ( xWantedSize > 0 ) && ( xWantedSize < configTOTAL_HEAP_SIZE ) )
+		{
+			/* Add the header and round up to the alignment. */
+			xSize = ( xWantedSize + heapHEADER_SIZE + heapALIGN - 1 ) & ~( heapALIGN - 1 );
+			if( xSize < heapMINIMUM_BLOCK_SIZE )
+			{
+				xSize = heapMINIMUM_BLOCK_SIZE;
+			}
+
+			pxBlock = prvFindFree( xSize );
+			if( pxBlock != NULL )
+			{
+				prvRemoveFree( pxBlock );
+
+				if( prvBlockSize( pxBlock ) - xSize >= heapMINIMUM_BLOCK_SIZE )
+				{
+					/* The rest stays free, the block after it still follows
+					a free block. */
+					pxRest = ( xHeapBlock * ) ( ( ( unsigned char * ) pxBlock ) + xSize );
+					pxRest->xSize = ( prvBlockSize( pxBlock ) - xSize ) | heapFLAG_FREE;
+					prvNextPhys( pxRest )->pxPrevPhys = pxRest;
+					pxBlock->xSize = xSize | ( pxBlock->xSize & heapFLAG_PREV_FREE );
+					prvInsertFree( pxRest );
+				}
+				else
+				{
+					prvNextPhys( pxBlock )->xSize &= ~heapFLAG_PREV_FREE;
+				}
+
+				xSize = prvBlockSize( pxBlock );
+				pxBlock->xSize = xSize | ( pxBlock->xSize & heapFLAG_PREV_FREE ) | ( ( size_t ) iSite << heapSITE_SHIFT );
+
+				xTlsfStats.xFreeBytes -= xSize;
+				if( xTlsfStats.xFreeBytes < xTlsfStats.xMinimumEverFreeBytes )
+				{
+					xTlsfStats.xMinimumEverFreeBytes = xTlsfStats.xFreeBytes;
+				}
+				xTlsfStats.ulUsedBlocks++;
+				xTlsfStats.ulAllocations++;
+
+				xTlsfSites[ iSite ].ulAllocations++;
+				xTlsfSites[ iSite ].xBytes += xSize;
+				if( xTlsfSites[ iSite ].xBytes > xTlsfSites[ iSite ].xPeakBytes )
+				{
+					xTlsfSites[ iSite ].xPeakBytes = xTlsfSites[ iSite ].xBytes;
+				}
+
+				pvReturn = ( void * ) ( ( ( unsigned char * ) pxBlock ) + heapHEADER_SIZE );
+			}
+		}
+
+		if( pvReturn == NULL )
+		{
+			xTlsfStats.ulFailed++;
+			xTlsfSites[ iSite ].ulFailed++;
+		}
+
+		#if ENABLE_HEAP_TRACE
+		{
+			vHeapTraceRecord( pvReturn != NULL ? HEAP_TRACE_MALLOC : HEAP_TRACE_FAILED, pvReturn, xWantedSize, __builtin_return_address( 0 ) );
+		}
+		#endif
+	}
+#if DEBUG_MEMORY
+	printf("-- malloc -- %d (%d)\n", xWantedSize, xTlsfStats.xFreeBytes);
+#endif
+	configHEAP_UNLOCK();
+
+	#if( configUSE_MALLOC_FAILED_HOOK == 1 )
+	{
+		if( pvReturn == NULL )
+		{
+			extern void vApplicationMallocFailedHook( void );
+			vApplicationMallocFailedHook();
+		}
+	}
+	#endif
+
+	return pvReturn;
+}
+/*-----------------------------------------------------------*/
+
+void vPortFree( void *pv )
+{
+xHeapBlock *pxBlock, *pxNext;
+size_t xSize;
+int iSite;
+
+	if( pv )
+	{
+		pxBlock = ( xHeapBlock * ) ( ( ( unsigned char * ) pv ) - heapHEADER_SIZE );
+
+		configHEAP_LOCK();
+		{
+			xSize = prvBlockSize( pxBlock );
+			iSite = ( int ) ( ( pxBlock->xSize & heapSITE_MASK ) >> heapSITE_SHIFT );
+
+			xTlsfStats.xFreeBytes += xSize;
+			xTlsfStats.ulUsedBlocks--;
+			xTlsfStats.ulFrees++;
+			xTlsfSites[ iSite ].ulFrees++;
+			xTlsfSites[ iSite ].xBytes -= xSize;
+
+			#if ENABLE_HEAP_TRACE
+			{
+				vHeapTraceRecord( HEAP_TRACE_FREE, pv, xSize - heapHEADER_SIZE, __builtin_return_address( 0 ) );
+			}
+			#endif
+
+			pxBlock->xSize = xSize | ( pxBlock->xSize & heapFLAG_PREV_FREE ) | heapFLAG_FREE;
+
+			/* Combine with the block before. */
+			if( pxBlock->xSize & heapFLAG_PREV_FREE )
+			{
+				prvRemoveFree( pxBlock->pxPrevPhys );
+				pxBlock->pxPrevPhys->xSize += xSize;
+				pxBlock = pxBlock->pxPrevPhys;
+			}
+
+			/* Combine with the block after. */
+			pxNext = prvNextPhys( pxBlock );
+			if( pxNext->xSize & heapFLAG_FREE )
+			{
+				prvRemoveFree( pxNext );
+				pxBlock->xSize += prvBlockSize( pxNext );
+			}
+
+			pxNext = prvNextPhys( pxBlock );
+			pxNext->pxPrevPhys = pxBlock;
+			pxNext->xSize |= heapFLAG_PREV_FREE;
+
+			prvInsertFree( pxBlock );
+		}
+#if DEBUG_MEMORY
+		printf("-- free -- %d (%d)\n", xSize, xTlsfStats.xFreeBytes);
+#endif
+		configHEAP_UNLOCK();
+	}
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetFreeHeapSize( void )
+{
+	return xTlsfStats.xFreeBytes;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetMinimumEverFreeHeapSize( void )
+{
+	return xTlsfStats.xMinimumEverFreeBytes;
+}
+/*-----------------------------------------------------------*/
+
+void vPortGetHeapStats( xHeapStats *pxStats )
+{
+xHeapBlock *pxBlock;
+int iFl, iSl;
+
+	configHEAP_LOCK();
+	{
+		*pxStats = xTlsfStats;
+		pxStats->xLargestFreeBlock = 0;
+
+		/* The largest block is in the highest non empty list. */
+		if( ulFlBitmap != 0 )
+		{
+			iFl = prvFls( ulFlBitmap );
+			iSl = prvFls( ulSlBitmap[ iFl ] );
+			for( pxBlock = pxFreeLists[ iFl ][ iSl ]; pxBlock != NULL; pxBlock = pxBlock->pxNextFree )
+			{
+				if( prvBlockSize( pxBlock ) > pxStats->xLargestFreeBlock )
+				{
+					pxStats->xLargestFreeBlock = prvBlockSize( pxBlock );
+				}
+			}
+
+			/* That's what can be allocated from it. */
+			pxStats->xLargestFreeBlock -= heapHEADER_SIZE;
+		}
+	}
+	configHEAP_UNLOCK();
+}
+/*-----------------------------------------------------------*/
+
+const xHeapSite *pxPortGetHeapSites( unsigned portBASE_TYPE *puxCount )
+{
+	*puxCount = configHEAP_CALL_SITES;
+	return xTlsfSites;
+}
+/*-----------------------------------------------------------*/
+
+void vPortInitialiseBlocks( void )
+{
+	/* This just exists to keep the linker quiet. */
+}
@@ -2180,6 +2180,22 @@ tskTCB *pxNewTCB;
 
 /*-----------------------------------------------------------*/
 
+#if ( INCLUDE_pcTaskGetTaskName == 1 )
+
+	signed char *pcTaskGetTaskName( xTaskHandle xTaskToQuery )
+	{
+	tskTCB *pxTCB;
+
+		/* If null is passed in here then the name of the calling task is
+		being queried. */
+		pxTCB = prvGetTCBFromHandle( xTaskToQuery );
+		return &( pxTCB->pcTaskName[ 0 ] );
+	}
+
+#endif
+
+/*-----------------------------------------------------------*/
+
 #if ( INCLUDE_xTaskGetSchedulerState == 1 )
 
 	portBASE_TYPE xTaskGetSchedulerState( void )
@@ -57,7 +57,7 @@ extern void vPortSVCHandler(void);
 extern void Timer0IntHandler(void);
 extern void ETH0IntHandler(void);
 
-//extern void UARTStdioIntHandler(void);
+extern void UARTStdioIntHandler(void);
 
 //*****************************************************************************
 //
@@ -108,7 +108,7 @@ void (* const g_pfnVectors[])(void) =
 		IntDefaultHandler, // GPIO Port C
 		IntDefaultHandler, // GPIO Port D
 		IntDefaultHandler, // GPIO Port E
-		IntEmptyHandler, // UART0 Rx and Tx
+		UARTStdioIntHandler, // UART0 Rx and Tx
 		IntDefaultHandler, // UART1 Rx and Tx
 		IntDefaultHandler, // SSI0 Rx and Tx
 		IntDefaultHandler, // I2C0 Master and Slave
@@ -0,0 +1,404 @@
+/*
+ * cachebench.c - Host run of the SD Card sector cache over a disk image
+ *
+ * Compiles external/fatfs/ff.c and external/fatfs/diskcache.c with the
+ * configuration of the target (_FS_TINY, ENABLE_DISK_CACHE of setup.h) on
+ * top of a RAM disk image. The image is formatted with f_mkfs and filled
+ * with a directory of the host, by default the SD Card content in sd_data.
+ *
+ * Then it replays the file system load of the webserver: page loads open a
+ * page (index.ssi most often) and the stylesheet and script it references
+ * and send them with f_forward like lmi_fs.c (ENABLE_FS_FORWARD). The path
+ * and content caches of lmi_fs.c are not part of the run, every request
+ * opens the file. Every 10th page load appends a line to the log like
+ * appendToLog.
+ *
+ * Prints the counters of disk_cache_stats() and the commands the card would
+ * have got without the cache (every disk_read call is one command then).
+ * All data sent is compared with the files on the host.
+ *
+ * Build (from src/):
+ *   gcc -O2 -I uInterface -I external/fatfs -o cachebench tools/cachebench.c
+ *
+ * Usage:
+ *   cachebench [directory] [page loads]
+ *   cachebench sd_data 10000
+ *
+ * Author: Anzinger Martin, Hahn Florian
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/* DIR of FatFs and dirent.h differ */
+#define DIR					FF_DIR
+
+/* f_mkfs is only needed on the host */
+#include "ff.h"
+#undef _USE_MKFS
+#define _USE_MKFS			1
+FRESULT f_mkfs(BYTE drv, BYTE partition, WORD allocsize);
+
+#include "../external/fatfs/ff.c"
+
+/* count the calls of FatFs before they reach the cache */
+#define disk_read			cache_disk_read
+#define disk_write			cache_disk_write
+#include "../external/fatfs/diskcache.c"
+#undef disk_read
+#undef disk_write
+
+#undef DIR
+#include <dirent.h>
+
+/* size of the image, 16 MB gives FAT16 like the cards in use */
+#define IMAGE_SECTORS		32768
+
+/* largest file copied into the image */
+#define MAX_FILE			65536
+
+/* number of files in the image */
+#define MAX_FILES			64
+
+/* log line of appendToLog */
+#define LOG_PATH			"log/sys.log"
+
+static BYTE image[IMAGE_SECTORS][512];
+
+/* commands and sectors of the card */
+static unsigned long card_reads, card_read_sectors, card_writes;
+
+/* disk_read calls of FatFs, the commands without the cache */
+static unsigned long fs_reads, fs_read_sectors;
+
+/* files copied into the image */
+static struct
+{
+	char path[64];
+	BYTE *data;
+	UINT len;
+	unsigned long requests;
+} files[MAX_FILES];
+static int num_files;
+
+static int errors;
+
+/*
+ * The card and the bus manager
+ */
+void vSSIBusAcquire(int iDevice) { }
+void vSSIBusRelease(void) { }
+
+DSTATUS disk_initialize(BYTE drv) { return 0; }
+DSTATUS disk_status(BYTE drv) { return 0; }
+DWORD get_fattime(void) { return 0; }
+
+BOOL ff_cre_syncobj(BYTE vol, _SYNC_t *sobj) { *sobj = image; return TRUE; }
+BOOL ff_del_syncobj(_SYNC_t sobj) { return TRUE; }
+BOOL ff_req_grant(_SYNC_t sobj) { return TRUE; }
+void ff_rel_grant(_SYNC_t sobj) { }
+
+DRESULT
+disk_ioctl(BYTE drv, BYTE ctrl, void *buff)
+{
+	switch (ctrl)
+	{
+	case GET_SECTOR_COUNT:
+		*(DWORD *) buff = IMAGE_SECTORS;
+		return RES_OK;
+	case GET_SECTOR_SIZE:
+		*(WORD *) buff = 512;
+		return RES_OK;
+	case GET_BLOCK_SIZE:
+		*(DWORD *) buff = 1;
+		return RES_OK;
+	case CTRL_SYNC:
+		return RES_OK;
+	}
+
+	return RES_PARERR;
+}
+
+DRESULT
+mmc_disk_read(BYTE drv, BYTE *buff, DWORD sector, BYTE count)
+{
+	if (sector + count > IMAGE_SECTORS)
+		return RES_ERROR;
+
+	memcpy(buff, image[sector], count * 512);
+	card_reads++;
+	card_read_sectors += count;
+
+	return RES_OK;
+}
+
+DRESULT
+mmc_disk_write(BYTE drv, const BYTE *buff, DWORD sector, BYTE count)
+{
+	if (sector + count > IMAGE_SECTORS)
+		return RES_ERROR;
+
+	memcpy(image[sector], buff, count * 512);
+	card_writes++;
+
+	return RES_OK;
+}
+
+DRESULT
+disk_read(BYTE drv, BYTE *buff, DWORD sector, BYTE count)
+{
+	fs_reads++;
+	fs_read_sectors += count;
+
+	return cache_disk_read(drv, buff, sector, count);
+}
+
+DRESULT
+disk_write(BYTE drv, const BYTE *buff, DWORD sector, BYTE count)
+{
+	return cache_disk_write(drv, buff, sector, count);
+}
+
+/*
+ * Filling the image
+ */
+static void
+copy_dir(const char *host, const char *path)
+{
+	char host_path[256], fs_path[64];
+	struct dirent *entry;
+	struct stat st;
+	FILE *in;
+	FIL fil;
+	UINT written;
+	DIR *dir;
+
+	dir = opendir(host);
+	if (dir == NULL)
+	{
+		perror(host);
+		exit(2);
+	}
+
+	while ((entry = readdir(dir)) != NULL)
+	{
+		if (entry->d_name[0] == '.')
+			continue;
+
+		/* names which don't fit are skipped */
+		if (snprintf(host_path, sizeof(host_path), "%s/%s", host,
+				entry->d_name) >= (int) sizeof(host_path))
+			continue;
+		if (snprintf(fs_path, sizeof(fs_path), "%s%s%s", path, *path ? "/" : "",
+				entry->d_name) >= (int) sizeof(fs_path))
+			continue;
+		if (stat(host_path, &st) != 0)
+			continue;
+
+		if (S_ISDIR(st.st_mode))
+		{
+			f_mkdir(fs_path);
+			copy_dir(host_path, fs_path);
+			continue;
+		}
+
+		if (num_files == MAX_FILES || st.st_size > MAX_FILE ||
+				strlen(fs_path) >= sizeof(files[0].path))
+			continue;
+
+		files[num_files].data = malloc(st.st_size + 1);
+		in = fopen(host_path, "rb");
+		files[num_files].len = fread(files[num_files].data, 1, st.st_size, in);
+		fclose(in);
+
+		if (f_open(&fil, fs_path, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK ||
+				f_write(&fil, files[num_files].data, files[num_files].len,
+						&written) != FR_OK || written != files[num_files].len)
+		{
+			printf("can't write %s\n", fs_path);
+			errors++;
+		}
+		f_close(&fil);
+
+		strcpy(files[num_files].path, fs_path);
+		num_files++;
+	}
+
+	closedir(dir);
+}
+
+static int
+find_file(const char *path)
+{
+	int i;
+
+	for (i = 0; i < num_files; i++)
+	{
+		if (strcmp(files[i].path, path) == 0)
+			return i;
+	}
+
+	return -1;
+}
+
+/*
+ * The load
+ */
+static const BYTE *sink_expect;
+static UINT sink_pos, sink_len;
+
+/* stream function of f_forward, compares with the host file */
+static UINT
+sink(const BYTE *data, UINT len)
+{
+	if (len == 0)
+		return 1;
+
+	if (sink_pos + len > sink_len ||
+			memcmp(data, sink_expect + sink_pos, len) != 0)
+	{
+		errors++;
+	}
+	sink_pos += len;
+
+	return len;
+}
+
+/* one request like fs_open/fs_read of lmi_fs.c */
+static void
+request(int i)
+{
+	FIL fil;
+	UINT sent;
+
+	if (i < 0)
+		return;
+
+	files[i].requests++;
+	if (f_open(&fil, files[i].path, FA_READ) != FR_OK)
+	{
+		errors++;
+		return;
+	}
+
+	sink_expect = files[i].data;
+	sink_len = files[i].len;
+	sink_pos = 0;
+	do
+	{
+		/* the size of a TCP segment, like the send buffer of httpd */
+		if (f_forward(&fil, sink, 1460, &sent) != FR_OK)
+		{
+			errors++;
+			break;
+		}
+	} while (sent);
+
+	if (sink_pos != sink_len)
+		errors++;
+
+	f_close(&fil);
+}
+
+static void
+append_log(int n)
+{
+	char line[64];
+	FIL fil;
+	UINT written;
+	int len;
+
+	len = snprintf(line, sizeof(line), "%08d page load\r\n", n);
+	if (f_open(&fil, LOG_PATH, FA_OPEN_ALWAYS | FA_WRITE) != FR_OK ||
+			f_lseek(&fil, fil.fsize) != FR_OK ||
+			f_write(&fil, line, len, &written) != FR_OK)
+	{
+		errors++;
+	}
+	f_close(&fil);
+}
+
+int main(int argc, char *argv[])
+{
+	static FATFS fs;
+	const char *host = "sd_data";
+	const tDiskCacheStats *stats;
+	int pages[MAX_FILES], num_pages = 0, css, js, index;
+	long loads = 10000, n;
+	int i, page;
+
+	if (argc > 1)
+		host = argv[1];
+	if (argc > 2)
+		loads = atol(argv[2]);
+
+	srand(1);
+
+	f_mount(0, &fs);
+	if (f_mkfs(0, 0, 0) != FR_OK)
+	{
+		printf("f_mkfs failed\n");
+		return 2;
+	}
+	copy_dir(host, "");
+
+	/* mount again like fs_init, with the cache registered and empty */
+	f_mount(0, NULL);
+	disk_cache_invalidate();
+	disk_cache_register(&fs);
+	f_mount(0, &fs);
+	memset(&xCacheStats, 0, sizeof(xCacheStats));
+	card_reads = card_read_sectors = card_writes = 0;
+	fs_reads = fs_read_sectors = 0;
+
+	for (i = 0; i < num_files; i++)
+	{
+		if (strstr(files[i].path, ".ssi") || strstr(files[i].path, ".htm"))
+			pages[num_pages++] = i;
+	}
+	index = find_file("httpd-fs/index.ssi");
+	css = find_file("httpd-fs/css/design.css");
+	js = find_file("httpd-fs/js/funcs_c.js");
+	if (num_pages == 0)
+	{
+		printf("no pages in %s\n", host);
+		return 2;
+	}
+
+	for (n = 0; n < loads; n++)
+	{
+		/* half of the loads are the start page */
+		page = (index >= 0 && rand() % 2) ? index :
+				pages[rand() % num_pages];
+		request(page);
+		request(css);
+		request(js);
+
+		if (n % 10 == 0)
+			append_log(n);
+	}
+
+	stats = disk_cache_stats();
+
+	printf("%d files, %ld page loads, %d sectors cached (%d pinned), "
+			"read-ahead %d\n\n", num_files, loads, DISK_CACHE_SECTORS,
+			DISK_CACHE_PINNED, DISK_CACHE_READAHEAD);
+	printf("sectors read by FatFs   %10lu\n", stats->ulReads);
+	printf("hits                    %10lu  %.1f %%\n", stats->ulHits,
+			stats->ulReads ? 100.0 * stats->ulHits / stats->ulReads : 0.0);
+	printf("misses                  %10lu\n", stats->ulMisses);
+	printf("read-aheads             %10lu\n", stats->ulReadAheads);
+	printf("sectors written         %10lu\n", stats->ulWrites);
+	printf("\n%-23s %10s %10s\n", "", "commands", "sectors");
+	printf("%-23s %10lu %10lu\n", "card without cache", fs_reads,
+			fs_read_sectors);
+	printf("%-23s %10lu %10lu\n", "card with cache", card_reads,
+			card_read_sectors);
+	printf("%-23s %10lu %9.1f%%\n", "saved", fs_reads - card_reads,
+			fs_reads ? 100.0 * (fs_reads - card_reads) / fs_reads : 0.0);
+	printf("\n%d errors\n", errors);
+
+	return errors ? 1 : 0;
+}
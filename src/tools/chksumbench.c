@@ -0,0 +1,243 @@
+/*
+ * chksumbench.c - Host test of the checksum routines of the lwIP port
+ *
+ * Compiles external/ethernet/lwip131/port/chksum.c with its C word loops
+ * (the Thumb-2 assembler is only used on the target) and checks
+ * lm3s_chksum() and lm3s_chksum_copy() against lwip_standard_chksum()
+ * (algorithm 1 of inet_chksum.c) for random data, lengths and alignments
+ * of source and destination. It also checks that the data sums of
+ * segments appended by tcp_enqueue() (tcp_seg_add_chksum(), swapped at
+ * odd offsets) add up to the sum of the whole data.
+ *
+ * Then it prints the time per KB of all routines. The cycles on the target
+ * are printed by log/chksumbench.c (ENABLE_CHKSUM_BENCH in setup.h).
+ *
+ * Build (from src/):
+ *   gcc -O2 -I external/ethernet/lwip131/port/LM3S -o chksumbench \
+ *       tools/chksumbench.c
+ *
+ * Usage:
+ *   chksumbench [iterations]
+ *
+ * Author: Anzinger Martin, Hahn Florian
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+/* the types of arch/cc.h with the sizes of the target */
+#define __CC_H__
+typedef uint8_t u8_t;
+typedef uint16_t u16_t;
+typedef uint32_t u32_t;
+typedef uintptr_t mem_ptr_t;
+
+#include "../external/ethernet/lwip131/port/chksum.c"
+
+/** largest tested length, one segment of the MSS plus options */
+#define MAX_LEN			1536
+
+/**
+ * Algorithm 1 of inet_chksum.c (lwip_standard_chksum()), the reference
+ */
+static u16_t
+lwip_standard_chksum(void *dataptr, u16_t len)
+{
+	u32_t acc;
+	u16_t src;
+	u8_t *octetptr;
+
+	acc = 0;
+	octetptr = (u8_t*) dataptr;
+	while (len > 1)
+	{
+		src = (*octetptr) << 8;
+		octetptr++;
+		src |= (*octetptr);
+		octetptr++;
+		acc += src;
+		len -= 2;
+	}
+	if (len > 0)
+	{
+		src = (*octetptr) << 8;
+		acc += src;
+	}
+
+	acc = (acc >> 16) + (acc & 0x0000ffffUL);
+	if ((acc & 0xffff0000UL) != 0)
+	{
+		acc = (acc >> 16) + (acc & 0x0000ffffUL);
+	}
+
+	/* htons() on the little endian target */
+	src = (u16_t) acc;
+	return (u16_t) ((src >> 8) | (src << 8));
+}
+
+/**
+ * Same as tcp_seg_add_chksum() in tcp_out.c
+ */
+static u16_t
+seg_add_chksum(u16_t sum, u16_t chksum, u16_t offset)
+{
+	u32_t acc;
+
+	if (offset & 1)
+	{
+		chksum = (u16_t) (((chksum & 0xff) << 8) | ((chksum & 0xff00) >> 8));
+	}
+	acc = (u32_t) sum + chksum;
+	acc = (acc >> 16) + (acc & 0x0000ffffUL);
+	return (u16_t) acc;
+}
+
+static void
+fill(u8_t *p, int len, int mode)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+	{
+		/* all ones and all zeros make the carries go around */
+		p[i] = mode == 0 ? 0xff : mode == 1 ? 0x00 : (u8_t) rand();
+	}
+}
+
+static int
+test(long iterations)
+{
+	static u8_t src[MAX_LEN + 8], dst[MAX_LEN + 8], check[MAX_LEN + 8];
+	long i;
+	int errors = 0;
+
+	for (i = 0; i < iterations && errors < 10; i++)
+	{
+		int so = rand() & 7, doff = rand() & 7;
+		u16_t len = (u16_t) (i < 64 ? i : rand() % MAX_LEN);
+		u16_t ref, sum, copy, split, parts;
+		u16_t off;
+
+		fill(src, sizeof(src), i % 17 == 0 ? 0 : i % 19 == 0 ? 1 : 2);
+		memset(dst, 0x5a, sizeof(dst));
+		memcpy(check, dst, sizeof(check));
+		memcpy(check + doff, src + so, len);
+
+		ref = lwip_standard_chksum(src + so, len);
+		sum = lm3s_chksum(src + so, len);
+		copy = lm3s_chksum_copy(dst + doff, src + so, len);
+
+		if (ref != sum)
+		{
+			printf("lm3s_chksum: len %u at +%d: 0x%04x, expected 0x%04x\n",
+					len, so, sum, ref);
+			errors++;
+		}
+		if (ref != copy)
+		{
+			printf("lm3s_chksum_copy: len %u from +%d to +%d: 0x%04x, "
+				"expected 0x%04x\n", len, so, doff, copy, ref);
+			errors++;
+		}
+		if (memcmp(dst, check, sizeof(dst)) != 0)
+		{
+			printf("lm3s_chksum_copy: len %u from +%d to +%d: wrong copy\n",
+					len, so, doff);
+			errors++;
+		}
+
+		/* the data of a segment written in pieces by tcp_write() */
+		parts = 0;
+		for (off = 0; off < len; off += split)
+		{
+			split = (u16_t) (1 + rand() % (len - off));
+			copy = lm3s_chksum_copy(dst + doff + off, src + so + off, split);
+			parts = off == 0 ? copy : seg_add_chksum(parts, copy, off);
+		}
+		if (len > 0 && ref != parts)
+		{
+			printf("tcp_seg_add_chksum: len %u: 0x%04x, expected 0x%04x\n",
+					len, parts, ref);
+			errors++;
+		}
+	}
+
+	printf("%ld lengths and alignments tested, %d errors\n", i, errors);
+
+	return errors;
+}
+
+static double
+seconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void
+bench(u16_t len, int offset)
+{
+	static u8_t src[MAX_LEN + 8], dst[MAX_LEN + 8];
+	const long rounds = 200000;
+	volatile u16_t sink = 0;
+	double t0, ref, sum, copy, fused;
+	long i;
+
+	fill(src, sizeof(src), 2);
+
+	t0 = seconds();
+	for (i = 0; i < rounds; i++)
+		sink += lwip_standard_chksum(src + offset, len);
+	ref = seconds() - t0;
+
+	t0 = seconds();
+	for (i = 0; i < rounds; i++)
+		sink += lm3s_chksum(src + offset, len);
+	sum = seconds() - t0;
+
+	t0 = seconds();
+	for (i = 0; i < rounds; i++)
+	{
+		memcpy(dst, src + offset, len);
+		sink += lm3s_chksum(dst, len);
+	}
+	copy = seconds() - t0;
+
+	t0 = seconds();
+	for (i = 0; i < rounds; i++)
+		sink += lm3s_chksum_copy(dst, src + offset, len);
+	fused = seconds() - t0;
+
+	/* ns per KB */
+	printf("%5u +%d %10.0f %10.0f %10.0f %10.0f\n", len, offset,
+			ref * 1e9 / rounds * 1024 / len, sum * 1e9 / rounds * 1024 / len,
+			copy * 1e9 / rounds * 1024 / len, fused * 1e9 / rounds * 1024 / len);
+	(void) sink;
+}
+
+int main(int argc, char *argv[])
+{
+	static const u16_t sizes[] = { 64, 256, 536, 1024, 1460 };
+	long iterations = argc > 1 ? atol(argv[1]) : 200000;
+	unsigned int i;
+	int errors;
+
+	srand(1);
+	errors = test(iterations);
+
+	printf("\nns per KB on the host (target cycles: log/chksumbench.c)\n");
+	printf("%5s %2s %10s %10s %10s %10s\n", "len", "", "ref", "sum",
+			"copy+sum", "fused");
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		bench(sizes[i], 0);
+		bench(sizes[i], 1);
+	}
+
+	return errors ? 1 : 0;
+}
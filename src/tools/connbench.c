@@ -0,0 +1,285 @@
+/*
+ * connbench.c - Sustained connection rate of the webserver
+ *
+ * Opens connections to the board as fast as the threads can and fetches a
+ * page on each, the way a browser burst and the AJAX polling of the pages
+ * do. Every connection closes after the response, the mode decides who
+ * closes first and so who keeps the TIME_WAIT pcb:
+ *
+ *   http10  "GET ... HTTP/1.0", the server closes (the old behaviour)
+ *   close   "HTTP/1.1" with "Connection: close", the server closes
+ *   keep    "HTTP/1.1", the client reads Content-Length bytes and closes
+ *           first, the server keeps no pcb (only the JSON files under /api
+ *           have a Content-Length, other files fall back to the server close)
+ *
+ * With the server closing, MEMP_NUM_TCP_PCB pcbs last for
+ * MEMP_NUM_TCP_PCB / (2 * TCP_MSL) connections per second before lwIP has
+ * to recycle TIME_WAIT pcbs. The recycled pcbs and the dropped SYNs are in
+ * the "tcp" part of /api/stats, the closes in its "httpd" part.
+ *
+ * Prints the connections and failures per second and the connections which
+ * the server closed first.
+ *
+ * Build (from src/):
+ *   gcc -O2 -pthread -o connbench tools/connbench.c
+ *
+ * Usage:
+ *   connbench host[:port] [path] [seconds] [threads] [http10|close|keep]
+ *   connbench 192.168.1.100 /api/stats 30 4 keep
+ *
+ * Author: Anzinger Martin, Hahn Florian
+ */
+
+#define _GNU_SOURCE			/* memmem */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+/* timeout of connect and recv in s */
+#define BENCH_TIMEOUT		3
+
+/* largest response read */
+#define BENCH_BUF_LEN		4096
+
+enum mode { MODE_HTTP10, MODE_CLOSE, MODE_KEEP };
+
+static struct addrinfo *addr;
+static const char *path = "/api/stats";
+static enum mode mode = MODE_KEEP;
+static volatile int running = 1;
+
+/* counters of all threads, read once per second */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static long conns, failures, server_closed;
+static double conn_time;
+
+static double
+seconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Length of the response as given by its header, -1 if it has no
+ * Content-Length (the server closes then)
+ */
+static long
+content_length(const char *buf, int len, int *header)
+{
+	const char *end, *field;
+
+	end = memmem(buf, len, "\r\n\r\n", 4);
+	if (end == NULL)
+	{
+		return -2;
+	}
+	*header = end + 4 - buf;
+
+	for (field = buf; field < end; field++)
+	{
+		if (strncasecmp(field, "\r\nContent-Length:", 17) == 0)
+		{
+			return atol(field + 17);
+		}
+	}
+
+	return -1;
+}
+
+/**
+ * One connection with one request. Returns 0 on success, 1 if the server
+ * closed first and -1 on failure.
+ */
+static int
+fetch(void)
+{
+	char buf[BENCH_BUF_LEN];
+	char request[256];
+	struct timeval tv = { BENCH_TIMEOUT, 0 };
+	long length = -2;
+	int s, n, len = 0, header = 0, result = -1;
+
+	s = socket(addr->ai_family, SOCK_STREAM, 0);
+	if (s < 0)
+	{
+		return -1;
+	}
+	setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+	if (connect(s, addr->ai_addr, addr->ai_addrlen) < 0)
+	{
+		close(s);
+		return -1;
+	}
+
+	n = snprintf(request, sizeof(request), mode == MODE_HTTP10 ?
+		"GET %s HTTP/1.0\r\n\r\n" : mode == MODE_CLOSE ?
+		"GET %s HTTP/1.1\r\nHost: board\r\nConnection: close\r\n\r\n" :
+		"GET %s HTTP/1.1\r\nHost: board\r\n\r\n", path);
+	if (send(s, request, n, 0) != n)
+	{
+		close(s);
+		return -1;
+	}
+
+	for (;;)
+	{
+		n = recv(s, buf + len, sizeof(buf) - len, 0);
+		if (n < 0)
+		{
+			/* timeout or reset */
+			break;
+		}
+		if (n == 0)
+		{
+			/* the server closed first */
+			result = len > 0 ? 1 : -1;
+			break;
+		}
+		len += n;
+		if (length == -2)
+		{
+			length = content_length(buf, len, &header);
+		}
+		if (mode == MODE_KEEP && length >= 0 && len >= header + length)
+		{
+			/* complete, the client closes */
+			result = 0;
+			break;
+		}
+		if (len == sizeof(buf))
+		{
+			/* only the length matters, drop the rest */
+			header = length >= 0 ? header - len : 0;
+			len = 0;
+		}
+	}
+
+	close(s);
+	return result;
+}
+
+static void *
+worker(void *arg)
+{
+	double t0;
+	int result;
+
+	(void) arg;
+
+	while (running)
+	{
+		t0 = seconds();
+		result = fetch();
+		t0 = seconds() - t0;
+
+		pthread_mutex_lock(&lock);
+		if (result < 0)
+		{
+			failures++;
+		}
+		else
+		{
+			conns++;
+			conn_time += t0;
+			server_closed += result;
+		}
+		pthread_mutex_unlock(&lock);
+
+		if (result < 0)
+		{
+			/* refused or reset, give the pcbs some time */
+			usleep(10000);
+		}
+	}
+
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	struct addrinfo hints;
+	pthread_t *threads;
+	char *port;
+	long last_conns = 0, last_failures = 0;
+	int duration = 30, nthreads = 4, i, t;
+
+	if (argc < 2)
+	{
+		fprintf(stderr, "usage: connbench host[:port] [path] [seconds] [threads] "
+			"[http10|close|keep]\n");
+		return 2;
+	}
+	if (argc > 2)
+		path = argv[2];
+	if (argc > 3)
+		duration = atoi(argv[3]);
+	if (argc > 4)
+		nthreads = atoi(argv[4]);
+	if (argc > 5)
+		mode = strcmp(argv[5], "http10") == 0 ? MODE_HTTP10 :
+			strcmp(argv[5], "close") == 0 ? MODE_CLOSE : MODE_KEEP;
+
+	port = strchr(argv[1], ':');
+	if (port)
+		*port++ = 0;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(argv[1], port ? port : "80", &hints, &addr) != 0)
+	{
+		fprintf(stderr, "connbench: unknown host %s\n", argv[1]);
+		return 2;
+	}
+
+	threads = calloc(nthreads, sizeof(pthread_t));
+	for (i = 0; i < nthreads; i++)
+	{
+		pthread_create(&threads[i], NULL, worker, NULL);
+	}
+
+	printf("%s %s, %d threads\n", argv[1], path, nthreads);
+	printf("%4s %8s %8s %8s\n", "s", "conns/s", "fail/s", "srv close");
+	for (t = 1; t <= duration; t++)
+	{
+		sleep(1);
+		pthread_mutex_lock(&lock);
+		printf("%4d %8ld %8ld %8ld\n", t, conns - last_conns,
+				failures - last_failures, server_closed);
+		last_conns = conns;
+		last_failures = failures;
+		pthread_mutex_unlock(&lock);
+	}
+
+	running = 0;
+	for (i = 0; i < nthreads; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+
+	printf("\n%ld connections (%.1f/s), %ld failures, %ld closed by the "
+		"server first, %.1f ms per connection\n", conns,
+			(double) conns / duration, failures, server_closed,
+			conns ? conn_time * 1000 / conns : 0.0);
+
+	freeaddrinfo(addr);
+	free(threads);
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,390 @@
+/*
+ * ethrxbench.c - Host model of the Ethernet receive path
+ *
+ * A mock MAC with the 2 KB RX FIFO of the LM3S9B96 receives bursts of
+ * frames (a browser fetching a page and its assets over three
+ * connections). The CPU is shared by the RX interrupt, the input task
+ * (ethernetif_input) and the lower priority tcpip thread, every step costs
+ * the time estimated below for the 50 MHz target.
+ *
+ * Two input tasks are compared:
+ *
+ *   frame  one tcpip_input() message per frame, the pool of
+ *          MEMP_NUM_TCPIP_MSG_INPKT messages limits the frames in flight
+ *   batch  all frames of the FIFO go into a queue of ETH_RX_QUEUE_SIZE,
+ *          the tcpip thread gets one callback per batch
+ *
+ * and the frames per wakeup, the drops (FIFO overflow, no message or queue
+ * full) and the CPU time of the receive path (interrupt, input task and
+ * tcpip thread) are reported. The costs are estimates, the model compares
+ * the two designs, the counters of /api/stats give the real numbers.
+ *
+ * Build (from src/):
+ *   gcc -O2 -o ethrxbench tools/ethrxbench.c
+ *
+ * Usage:
+ *   ethrxbench [seconds] [mean burst gap in ms]
+ *
+ * Author: Anzinger Martin, Hahn Florian
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* simulation step in us */
+#define BENCH_STEP			0.02
+
+/* mock MAC */
+#define MAC_FIFO_SIZE		2048
+#define MAC_FIFO_FRAMES		64
+#define MAC_WIRE_US_BYTE	0.08	/* 100 Mbit/s */
+
+/* limits of the stack (lwipopts.h, opt.h, LWIPStack.h) */
+#define MSG_INPKT_POOL		8
+#define RX_QUEUE_SIZE		8
+
+/* costs in us at 50 MHz */
+#define COST_ISR			1.5		/* interrupt, semaphore give */
+#define COST_SWITCH			2.0		/* context switch */
+#define COST_CHECK			0.4		/* packet available, error flags */
+#define COST_ENABLE			1.0		/* enable RX interrupt, take semaphore */
+#define COST_PBUF			3.0		/* pbuf_alloc of the pool chain */
+#define COST_WORD			0.1		/* one word from the FIFO */
+#define COST_POST			4.0		/* memp_malloc + mbox post */
+#define COST_QUEUE			1.5		/* xQueueSend / xQueueReceive */
+#define COST_FETCH			3.0		/* mbox fetch + memp_free */
+#define COST_STACK			20.0	/* ethernet_input .. tcp_input */
+#define COST_STACK_BYTE		0.02	/* checksum */
+
+typedef enum
+{
+	MODE_FRAME, MODE_BATCH
+} tBenchMode;
+
+typedef struct
+{
+	double dTime;
+	int iLen;
+} tFrame;
+
+/* the traffic, identical for both modes */
+static tFrame *pxArrivals;
+static int iArrivals;
+
+/* state of one run */
+static struct
+{
+	tBenchMode xMode;
+
+	/* MAC */
+	int piFifo[MAC_FIFO_FRAMES];
+	int iFifoHead, iFifoCount, iFifoBytes;
+	int bRxIntEnabled;
+
+	/* input task: blocked on the semaphore, or busy until dTaskBusy */
+	int bTaskWaiting, bTaskQueueWait;
+	double dTaskBusy, dQueueWaitStart;
+	int iTaskStep, iTaskFrame, iWakeFrames;
+
+	/* tcpip thread: frames waiting, messages waiting */
+	int iStackFrames, iStackMsgs, iInFlight, bPending;
+	double dStackBusy;
+	int iStackStep;
+
+	int iOwner;
+	double dCpu;
+
+	long lWakeups, lFrames, lMaxBatch, lOverflow, lNoMsg, lQueueFull;
+} s;
+
+static double dRand(void)
+{
+	return rand() / (RAND_MAX + 1.0);
+}
+
+/**
+ * Bursts of small frames (ACK, SYN), requests and a few full frames,
+ * back to back on the wire
+ */
+static void vBenchTraffic(double dSeconds, double dGapMs)
+{
+	double dTime = 0, dEnd = dSeconds * 1e6;
+	int i, iBurst, iMax = 0;
+
+	srand(1);
+	while (dTime < dEnd)
+	{
+		dTime += dGapMs * 1000 * (0.2 + 1.6 * dRand());
+		for (iBurst = 4 + rand() % 28, i = 0; i < iBurst; i++)
+		{
+			if (iArrivals == iMax)
+			{
+				iMax = iMax ? iMax * 2 : 4096;
+				pxArrivals = realloc(pxArrivals, iMax * sizeof(tFrame));
+			}
+			pxArrivals[iArrivals].iLen = dRand() < 0.7 ? 64 : dRand() < 0.85
+					? 300 + rand() % 400 : 1514;
+			dTime += (pxArrivals[iArrivals].iLen + 20) * MAC_WIRE_US_BYTE;
+			pxArrivals[iArrivals].dTime = dTime;
+			iArrivals++;
+		}
+	}
+}
+
+/* FIFO words of a frame: length word, data, FCS */
+static int iFifoBytes(int iLen)
+{
+	return (iLen + 6 + 3) & ~3;
+}
+
+/**
+ * Gives the CPU to a context, a change costs a context switch
+ */
+static double dBenchRun(int iOwner, double dCost)
+{
+	if (s.iOwner != iOwner)
+	{
+		s.iOwner = iOwner;
+		dCost += COST_SWITCH;
+	}
+	s.dCpu += dCost;
+
+	return dCost;
+}
+
+/**
+ * Next step of the input task, returns its cost
+ */
+static double dBenchTask(void)
+{
+	int iLen;
+
+	switch (s.iTaskStep)
+	{
+	case 0:
+		/* packet available? */
+		s.iTaskStep = s.iFifoCount ? 1 : 3;
+		return COST_CHECK;
+
+	case 1:
+		/* read the frame into a pbuf */
+		iLen = s.piFifo[s.iFifoHead];
+		s.iFifoHead = (s.iFifoHead + 1) % MAC_FIFO_FRAMES;
+		s.iFifoCount--;
+		s.iFifoBytes -= iFifoBytes(iLen);
+		s.iTaskFrame = iLen;
+		s.iTaskStep = 2;
+		return COST_PBUF + iFifoBytes(iLen) / 4 * COST_WORD;
+
+	case 2:
+		/* hand the frame over */
+		s.iTaskStep = 0;
+		if (s.xMode == MODE_FRAME)
+		{
+			if (s.iInFlight == MSG_INPKT_POOL)
+			{
+				s.lNoMsg++;
+			}
+			else
+			{
+				s.iInFlight++;
+				s.iStackMsgs++;
+				s.iStackFrames++;
+				s.iWakeFrames++;
+			}
+			return COST_POST;
+		}
+		if (s.iStackFrames == RX_QUEUE_SIZE)
+		{
+			/* post the batch and wait for space in the queue */
+			if (!s.bPending)
+			{
+				s.bPending = 1;
+				s.iStackMsgs++;
+			}
+			s.bTaskQueueWait = 1;
+			s.iTaskStep = 4;
+			return COST_POST;
+		}
+		s.iStackFrames++;
+		s.iWakeFrames++;
+		return COST_QUEUE;
+
+	case 3:
+		/* FIFO empty: post the batch, enable the interrupt, wait */
+		s.lWakeups++;
+		s.lFrames += s.iWakeFrames;
+		if (s.iWakeFrames > s.lMaxBatch)
+		{
+			s.lMaxBatch = s.iWakeFrames;
+		}
+		s.iWakeFrames = 0;
+		s.iTaskStep = 0;
+		s.bTaskWaiting = 1;
+		s.bRxIntEnabled = 1;
+		if (s.xMode == MODE_BATCH && s.iStackFrames && !s.bPending)
+		{
+			s.bPending = 1;
+			s.iStackMsgs++;
+			return COST_POST + COST_ENABLE;
+		}
+		return COST_ENABLE;
+
+	case 4:
+		/* the tcpip thread made space or the wait timed out */
+		s.iTaskStep = 0;
+		if (s.iStackFrames == RX_QUEUE_SIZE)
+		{
+			s.lQueueFull++;
+			return COST_QUEUE;
+		}
+		s.iStackFrames++;
+		s.iWakeFrames++;
+		return COST_QUEUE;
+	}
+
+	return 0;
+}
+
+/**
+ * Next step of the tcpip thread, returns its cost
+ */
+static double dBenchStack(void)
+{
+	int iLen = 64 + rand() % 450;
+
+	if (s.xMode == MODE_FRAME)
+	{
+		s.iStackMsgs--;
+		s.iStackFrames--;
+		s.iInFlight--;
+		return COST_FETCH + COST_STACK + iLen * COST_STACK_BYTE;
+	}
+
+	/* one callback delivers the whole queue */
+	if (s.iStackStep == 0)
+	{
+		s.iStackMsgs--;
+		s.bPending = 0;
+		s.iStackStep = s.iStackFrames ? 1 : 0;
+		return COST_FETCH;
+	}
+	s.iStackFrames--;
+	if (s.iStackFrames == 0)
+	{
+		s.iStackStep = 0;
+	}
+
+	return COST_QUEUE + COST_STACK + iLen * COST_STACK_BYTE;
+}
+
+static void vBenchRun(tBenchMode xMode, const char *pcName)
+{
+	double dNow = 0, dCost;
+	int iNext = 0;
+
+	memset(&s, 0, sizeof(s));
+	s.xMode = xMode;
+	s.bTaskWaiting = 1;
+	s.bRxIntEnabled = 1;
+	s.iOwner = -1;
+
+	while (iNext < iArrivals || s.iFifoCount || s.iStackFrames || !s.bTaskWaiting)
+	{
+		/* the MAC receives */
+		while (iNext < iArrivals && pxArrivals[iNext].dTime <= dNow)
+		{
+			if (s.iFifoBytes + iFifoBytes(pxArrivals[iNext].iLen)
+					> MAC_FIFO_SIZE || s.iFifoCount == MAC_FIFO_FRAMES)
+			{
+				s.lOverflow++;
+			}
+			else
+			{
+				s.piFifo[(s.iFifoHead + s.iFifoCount) % MAC_FIFO_FRAMES]
+						= pxArrivals[iNext].iLen;
+				s.iFifoCount++;
+				s.iFifoBytes += iFifoBytes(pxArrivals[iNext].iLen);
+			}
+			iNext++;
+		}
+
+		/* the RX interrupt wakes the task and masks itself */
+		if (s.bRxIntEnabled && s.iFifoCount)
+		{
+			s.bRxIntEnabled = 0;
+			s.bTaskWaiting = 0;
+			s.dCpu += COST_ISR;
+			if (s.dTaskBusy < dNow)
+			{
+				s.dTaskBusy = dNow;
+			}
+			s.dTaskBusy += COST_ISR;
+			if (s.dStackBusy > dNow)
+			{
+				s.dStackBusy += COST_ISR;
+			}
+		}
+
+		/* a full queue blocks the task up to ETH_RX_QUEUE_WAIT_MS */
+		if (s.bTaskQueueWait && s.iStackFrames == RX_QUEUE_SIZE
+				&& dNow - s.dQueueWaitStart < 10000)
+		{
+			/* still waiting */
+		}
+		else
+		{
+			s.bTaskQueueWait = 0;
+		}
+
+		/* the input task has the higher priority and preempts the stack */
+		if (!s.bTaskWaiting && !s.bTaskQueueWait && s.dTaskBusy <= dNow)
+		{
+			dCost = dBenchRun(0, dBenchTask());
+			s.dTaskBusy = dNow + dCost;
+			if (s.dStackBusy > dNow)
+			{
+				s.dStackBusy += dCost;
+			}
+			if (s.bTaskQueueWait)
+			{
+				s.dQueueWaitStart = s.dTaskBusy;
+			}
+		}
+		else if ((s.bTaskWaiting || s.bTaskQueueWait) && s.dStackBusy <= dNow
+				&& s.iStackMsgs + s.iStackStep > 0)
+		{
+			s.dStackBusy = dNow + dBenchRun(1, dBenchStack());
+		}
+
+		dNow += BENCH_STEP;
+		if (dNow > pxArrivals[iArrivals - 1].dTime + 1e6)
+		{
+			break;
+		}
+	}
+
+	printf("%-6s %8d %8ld %8ld %6.2f %6ld %8ld %8ld %8ld %7.2f%% %8.1f\n",
+			pcName, iArrivals, s.lFrames, s.lWakeups, s.lWakeups
+					? (double) s.lFrames / s.lWakeups : 0, s.lMaxBatch,
+			s.lOverflow, s.lNoMsg, s.lQueueFull, 100 * s.dCpu / dNow,
+			s.lFrames ? s.dCpu / s.lFrames : 0);
+}
+
+int main(int argc, char *argv[])
+{
+	double dSeconds = argc > 1 ? atof(argv[1]) : 10;
+	double dGap = argc > 2 ? atof(argv[2]) : 5;
+
+	vBenchTraffic(dSeconds, dGap);
+
+	printf("%.0f s, bursts every %.1f ms\n\n", dSeconds, dGap);
+	printf("%-6s %8s %8s %8s %6s %6s %8s %8s %8s %8s %8s\n", "mode",
+			"frames", "to stack", "wakeups", "f/wake", "max", "overflow",
+			"no msg", "q full", "cpu", "us/frame");
+	vBenchRun(MODE_FRAME, "frame");
+	vBenchRun(MODE_BATCH, "batch");
+
+	return 0;
+}
@@ -0,0 +1,347 @@
+/*
+ * heapbench.c - Host benchmark of the heap implementations
+ *
+ * Runs the same sequence of allocations against heap_2.c and heap_tlsf.c
+ * (both compiled in unchanged) and reports failed allocations, peak usage,
+ * the largest free block and the time per call.
+ *
+ * The sequence is read from a trace file with one call per line:
+ *
+ *   m <id> <size>     pvPortMalloc(size), the result is called <id>
+ *   f <id>            vPortFree(<id>)
+ *   # ...             comment
+ *
+ * Without a file a day of browsing is simulated: connections with their
+ * http_state, send buffers, FIL objects, SSI parameters and pbufs, mixed
+ * with a few long living allocations.
+ *
+ * Build (from src/, -m32 gives the header sizes of the target):
+ *   gcc -O2 -I uInterface -I external/freeRTOS/Source/include \
+ *       -I external/freeRTOS/Source/portable/GCC/ARM_CM3 \
+ *       -o heapbench tools/heapbench.c
+ *
+ * Usage:
+ *   heapbench [trace.txt]
+ *
+ * Author: Anzinger Martin, Hahn Florian
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* heap_2.c, the functions get own names */
+#define pvPortMalloc						pvHeap2Malloc
+#define vPortFree							vHeap2Free
+#define xPortGetFreeHeapSize				xHeap2GetFreeHeapSize
+#define xPortGetMinimumEverFreeHeapSize		xHeap2GetMinimumEverFreeHeapSize
+#define vPortInitialiseBlocks				vHeap2InitialiseBlocks
+#include "../external/freeRTOS/Source/portable/MemMang/heap_2.c"
+#undef pvPortMalloc
+#undef vPortFree
+#undef xPortGetFreeHeapSize
+#undef xPortGetMinimumEverFreeHeapSize
+#undef vPortInitialiseBlocks
+#undef prvHeapInit
+#undef prvInsertBlockIntoFreeList
+#undef heapMINIMUM_BLOCK_SIZE
+
+/* heap_tlsf.c */
+#define pvPortMalloc						pvTlsfMalloc
+#define vPortFree							vTlsfFree
+#define xPortGetFreeHeapSize				xTlsfGetFreeHeapSize
+#define xPortGetMinimumEverFreeHeapSize		xTlsfGetMinimumEverFreeHeapSize
+#define vPortInitialiseBlocks				vTlsfInitialiseBlocks
+#define vPortGetHeapStats					vTlsfGetHeapStats
+#define pxPortGetHeapSites					pxTlsfGetHeapSites
+#include "../external/freeRTOS/Source/portable/MemMang/heap_tlsf.c"
+
+/* There is no scheduler on the host. */
+void vTaskSuspendAll(void)
+{
+}
+
+signed portBASE_TYPE xTaskResumeAll(void)
+{
+	return pdFALSE;
+}
+
+/* The heap lock of FreeRTOSConfig.h, the lock timing of log/trace.c */
+void vTraceSuspendAll(void)
+{
+}
+
+void vTraceResumeAll(void)
+{
+}
+
+/* the largest free block is sampled every BENCH_PROBE calls */
+#define BENCH_PROBE			256
+
+typedef enum
+{
+	BENCH_MALLOC, BENCH_FREE
+} tBenchType;
+
+typedef struct
+{
+	tBenchType xType;
+	int iId;
+	size_t xSize;
+} tBenchCall;
+
+typedef struct
+{
+	const char *pcName;
+	void *(*pfnMalloc)(size_t xSize);
+	void (*pfnFree)(void *pv);
+	size_t (*pfnFreeBytes)(void);
+	size_t (*pfnMinFree)(void);
+	size_t (*pfnLargest)(void);
+} tBenchHeap;
+
+static tBenchCall *pxCalls;
+static int iCalls, iCallsMax;
+
+/**
+ * Largest block of heap_2, the free list is sorted by size
+ */
+static size_t xHeap2Largest(void)
+{
+	xBlockLink *pxBlock, *pxLargest = NULL;
+
+	for (pxBlock = xStart.pxNextFreeBlock; pxBlock != &xEnd; pxBlock
+			= pxBlock->pxNextFreeBlock)
+	{
+		pxLargest = pxBlock;
+	}
+
+	return pxLargest ? pxLargest->xBlockSize - heapSTRUCT_SIZE : 0;
+}
+
+static size_t xTlsfLargest(void)
+{
+	xHeapStats xStats;
+
+	vTlsfGetHeapStats(&xStats);
+
+	return xStats.xLargestFreeBlock;
+}
+
+static const tBenchHeap xHeaps[] =
+{
+{ "heap_2", pvHeap2Malloc, vHeap2Free, xHeap2GetFreeHeapSize,
+		xHeap2GetMinimumEverFreeHeapSize, xHeap2Largest },
+{ "heap_tlsf", pvTlsfMalloc, vTlsfFree, xTlsfGetFreeHeapSize,
+		xTlsfGetMinimumEverFreeHeapSize, xTlsfLargest }, };
+
+static void vBenchAdd(tBenchType xType, int iId, size_t xSize)
+{
+	if (iCalls == iCallsMax)
+	{
+		iCallsMax = iCallsMax ? iCallsMax * 2 : 4096;
+		pxCalls = realloc(pxCalls, iCallsMax * sizeof(tBenchCall));
+		if (pxCalls == NULL)
+		{
+			fprintf(stderr, "out of memory\n");
+			exit(1);
+		}
+	}
+
+	pxCalls[iCalls].xType = xType;
+	pxCalls[iCalls].iId = iId;
+	pxCalls[iCalls].xSize = xSize;
+	iCalls++;
+}
+
+/**
+ * Reads a trace file
+ */
+static void vBenchRead(const char *pcPath)
+{
+	char pcLine[128];
+	unsigned long ulSize;
+	int iId;
+	FILE *pxFile;
+
+	pxFile = fopen(pcPath, "r");
+	if (pxFile == NULL)
+	{
+		perror(pcPath);
+		exit(1);
+	}
+
+	while (fgets(pcLine, sizeof(pcLine), pxFile) != NULL)
+	{
+		if (sscanf(pcLine, "m %d %lu", &iId, &ulSize) == 2)
+		{
+			vBenchAdd(BENCH_MALLOC, iId, ulSize);
+		}
+		else if (sscanf(pcLine, "f %d", &iId) == 1)
+		{
+			vBenchAdd(BENCH_FREE, iId, 0);
+		}
+	}
+
+	fclose(pxFile);
+}
+
+/**
+ * Simulates browsing: up to 4 connections at a time, every page has some
+ * SSI parameters and pbufs, every 50th page changes a long living value.
+ */
+static void vBenchSimulate(void)
+{
+	int iConn[4], iConnSend[4], iConnFile[4], iConnParams[4];
+	int i, j, k, iId = 0, iLong = 0, iLongIds[64];
+
+	srand(1);
+	memset(iConn, -1, sizeof(iConn));
+
+	for (i = 0; i < 20000; i++)
+	{
+		j = rand() % 4;
+
+		if (iConn[j] < 0)
+		{
+			/* new connection: http_state, FIL and SSI parameters */
+			iConn[j] = iId++;
+			vBenchAdd(BENCH_MALLOC, iConn[j], 600);
+			iConnFile[j] = iId++;
+			vBenchAdd(BENCH_MALLOC, iConnFile[j], 560);
+			iConnParams[j] = iId;
+			for (k = 4 + rand() % 12; k > 0; k--)
+			{
+				vBenchAdd(BENCH_MALLOC, iId++, 8 + rand() % 40);
+			}
+			for (k = 1 + rand() % 4; k > 0; k--)
+			{
+				/* pbufs of the lwIP heap (MEM_LIBC_MALLOC) */
+				vBenchAdd(BENCH_MALLOC, iId++, 64 + rand() % 1450);
+			}
+			iConnSend[j] = iId++;
+			vBenchAdd(BENCH_MALLOC, iConnSend[j], 3000);
+		}
+		else
+		{
+			/* close: parameters and pbufs in reverse, send buffer, file,
+			 state */
+			for (k = iConnSend[j] - 1; k >= iConnParams[j]; k--)
+			{
+				vBenchAdd(BENCH_FREE, k, 0);
+			}
+			vBenchAdd(BENCH_FREE, iConnSend[j], 0);
+			vBenchAdd(BENCH_FREE, iConnFile[j], 0);
+			vBenchAdd(BENCH_FREE, iConn[j], 0);
+			iConn[j] = -1;
+		}
+
+		if (i % 50 == 0)
+		{
+			/* a long living value is replaced */
+			if (iLong == 64)
+			{
+				vBenchAdd(BENCH_FREE, iLongIds[i / 50 % 64], 0);
+				iLongIds[i / 50 % 64] = iId;
+			}
+			else
+			{
+				iLongIds[iLong++] = iId;
+			}
+			vBenchAdd(BENCH_MALLOC, iId++, 16 + rand() % 64);
+		}
+	}
+}
+
+/**
+ * Replays the calls against one heap
+ */
+static void vBenchRun(const tBenchHeap *pxHeap)
+{
+	void **ppvIds;
+	struct timespec xT0, xT1;
+	size_t xLargest, xMinLargest = (size_t) -1;
+	int i, iFailed = 0, iFirstFailed = -1, iMaxId = 0;
+	double dNs = 0;
+
+	for (i = 0; i < iCalls; i++)
+	{
+		if (pxCalls[i].iId > iMaxId)
+		{
+			iMaxId = pxCalls[i].iId;
+		}
+	}
+	ppvIds = calloc(iMaxId + 1, sizeof(void *));
+
+	for (i = 0; i < iCalls; i++)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &xT0);
+		if (pxCalls[i].xType == BENCH_MALLOC)
+		{
+			ppvIds[pxCalls[i].iId] = pxHeap->pfnMalloc(pxCalls[i].xSize);
+		}
+		else
+		{
+			pxHeap->pfnFree(ppvIds[pxCalls[i].iId]);
+			ppvIds[pxCalls[i].iId] = NULL;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &xT1);
+		dNs += (xT1.tv_sec - xT0.tv_sec) * 1e9 + (xT1.tv_nsec - xT0.tv_nsec);
+
+		if (pxCalls[i].xType == BENCH_MALLOC && ppvIds[pxCalls[i].iId]
+				== NULL)
+		{
+			if (iFirstFailed < 0)
+			{
+				iFirstFailed = i;
+			}
+			iFailed++;
+		}
+
+		if (i % BENCH_PROBE == 0)
+		{
+			xLargest = pxHeap->pfnLargest();
+			if (xLargest < xMinLargest)
+			{
+				xMinLargest = xLargest;
+			}
+		}
+	}
+
+	xLargest = pxHeap->pfnLargest();
+	printf("%-10s %8d %8d %8d %8d %8d %8d %5d%% %8.1f\n", pxHeap->pcName,
+			iCalls, iFailed, iFirstFailed,
+			(int) (configTOTAL_HEAP_SIZE - pxHeap->pfnMinFree()),
+			(int) xMinLargest, (int) xLargest, (int) (pxHeap->pfnFreeBytes()
+					? 100 - 100 * xLargest / pxHeap->pfnFreeBytes() : 0),
+			dNs / iCalls);
+
+	free(ppvIds);
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int i;
+
+	if (argc > 1)
+	{
+		vBenchRead(argv[1]);
+	}
+	else
+	{
+		vBenchSimulate();
+	}
+
+	printf("heap %d bytes, %d bytes per pointer\n\n",
+			(int) configTOTAL_HEAP_SIZE, (int) sizeof(void *));
+	printf("%-10s %8s %8s %8s %8s %8s %8s %6s %8s\n", "heap", "calls",
+			"failed", "1st fail", "peak", "min lrg", "largest", "frag",
+			"ns/call");
+	for (i = 0; i < sizeof(xHeaps) / sizeof(xHeaps[0]); i++)
+	{
+		vBenchRun(&xHeaps[i]);
+	}
+
+	return 0;
+}
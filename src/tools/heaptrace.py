@@ -0,0 +1,307 @@
+#!/usr/bin/env python
+#
+# heaptrace.py - Analysis of the allocation trace (uInterface/log/heaptrace.c)
+#
+# The target records every pvPortMalloc()/vPortFree() with the return
+# address of the call. This tool resolves the callers with the map file
+# (rtosdemo.map, gives the object file of every function) or the symbol
+# table of the .axf file, sums the calls up per subsystem and writes the
+# calls in the format of tools/heapbench.c, which replays them against the
+# heap implementations.
+#
+# Usage:
+#   heaptrace.py [-o calls.txt] [-b heapbench] <rtosdemo.map|file.axf> <dump>
+#
+#   <dump> is a snapshot from the webserver (heaptrace.bin) or a UART log
+#   with the "#N" and "#H" lines of the trace task.
+#
+# Author: Anzinger Martin, Hahn Florian
+#
+
+import bisect
+import optparse
+import re
+import struct
+import subprocess
+import sys
+
+HEAP_TRACE_MAGIC = 0x50414548
+HEAP_TRACE_MALLOC = 0
+HEAP_TRACE_FREE = 1
+HEAP_TRACE_FAILED = 2
+HEAP_TRACE_NO_TASK = 0xFF
+
+HEADER = struct.Struct("<IIIHHHH")
+EVENT = struct.Struct("<IIIHHBBH")
+
+# subsystems by the path of the object file, the first match counts
+SUBSYSTEM_PATHS = [
+    ("taglib", re.compile(r"taglib/")),
+    ("httpd", re.compile(r"ethernet/httpd/|ethernet/fs/|lmi_fs")),
+    ("comTask", re.compile(r"communication/")),
+    ("grlib widgets", re.compile(r"graphic/gui/|grlib")),
+    ("webClient", re.compile(r"graphic/httpc/")),
+    ("lwip", re.compile(r"lwip|ethernet/")),
+    ("fatfs", re.compile(r"fatfs")),
+    ("freertos", re.compile(r"freeRTOS")),
+]
+
+# without a map file only the function names are known
+SUBSYSTEM_NAMES = [
+    ("taglib", re.compile(r"InputField|Hyperlink|[Tt]ag")),
+    ("httpd", re.compile(r"http|SSI|ssi|cgi|CGI|^fs_|Arena")),
+    ("comTask", re.compile(r"[Cc]om|SdCard")),
+    ("grlib widgets", re.compile(r"Widget|Canvas|PushButton|Checkbox|"
+                                 r"Slider|ListBox|RadioButton|display")),
+    ("webClient", re.compile(r"webClient|httpc")),
+    ("lwip", re.compile(r"^(pbuf|mem|memp|netconn|netbuf|tcp|udp|ip|etharp|"
+                        r"sys|lwip|dhcp|dns)_")),
+    ("fatfs", re.compile(r"^f_|^disk_")),
+    ("freertos", re.compile(r"^(x|v|ux|pv|prv)(Task|Queue|Port)")),
+]
+
+
+class Symbols(object):
+    """Function address ranges with name and object file"""
+
+    def __init__(self):
+        self.starts = []
+        self.entries = []
+
+    def add(self, start, size, name, obj):
+        self.entries.append((start, size, name, obj))
+
+    def finish(self):
+        self.entries.sort()
+        self.starts = [e[0] for e in self.entries]
+
+    def lookup(self, addr):
+        # the return address has the thumb bit set and points behind the
+        # call, step back into the calling instruction
+        addr = (addr & ~1) - 2
+        i = bisect.bisect_right(self.starts, addr) - 1
+        if i >= 0:
+            start, size, name, obj = self.entries[i]
+            if addr < start + max(size, 1):
+                return name, obj
+        return "0x%08x" % (addr + 2), None
+
+
+def read_map(path):
+    """Reads the .text.<function> input sections of the GNU ld map file
+    (the Makefile compiles with -ffunction-sections)"""
+    symbols = Symbols()
+    section = None
+    line_re = re.compile(r"^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S+)")
+    for line in open(path):
+        m = re.match(r"^ \.text\.(\S+)(.*)$", line)
+        if m:
+            section = m.group(1)
+            rest = line_re.match(m.group(2))
+            if rest:
+                symbols.add(int(rest.group(1), 16), int(rest.group(2), 16),
+                            section, rest.group(3))
+                section = None
+            continue
+        if section:
+            rest = line_re.match(line)
+            if rest:
+                symbols.add(int(rest.group(1), 16), int(rest.group(2), 16),
+                            section, rest.group(3))
+            section = None
+    symbols.finish()
+    return symbols
+
+
+def read_elf(path):
+    """Reads the function symbols of a little endian ELF32 file"""
+    data = open(path, "rb").read()
+    if data[:4] != b"\x7fELF" or data[4:5] != b"\x01" or data[5:6] != b"\x01":
+        raise ValueError("%s is not a little endian ELF32 file" % path)
+    shoff, = struct.unpack_from("<I", data, 0x20)
+    shentsize, shnum = struct.unpack_from("<HH", data, 0x2E)
+    sections = [struct.unpack_from("<10I", data, shoff + i * shentsize)
+                for i in range(shnum)]
+    symbols = Symbols()
+    for (name, stype, flags, addr, offset, size,
+         link, info, align, entsize) in sections:
+        if stype != 2:  # SHT_SYMTAB
+            continue
+        strtab = sections[link]
+        strings = data[strtab[4]:strtab[4] + strtab[5]]
+        source = None
+        for i in range(0, size, 16):
+            st_name, value, st_size, st_info, other, shndx = \
+                struct.unpack_from("<IIIBBH", data, offset + i)
+            sym = strings[st_name:strings.find(b"\0", st_name)].decode(
+                "latin-1")
+            if st_info & 0xF == 4:  # STT_FILE, the locals of the file follow
+                source = sym
+            elif st_info & 0xF == 2:  # STT_FUNC
+                # only local functions are listed behind their file
+                obj = source if st_info >> 4 == 0 else None
+                symbols.add(value & ~1, st_size, sym, obj)
+    symbols.finish()
+    return symbols
+
+
+def subsystem(name, obj):
+    if obj:
+        for sub, pattern in SUBSYSTEM_PATHS:
+            if pattern.search(obj):
+                return sub
+    for sub, pattern in SUBSYSTEM_NAMES:
+        if pattern.search(name):
+            return sub
+    return "other"
+
+
+def read_binary(data):
+    (magic, head, lost, ring_size, event_size,
+     ntasks, task_size) = HEADER.unpack_from(data, 0)
+    if magic != HEAP_TRACE_MAGIC or event_size != EVENT.size:
+        raise ValueError("no heap trace dump (magic 0x%08x, event size %d)"
+                         % (magic, event_size))
+    tasks = {}
+    offset = HEADER.size
+    for i in range(ntasks):
+        handle, = struct.unpack_from("<I", data, offset)
+        name = data[offset + 4:offset + task_size].split(b"\0")[0]
+        if handle:
+            tasks[i] = name.decode("latin-1")
+        offset += task_size
+    events = []
+    for i in range(ring_size):
+        events.append(EVENT.unpack_from(data, offset + i * EVENT.size))
+    # only the last ring_size calls are valid, order them by sequence number
+    # relative to the head
+    valid = min(head, ring_size)
+    events = [e for e in events if 0 < (head - e[3]) & 0xFFFF <= valid]
+    events.sort(key=lambda e: -((head - e[3]) & 0xFFFF))
+    # the ulLost of the header counts the calls the UART missed, the
+    # snapshot is complete from its first call on
+    return [(e[3], e[0], e[5], e[6], e[4], e[1], e[2]) for e in events], \
+        tasks, 0
+
+
+def read_uart(text):
+    tasks = {}
+    events = []
+    for line in text.splitlines():
+        parts = line.split()
+        if len(parts) >= 3 and parts[0] == "#N":
+            tasks[int(parts[1], 16)] = " ".join(parts[3:])
+        elif len(parts) == 8 and parts[0] == "#H":
+            events.append(tuple(int(p, 16) for p in parts[1:]))
+    return events, tasks, 0
+
+
+def main(argv):
+    parser = optparse.OptionParser(
+        usage="%prog [-o calls.txt] [-b heapbench] <file.map|file.axf> <dump>")
+    parser.add_option("-o", dest="output",
+                      help="write the calls for tools/heapbench.c")
+    parser.add_option("-b", dest="bench",
+                      help="replay the calls with this heapbench binary")
+    parser.add_option("-v", dest="verbose", action="store_true",
+                      help="print every call")
+    options, args = parser.parse_args(argv[1:])
+    if len(args) != 2:
+        parser.print_usage(sys.stderr)
+        return 1
+
+    if open(args[0], "rb").read(4) == b"\x7fELF":
+        symbols = read_elf(args[0])
+    else:
+        symbols = read_map(args[0])
+    data = open(args[1], "rb").read()
+    if data[:4] == struct.pack("<I", HEAP_TRACE_MAGIC):
+        events, tasks, lost = read_binary(data)
+    else:
+        events, tasks, lost = read_uart(data.decode("latin-1"))
+
+    # subsystem -> [allocations, frees, failed, bytes, live, peak live]
+    totals = {}
+    live = {}
+    calls = []
+    used = peak = 0
+    next_id = 0
+    gaps = 0
+    untracked = 0
+    last_seq = None
+
+    for seq, time, ctype, task, size, address, caller in events:
+        if last_seq is not None and (seq - last_seq) & 0xFFFF != 1:
+            gaps += ((seq - last_seq) & 0xFFFF) - 1
+        last_seq = seq
+
+        name, obj = symbols.lookup(caller)
+        sub = subsystem(name, obj)
+        task_name = tasks.get(task, "-" if task == HEAP_TRACE_NO_TASK
+                              else "task%d" % task)
+        if options.verbose:
+            print("%10d ms  %-12s %-6s %5d 0x%08x  %s (%s)" % (
+                time, task_name, ("malloc", "free", "FAILED")[ctype], size,
+                address, name, sub))
+
+        if ctype == HEAP_TRACE_FREE:
+            if address not in live:
+                # allocated before the first recorded call
+                untracked += 1
+                continue
+            block_id, block_size, block_sub = live.pop(address)
+            totals[block_sub][1] += 1
+            totals[block_sub][4] -= block_size
+            used -= block_size
+            calls.append("f %d" % block_id)
+            continue
+
+        entry = totals.setdefault(sub, [0, 0, 0, 0, 0, 0])
+        if ctype == HEAP_TRACE_FAILED:
+            entry[2] += 1
+            calls.append("# failed %d bytes from %s (%s)" % (size, name,
+                                                            task_name))
+            continue
+
+        entry[0] += 1
+        entry[3] += size
+        entry[4] += size
+        entry[5] = max(entry[5], entry[4])
+        used += size
+        peak = max(peak, used)
+        live[address] = (next_id, size, sub)
+        calls.append("m %d %d" % (next_id, size))
+        next_id += 1
+
+    print("%d calls, %d tasks, peak %d bytes requested, %d bytes live at "
+          "the end" % (len(events), len(tasks), peak, used))
+    if lost or gaps:
+        print("warning: %d calls lost, %d in gaps of the sequence - the "
+              "replay is incomplete" % (lost, gaps))
+    if untracked:
+        print("%d frees of blocks allocated before the trace were skipped"
+              % untracked)
+    print("")
+    print("%-14s %8s %8s %8s %10s %10s %10s" % (
+        "subsystem", "malloc", "free", "failed", "bytes", "peak live",
+        "live"))
+    for sub in sorted(totals, key=lambda s: -totals[s][5]):
+        a, f, failed, total, current, top = totals[sub]
+        print("%-14s %8d %8d %8d %10d %10d %10d" % (sub, a, f, failed,
+                                                    total, top, current))
+
+    if options.output or options.bench:
+        path = options.output or "heaptrace.calls"
+        out = open(path, "w")
+        out.write("# %s\n" % args[1])
+        out.write("\n".join(calls) + "\n")
+        out.close()
+        if options.bench:
+            print("")
+            sys.stdout.flush()
+            return subprocess.call([options.bench, path])
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
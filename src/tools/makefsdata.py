@@ -0,0 +1,171 @@
+#!/usr/bin/env python
+#
+# makefsdata.py - Generator for the internal flash file system (lmi-fsdata.h)
+#
+# Replacement for the makefsfile utility. Every file below the input
+# directory becomes a const array in flash. The files are listed in an index
+# sorted by name, so lmi_fs.c finds them with a binary search. Size, MIME
+# type and an ETag (CRC32 of the data) are computed here instead of on the
+# target. The ETag is part of the prepended headers and the index, httpd
+# answers a matching If-None-Match with 304.
+#
+# Usage:
+#   makefsdata.py -i fs -o lmi-fsdata.h [-h]
+#
+#   -i  input directory, its content is mounted below "httpd-fs"
+#   -o  output header
+#   -h  prepend HTTP/1.0 headers to the data (404 status for /404.*), files
+#       with 200 status get an ETag
+#
+# Author: Anzinger Martin, Hahn Florian
+#
+
+import getopt
+import os
+import re
+import sys
+import zlib
+
+MIME_TYPES = {
+    ".html": "text/html",
+    ".htm": "text/html",
+    ".shtml": "text/html",
+    ".ssi": "text/html",
+    ".css": "text/css",
+    ".js": "application/x-javascript",
+    ".gif": "image/gif",
+    ".jpg": "image/jpeg",
+    ".png": "image/png",
+    ".ico": "image/x-icon",
+    ".xml": "text/xml",
+    ".txt": "text/plain",
+    ".bin": "application/octet-stream",
+}
+
+SERVER = "Server: lwIP/1.3.0 (http://www.sics.se/~adam/lwip/)\r\n"
+
+HEADER = """/**
+ * \\addtogroup Ethernet
+ * @{
+ *
+ * \\author Anziner, Hahn
+ * \\brief
+ *
+ */
+
+//***************************************************************************
+//
+// File System Image.
+//
+// This file was automatically generated using tools/makefsdata.py, the
+// index is sorted by name (binary search in lmi_fs.c).
+//
+//***************************************************************************
+
+"""
+
+FOOTER = """
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
+"""
+
+
+def mime_type(name):
+    return MIME_TYPES.get(os.path.splitext(name)[1].lower(), "text/plain")
+
+
+def is_404(name):
+    return os.path.basename(name).startswith("404.")
+
+
+def etag(data):
+    # 0 means "no ETag" in the index
+    return (zlib.crc32(data) & 0xFFFFFFFF) or 1
+
+
+def http_header(name, tag):
+    if is_404(name):
+        status = "HTTP/1.0 404 File not found\r\n"
+    else:
+        status = "HTTP/1.0 200 OK\r\n"
+    fields = SERVER + "Content-type: " + mime_type(name) + "\r\n"
+    if tag:
+        fields += "ETag: \"%08x\"\r\n" % tag
+    return (status + fields + "\r\n").encode("latin-1")
+
+
+def c_identifier(name):
+    return "data" + re.sub(r"[^A-Za-z0-9]", "_", name)
+
+
+def collect(root):
+    files = []
+    for dirpath, dirnames, filenames in os.walk(root):
+        dirnames.sort()
+        for filename in filenames:
+            path = os.path.join(dirpath, filename)
+            name = "/" + os.path.relpath(path, root).replace(os.sep, "/")
+            files.append((name, path))
+    # same order as strcmp() on the target
+    files.sort(key=lambda f: f[0].encode("latin-1"))
+    return files
+
+
+def c_array(ident, name, data):
+    lines = ["static const unsigned char %s[] =" % ident, "{", "/* %s */" % name]
+    for i in range(0, len(data), 12):
+        chunk = data[i:i + 12]
+        prefix = "" if i == 0 else "\t\t"
+        lines.append(prefix + ", ".join("0x%02X" % b for b in bytearray(chunk))
+                     + ",")
+    if not data:
+        lines.append("0x00,")
+    lines.append("};")
+    return "\n".join(lines) + "\n\n"
+
+
+def generate(root, headers):
+    out = [HEADER]
+    index = []
+    for name, path in collect(root):
+        data = open(path, "rb").read()
+        # without headers the ETag can't be sent, an error page isn't cached
+        tag = etag(data) if headers and not is_404(name) else 0
+        if headers:
+            data = http_header(name, tag) + data
+        ident = c_identifier(name)
+        out.append(c_array(ident, name, data))
+        index.append((name, ident, len(data), tag))
+
+    out.append("const tFsRomFile g_psFsRomFiles[] =\n{\n")
+    for name, ident, size, tag in index:
+        out.append("{ \"%s\", %s, %d, 0x%08XUL },\n"
+                   % (name, ident, size, tag))
+    out.append("};\n\n#define FS_ROM_NUMFILES %d\n" % len(index))
+    out.append(FOOTER)
+    return "".join(out)
+
+
+def main(argv):
+    try:
+        opts, args = getopt.getopt(argv[1:], "i:o:h")
+    except getopt.GetoptError as err:
+        sys.stderr.write("%s\n" % err)
+        return 1
+    opts = dict(opts)
+    if "-i" not in opts or "-o" not in opts or args:
+        sys.stderr.write("usage: %s -i <dir> -o <lmi-fsdata.h> [-h]\n"
+                         % argv[0])
+        return 1
+
+    text = generate(opts["-i"], "-h" in opts)
+    open(opts["-o"], "w").write(text)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,524 @@
+/*
+ * ssibench.c - Host benchmark of the SSI0 bus manager and the SD Card driver
+ *
+ * Compiles uInterface/ssiBus.c and external/fatfs/mmc-dk-lm3s9b96.c against
+ * a mocked SSI port. Behind the port an SDHC card in SPI mode answers the
+ * commands of the driver (CMD0/8/55/41/58 to initialize, CMD17/18/12 to
+ * read, CMD24/25 to write, CMD9 for the size). The mock counts the frames
+ * clocked at every bit rate, the bus time is frames * 8 / bit rate.
+ *
+ * The same load runs twice:
+ *
+ *   fs_enable  the old code, fs_open/fs_read/logging called
+ *              fs_enable(400000) before every access, which reconfigured the
+ *              port to the 400 kHz identification clock
+ *   ssiBus     the bus manager, the port stays at the data clock
+ *
+ * The load is a mount (disk_initialize, sector count), single sector reads
+ * as FatFs does them without the cache, 4 sector reads as the read-ahead of
+ * the cache does them and single sector writes as appendToLog does them.
+ * All read data is compared with the card.
+ *
+ * The time is the time on the wire only, the CPU time per frame of the
+ * polling driver comes on top on the target and is the same in both runs.
+ *
+ * Like the target, the mock faults (exit code 2) if a register of the SSI
+ * port or a GPIO port is accessed before SysCtlPeripheralEnable() clocked it.
+ *
+ * Build (from src/):
+ *   gcc -O2 -I uInterface -I external/fatfs -I external/lm3s9b96 \
+ *       -I external/lm3s9b96/inc -I external/lm3s9b96/driverlib \
+ *       -I external/lm3s9b96/drivers -I external/freeRTOS/Source/include \
+ *       -o ssibench tools/ssibench.c
+ *
+ * Usage:
+ *   ssibench [sectors]
+ *
+ * Author: Anzinger Martin, Hahn Florian
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* FreeRTOS, only the recursive mutex of the bus manager */
+#define INC_FREERTOS_H
+#define TASK_H
+#define SEMAPHORE_H
+typedef void *xSemaphoreHandle;
+#define portMAX_DELAY					0xffffffffUL
+#define xSemaphoreCreateRecursiveMutex()	((xSemaphoreHandle) &mutex_depth)
+#define xSemaphoreTakeRecursive(x, t)	(mutex_takes++, ++mutex_depth)
+#define xSemaphoreGiveRecursive(x)		(--mutex_depth)
+
+static int mutex_depth;
+static unsigned long mutex_takes;
+
+/* the sector cache is not part of this benchmark */
+#include "diskcache.h"
+void disk_cache_invalidate(void) { }
+
+#include "../uInterface/ssiBus.c"
+#include "../external/fatfs/mmc-dk-lm3s9b96.c"
+
+/* system clock of the board */
+#define SYS_CLOCK			50000000UL
+
+/* size of the emulated card in sectors */
+#define CARD_SECTORS		4096
+
+/* 0xFF bytes before a data token (N_AC) */
+#define CARD_NAC			4
+
+/* busy bytes after a written block */
+#define CARD_BUSY			8
+
+/* bit rates the port ran at */
+#define MAX_RATES			4
+
+/*
+ * The mocked SSI port
+ */
+static unsigned long ssi_rate;
+static unsigned long rates[MAX_RATES];
+static unsigned long frames[MAX_RATES];
+static unsigned long configs;
+static int cs_low;
+
+/* clocked peripherals (SysCtlPeripheralEnable) */
+#define MAX_CLOCKED			8
+static unsigned long clocked[MAX_CLOCKED];
+static int num_clocked;
+
+/*
+ * The emulated card
+ */
+static BYTE card[CARD_SECTORS][512];
+static BYTE out[600];
+static int out_len, out_pos;
+static BYTE cmd[6];
+static int cmd_len;
+static int idle = 1;
+static int app_cmd;
+
+enum card_state { CARD_CMD, CARD_READ_MULTI, CARD_WRITE_TOKEN, CARD_WRITE_DATA };
+static enum card_state state = CARD_CMD;
+static DWORD next_sector;
+static int multi_write, data_len;
+static BYTE write_buf[514];
+
+static void
+card_queue(const BYTE *data, int len)
+{
+	memcpy(out + out_len, data, len);
+	out_len += len;
+}
+
+static void
+card_queue_byte(BYTE b)
+{
+	out[out_len++] = b;
+}
+
+/* Queues a data block with the leading 0xFF bytes, token and CRC */
+static void
+card_queue_block(const BYTE *data, int len)
+{
+	int i;
+
+	for (i = 0; i < CARD_NAC; i++)
+		card_queue_byte(0xFF);
+	card_queue_byte(0xFE);
+	card_queue(data, len);
+	card_queue_byte(0);
+	card_queue_byte(0);
+}
+
+static void
+card_command(void)
+{
+	DWORD arg = (DWORD) cmd[1] << 24 | (DWORD) cmd[2] << 16 |
+			(DWORD) cmd[3] << 8 | cmd[4];
+	BYTE index = cmd[0] & 0x3F;
+	BYTE r1 = idle ? 0x01 : 0x00;
+	BYTE csd[16];
+	int app = app_cmd;
+
+	out_len = out_pos = 0;
+	app_cmd = 0;
+	card_queue_byte(0xFF);			/* N_CR */
+
+	switch (index)
+	{
+	case 0:
+		idle = 1;
+		state = CARD_CMD;
+		card_queue_byte(0x01);
+		break;
+	case 8:
+		card_queue_byte(r1);
+		card_queue((const BYTE *) "\x00\x00\x01\xAA", 4);
+		break;
+	case 55:
+		app_cmd = 1;
+		card_queue_byte(r1);
+		break;
+	case 41:
+		idle = 0;
+		card_queue_byte(app ? 0x00 : 0x05);
+		break;
+	case 58:
+		card_queue_byte(r1);
+		card_queue((const BYTE *) "\xC0\xFF\x80\x00", 4);	/* CCS set */
+		break;
+	case 9:
+		memset(csd, 0, sizeof(csd));
+		csd[0] = 0x40;						/* CSD version 2.0 */
+		csd[8] = ((CARD_SECTORS / 1024 - 1) >> 8) & 0xFF;
+		csd[9] = (CARD_SECTORS / 1024 - 1) & 0xFF;
+		card_queue_byte(0x00);
+		card_queue_block(csd, sizeof(csd));
+		break;
+	case 12:
+		state = CARD_CMD;
+		card_queue_byte(0xFF);				/* stuff byte */
+		card_queue_byte(0x00);
+		break;
+	case 16:
+	case 23:
+		card_queue_byte(r1);
+		break;
+	case 17:
+		card_queue_byte(0x00);
+		card_queue_block(card[arg % CARD_SECTORS], 512);
+		break;
+	case 18:
+		card_queue_byte(0x00);
+		state = CARD_READ_MULTI;
+		next_sector = arg;
+		break;
+	case 24:
+	case 25:
+		card_queue_byte(0x00);
+		state = CARD_WRITE_TOKEN;
+		next_sector = arg;
+		multi_write = (index == 25);
+		break;
+	default:
+		card_queue_byte(0x04);				/* illegal command */
+		break;
+	}
+}
+
+/* One frame, returns the byte clocked in from the card */
+static BYTE
+card_xfer(BYTE b)
+{
+	BYTE in = 0xFF;
+	int i;
+
+	if (!cs_low)
+	{
+		cmd_len = 0;
+		return 0xFF;
+	}
+
+	if (out_pos < out_len)
+	{
+		in = out[out_pos++];
+	}
+	else if (state == CARD_READ_MULTI)
+	{
+		out_len = out_pos = 0;
+		card_queue_block(card[next_sector++ % CARD_SECTORS], 512);
+		in = out[out_pos++];
+	}
+
+	switch (state)
+	{
+	case CARD_WRITE_TOKEN:
+		if (b == 0xFE || b == 0xFC)
+		{
+			state = CARD_WRITE_DATA;
+			data_len = 0;
+		}
+		else if (b == 0xFD)
+		{
+			/* stop token of a multiple block write */
+			state = CARD_CMD;
+			out_len = out_pos = 0;
+			card_queue_byte(0xFF);
+			for (i = 0; i < CARD_BUSY; i++)
+				card_queue_byte(0x00);
+		}
+		return in;
+
+	case CARD_WRITE_DATA:
+		write_buf[data_len++] = b;
+		if (data_len == 514)
+		{
+			memcpy(card[next_sector++ % CARD_SECTORS], write_buf, 512);
+			out_len = out_pos = 0;
+			card_queue_byte(0xE5);			/* data accepted */
+			for (i = 0; i < CARD_BUSY; i++)
+				card_queue_byte(0x00);
+			state = multi_write ? CARD_WRITE_TOKEN : CARD_CMD;
+		}
+		return in;
+
+	default:
+		break;
+	}
+
+	if (cmd_len == 0 && (b & 0xC0) != 0x40)
+	{
+		return in;
+	}
+
+	cmd[cmd_len++] = b;
+	if (cmd_len == 6)
+	{
+		cmd_len = 0;
+		card_command();
+	}
+
+	return in;
+}
+
+/*
+ * driverlib functions used by the bus manager and the driver
+ */
+static BYTE ssi_rx;
+
+unsigned long SysCtlClockGet(void) { return SYS_CLOCK; }
+
+void
+SysCtlPeripheralEnable(unsigned long ulPeripheral)
+{
+	int i;
+
+	for (i = 0; i < num_clocked; i++)
+		if (clocked[i] == ulPeripheral)
+			return;
+	if (num_clocked < MAX_CLOCKED)
+		clocked[num_clocked++] = ulPeripheral;
+}
+
+/* Faults like the target if the peripheral at ulBase is not clocked */
+static void
+check_clock(const char *func, unsigned long ulBase)
+{
+	unsigned long periph;
+	int i;
+
+	switch (ulBase)
+	{
+	case SSI0_BASE:			periph = SYSCTL_PERIPH_SSI0; break;
+	case GPIO_PORTA_BASE:	periph = SYSCTL_PERIPH_GPIOA; break;
+	case GPIO_PORTF_BASE:	periph = SYSCTL_PERIPH_GPIOF; break;
+	default:
+		printf("%s: unknown peripheral 0x%08lx\n", func, ulBase);
+		exit(2);
+	}
+
+	for (i = 0; i < num_clocked; i++)
+		if (clocked[i] == periph)
+			return;
+
+	printf("bus fault: %s on unclocked peripheral 0x%08lx\n", func, ulBase);
+	exit(2);
+}
+
+void SSIEnable(unsigned long ulBase) { check_clock("SSIEnable", ulBase); }
+void SSIDisable(unsigned long ulBase) { check_clock("SSIDisable", ulBase); }
+
+void
+GPIOPinTypeSSI(unsigned long ulPort, unsigned char ucPins)
+{
+	check_clock("GPIOPinTypeSSI", ulPort);
+}
+
+void
+GPIOPinTypeGPIOOutput(unsigned long ulPort, unsigned char ucPins)
+{
+	check_clock("GPIOPinTypeGPIOOutput", ulPort);
+}
+
+void
+GPIOPadConfigSet(unsigned long ulPort, unsigned char ucPins,
+		unsigned long ulStrength, unsigned long ulPadType)
+{
+	check_clock("GPIOPadConfigSet", ulPort);
+}
+
+void
+GPIOPinWrite(unsigned long ulPort, unsigned char ucPins, unsigned char ucVal)
+{
+	check_clock("GPIOPinWrite", ulPort);
+	if (ulPort == SDCARD_CS_BASE && (ucPins & SDCARD_CS_PIN))
+	{
+		cs_low = !(ucVal & SDCARD_CS_PIN);
+	}
+}
+
+void
+SSIConfigSetExpClk(unsigned long ulBase, unsigned long ulSSIClk,
+		unsigned long ulProtocol, unsigned long ulMode,
+		unsigned long ulBitRate, unsigned long ulDataWidth)
+{
+	check_clock("SSIConfigSetExpClk", ulBase);
+
+	/* the port divides the clock by at least 2 */
+	ssi_rate = ulBitRate < ulSSIClk / 2 ? ulBitRate : ulSSIClk / 2;
+	configs++;
+}
+
+void
+SSIDataPut(unsigned long ulBase, unsigned long ulData)
+{
+	int i;
+
+	check_clock("SSIDataPut", ulBase);
+	for (i = 0; i < MAX_RATES - 1 && rates[i] != 0 && rates[i] != ssi_rate; i++)
+		;
+	rates[i] = ssi_rate;
+	frames[i]++;
+
+	ssi_rx = card_xfer((BYTE) ulData);
+}
+
+void
+SSIDataGet(unsigned long ulBase, unsigned long *pulData)
+{
+	check_clock("SSIDataGet", ulBase);
+	*pulData = ssi_rx;
+}
+
+/*
+ * The old fs_enable() of lmi_fs.c
+ */
+static void
+fs_enable(unsigned long ulFrequency)
+{
+	SSIDisable(SSI0_BASE);
+	SSIConfigSetExpClk(SSI0_BASE, SysCtlClockGet(), SSI_FRF_MOTO_MODE_0,
+			SSI_MODE_MASTER, ulFrequency, 8);
+	SSIEnable(SSI0_BASE);
+}
+
+static int errors;
+
+/* One run of the load, prints a line of results */
+static void
+run(const char *name, int old, long sectors)
+{
+	static BYTE buf[4 * 512];
+	double seconds = 0;
+	unsigned long bytes = 0, total = 0;
+	DWORD count = 0;
+	long i;
+	int r;
+
+	memset(rates, 0, sizeof(rates));
+	memset(frames, 0, sizeof(frames));
+	configs = 0;
+	mutex_takes = 0;
+	Stat = STA_NOINIT;
+	iSSIConfigured = -1;
+
+	if (old)
+		fs_enable(400000);
+	if (disk_initialize(0) & STA_NOINIT)
+	{
+		printf("%s: disk_initialize failed\n", name);
+		errors++;
+		return;
+	}
+	if (old)
+		fs_enable(400000);
+	if (disk_ioctl(0, GET_SECTOR_COUNT, &count) != RES_OK ||
+			count != CARD_SECTORS)
+	{
+		printf("%s: sector count %lu\n", name, (unsigned long) count);
+		errors++;
+	}
+
+	for (i = 0; i < sectors; i++)
+	{
+		/* FatFs without the cache: one sector per call */
+		if (old)
+			fs_enable(400000);
+		r = mmc_disk_read(0, buf, i % CARD_SECTORS, 1);
+		if (r != RES_OK || memcmp(buf, card[i % CARD_SECTORS], 512) != 0)
+		{
+			errors++;
+		}
+		bytes += 512;
+
+		/* a read-ahead of the cache every 4th sector */
+		if ((i & 3) == 0)
+		{
+			if (old)
+				fs_enable(400000);
+			r = mmc_disk_read(0, buf, (i + 1000) % (CARD_SECTORS - 4), 4);
+			if (r != RES_OK || memcmp(buf, card[(i + 1000) % (CARD_SECTORS - 4)],
+					sizeof(buf)) != 0)
+			{
+				errors++;
+			}
+			bytes += sizeof(buf);
+		}
+
+		/* a log line every 16th sector */
+		if ((i & 15) == 0)
+		{
+			memset(buf, 'a' + i % 26, 512);
+			if (old)
+				fs_enable(400000);
+			r = mmc_disk_write(0, buf, CARD_SECTORS - 1, 1);
+			if (r != RES_OK || card[CARD_SECTORS - 1][0] != 'a' + i % 26)
+			{
+				errors++;
+			}
+			bytes += 512;
+		}
+	}
+
+	for (i = 0; i < MAX_RATES && rates[i]; i++)
+	{
+		seconds += frames[i] * 8.0 / rates[i];
+		total += frames[i];
+	}
+
+	printf("%-10s %10lu %10lu %8lu %8lu %10.1f %10.1f\n", name, bytes, total,
+			configs, mutex_takes, seconds * 1000, bytes / seconds / 1024);
+	for (i = 0; i < MAX_RATES && rates[i]; i++)
+	{
+		printf("%-10s   %9lu frames at %lu Hz\n", "", frames[i], rates[i]);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	long sectors = 1024;
+	int i, j;
+
+	if (argc > 1)
+		sectors = atol(argv[1]);
+
+	srand(1);
+	for (i = 0; i < CARD_SECTORS; i++)
+		for (j = 0; j < 512; j++)
+			card[i][j] = rand();
+
+	vSSIBusInit();
+
+	printf("%-10s %10s %10s %8s %8s %10s %10s\n", "", "data B", "frames",
+			"configs", "acquire", "bus ms", "KB/s");
+	run("fs_enable", 1, sectors);
+	run("ssiBus", 0, sectors);
+
+	printf("%d errors\n", errors);
+
+	return errors ? 1 : 0;
+}
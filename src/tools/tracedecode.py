@@ -0,0 +1,163 @@
+#!/usr/bin/env python
+#
+# tracedecode.py - Decoder for the deferred binary trace (uInterface/log/trace.c)
+#
+# The target records only the address of the format string, a cycle counter
+# timestamp and the raw argument words. This tool looks the format strings up
+# in the .axf file and rebuilds the messages.
+#
+# Usage:
+#   tracedecode.py Maschinen_Simulation.axf trace.bin      (SD Card / HTTP)
+#   tracedecode.py Maschinen_Simulation.axf uart.log       (UART, "#T" lines)
+#
+# Author: Anzinger Martin, Hahn Florian
+#
+
+import re
+import struct
+import sys
+
+TRACE_MAGIC = 0x45435254
+TRACE_FLAG_STRING = 0x01
+TRACE_MAX_ARGS = 4
+# prvSetupHardware() runs the core from the PLL at 50 MHz
+CPU_CLOCK_HZ = 50000000
+
+HEADER = struct.Struct("<IIIHH")
+EVENT = struct.Struct("<IIHBB%dI" % TRACE_MAX_ARGS)
+
+CONVERSION = re.compile(r"%([-0 ]*)(\d*)([diuxXcsp%])")
+
+
+class Elf(object):
+    """Minimal ELF32 little endian reader, maps addresses to file contents"""
+
+    def __init__(self, path):
+        data = open(path, "rb").read()
+        if data[:4] != b"\x7fELF" or data[4] != 1 or data[5] != 1:
+            raise ValueError("%s is not a little endian ELF32 file" % path)
+        shoff, = struct.unpack_from("<I", data, 0x20)
+        shentsize, shnum = struct.unpack_from("<HH", data, 0x2E)
+        self.sections = []
+        for i in range(shnum):
+            (name, stype, flags, addr, offset, size,
+             link, info, align, entsize) = struct.unpack_from(
+                "<10I", data, shoff + i * shentsize)
+            # allocated sections with contents (SHT_NOBITS = 8)
+            if flags & 0x2 and stype != 8 and size:
+                self.sections.append((addr, data[offset:offset + size]))
+
+    def string(self, addr):
+        if addr == 0:
+            return "(null)"
+        for base, content in self.sections:
+            if base <= addr < base + len(content):
+                end = content.find(b"\0", addr - base)
+                if end < 0:
+                    end = len(content)
+                return content[addr - base:end].decode("latin-1")
+        return "<0x%08x>" % addr
+
+
+def inline_string(args, first):
+    raw = b"".join(struct.pack("<I", a) for a in args[first:])
+    return raw.split(b"\0")[0].decode("latin-1")
+
+
+def render(elf, fmt_addr, nargs, flags, args):
+    fmt = elf.string(fmt_addr)
+    numbers = list(args[:nargs])
+    text = inline_string(args, nargs) if flags & TRACE_FLAG_STRING else None
+
+    def convert(match):
+        pad, width, conv = match.groups()
+        if conv == "%":
+            return "%"
+        if conv == "s":
+            if text is not None:
+                value = text
+            else:
+                value = elf.string(numbers.pop(0) if numbers else 0)
+        else:
+            value = numbers.pop(0) if numbers else 0
+            if conv in "di" and value & 0x80000000:
+                value -= 0x100000000
+            if conv == "c":
+                value = chr(value & 0xFF)
+            elif conv == "p":
+                value = "0x%08x" % value
+            else:
+                spec = {"u": "d", "i": "d"}.get(conv, conv)
+                value = ("%" + spec) % value
+        width = int(width) if width else 0
+        if "-" in pad:
+            return value.ljust(width)
+        return value.rjust(width, "0" if "0" in pad else " ")
+
+    return CONVERSION.sub(convert, fmt).rstrip("\n")
+
+
+def read_binary(data):
+    magic, head, lost, ring_size, event_size = HEADER.unpack_from(data, 0)
+    if magic != TRACE_MAGIC or event_size != EVENT.size:
+        raise ValueError("no trace dump (magic 0x%08x, event size %d)"
+                         % (magic, event_size))
+    events = []
+    for offset in range(HEADER.size, len(data) - EVENT.size + 1, EVENT.size):
+        fields = EVENT.unpack_from(data, offset)
+        events.append((fields[2], fields[1], fields[0], fields[3], fields[4],
+                       fields[5:]))
+    if ring_size:
+        # HTTP snapshot: only the last ring_size events are valid, order
+        # them by sequence number relative to the head
+        valid = min(head, ring_size)
+        events = [e for e in events
+                  if 0 < (head - e[0]) & 0xFFFF <= valid]
+        events.sort(key=lambda e: -((head - e[0]) & 0xFFFF))
+    return events, lost
+
+
+def read_uart(text):
+    events = []
+    for line in text.splitlines():
+        parts = line.split()
+        if len(parts) != 9 or parts[0] != "#T":
+            continue
+        values = [int(p, 16) for p in parts[1:]]
+        seq, time, fmt, argflags = values[:4]
+        events.append((seq, time, fmt, argflags >> 8, argflags & 0xFF,
+                       tuple(values[4:])))
+    return events, 0
+
+
+def main(argv):
+    if len(argv) != 3:
+        sys.stderr.write("usage: %s <file.axf> <trace.bin|uart.log>\n" % argv[0])
+        return 1
+
+    elf = Elf(argv[1])
+    data = open(argv[2], "rb").read()
+    if data[:4] == struct.pack("<I", TRACE_MAGIC):
+        events, lost = read_binary(data)
+    else:
+        events, lost = read_uart(data.decode("latin-1"))
+
+    last_seq = None
+    last_time = None
+    elapsed = 0
+    for seq, time, fmt, nargs, flags, args in events:
+        if last_seq is not None and (seq - last_seq) & 0xFFFF != 1:
+            print("---- %d events lost ----" % (((seq - last_seq) & 0xFFFF) - 1))
+        if last_time is not None:
+            # the cycle counter wraps every 85 s at 50 MHz
+            elapsed += (time - last_time) & 0xFFFFFFFF
+        last_seq, last_time = seq, time
+        print("%12.3f ms  %5d  %s" % (elapsed * 1000.0 / CPU_CLOCK_HZ, seq,
+                                     render(elf, fmt, nargs, flags, args)))
+    if lost:
+        print("---- %d events overwritten on the target ----" % lost)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,257 @@
+/*
+ * uartringtest.c - Host test of the UART ring buffers
+ *
+ * Compiles uInterface/uart/uartring.c and checks it against a simulated
+ * UART: a producer writes random lines the way UARTRingWrite() does for the
+ * console channel (make room by dropping the oldest lines, then put the
+ * bytes) and a consumer drains a random number of bytes the way the TX
+ * interrupt fills the FIFO. Checks that
+ *
+ *   - the ring never stores more than ulSize - 1 bytes and the used and free
+ *     counts add up, also across the wrap of the indices
+ *   - the consumer sees every line complete and in the order written, or
+ *     not at all, or, if it had already read the start of a dropped line,
+ *     that start ended with a CR LF
+ *   - ulDropped counts exactly the bytes which were not received (it may
+ *     count more if lines are larger than the ring)
+ *   - a write larger than the ring is truncated to ulSize - 1 bytes
+ *
+ * Build (from src/):
+ *   gcc -O2 -Wall -o uartringtest tools/uartringtest.c
+ *
+ * Usage:
+ *   uartringtest [iterations]
+ *
+ * Author: Anzinger Martin, Hahn Florian
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../uInterface/uart/uartring.c"
+
+/* the console ring of uartstdio.c (UART_TX_BUFFER_SIZE) and a small one */
+static const unsigned long sizes[] = { 1024, 128, 17, 2 };
+
+static int failures;
+
+#define CHECK(cond, ...)						\
+	do									\
+	{									\
+		if (!(cond))						\
+		{								\
+			printf(__VA_ARGS__);			\
+			printf(" (line %d)\n", __LINE__);	\
+			failures++;					\
+		}								\
+	} while (0)
+
+/**
+ * Basic put/get/full/empty behaviour
+ */
+static void
+test_basic(unsigned long size)
+{
+	unsigned char buf[1024];
+	unsigned char c;
+	tUARTRing ring;
+	unsigned long i, n;
+
+	UARTRingInit(&ring, buf, size);
+	CHECK(UARTRingEmpty(&ring), "size %lu: not empty after init", size);
+	CHECK(UARTRingFree(&ring) == size - 1, "size %lu: free %lu", size,
+			UARTRingFree(&ring));
+
+	/* move the indices around the wrap a few times */
+	for (n = 0; n < 3 * size; n++)
+	{
+		CHECK(UARTRingPut(&ring, (unsigned char) n), "size %lu: put failed",
+				size);
+		CHECK(UARTRingGet(&ring, &c) && c == (unsigned char) n,
+				"size %lu: get returned wrong byte", size);
+	}
+	CHECK(!UARTRingGet(&ring, &c), "size %lu: get from empty ring", size);
+
+	for (i = 0; i < size - 1; i++)
+	{
+		CHECK(UARTRingPut(&ring, (unsigned char) i), "size %lu: put %lu failed",
+				size, i);
+		CHECK(UARTRingUsed(&ring) + UARTRingFree(&ring) == size - 1,
+				"size %lu: used %lu + free %lu", size, UARTRingUsed(&ring),
+				UARTRingFree(&ring));
+	}
+	CHECK(!UARTRingPut(&ring, 0), "size %lu: put into full ring", size);
+	CHECK(UARTRingUsed(&ring) == size - 1, "size %lu: used %lu", size,
+			UARTRingUsed(&ring));
+
+	for (i = 0; i < size - 1; i++)
+	{
+		CHECK(UARTRingGet(&ring, &c) && c == (unsigned char) i,
+				"size %lu: get %lu", size, i);
+	}
+	CHECK(UARTRingEmpty(&ring), "size %lu: not empty after drain", size);
+
+	/* a write larger than the ring */
+	n = UARTRingMakeRoom(&ring, size * 2);
+	CHECK(n == size - 1, "size %lu: room %lu for an oversized write", size, n);
+
+	UARTRingPut(&ring, 'x');
+	UARTRingFlush(&ring);
+	CHECK(UARTRingEmpty(&ring), "size %lu: not empty after flush", size);
+}
+
+/**
+ * Writes pcLine like UARTRingWrite() with bDrop set, returns the bytes
+ * stored
+ */
+static unsigned long
+ring_write(tUARTRing *ring, const char *line, unsigned long len)
+{
+	unsigned long room, i;
+
+	room = UARTRingMakeRoom(ring, len);
+	if (room < len)
+	{
+		ring->ulDropped += len - room;
+	}
+
+	for (i = 0; i < len; i++)
+	{
+		if (!UARTRingPut(ring, line[i]))
+		{
+			break;
+		}
+	}
+
+	return i;
+}
+
+/**
+ * Random lines against a random consumer
+ */
+static void
+test_stream(unsigned long size, long iterations)
+{
+	static char line[64];
+	static unsigned char buf[1024];
+	static char rx[256];
+	tUARTRing ring;
+	unsigned long written = 0, received = 0, lost = 0, stored, cut = 0;
+	unsigned long seq = 0, expect = 0, rxlen = 0, len, n;
+	unsigned char c;
+	long it;
+
+	UARTRingInit(&ring, buf, size);
+
+	for (it = 0; it < iterations; it++)
+	{
+		/* a line "<seq> xxxx\n" of random length */
+		len = snprintf(line, sizeof(line), "%lu ", seq);
+		n = rand() % 40;
+		memset(line + len, 'a' + seq % 26, n);
+		len += n;
+		line[len++] = '\n';
+
+		stored = ring_write(&ring, line, len);
+		written += len;
+		if (stored < len)
+		{
+			/* truncated, only for lines larger than the ring */
+			CHECK(len > size - 1, "size %lu: line of %lu truncated", size, len);
+		}
+		seq++;
+
+		CHECK(UARTRingUsed(&ring) <= size - 1, "size %lu: used %lu", size,
+				UARTRingUsed(&ring));
+
+		/* the interrupt drains a FIFO's worth now and then */
+		n = (rand() % 4 == 0) ? rand() % 32 : 0;
+		while (n-- && UARTRingGet(&ring, &c))
+		{
+			received++;
+			cut += (c == '\r');
+			if (rxlen < sizeof(rx) - 1)
+			{
+				rx[rxlen++] = c;
+			}
+			if (c != '\n')
+			{
+				continue;
+			}
+
+			rx[rxlen] = 0;
+			if (size <= sizeof(line))
+			{
+				/* lines larger than the ring are truncated, no order */
+			}
+			else if (rxlen > 1 && rx[rxlen - 2] == '\r')
+			{
+				/* a line cut by UARTRingMakeRoom(), only its start is left */
+				CHECK(strspn(rx, "0123456789 abcdefghijklmnopqrstuvwxyz") ==
+						rxlen - 2, "size %lu: cut line broken: %s", size, rx);
+			}
+			else
+			{
+				/* a complete line, its number must not go back */
+				unsigned long got = strtoul(rx, NULL, 10);
+				char *p = strchr(rx, ' ');
+
+				CHECK(got >= expect, "size %lu: line %lu after %lu", size,
+						got, expect);
+				CHECK(p && strspn(p + 1, "abcdefghijklmnopqrstuvwxyz") ==
+						strlen(p + 1) - 1 && (strlen(p + 1) == 1 ||
+						p[1] == 'a' + got % 26),
+						"size %lu: line %lu broken: %s", size, got, rx);
+				expect = got + 1;
+			}
+			rxlen = 0;
+		}
+	}
+
+	while (UARTRingGet(&ring, &c))
+	{
+		received++;
+		cut += (c == '\r');
+	}
+	/* the producer writes no CR, each CR LF was added for a cut line */
+	lost = written - (received - 2 * cut);
+
+	/*
+	 * writes larger than the ring may also drop an LF added for a cut line,
+	 * which was never written but counts as dropped
+	 */
+	CHECK(lost == ring.ulDropped || (size <= sizeof(line) &&
+			lost < ring.ulDropped), "size %lu: lost %lu, counted %lu", size,
+			lost, ring.ulDropped);
+
+	printf("%6lu %10lu %10lu %10lu %8lu %8lu\n", size, written, received,
+			ring.ulDropped, ring.ulDropEvents, cut);
+}
+
+int main(int argc, char *argv[])
+{
+	long iterations = 1000000;
+	unsigned int i;
+
+	if (argc > 1)
+		iterations = atol(argv[1]);
+
+	srand(1);
+
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		test_basic(sizes[i]);
+	}
+
+	printf("%6s %10s %10s %10s %8s %8s\n", "size", "written", "received",
+			"dropped", "events", "cut");
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		test_stream(sizes[i], iterations);
+	}
+
+	printf("%d failures\n", failures);
+
+	return failures ? 1 : 0;
+}
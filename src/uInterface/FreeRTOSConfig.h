@@ -13,7 +13,7 @@
 #define configUSE_PREEMPTION			0
 #define configUSE_IDLE_HOOK				0
 #define configUSE_TICK_HOOK				0
-#define configCPU_CLOCK_HZ				( ( unsigned portLONG ) 80000000 )
+#define configCPU_CLOCK_HZ				( ( unsigned portLONG ) 50000000 )
 #define configTICK_RATE_HZ				( ( portTickType ) 1000 )
 #define configMINIMAL_STACK_SIZE		( ( unsigned portSHORT ) 80 )
 #define configTOTAL_HEAP_SIZE			( ( size_t ) ( 48000 ) )
@@ -29,6 +29,19 @@
 #define configQUEUE_REGISTRY_SIZE		10
 #define configMAX_PRIORITIES		( ( unsigned portBASE_TYPE ) 5 )
 #define configMAX_CO_ROUTINE_PRIORITIES ( 2 )
+#define configGENERATE_RUN_TIME_STATS	1
+
+/* The run time stats count the ticks of the 20 kHz timer (timer.c). */
+extern void vSetupHighFrequencyTimer( void );
+extern volatile unsigned long ulHighFrequencyTimerTicks;
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()	vSetupHighFrequencyTimer()
+#define portGET_RUN_TIME_COUNTER_VALUE()			ulHighFrequencyTimerTicks
+
+/* heap_tlsf.c locks the scheduler with the lock timing of log/trace.c. */
+extern void vTraceSuspendAll( void );
+extern void vTraceResumeAll( void );
+#define configHEAP_LOCK()		vTraceSuspendAll()
+#define configHEAP_UNLOCK()		vTraceResumeAll()
 
 /* Set the following definitions to 1 to include the API function, or zero
  to exclude the API function. */
@@ -41,6 +54,8 @@
 #define INCLUDE_vTaskDelayUntil				1
 #define INCLUDE_vTaskDelay					1
 #define INCLUDE_uxTaskGetStackHighWaterMark	1
+#define INCLUDE_pcTaskGetTaskName			1
+#define INCLUDE_xTaskGetSchedulerState		1
 
 #define configKERNEL_INTERRUPT_PRIORITY 		( 7 << 5 )
 /* Priority 7, or 255 as only the top three bits are implemented.  This is the lowest priority. */
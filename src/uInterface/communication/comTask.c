@@ -29,6 +29,7 @@
 #include "queueConfig.h"
 
 #include "setup.h"
+#include "log/trace.h"
 
 xComMessage xMessage;
 
@@ -48,7 +49,7 @@ void vComTask(void *pvParameters)
 		{
 
 #if DEBUG_COM
-			printf("ComTask: Got Item from Queue \n");
+			TRACE0("ComTask: Got Item from Queue \n");
 #endif
 
 			xMessage.errorDesc = NULL;
@@ -63,7 +64,7 @@ void vComTask(void *pvParameters)
 					sprintf(xMessage.errorDesc, "\"ERROR: %s\"", xMessage.item);
 
 #if DEBUG_COM
-				printf("COMTASK: Sende wert zurueck (%s, %d)\n", xMessage.item,
+				TRACE_STR1("COMTASK: Sende wert zurueck (%s, %d)\n", xMessage.item,
 						xMessage.value);
 #endif
 				xQueueSend(xHttpdQueue, &xMessage, (portTickType) 0);
@@ -77,7 +78,7 @@ void vComTask(void *pvParameters)
 					sprintf(buffer, "FAIL: %s", xMessage.item);
 
 #if DEBUG_COM
-				printf("COMTASK: Daten gespeichert (%s = %d)\n", xMessage.item,
+				TRACE_STR1("COMTASK: Daten gespeichert (%s = %d)\n", xMessage.item,
 						xMessage.value);
 #endif
 
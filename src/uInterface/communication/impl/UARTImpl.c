@@ -40,7 +40,7 @@ int sendToMachine(char* id, int value)
 {
 	int rc = 0;
 	
-	UARTprintf("!s:%s=%d\n", id, value);
+	UARTMachinePrintf("!s:%s=%d\n", id, value);
 
 	
 	return rc;
@@ -53,7 +53,7 @@ int getFormMachine(char* id)
 	char read_buf[32];
 	
 	//UARTFlushRx();
-	UARTprintf("!g:%s\n", id);
+	UARTMachinePrintf("!g:%s\n", id);
 	UARTgets(read_buf, 32);
 
 	UARTprintf("READ from Machine: '%s'\n", read_buf);
@@ -5,10 +5,16 @@
  * \author Anziner, Hahn
  * \brief implements a simple testroutine to store and read the values from/to the SD-Card
  *
+ * The values are kept in a RAM index. Every set appends one 16 byte record
+ * to a log file, so only the data sector and the directory entry of the log
+ * are written. If the log gets too long, the index is written as snapshot
+ * and the log starts over. On start the snapshot is loaded and the log is
+ * replayed, a torn record at the end of the log is ignored.
  *
  */
 
 /* std lib includes */
+#include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -28,116 +34,395 @@
 
 #define PATH_TO_DATA	"data/"
 
-char path_buf[32], buf[32];
-FIL save_file;
+/// append-only log of the sets since the last snapshot
+#define SD_KV_LOG		PATH_TO_DATA "params.log"
+/// all values at the time of the last compaction
+#define SD_KV_SNAPSHOT	PATH_TO_DATA "params.snp"
+/// new snapshot, renamed to SD_KV_SNAPSHOT when complete
+#define SD_KV_TMP		PATH_TO_DATA "params.tmp"
 
-// Empty Init Routine
-void vComTaskInitImpl(void)
+/// max. number of values (power of 2)
+#define SD_KV_ENTRIES	32
+/// max. length of an id, longer ids are truncated (like the old file names)
+#define SD_KV_ID_LEN	8
+/// the log is compacted if it gets longer
+#define SD_KV_LOG_MAX	(8 * 512)
+
+/// length of the path and value buffers
+#define SD_BUF_LEN		32
+
+/// returned if a value is unknown
+#define SD_KV_ERROR		-999
+
+/**
+ * Record of the log and the snapshot, 32 records fill a sector
+ */
+typedef struct
 {
-}
+	char cId[SD_KV_ID_LEN]; ///< not terminated if SD_KV_ID_LEN long
+	long lValue;
+	unsigned long ulCheck; ///< checksum of cId and lValue
+} tKvRecord;
 
-int sendToMachine(char* id, int value)
+/**
+ * Entry of the RAM index
+ */
+typedef struct
 {
-	unsigned int bw;
-	int rc = 0, error = 0;
+	char cId[SD_KV_ID_LEN]; ///< cId[0] == 0: unused
+	long lValue;
+} tKvEntry;
 
-	// suspend all other tasks
-	vTaskSuspendAll();
+static tKvEntry xKvIndex[SD_KV_ENTRIES];
 
-	fs_enable(400000);
+/** the log stays open, sets are appended at its end */
+static FIL xKvLog;
+static tBoolean bKvLogOpen = false;
 
-	strcat(path_buf, PATH_TO_DATA);
-	strncat(path_buf, id, 8);
+/**
+ * Checksum of a record (Fletcher-32 over the id and the value)
+ */
+static unsigned long ulKvCheck(const tKvRecord *pxRecord)
+{
+	const unsigned char *pucData = (const unsigned char *) pxRecord;
+	unsigned long ulSum1 = 0xFFFF, ulSum2 = 0xFFFF;
+	int i;
 
-#if DEBUG_COM
-	printf("SendToMachine: opening file: %s \n", path_buf);
-#endif
+	for (i = 0; i < (int) offsetof(tKvRecord, ulCheck); i++)
+	{
+		ulSum1 = (ulSum1 + pucData[i]) % 0xFFFF;
+		ulSum2 = (ulSum2 + ulSum1) % 0xFFFF;
+	}
 
-	if (strcmp(id, "kurve") == 0)
+	return (ulSum2 << 16) | ulSum1;
+}
+
+/**
+ * Hash of an id, at most SD_KV_ID_LEN characters are used
+ */
+static unsigned int uiKvHash(const char *pcId)
+{
+	unsigned int uiHash = 5381;
+	int i;
+
+	for (i = 0; i < SD_KV_ID_LEN && pcId[i]; i++)
 	{
-		if (value < 10 || value > 20)
+		uiHash = ((uiHash << 5) + uiHash) ^ (unsigned char) pcId[i];
+	}
+
+	return uiHash;
+}
+
+/**
+ * Returns the index entry of an id, or the free entry where it belongs.
+ * NULL if the index is full.
+ */
+static tKvEntry* pxKvSlot(const char *pcId)
+{
+	unsigned int i, uiSlot, uiHash = uiKvHash(pcId);
+
+	for (i = 0; i < SD_KV_ENTRIES; i++)
+	{
+		uiSlot = (uiHash + i) & (SD_KV_ENTRIES - 1);
+		if (xKvIndex[uiSlot].cId[0] == 0 || strncmp(xKvIndex[uiSlot].cId,
+				pcId, SD_KV_ID_LEN) == 0)
 		{
-			error = 1;
+			return &xKvIndex[uiSlot];
 		}
 	}
 
-	rc = f_open(&save_file, path_buf, FA_CREATE_NEW);
+	return NULL;
+}
 
-	if (rc == FR_EXIST)
-		rc = f_open(&save_file, path_buf, FA_WRITE);
+/**
+ * Stores a value in the RAM index
+ */
+static tBoolean bKvIndexSet(const char *pcId, long lValue)
+{
+	tKvEntry *pxEntry = pxKvSlot(pcId);
 
-	if (rc == FR_OK)
+	if (pxEntry == NULL)
 	{
+		return false;
+	}
+
+	strncpy(pxEntry->cId, pcId, SD_KV_ID_LEN);
+	pxEntry->lValue = lValue;
+
+	return true;
+}
+
+/**
+ * Reads the records of a file into the index, stops at the first invalid
+ * record
+ *
+ * @return offset behind the last valid record, -1 if the file can't be
+ * opened
+ */
+static long lKvReplay(FIL *pxFile, const char *pcPath)
+{
+	tKvRecord xRecord;
+	unsigned int br;
+	long lOffset = 0;
+
+	if (f_open(pxFile, pcPath, FA_READ) != FR_OK)
+	{
+		return -1;
+	}
 
-		sprintf(buf, "%d", value);
-		if (error == 0)
+	while (f_read(pxFile, &xRecord, sizeof(xRecord), &br) == FR_OK && br
+			== sizeof(xRecord))
+	{
+		if (xRecord.cId[0] == 0 || ulKvCheck(&xRecord) != xRecord.ulCheck)
 		{
-			rc = f_write(&save_file, &buf, strlen(buf), &bw);
 #if DEBUG_COM
-			printf("SendToMachine: rc: %d - wrote '%s' to file\n",rc, buf);
+			printf("SD: invalid record in %s at %d\n", pcPath, lOffset);
 #endif
+			break;
 		}
-		f_sync(&save_file);
-		f_close(&save_file);
+		bKvIndexSet(xRecord.cId, xRecord.lValue);
+		lOffset += sizeof(xRecord);
+	}
+
+	f_close(pxFile);
 
+	return lOffset;
+}
+
+/**
+ * Fills a record
+ */
+static void vKvRecord(tKvRecord *pxRecord, const char *pcId, long lValue)
+{
+	memset(pxRecord, 0, sizeof(tKvRecord));
+	strncpy(pxRecord->cId, pcId, SD_KV_ID_LEN);
+	pxRecord->lValue = lValue;
+	pxRecord->ulCheck = ulKvCheck(pxRecord);
+}
+
+/**
+ * Writes the index as new snapshot and starts a new log. A reset at any
+ * point leaves a snapshot and a log which give the latest values: the log
+ * is only truncated after the new snapshot is complete, replaying the old
+ * log over the new snapshot gives the same values.
+ */
+static void vKvCompact(void)
+{
+	tKvRecord xRecord;
+	FIL *pxFile;
+	unsigned int bw;
+	int i, rc;
+
+	pxFile = (FIL*) pvPortMalloc(sizeof(FIL));
+	if (pxFile == NULL)
+	{
+		return;
+	}
+
+	rc = f_open(pxFile, SD_KV_TMP, FA_CREATE_ALWAYS | FA_WRITE);
+	for (i = 0; i < SD_KV_ENTRIES && rc == FR_OK; i++)
+	{
+		if (xKvIndex[i].cId[0] != 0)
+		{
+			vKvRecord(&xRecord, xKvIndex[i].cId, xKvIndex[i].lValue);
+			rc = f_write(pxFile, &xRecord, sizeof(xRecord), &bw);
+		}
+	}
+	if (rc == FR_OK)
+	{
+		rc = f_close(pxFile);
 	}
 	else
 	{
+		f_close(pxFile);
+	}
+	vPortFree(pxFile);
+
+	if (rc == FR_OK)
+	{
+		f_unlink(SD_KV_SNAPSHOT);
+		rc = f_rename(SD_KV_TMP, SD_KV_SNAPSHOT);
+	}
+
+	if (rc == FR_OK)
+	{
+		f_lseek(&xKvLog, 0);
+		f_truncate(&xKvLog);
+		f_sync(&xKvLog);
+	}
+
 #if DEBUG_COM
-		printf("SendToMachine: Error opening file, rc=%d\n", rc);
+	printf("SD: log compacted, rc=%d\n", rc);
 #endif
+}
+
+/**
+ * Reads a value of the old format (one file per value)
+ */
+static int iKvLegacyGet(char* id, long *plValue)
+{
+	int rc;
+	char path_buf[SD_BUF_LEN], buf[SD_BUF_LEN];
+	FIL *save_file;
+
+	save_file = (FIL*) pvPortMalloc(sizeof(FIL));
+	if (save_file == NULL)
+	{
+		return -1;
+	}
+
+	strcpy(path_buf, PATH_TO_DATA);
+	strncat(path_buf, id, SD_KV_ID_LEN);
+
+	rc = f_open(save_file, path_buf, FA_READ);
+	if (rc == FR_OK)
+	{
+		buf[0] = 0;
+		f_gets(buf, SD_BUF_LEN, save_file);
+		*plValue = atoi(buf);
+		f_close(save_file);
 	}
-	path_buf[0] = 0;
-	buf[0] = 0;
 
-	// resumes all tasks
-	xTaskResumeAll();
+	vPortFree(save_file);
 
 	return rc;
 }
 
-int getFormMachine(char* id)
+/**
+ * Loads the snapshot, replays the log and opens it for appending
+ */
+void vComTaskInitImpl(void)
 {
-	int value = -999; // error code
-	int rc;
+	FIL *pxFile;
+	long lEnd;
 
-	// suspend all other tasks
-	vTaskSuspendAll();
+	memset(xKvIndex, 0, sizeof(xKvIndex));
 
-	fs_enable(400000);
+	pxFile = (FIL*) pvPortMalloc(sizeof(FIL));
+	if (pxFile == NULL)
+	{
+		return;
+	}
+
+	//
+	// a complete new snapshot without the old one: the reset happened
+	// between unlink and rename of the compaction
+	//
+	if (f_open(pxFile, SD_KV_SNAPSHOT, FA_READ) == FR_OK)
+	{
+		f_close(pxFile);
+		f_unlink(SD_KV_TMP);
+	}
+	else
+	{
+		f_rename(SD_KV_TMP, SD_KV_SNAPSHOT);
+	}
 
-	strcat(path_buf, PATH_TO_DATA);
-	strncat(path_buf, id, 8);
+	lKvReplay(pxFile, SD_KV_SNAPSHOT);
+	lEnd = lKvReplay(pxFile, SD_KV_LOG);
+	vPortFree(pxFile);
 
+	if (f_open(&xKvLog, SD_KV_LOG, FA_OPEN_ALWAYS | FA_READ | FA_WRITE)
+			!= FR_OK)
+	{
 #if DEBUG_COM
-	printf("getFormMachine: opening file: '%s' \n", path_buf);
+		printf("SD: can't open %s\n", SD_KV_LOG);
 #endif
+		return;
+	}
+	bKvLogOpen = true;
 
-	rc = f_open(&save_file, path_buf, FA_READ);
+	//
+	// cut a torn record off, new records follow the last valid one
+	//
+	if (lEnd < 0)
+	{
+		lEnd = 0;
+	}
+	if ((DWORD) lEnd != xKvLog.fsize)
+	{
+		f_lseek(&xKvLog, lEnd);
+		f_truncate(&xKvLog);
+		f_sync(&xKvLog);
+	}
+	f_lseek(&xKvLog, lEnd);
+}
 
+int sendToMachine(char* id, int value)
+{
+	tKvRecord xRecord;
+	unsigned int bw;
+	int rc;
+
+	if (strcmp(id, "kurve") == 0)
+	{
+		if (value < 10 || value > 20)
+		{
+			return FR_OK;
+		}
+	}
+
+	if (!bKvLogOpen || pxKvSlot(id) == NULL)
+	{
+		return -1;
+	}
+
+	//
+	// one record is appended to the log
+	//
+	vKvRecord(&xRecord, id, value);
+	rc = f_write(&xKvLog, &xRecord, sizeof(xRecord), &bw);
 	if (rc == FR_OK)
 	{
-		f_gets(buf, 32, &save_file);
-		value = atoi(buf);
-		f_close(&save_file);
+		rc = f_sync(&xKvLog);
+	}
+
 #if DEBUG_COM
-		printf("getFormMachine: rc: %d - read '%d' from file\n",rc, value);
+	printf("SendToMachine: rc: %d - wrote %s = %d\n", rc, id, value);
 #endif
+
+	if (rc != FR_OK)
+	{
+		return rc;
 	}
-	else
+
+	bKvIndexSet(id, value);
+
+	if (xKvLog.fsize >= SD_KV_LOG_MAX)
 	{
-#if DEBUG_COM
-		printf("getFormMachine: Error opening file, rc=%d\n", rc);
-#endif
+		vKvCompact();
 	}
 
-	path_buf[0] = 0;
-	buf[0] = 0;
+	return rc;
+}
 
-	// resumes all tasks
-	xTaskResumeAll();
+int getFormMachine(char* id)
+{
+	tKvEntry *pxEntry;
+	long lValue;
 
-	return value;
+	pxEntry = pxKvSlot(id);
+	if (pxEntry != NULL && pxEntry->cId[0] != 0)
+	{
+		return pxEntry->lValue;
+	}
+
+	//
+	// values of the old format are taken over into the log
+	//
+	if (iKvLegacyGet(id, &lValue) == FR_OK)
+	{
+#if DEBUG_COM
+		printf("getFormMachine: took over '%s' = %d\n", id, lValue);
+#endif
+		if (sendToMachine(id, lValue) != FR_OK)
+		{
+			bKvIndexSet(id, lValue);
+		}
+		return lValue;
+	}
+
+	return SD_KV_ERROR;
 }
 
 //*****************************************************************************
@@ -146,4 +431,3 @@ int getFormMachine(char* id)
 //! @}
 //
 //*****************************************************************************
-
@@ -0,0 +1,255 @@
+/**
+ * \addtogroup Config
+ * @{
+ *
+ * \author Anziner, Hahn
+ * \brief Copy of the configuration in internal flash
+ *
+ * The configuration is stored as CRC protected record in the last flash
+ * pages, so the network can be set up without reading the SD Card. The
+ * pages are used as ring of record slots: a new record goes into the slot
+ * after the newest one, a page is only erased when the ring wraps into it.
+ * The newest record is never in the erased page, so a reset during an
+ * update leaves the previous record valid.
+ *
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "hw_types.h"
+#include "hw_memmap.h"
+#include "flash.h"
+#include "sysctl.h"
+
+#include "FreeRTOS.h"
+
+#include "configflash.h"
+
+/// "LCFG"
+#define CONFIG_FLASH_MAGIC		0x4746434C
+
+#define CONFIG_FLASH_SLOTS		(CONFIG_FLASH_PAGES * CONFIG_FLASH_PAGE_SIZE \
+									/ CONFIG_FLASH_SLOT)
+#define CONFIG_SLOTS_PER_PAGE	(CONFIG_FLASH_PAGE_SIZE / CONFIG_FLASH_SLOT)
+
+/**
+ * Layout of a record slot
+ */
+typedef struct
+{
+	unsigned long ulMagic;
+	unsigned long ulSeq; ///< the highest sequence number is the newest
+	unsigned short usVersion;
+	unsigned short usLen; ///< used bytes of ucData
+	tConfigSource xSource;
+	unsigned long ulCrc; ///< over the fields above and ucData[usLen]
+	unsigned char ucData[CONFIG_FLASH_DATA_LEN];
+} tConfigRecord;
+
+/**
+ * Returns the record in a slot
+ */
+static const tConfigRecord* pxConfigSlot(int iSlot)
+{
+	return (const tConfigRecord *) (CONFIG_FLASH_BASE + iSlot
+			* CONFIG_FLASH_SLOT);
+}
+
+/**
+ * CRC32 (IEEE) with a 4 bit table
+ */
+static unsigned long ulConfigCrc(unsigned long ulCrc,
+		const unsigned char *pucData, int iLen)
+{
+	static const unsigned long pulTable[16] =
+	{ 0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4,
+			0x4DB26158, 0x5005713C, 0xEDB88320, 0xF00F9344, 0xD6D6A3E8,
+			0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C };
+
+	ulCrc = ~ulCrc;
+	while (iLen--)
+	{
+		ulCrc ^= *pucData++;
+		ulCrc = pulTable[ulCrc & 0x0F] ^ (ulCrc >> 4);
+		ulCrc = pulTable[ulCrc & 0x0F] ^ (ulCrc >> 4);
+	}
+
+	return ~ulCrc;
+}
+
+/**
+ * CRC of a record
+ */
+static unsigned long ulConfigRecordCrc(const tConfigRecord *pxRecord)
+{
+	unsigned long ulCrc;
+
+	ulCrc = ulConfigCrc(0, (const unsigned char *) pxRecord,
+			offsetof(tConfigRecord, ulCrc));
+
+	return ulConfigCrc(ulCrc, pxRecord->ucData, pxRecord->usLen);
+}
+
+/**
+ * Returns the slot of the newest valid record, -1 if there is none
+ */
+static int iConfigNewest(void)
+{
+	const tConfigRecord *pxRecord;
+	int i, iNewest = -1;
+
+	for (i = 0; i < CONFIG_FLASH_SLOTS; i++)
+	{
+		pxRecord = pxConfigSlot(i);
+		if (pxRecord->ulMagic != CONFIG_FLASH_MAGIC || pxRecord->usVersion
+				!= CONFIG_FLASH_VERSION || pxRecord->usLen
+				> CONFIG_FLASH_DATA_LEN)
+		{
+			continue;
+		}
+		if (iNewest >= 0 && (long) (pxRecord->ulSeq
+				- pxConfigSlot(iNewest)->ulSeq) <= 0)
+		{
+			continue;
+		}
+		if (ulConfigRecordCrc(pxRecord) == pxRecord->ulCrc)
+		{
+			iNewest = i;
+		}
+	}
+
+	return iNewest;
+}
+
+/**
+ * Checks if a slot is erased
+ */
+static tBoolean bConfigSlotErased(int iSlot)
+{
+	const unsigned long *pulData = (const unsigned long *) pxConfigSlot(iSlot);
+	int i;
+
+	for (i = 0; i < CONFIG_FLASH_SLOT / 4; i++)
+	{
+		if (pulData[i] != 0xFFFFFFFF)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Returns the data of the newest valid record
+ */
+const unsigned char* pucConfigFlashFind(int *piLen, tConfigSource *pxSource)
+{
+	const tConfigRecord *pxRecord;
+	int iSlot;
+
+	iSlot = iConfigNewest();
+	if (iSlot < 0)
+	{
+		return NULL;
+	}
+
+	pxRecord = pxConfigSlot(iSlot);
+	*piLen = pxRecord->usLen;
+	if (pxSource != NULL)
+	{
+		*pxSource = pxRecord->xSource;
+	}
+
+	return pxRecord->ucData;
+}
+
+/**
+ * Writes a new record into the next slot
+ */
+int iConfigFlashStore(const void *pvData, int iLen,
+		const tConfigSource *pxSource)
+{
+	tConfigRecord *pxRecord;
+	unsigned long ulSeq = 0;
+	int iNewest, iSlot, iResult = 0;
+
+	if (iLen > CONFIG_FLASH_DATA_LEN)
+	{
+		return -1;
+	}
+
+	iNewest = iConfigNewest();
+	if (iNewest >= 0)
+	{
+		ulSeq = pxConfigSlot(iNewest)->ulSeq + 1;
+	}
+	iSlot = (iNewest + 1) % CONFIG_FLASH_SLOTS;
+
+	//
+	// a slot in the middle of a page can only be used if it's still erased,
+	// otherwise continue with the next page
+	//
+	if ((iSlot % CONFIG_SLOTS_PER_PAGE) && !bConfigSlotErased(iSlot))
+	{
+		iSlot = (iSlot - iSlot % CONFIG_SLOTS_PER_PAGE + CONFIG_SLOTS_PER_PAGE)
+				% CONFIG_FLASH_SLOTS;
+	}
+
+	//
+	// build the record in RAM, FlashProgram needs whole words
+	//
+	pxRecord = (tConfigRecord *) pvPortMalloc(sizeof(tConfigRecord));
+	if (pxRecord == NULL)
+	{
+		return -1;
+	}
+	memset(pxRecord, 0xFF, sizeof(tConfigRecord));
+	pxRecord->ulMagic = CONFIG_FLASH_MAGIC;
+	pxRecord->ulSeq = ulSeq;
+	pxRecord->usVersion = CONFIG_FLASH_VERSION;
+	pxRecord->usLen = iLen;
+	pxRecord->xSource = *pxSource;
+	memcpy(pxRecord->ucData, pvData, iLen);
+	pxRecord->ulCrc = ulConfigRecordCrc(pxRecord);
+
+	FlashUsecSet(SysCtlClockGet() / 1000000);
+
+	if (!(iSlot % CONFIG_SLOTS_PER_PAGE))
+	{
+		//
+		// the ring wraps into this page, it only holds older records
+		//
+		if (FlashErase(CONFIG_FLASH_BASE + iSlot * CONFIG_FLASH_SLOT) != 0)
+		{
+			iResult = -1;
+		}
+	}
+
+	if (iResult == 0 && FlashProgram((unsigned long *) pxRecord,
+			CONFIG_FLASH_BASE + iSlot * CONFIG_FLASH_SLOT,
+			(offsetof(tConfigRecord, ucData) + iLen + 3) & ~3) != 0)
+	{
+		iResult = -1;
+	}
+
+	vPortFree(pxRecord);
+
+	//
+	// only a record which reads back correctly counts
+	//
+	if (iResult == 0 && iConfigNewest() != iSlot)
+	{
+		iResult = -1;
+	}
+
+	return iResult;
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
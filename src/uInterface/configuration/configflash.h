@@ -0,0 +1,64 @@
+/**
+ * \addtogroup Config
+ * @{
+ *
+ * \author Anziner, Hahn
+ * \brief Copy of the configuration in internal flash
+ *
+ */
+
+#ifndef CONFIGFLASH_H_
+#define CONFIGFLASH_H_
+
+/// first address of the reserved flash pages (see standalone.ld)
+#define CONFIG_FLASH_BASE		0x0003F000
+/// number of reserved 1 KB flash pages
+#define CONFIG_FLASH_PAGES		4
+/// size of the flash pages
+#define CONFIG_FLASH_PAGE_SIZE	1024
+/// size of one record, the pages are used as ring of record slots
+#define CONFIG_FLASH_SLOT		512
+
+/// increase if the layout of the stored data changes
+#define CONFIG_FLASH_VERSION	1
+
+/// max. length of the stored data
+#define CONFIG_FLASH_DATA_LEN	(CONFIG_FLASH_SLOT - 24)
+
+/**
+ * Identifies the config file the record was generated from
+ */
+typedef struct
+{
+	unsigned long ulSize;
+	unsigned short usDate;
+	unsigned short usTime;
+} tConfigSource;
+
+/**
+ * Returns the data of the newest valid record, it's read directly from
+ * flash
+ *
+ * @param piLen returns the length of the data
+ * @param pxSource returns the source of the record, may be NULL
+ * @return pointer to the data or NULL if there is no valid record
+ */
+const unsigned char* pucConfigFlashFind(int *piLen, tConfigSource *pxSource);
+
+/**
+ * Writes a new record into the next slot, the newest record is kept until
+ * the new one is written
+ *
+ * @return 0 on success, -1 if the data is too long or programming failed
+ */
+int iConfigFlashStore(const void *pvData, int iLen,
+		const tConfigSource *pxSource);
+
+#endif /* CONFIGFLASH_H_ */
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
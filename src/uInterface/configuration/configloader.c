@@ -5,203 +5,756 @@
  * \author Anziner, Hahn
  * \brief Routines for conf file handling
  *
+ * The config file is parsed once into a hash table, the getters work on the
+ * table and don't touch the SD Card. iConfigReload parses the file again if
+ * it was changed, iConfigSave writes changed values back.
+ *
+ * With ENABLE_CONFIG_FLASH the table is also stored in internal flash. At
+ * boot it's taken from there, the file is only parsed if it was changed
+ * since the record was written or if there is no valid record.
+ *
  */
 
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 
-#include "lmi_fs.h"
 #include "hw_types.h"
-#include "hw_memmap.h"
 #include "setup.h"
 
-#include "interrupt.h"
-#include "hw_watchdog.h"
-#include "watchdog.h"
+#include "fatfs/ff.h"
 
 #include "graphic/gui/displayBasics.h"
 
 #include "FreeRTOS.h"
 #include "task.h"
+#include "semphr.h"
+
+#include "configloader.h"
+#include "configflash.h"
 
 /// Enables debug messages for config handling
 #define CONFIG_DEBUG 1
 
-/// length of read buffer
+/// length of the line buffer
 #define READBUFFERLEN 	128
 
-/// pointer to the config file
-struct fs_file *config_file;
+/// slots of the hash table (power of 2, above CONFIG_MAX_ENTRIES)
+#define CONFIG_TABLE_SIZE		32
+
+/// written first, then renamed to IP_CONFIG_FILE
+#define CONFIG_TMP_FILE			"/conf/ipconfig.tmp"
+
+#if CONFIG_TABLE_SIZE <= CONFIG_MAX_ENTRIES
+#error "CONFIG_TABLE_SIZE must be greater than CONFIG_MAX_ENTRIES"
+#endif
+
+/**
+ * Parameter of the config file
+ */
+typedef struct
+{
+	unsigned long ulHash; ///< 0 = unused
+	char pcKey[CONFIG_KEY_LEN];
+	char pcValue[CONFIG_VALUE_LEN];
+	tBoolean bDirty; ///< changed by iConfigSet, not saved yet
+} tConfigEntry;
+
+/** parameter table */
+static tConfigEntry g_psConfig[CONFIG_TABLE_SIZE];
+static int iConfigEntries = 0;
+
+/** size and time of the parsed file, to detect changes */
+static FILINFO xConfigStat;
+
+/** serializes reload, set and save */
+static xSemaphoreHandle xConfigMutex = NULL;
+
+/**
+ * Hash of a parameter name, never 0
+ */
+static unsigned long ulConfigHash(const char *pcKey)
+{
+	unsigned long ulHash = 5381;
+
+	while (*pcKey)
+	{
+		ulHash = ((ulHash << 5) + ulHash) ^ (unsigned char) *pcKey++;
+	}
 
-/// read buffer
-char buffer[READBUFFERLEN];
+	return ulHash ? ulHash : 1;
+}
 
-char* paramAndValueFound(char* param, char* value, int paramLen, int valueLen)
+/**
+ * Returns the slot of a parameter, or the free slot where it belongs if
+ * it's not in the table
+ */
+static tConfigEntry* pxConfigSlot(tConfigEntry *pxTable, const char *pcKey,
+		unsigned long ulHash)
 {
-	char* returnValue;
-	int j;
-	if (paramLen > 0)
+	unsigned int i, uiSlot;
+
+	for (i = 0; i < CONFIG_TABLE_SIZE; i++)
 	{
-		paramLen = 0;
-		if (valueLen > 0)
+		uiSlot = (ulHash + i) & (CONFIG_TABLE_SIZE - 1);
+		if (pxTable[uiSlot].ulHash == 0 || (pxTable[uiSlot].ulHash == ulHash
+				&& strcmp(pxTable[uiSlot].pcKey, pcKey) == 0))
 		{
-			returnValue = (char*) pvPortMalloc(valueLen * sizeof(char) + 1);
-			for (j = 0; j < valueLen && value[j] > 0x20 && value[j] < 0x7F; j++)
-			{
-				returnValue[j] = value[j];
-			}
-			returnValue[j] = 0;
-			strtrim(returnValue);
-			xTaskResumeAll();
-			return returnValue;
+			return &pxTable[uiSlot];
 		}
-		for (j = 0; j < READBUFFERLEN; j++)
+	}
+
+	return NULL;
+}
+
+/**
+ * Returns the entry of a parameter, NULL if it's not set
+ */
+static tConfigEntry* pxConfigFind(const char *pcKey)
+{
+	tConfigEntry *pxEntry;
+
+	pxEntry = pxConfigSlot(g_psConfig, pcKey, ulConfigHash(pcKey));
+	if (pxEntry == NULL || pxEntry->ulHash == 0)
+	{
+		return NULL;
+	}
+
+	return pxEntry;
+}
+
+/**
+ * Splits a line of the config file ("NAME=VALUE # comment"). The value ends
+ * at the first space or '#'.
+ *
+ * @return true if the line holds a parameter (the value may be empty)
+ */
+static tBoolean bConfigSplitLine(const char *pcLine, int *piKey, int *piKeyLen,
+		int *piValue, int *piValueLen)
+{
+	int i = 0, iEnd;
+
+	while (pcLine[i] == ' ' || pcLine[i] == '\t')
+	{
+		i++;
+	}
+	*piKey = i;
+
+	while (pcLine[i] != '=')
+	{
+		if (pcLine[i] == 0 || pcLine[i] == '#' || pcLine[i] == '\n')
 		{
-			param[j] = 0;
+			return false;
 		}
+		i++;
 	}
-	xTaskResumeAll();
-	return NULL;
+
+	iEnd = i;
+	while (iEnd > *piKey && (pcLine[iEnd - 1] == ' '
+			|| pcLine[iEnd - 1] == '\t'))
+	{
+		iEnd--;
+	}
+	*piKeyLen = iEnd - *piKey;
+	if (*piKeyLen == 0)
+	{
+		return false;
+	}
+
+	i++;
+	while (pcLine[i] == ' ' || pcLine[i] == '\t')
+	{
+		i++;
+	}
+	*piValue = i;
+
+	while (pcLine[i] > 0x20 && pcLine[i] < 0x7F && pcLine[i] != '#')
+	{
+		i++;
+	}
+	*piValueLen = i - *piValue;
+
+	return true;
 }
 
 /**
+ * Parses the config file into pxTable
  *
- * searchs the config file for a parameter and returns the value
+ * @return number of parameters, -1 if the file can't be read
+ */
+static int iConfigParse(tConfigEntry *pxTable)
+{
+	FIL *pxFile;
+	tConfigEntry *pxEntry;
+	char pcLine[READBUFFERLEN];
+	int iKey, iKeyLen, iValue, iValueLen, iCount = 0;
+
+	pxFile = (FIL *) pvPortMalloc(sizeof(FIL));
+	if (pxFile == NULL)
+	{
+		return -1;
+	}
+
+	if (f_open(pxFile, IP_CONFIG_FILE, FA_READ) != FR_OK)
+	{
+		vPortFree(pxFile);
+		return -1;
+	}
+
+	memset(pxTable, 0, CONFIG_TABLE_SIZE * sizeof(tConfigEntry));
+
+	while (f_gets(pcLine, READBUFFERLEN, pxFile) != NULL)
+	{
+		if (!bConfigSplitLine(pcLine, &iKey, &iKeyLen, &iValue, &iValueLen)
+				|| iValueLen == 0)
+		{
+			continue;
+		}
+
+		if (iKeyLen >= CONFIG_KEY_LEN || iValueLen >= CONFIG_VALUE_LEN
+				|| iCount >= CONFIG_MAX_ENTRIES)
+		{
+#if CONFIG_DEBUG
+			printf("CONF: skipped line %s", pcLine);
+#endif
+			continue;
+		}
+
+		pcLine[iKey + iKeyLen] = 0;
+		pcLine[iValue + iValueLen] = 0;
+
+		pxEntry = pxConfigSlot(pxTable, pcLine + iKey, ulConfigHash(pcLine
+				+ iKey));
+		if (pxEntry->ulHash == 0)
+		{
+			iCount++;
+		}
+		pxEntry->ulHash = ulConfigHash(pcLine + iKey);
+		strcpy(pxEntry->pcKey, pcLine + iKey);
+		strcpy(pxEntry->pcValue, pcLine + iValue);
+	}
+
+	f_close(pxFile);
+	vPortFree(pxFile);
+
+	return iCount;
+}
+
+#if ENABLE_CONFIG_FLASH
+/**
+ * Writes the table to internal flash ("NAME\0VALUE\0" pairs)
+ */
+static void vConfigFlashSave(const FILINFO *pxStat)
+{
+	unsigned char *pucData;
+	tConfigSource xSource;
+	int i, iLen = 0, iKeyLen, iValueLen;
+
+	pucData = (unsigned char *) pvPortMalloc(CONFIG_FLASH_DATA_LEN);
+	if (pucData == NULL)
+	{
+		return;
+	}
+
+	for (i = 0; i < CONFIG_TABLE_SIZE; i++)
+	{
+		if (g_psConfig[i].ulHash == 0)
+		{
+			continue;
+		}
+
+		iKeyLen = strlen(g_psConfig[i].pcKey) + 1;
+		iValueLen = strlen(g_psConfig[i].pcValue) + 1;
+		if (iLen + iKeyLen + iValueLen > CONFIG_FLASH_DATA_LEN)
+		{
+			printf("CONF: too long for the flash copy\n");
+			vPortFree(pucData);
+			return;
+		}
+
+		memcpy(pucData + iLen, g_psConfig[i].pcKey, iKeyLen);
+		iLen += iKeyLen;
+		memcpy(pucData + iLen, g_psConfig[i].pcValue, iValueLen);
+		iLen += iValueLen;
+	}
+
+	xSource.ulSize = pxStat->fsize;
+	xSource.usDate = pxStat->fdate;
+	xSource.usTime = pxStat->ftime;
+
+	if (iConfigFlashStore(pucData, iLen, &xSource) != 0)
+	{
+		printf("CONF: flash copy failed\n");
+	}
+
+	vPortFree(pucData);
+}
+
+/**
+ * Fills the table from the record in internal flash
  *
+ * @param pxStat returns the config file the record was made of
+ * @return true if a valid record was found
  */
-char* loadFromConfig(char* filePath, char* param)
+static tBoolean bConfigFlashLoad(FILINFO *pxStat)
 {
-	int i, j;
-	tBoolean beforeEqual = true, isInComment = false;
+	const unsigned char *pucData;
+	tConfigSource xSource;
+	tConfigEntry *pxEntry;
+	const char *pcKey, *pcValue;
+	int iLen, iPos = 0;
 
-	vTaskSuspendAll();
+	pucData = pucConfigFlashFind(&iLen, &xSource);
+	if (pucData == NULL)
+	{
+		return false;
+	}
 
-	char name[READBUFFERLEN];
-	char value[READBUFFERLEN];
+	memset(g_psConfig, 0, sizeof(g_psConfig));
+	iConfigEntries = 0;
+
+	while (iPos < iLen && iConfigEntries < CONFIG_MAX_ENTRIES)
+	{
+		pcKey = (const char *) pucData + iPos;
+		iPos += strlen(pcKey) + 1;
+		pcValue = (const char *) pucData + iPos;
+		iPos += strlen(pcValue) + 1;
 
-	char last = '\n';
+		if (iPos > iLen || strlen(pcKey) >= CONFIG_KEY_LEN || strlen(pcValue)
+				>= CONFIG_VALUE_LEN)
+		{
+			break;
+		}
 
-	int nameLen = 0;
-	int valueLen = 0;
-	config_file = fs_open(filePath);
+		pxEntry = pxConfigSlot(g_psConfig, pcKey, ulConfigHash(pcKey));
+		if (pxEntry->ulHash == 0)
+		{
+			iConfigEntries++;
+		}
+		pxEntry->ulHash = ulConfigHash(pcKey);
+		strcpy(pxEntry->pcKey, pcKey);
+		strcpy(pxEntry->pcValue, pcValue);
+	}
 
-	if (config_file != NULL)
+	pxStat->fsize = xSource.ulSize;
+	pxStat->fdate = xSource.usDate;
+	pxStat->ftime = xSource.usTime;
+
+	return true;
+}
+#endif
+
+/**
+ * Finishes an iConfigSave which was cut by a reset. CONFIG_TMP_FILE is
+ * complete before IP_CONFIG_FILE is removed, so without IP_CONFIG_FILE it's
+ * the new file. With IP_CONFIG_FILE it may be incomplete and is removed.
+ */
+static void vConfigRecover(void)
+{
+	FILINFO xStat;
+
+	if (f_stat(CONFIG_TMP_FILE, &xStat) != FR_OK)
+	{
+		return;
+	}
+
+	if (f_stat(IP_CONFIG_FILE, &xStat) == FR_NO_FILE)
+	{
+#if CONFIG_DEBUG
+		printf("CONF: restoring %s\n", CONFIG_TMP_FILE);
+#endif
+		f_rename(CONFIG_TMP_FILE, IP_CONFIG_FILE);
+	}
+	else
 	{
-		while (fs_read(config_file, buffer, READBUFFERLEN) > 0)
+		f_unlink(CONFIG_TMP_FILE);
+	}
+}
+
+/**
+ * Parses IP_CONFIG_FILE into the configuration table. With
+ * ENABLE_CONFIG_FLASH the copy in flash is used as long as the file is
+ * unchanged or if there is no SD Card.
+ */
+void vConfigInit(void)
+{
+	if (xConfigMutex == NULL)
+	{
+		xConfigMutex = xSemaphoreCreateMutex();
+	}
+
+	vConfigRecover();
+
+#if ENABLE_CONFIG_FLASH
+	if (bConfigFlashLoad(&xConfigStat))
+	{
+#if CONFIG_DEBUG
+		printf("CONF: %d parameters from flash\n", iConfigEntries);
+#endif
+		//
+		// without SD Card or with an unchanged file the flash copy is used
+		//
+		if (iConfigReload(false) >= 0 || iConfigEntries > 0)
 		{
+			return;
+		}
+	}
+#endif
 
-			for (i = 0; i < READBUFFERLEN; i++)
+	if (iConfigReload(true) < 0)
+	{
+#ifdef ENABLE_GRAPHIC
+		vShowBootText("Please insert a correct MicroSD card!");
+#endif
+		printf("CONF: File can't be opened");
+	}
+}
+
+/**
+ * Parses the config file again if it was changed on the SD Card. Values
+ * set with iConfigSet and not saved are lost.
+ */
+int iConfigReload(tBoolean bForce)
+{
+	tConfigEntry *pxTable;
+	FILINFO xStat;
+	int iCount;
+
+	if (f_stat(IP_CONFIG_FILE, &xStat) != FR_OK)
+	{
+		return -1;
+	}
+
+	if (!bForce && xStat.fsize == xConfigStat.fsize && xStat.fdate
+			== xConfigStat.fdate && xStat.ftime == xConfigStat.ftime)
+	{
+		return 0;
+	}
+
+	//
+	// parse into a new table, so the readers always see a complete one
+	//
+	pxTable = (tConfigEntry *) pvPortMalloc(CONFIG_TABLE_SIZE
+			* sizeof(tConfigEntry));
+	if (pxTable == NULL)
+	{
+		return -1;
+	}
+
+	xSemaphoreTake(xConfigMutex, portMAX_DELAY);
+
+	iCount = iConfigParse(pxTable);
+	if (iCount >= 0)
+	{
+		taskENTER_CRITICAL();
+		memcpy(g_psConfig, pxTable, sizeof(g_psConfig));
+		iConfigEntries = iCount;
+		xConfigStat = xStat;
+		taskEXIT_CRITICAL();
+
+#if CONFIG_DEBUG
+		printf("CONF: %d parameters loaded\n", iCount);
+#endif
+#if ENABLE_CONFIG_FLASH
+		vConfigFlashSave(&xStat);
+#endif
+	}
+
+	xSemaphoreGive(xConfigMutex);
+	vPortFree(pxTable);
+
+	return (iCount >= 0) ? 1 : -1;
+}
+
+/**
+ * Returns the value of a parameter
+ */
+const char* pcConfigGet(const char *pcKey)
+{
+	tConfigEntry *pxEntry = pxConfigFind(pcKey);
+
+	return (pxEntry != NULL) ? pxEntry->pcValue : NULL;
+}
+
+/**
+ * Copies the value of a parameter, the table is replaced by iConfigReload
+ * in one critical section, so the copy is never torn
+ */
+tBoolean bConfigGetString(const char *pcKey, char *pcBuf, int iLen)
+{
+	tConfigEntry *pxEntry;
+	tBoolean bFound = false;
+
+	taskENTER_CRITICAL();
+	pxEntry = pxConfigFind(pcKey);
+	if (pxEntry != NULL && (int) strlen(pxEntry->pcValue) < iLen)
+	{
+		strcpy(pcBuf, pxEntry->pcValue);
+		bFound = true;
+	}
+	taskEXIT_CRITICAL();
+
+	return bFound;
+}
+
+/**
+ * Returns a parameter as boolean
+ */
+tBoolean bConfigGetBool(const char *pcKey, tBoolean bDefault)
+{
+	char pcValue[CONFIG_VALUE_LEN];
+
+	if (!bConfigGetString(pcKey, pcValue, sizeof(pcValue)))
+	{
+		return bDefault;
+	}
+	if (strcmp(pcValue, "true") == 0 || strcmp(pcValue, "1") == 0)
+	{
+		return true;
+	}
+	if (strcmp(pcValue, "false") == 0 || strcmp(pcValue, "0") == 0)
+	{
+		return false;
+	}
+
+	return bDefault;
+}
+
+/**
+ * Returns a parameter as integer
+ */
+int iConfigGetInt(const char *pcKey, int iDefault)
+{
+	char pcValue[CONFIG_VALUE_LEN];
+	char *pcEnd;
+	long lValue;
+
+	if (!bConfigGetString(pcKey, pcValue, sizeof(pcValue)))
+	{
+		return iDefault;
+	}
+
+	lValue = strtol(pcValue, &pcEnd, 10);
+	if (pcEnd == pcValue || *pcEnd != 0)
+	{
+		return iDefault;
+	}
+
+	return (int) lValue;
+}
+
+/**
+ * Returns a parameter as IPv4 address, the first number is stored in the
+ * lowest byte (like the addr member of struct ip_addr)
+ */
+tBoolean bConfigGetIPv4(const char *pcKey, unsigned long *pulAddr)
+{
+	char pcBuf[CONFIG_VALUE_LEN];
+	const char *pcValue = pcBuf;
+	unsigned long ulAddr = 0, ulPart;
+	int i, iDigits;
+
+	if (!bConfigGetString(pcKey, pcBuf, sizeof(pcBuf)))
+	{
+		return false;
+	}
+
+	for (i = 0; i < 4; i++)
+	{
+		ulPart = 0;
+		for (iDigits = 0; *pcValue >= '0' && *pcValue <= '9'; iDigits++)
+		{
+			ulPart = ulPart * 10 + (*pcValue++ - '0');
+		}
+		if (iDigits == 0 || iDigits > 3 || ulPart > 255)
+		{
+			return false;
+		}
+		if (*pcValue != ((i < 3) ? '.' : 0))
+		{
+			return false;
+		}
+		pcValue++;
+
+		ulAddr |= ulPart << (i * 8);
+	}
+
+	*pulAddr = ulAddr;
+
+	return true;
+}
+
+/**
+ * Changes a parameter in the table
+ */
+int iConfigSet(const char *pcKey, const char *pcValue)
+{
+	tConfigEntry *pxEntry;
+	unsigned long ulHash;
+	int iResult = -1;
+
+	if (strlen(pcKey) >= CONFIG_KEY_LEN || strlen(pcValue) >= CONFIG_VALUE_LEN)
+	{
+		return -1;
+	}
+	ulHash = ulConfigHash(pcKey);
+
+	xSemaphoreTake(xConfigMutex, portMAX_DELAY);
+	taskENTER_CRITICAL();
+
+	pxEntry = pxConfigSlot(g_psConfig, pcKey, ulHash);
+	if (pxEntry != NULL && (pxEntry->ulHash != 0 || iConfigEntries
+			< CONFIG_MAX_ENTRIES))
+	{
+		if (pxEntry->ulHash == 0)
+		{
+			pxEntry->ulHash = ulHash;
+			strcpy(pxEntry->pcKey, pcKey);
+			iConfigEntries++;
+		}
+		strcpy(pxEntry->pcValue, pcValue);
+		pxEntry->bDirty = true;
+		iResult = 0;
+	}
+
+	taskEXIT_CRITICAL();
+	xSemaphoreGive(xConfigMutex);
+
+	return iResult;
+}
+
+/**
+ * Copies the config file to CONFIG_TMP_FILE and replaces the values of the
+ * changed parameters, the other parameters are appended
+ */
+static int iConfigWrite(FIL *pxIn, FIL *pxOut)
+{
+	tConfigEntry *pxEntry;
+	char pcLine[READBUFFERLEN], cKeyEnd;
+	int iKey, iKeyLen, iValue, iValueLen, i;
+	UINT uiWritten;
+	tBoolean bWritten[CONFIG_TABLE_SIZE];
+
+	memset(bWritten, 0, sizeof(bWritten));
+
+	while (f_gets(pcLine, READBUFFERLEN, pxIn) != NULL)
+	{
+		if (bConfigSplitLine(pcLine, &iKey, &iKeyLen, &iValue, &iValueLen))
+		{
+			cKeyEnd = pcLine[iKey + iKeyLen];
+			pcLine[iKey + iKeyLen] = 0;
+			pxEntry = pxConfigFind(pcLine + iKey);
+			pcLine[iKey + iKeyLen] = cKeyEnd;
+
+			if (pxEntry != NULL && pxEntry->bDirty)
 			{
-				if (last == '\n')
-				{
-					beforeEqual = true;
-					isInComment = false;
-					for (j = 0; j < READBUFFERLEN; j++)
-					{
-						name[j] = 0;
-						value[j] = 0;
-					}
-					nameLen = 0;
-					valueLen = 0;
-				}
-				if (isInComment == true || buffer[i] == '#')
-				{
-					if (buffer[i] == '#' && (nameLen > 0 || valueLen > 0))
-					{
-
-						if (strcmp(name, param) == 0 && beforeEqual == false)
-						{
-							fs_close(config_file);
-							return paramAndValueFound(name, value, nameLen,
-									valueLen);
-						}
-						else
-						{
-							for (j = 0; j < READBUFFERLEN; j++)
-							{
-								name[j] = 0;
-								value[j] = 0;
-							}
-						}
-					}
-					isInComment = true;
-					while (i < READBUFFERLEN && buffer[i] != '\n')
-					{
-						i++;
-					}
-					last = buffer[i];
-				}
-				else
+				//
+				// keep the text in front of the value and the comment
+				//
+				bWritten[pxEntry - g_psConfig] = true;
+				if (f_write(pxOut, pcLine, iValue, &uiWritten) != FR_OK
+						|| f_puts(pxEntry->pcValue, pxOut) < 0 || f_puts(pcLine
+						+ iValue + iValueLen, pxOut) < 0)
 				{
-					//	printf("CONFIG: read char 0x%X (%c)\n", buffer[i],
-					//			buffer[i]);
-
-					if (buffer[i] == '=' && nameLen > 0)
-					{
-						name[nameLen] = 0;
-						beforeEqual = false;
-
-						if (strcmp(name, param) != 0)
-						{
-							while (i < READBUFFERLEN && buffer[i] != '\n')
-							{
-								i++;
-							}
-							for (j = 0; j < READBUFFERLEN; j++)
-							{
-								name[j] = 0;
-							}
-						}
-					}
-					else if (buffer[i] == '\n')
-					{
-						isInComment = false;
-						beforeEqual = true;
-						if (strcmp(name, param) == 0)
-						{
-							fs_close(config_file);
-							return paramAndValueFound(name, value, nameLen,
-									valueLen);
-						}
-						else
-						{
-							for (j = 0; j < READBUFFERLEN; j++)
-							{
-								name[j] = 0;
-								value[j] = 0;
-							}
-						}
-					}
-					else
-					{
-						if (beforeEqual)
-						{
-							name[nameLen] = buffer[i];
-							nameLen++;
-						}
-						else
-						{
-							value[valueLen] = buffer[i];
-							valueLen++;
-						}
-					}
-
-					last = buffer[i];
+					return -1;
 				}
+				continue;
 			}
 		}
+
+		if (f_puts(pcLine, pxOut) < 0)
+		{
+			return -1;
+		}
 	}
-	else
+
+	for (i = 0; i < CONFIG_TABLE_SIZE; i++)
 	{
-#ifdef ENABLE_GRAPHIC
-		vShowBootText("Please insert a correct MicroSD card!");
+		if (g_psConfig[i].ulHash && g_psConfig[i].bDirty && !bWritten[i])
+		{
+			if (f_printf(pxOut, "%s=%s\n", g_psConfig[i].pcKey,
+					g_psConfig[i].pcValue) < 0)
+			{
+				return -1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Writes the changed parameters back to the config file
+ */
+int iConfigSave(void)
+{
+	FIL *pxIn, *pxOut;
+	FILINFO xStat;
+	int iResult = -1, i;
+
+	pxIn = (FIL *) pvPortMalloc(2 * sizeof(FIL));
+	if (pxIn == NULL)
+	{
+		return -1;
+	}
+	pxOut = pxIn + 1;
+
+	xSemaphoreTake(xConfigMutex, portMAX_DELAY);
+
+	if (f_open(pxIn, IP_CONFIG_FILE, FA_READ) == FR_OK)
+	{
+		if (f_open(pxOut, CONFIG_TMP_FILE, FA_CREATE_ALWAYS | FA_WRITE)
+				== FR_OK)
+		{
+			iResult = iConfigWrite(pxIn, pxOut);
+			if (f_close(pxOut) != FR_OK)
+			{
+				iResult = -1;
+			}
+		}
+		f_close(pxIn);
+	}
+
+	//
+	// the old file is only replaced by a complete new one, a reset between
+	// unlink and rename is repaired by vConfigRecover at the next boot
+	//
+	if (iResult == 0)
+	{
+		if (f_unlink(IP_CONFIG_FILE) != FR_OK || f_rename(CONFIG_TMP_FILE,
+				IP_CONFIG_FILE) != FR_OK)
+		{
+			iResult = -1;
+		}
+	}
+
+	if (iResult == 0)
+	{
+		for (i = 0; i < CONFIG_TABLE_SIZE; i++)
+		{
+			g_psConfig[i].bDirty = false;
+		}
+
+		//
+		// our own write is no change for iConfigReload
+		//
+		if (f_stat(IP_CONFIG_FILE, &xStat) == FR_OK)
+		{
+			xConfigStat = xStat;
+#if ENABLE_CONFIG_FLASH
+			vConfigFlashSave(&xStat);
 #endif
-		printf("CONF: File can't be opened");
+		}
 	}
-	fs_close(config_file);
-	xTaskResumeAll();
-	return NULL;
+	else
+	{
+		f_unlink(CONFIG_TMP_FILE);
+	}
+
+	xSemaphoreGive(xConfigMutex);
+	vPortFree(pxIn);
+
+	return iResult;
 }
 
 //*****************************************************************************
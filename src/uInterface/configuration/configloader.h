@@ -10,9 +10,86 @@
 #ifndef CONFIGLOADER_H_
 #define CONFIGLOADER_H_
 
+#include "hw_types.h"
+
 #define IP_CONFIG_FILE "/conf/ipconfig.cnf"
 
-char* loadFromConfig(char* file, char* param);
+/// max. number of parameters in the config file
+#define CONFIG_MAX_ENTRIES		24
+/// max. length of a parameter name (incl. terminating 0)
+#define CONFIG_KEY_LEN			24
+/// max. length of a parameter value (incl. terminating 0)
+#define CONFIG_VALUE_LEN		32
+
+/**
+ * Parses IP_CONFIG_FILE into the configuration table, called once at boot
+ */
+void vConfigInit(void);
+
+/**
+ * Parses the config file again if it was changed on the SD Card
+ *
+ * @param bForce parse the file even if it's unchanged
+ * @return 1 if the table was reloaded, 0 if the file is unchanged, -1 on
+ * error (the table is kept then)
+ */
+int iConfigReload(tBoolean bForce);
+
+/**
+ * Returns the value of a parameter. The pointer points into the table, don't
+ * free it. iConfigReload copies the new table over the old one, so the text
+ * behind the pointer may change (or be the value of another parameter) if
+ * another task reloads. Use bConfigGetString to keep a value.
+ *
+ * @param pcKey name of the parameter
+ * @return value or NULL if the parameter isn't set
+ */
+const char* pcConfigGet(const char *pcKey);
+
+/**
+ * Copies the value of a parameter, safe against a reload by another task
+ *
+ * @param pcKey name of the parameter
+ * @param pcBuf returns the value
+ * @param iLen size of pcBuf, CONFIG_VALUE_LEN holds every value
+ * @return false if the parameter isn't set or doesn't fit into pcBuf
+ */
+tBoolean bConfigGetString(const char *pcKey, char *pcBuf, int iLen);
+
+/**
+ * Returns a parameter as boolean ("true"/"1" or "false"/"0")
+ */
+tBoolean bConfigGetBool(const char *pcKey, tBoolean bDefault);
+
+/**
+ * Returns a parameter as integer, bDefault if it's missing or no number
+ */
+int iConfigGetInt(const char *pcKey, int iDefault);
+
+/**
+ * Returns a parameter as IPv4 address in the byte order of struct ip_addr
+ *
+ * @param pcKey name of the parameter
+ * @param pulAddr returns the address
+ * @return true if the parameter is a valid dotted address
+ */
+tBoolean bConfigGetIPv4(const char *pcKey, unsigned long *pulAddr);
+
+/**
+ * Changes a parameter in the table, iConfigSave writes it to the SD Card
+ *
+ * @return 0 on success, -1 if the name or value is too long or the table
+ * is full
+ */
+int iConfigSet(const char *pcKey, const char *pcValue);
+
+/**
+ * Writes the changed parameters back to the config file. Comments and the
+ * order of the lines are kept, new parameters are appended.
+ *
+ * @return 0 on success, -1 on error
+ */
+int iConfigSave(void);
 
 #endif /* CONFIGLOADER_H_ */
 
@@ -22,4 +99,3 @@ char* loadFromConfig(char* file, char* param);
 //! @}
 //
 //*****************************************************************************
-
@@ -32,6 +32,7 @@
 #include "flash.h"
 
 #include "ETHIsr.h"
+#include "log/trace.h"
 
 //*****************************************************************************
 //
@@ -108,6 +109,14 @@ xSemaphoreHandle ETHTxBinSemaphore[MAX_ETH_PORTS] =
 //pf { [0 ... (MAX_ETH_PORTS - 1)] = NULL };
 		{ NULL };
 
+//*****************************************************************************
+//
+// Informs service task about link changes from interrupt routine
+//
+//*****************************************************************************
+xSemaphoreHandle ETHLinkBinSemaphore[MAX_ETH_PORTS] =
+		{ NULL };
+
 //*****************************************************************************
 //
 // Prevents Tx simultaneously accessing devices from different tasks 
@@ -126,6 +135,15 @@ xSemaphoreHandle ETHRxAccessMutex[MAX_ETH_PORTS] =
 //pf { [0 ... (MAX_ETH_PORTS - 1)] = NULL };
 		{ NULL };
 
+//*****************************************************************************
+//
+// Called from the interrupt routine when a frame was sent, loads the next
+// queued frame. Without a handler ETHTxBinSemaphore is given.
+//
+//*****************************************************************************
+static void (*ETHTxHandler[MAX_ETH_PORTS])(void) =
+		{ NULL };
+
 //*****************************************************************************
 //
 //! Handles the ETH interrupt.
@@ -139,7 +157,7 @@ xSemaphoreHandle ETHRxAccessMutex[MAX_ETH_PORTS] =
 //*****************************************************************************
 void ETH0IntHandler(void)
 {
-	static portBASE_TYPE xHigherPriorityTaskWoken;
+	portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
 
 	unsigned long ulStatus;
 
@@ -162,14 +180,25 @@ void ETH0IntHandler(void)
 	{
 		HWREGBITW(&ETHDevice[0], ETH_ERROR) = 1;
 		HWREGBITW(&ETHDevice[0], ETH_TXERROR) = 1;
-		xHigherPriorityTaskWoken = 0;
 	}
 
 	// See if TX event occured.
 	if (ulStatus & ETH_INT_TX)
 	{
 		HWREGBITW(&ETHDevice[0], ETH_ERROR) = 0;
-		xSemaphoreGiveFromISR(ETHTxBinSemaphore[0], &xHigherPriorityTaskWoken);
+	}
+
+	// The frame is gone (sent or dropped), load the next one.
+	if (ulStatus & (ETH_INT_TX | ETH_INT_TXER))
+	{
+		if (ETHTxHandler[0] != NULL)
+		{
+			ETHTxHandler[0]();
+		}
+		else
+		{
+			xSemaphoreGiveFromISR(ETHTxBinSemaphore[0], &xHigherPriorityTaskWoken);
+		}
 	}
 
 	// See if RX overflow event occured.
@@ -185,27 +214,20 @@ void ETH0IntHandler(void)
 	// See if PHY event occured.
 	if (ulStatus & ETH_INT_PHY)
 	{
-		printf("PHY Event\n");
 		// Something important was happened with network
 		// no need to worry about while loop in EthernetPHYRead
 		// Ethernet PHY Management Register 17 - Interrupt Control/Status
 		// Read and Clear the interrupt.
-		unsigned long phyStatus = EthernetPHYRead(ETHBase[0], PHY_MR17);
+		EthernetPHYRead(ETHBase[0], PHY_MR17);
 
-		printf("phy: %X\n", (unsigned int) phyStatus);
-		switch (phyStatus & ETH_PHY_INT_MASKED)
-		{
-		case ETH_LINK_DOWN:
-			HWREGBITW(&ETHDevice[0], ETH_ERROR) = 0;
-			HWREGBITW(&ETHDevice[0], ETH_LINK_OK) = 0;
-			break;
-		case ETH_LINK_UP:
-			HWREGBITW(&ETHDevice[0], ETH_ERROR) = 0;
-			HWREGBITW(&ETHDevice[0], ETH_LINK_OK) = 1;
-			break;
-		}
-		// no need immediately to switch context 
-		xHigherPriorityTaskWoken = 0;
+		// Link change and autonegotiation complete come as separate
+		// events, the status register tells the current state.
+		HWREGBITW(&ETHDevice[0], ETH_ERROR) = 0;
+		HWREGBITW(&ETHDevice[0], ETH_LINK_OK) = (EthernetPHYRead(ETHBase[0],
+				PHY_MR1) & ETH_PHY_LINK_UP) ? 1 : 0;
+
+		// the service task brings the interface up or down
+		xSemaphoreGiveFromISR(ETHLinkBinSemaphore[0], &xHigherPriorityTaskWoken);
 	}
 	portEND_SWITCHING_ISR(xHigherPriorityTaskWoken);
 }
@@ -233,6 +255,7 @@ int ETHServiceTaskInit(const unsigned long ulPort)
 		// Initialize semaphores and mutexes.
 		ETHRxBinSemaphore[ulPort] = xSemaphoreCreateCounting( 1, 0 );
 		ETHTxBinSemaphore[ulPort] = xSemaphoreCreateCounting( 1, 0 );
+		ETHLinkBinSemaphore[ulPort] = xSemaphoreCreateCounting( 1, 0 );
 		ETHTxAccessMutex[ulPort] = xSemaphoreCreateMutex();
 		ETHRxAccessMutex[ulPort] = xSemaphoreCreateMutex();
 
@@ -324,23 +347,15 @@ int ETHServiceTaskEnable(unsigned long ulPort)
 		// Enable the Ethernet Controller transmitter and receiver.
 		EthernetEnable(ETHBase[ulPort]);
 
+		// Configure the Ethernet PHY interrupt management register, link
+		// changes are reported by interrupt from now on.
+		EthernetPHYWrite(ETHBase[ulPort], PHY_MR17, ETH_PHY_INT_MASK);
+
 		// Determine if link is up   	
 		// no need to worry about while loop in EthernetPHYRead
 		// Ethernet PHY Management Register 1 - Status
-		/*phyStatus = EthernetPHYRead(ETH_BASE, PHY_MR1);
-		 if (phyStatus & ETH_PHY_LINK_UP) {
-		 // set link up flag
-		 printf("set link up\n");
-		 HWREGBITW(&ETHDevice[ulPort], ETH_LINK_OK) = 1;
-		 } else {
-		 printf("set link down\n");
-		 HWREGBITW(&ETHDevice[ulPort], ETH_LINK_OK) = 0;
-		 }*/
-
-		HWREGBITW(&ETHDevice[ulPort], ETH_LINK_OK) = 1;
-
-		// Configure the Ethernet PHY interrupt management register.
-		//ma EthernetPHYWrite(ETHBase[ulPort], PHY_MR17, ETH_PHY_INT_MASK);
+		HWREGBITW(&ETHDevice[ulPort], ETH_LINK_OK) = (EthernetPHYRead(
+				ETHBase[ulPort], PHY_MR1) & ETH_PHY_LINK_UP) ? 1 : 0;
 
 		// Enable the Ethernet Interrupt handler.
 		IntEnable(ETHInterrupt[ulPort]);
@@ -588,6 +603,8 @@ int ETHServiceTaskEnableReceive(const unsigned long ulPort)
 {
 	if (ulPort < MAX_ETH_PORTS)
 	{
+		// Frames already read from the FIFO must not wake the task again.
+		EthernetIntClear(ETHBase[ulPort], ETH_INT_RX);
 		EthernetIntEnable(ETHBase[ulPort], ETH_INT_RX);
 		return 0;
 	}
@@ -596,12 +613,36 @@ int ETHServiceTaskEnableReceive(const unsigned long ulPort)
 	return (-1);
 }
 
+//*****************************************************************************
+//
+//! Sets the TX complete handler.
+//!
+//! \param ulPort is the Ethernet port number to be accessed.
+//! \param pfnHandler is called from the interrupt routine when a frame was
+//! sent or dropped, NULL gives ETHTxBinSemaphore instead.
+//!
+//! \return 0 or -1 if error.
+//
+//*****************************************************************************
+int ETHServiceTaskTxHandler(const unsigned long ulPort,
+		void (*pfnHandler)(void))
+{
+	if (ulPort < MAX_ETH_PORTS)
+	{
+		ETHTxHandler[ulPort] = pfnHandler;
+		return 0;
+	}
+	HWREGBITW(&ETHDevice[ulPort], ETH_ERROR) = 1;
+	HWREGBITW(&ETHDevice[ulPort], ETH_EBADF) = 1;
+	return (-1);
+}
+
 int ETHServiceTaskWaitReady(const unsigned long ulPort)
 {
 	if ((ulPort < MAX_ETH_PORTS)
 			&& (HWREGBITW(&ETHDevice[ulPort], ETH_ENABLED)))
 	{
-		vTaskSuspendAll();
+		vTraceSuspendAll();
 		// See if Ethernet completed autonegation,
 
 		//while (!(EthernetPHYRead(ETH_BASE, PHY_MR1) & ETH_PHY_LINK_UP))
@@ -609,7 +650,7 @@ int ETHServiceTaskWaitReady(const unsigned long ulPort)
 		while (!(PHY_MR1_ANEGC & EthernetPHYRead(ETHBase[0], PHY_MR1)))
 			;
 		printf("ok\n");
-		xTaskResumeAll();
+		vTraceResumeAll();
 		return (0);
 	}
 	HWREGBITW(&ETHDevice[ulPort], ETH_ERROR) = 1;
@@ -99,6 +99,7 @@ extern "C"
 //*****************************************************************************
 extern xSemaphoreHandle ETHRxBinSemaphore[MAX_ETH_PORTS];
 extern xSemaphoreHandle ETHTxBinSemaphore[MAX_ETH_PORTS];
+extern xSemaphoreHandle ETHLinkBinSemaphore[MAX_ETH_PORTS];
 extern xSemaphoreHandle ETHTxAccessMutex[MAX_ETH_PORTS];
 extern xSemaphoreHandle ETHRxAccessMutex[MAX_ETH_PORTS];
 
@@ -114,6 +115,8 @@ extern int ETHServiceTaskMACAddress(const unsigned long ulPort,
 extern int ETHServiceTaskEnableReceive(const unsigned long ulPort);
 extern int ETHServiceTaskPacketAvail(const unsigned long ulPort);
 extern int ETHServiceTaskWaitReady(const unsigned long ulPort);
+extern int ETHServiceTaskTxHandler(const unsigned long ulPort,
+		void (*pfnHandler)(void));
 
 //*****************************************************************************
 //
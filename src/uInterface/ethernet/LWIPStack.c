@@ -76,6 +76,10 @@
 
 #include "configuration/configloader.h"
 
+#include "log/boottime.h"
+#include "log/apibench.h"
+#include "log/trace.h"
+
 #include "graphic/gui/displayBasics.h"
 #include "graphic/gui/displayDraw.h"
 
@@ -92,14 +96,56 @@
 #define IP_STATIC 	1
 #define IP_DYNAMIC 	2
 
+// Cycle counter (DWT_CYCCNT), started by vTraceInit().
+#define ETH_DWT_CYCCNT	(*((volatile unsigned long *) 0xE0001004))
+
 // Forward declarations.
 static void ethernetif_input(void *pParams);
+static void ethernetif_deliver(void *ctx);
 static struct pbuf * low_level_input(struct netif *netif);
 static err_t low_level_output(struct netif *netif, struct pbuf *p);
 static err_t low_level_transmit(struct netif *netif, struct pbuf *p);
+static void ethernetif_tx_isr(void);
+static void ethernetif_tx_reclaim(void);
+static void ethernetif_rx_free(struct pbuf *p);
 
 static struct netif lwip_netif;
 
+// Frames read from the RX FIFO, handed to the tcpip thread as one batch.
+static xQueueHandle xEthRxQueue = NULL;
+
+// A callback to deliver the batch is posted to the tcpip thread.
+static volatile tBoolean bEthRxPending = false;
+
+// Frames per wakeup and drops of the input task.
+static tEthRxStats xEthRxStats;
+
+// TCP pcbs of the last count.
+static tTcpStats xTcpStats;
+
+// A frame larger than a pool pbuf is read into one of these buffers instead
+// of a chain of pool pbufs. The pbuf is attached as a custom pbuf, so
+// pbuf_free() gives the buffer back with ethernetif_rx_free().
+typedef struct
+{
+	struct pbuf_custom xPbuf;
+	unsigned long pulData[ETH_RX_LARGE_SIZE / 4];
+} tEthRxBuffer;
+
+static tEthRxBuffer xEthRxBuffers[ETH_RX_LARGE_BUFFERS];
+
+// Free large buffers, linked by the next pointer of their pbuf.
+static struct pbuf *pxEthRxFree = NULL;
+
+// Frames to send, copies of the frames given by lwIP. The tcpip thread adds
+// at ulEthTxHead, the frames up to ulEthTxLoad have been loaded into the TX
+// FIFO (by the thread or the TX interrupt), the frames up to ulEthTxTail
+// have been freed again.
+static struct pbuf *pxEthTxQueue[ETH_TX_QUEUE_SIZE];
+static volatile unsigned long ulEthTxHead = 0;
+static volatile unsigned long ulEthTxLoad = 0;
+static unsigned long ulEthTxTail = 0;
+
 //*****************************************************************************
 //
 // In this function, the hardware should be initialized.
@@ -113,6 +159,7 @@ static struct netif lwip_netif;
 //*****************************************************************************
 static err_t low_level_init(struct netif *netif)
 {
+	int i;
 
 	//ma ETHServiceTaskDisable(0);
 
@@ -138,16 +185,26 @@ static err_t low_level_init(struct netif *netif)
 	// don't set NETIF_FLAG_ETHARP if this device is not an ethernet one
 	netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP;
 
+	// Queue between the input task and the tcpip thread.
+	xEthRxQueue = xQueueCreate(ETH_RX_QUEUE_SIZE, sizeof(struct pbuf *));
+
+	// All large buffers are free.
+	for (i = 0; i < ETH_RX_LARGE_BUFFERS; i++)
+	{
+		xEthRxBuffers[i].xPbuf.custom_free_function = ethernetif_rx_free;
+		ethernetif_rx_free(&xEthRxBuffers[i].xPbuf.pbuf);
+	}
+
 	// Create the task that handles the incoming packets.	
-	if (pdPASS
+	if (xEthRxQueue != NULL && pdPASS
 			== xTaskCreate(ethernetif_input, ( signed portCHAR * ) "ETH_INPUT", netifINTERFACE_TASK_STACK_SIZE, (void *)netif, netifINTERFACE_TASK_PRIORITY, NULL))
 	{
-		ETHServiceTaskEnable(0);
-		LWIP_DEBUGF(CORTEX_DEBUG, ("low_level_input: Waiting for Ethernet to become ready\n"));
-		ETHServiceTaskWaitReady(0);
-		netif->flags |= NETIF_FLAG_LINK_UP;
+		// The TX interrupt sends the queued frames.
+		ETHServiceTaskTxHandler(0, ethernetif_tx_isr);
 
-		LWIP_DEBUGF(CORTEX_DEBUG, ("low_level_init: Ethernet link is up\n"));
+		// Don't wait for autonegotiation, the link up interrupt brings the
+		// interface up (LWIPServiceTaskInit).
+		ETHServiceTaskEnable(0);
 
 		return ERR_OK;
 
@@ -159,11 +216,62 @@ static err_t low_level_init(struct netif *netif)
 	}
 }
 
+/**
+ * Gives a large buffer back, called by pbuf_free() from the tcpip thread
+ * or the input task.
+ *
+ * @param p the pbuf of the buffer
+ */
+static void ethernetif_rx_free(struct pbuf *p)
+{
+	SYS_ARCH_DECL_PROTECT(lev);
+
+	SYS_ARCH_PROTECT(lev);
+	p->next = pxEthRxFree;
+	pxEthRxFree = p;
+	SYS_ARCH_UNPROTECT(lev);
+}
+
+/**
+ * Takes a large buffer for a frame
+ *
+ * @param len length of the frame as read from the FIFO
+ * @return a custom pbuf for the frame, NULL if all buffers are in use
+ */
+static struct pbuf * ethernetif_rx_alloc(u16_t len)
+{
+	struct pbuf *p;
+	tEthRxBuffer *pxBuffer;
+	SYS_ARCH_DECL_PROTECT(lev);
+
+	SYS_ARCH_PROTECT(lev);
+	p = pxEthRxFree;
+	if (p != NULL)
+	{
+		pxEthRxFree = p->next;
+	}
+	SYS_ARCH_UNPROTECT(lev);
+
+	if (p == NULL)
+	{
+		return NULL;
+	}
+
+	pxBuffer = (tEthRxBuffer *) p;
+	return pbuf_alloced_custom(PBUF_RAW, len, PBUF_RAM, &pxBuffer->xPbuf,
+			pxBuffer->pulData, sizeof(pxBuffer->pulData));
+}
+
 /**
  * This function will read a single packet from the Stellaris ethernet
  * interface, if available, and return a pointer to a pbuf.  The timestamp
  * of the packet will be placed into the pbuf structure.
  *
+ * The length in the first FIFO word chooses the buffer: a frame that fits
+ * into one pool pbuf (ACKs, ARP) is read into a pool pbuf, a larger one
+ * into a large buffer. Only if all large buffers are in use, it becomes a
+ * chain of pool pbufs.
+ *
  * @param netif the lwip network interface structure for this ethernetif
  * @return pointer to pbuf packet if available, NULL otherswise.
  */
@@ -174,6 +282,7 @@ static struct pbuf * low_level_input(struct netif *netif)
 	u32_t temp;
 	int i;
 	unsigned long *ptr;
+	unsigned long ulStart;
 #if LWIP_PTPD
 	u32_t time_s, time_ns;
 
@@ -184,11 +293,6 @@ static struct pbuf * low_level_input(struct netif *netif)
 	/* Check if a packet is available, if not, return NULL packet. */
 	if ((HWREG(ETH_BASE + MAC_O_NP) & MAC_NP_NPR_M) == 0)
 	{
-		int err = ETHServiceTaskLastError(0);
-		if ((ETH_ERROR & err) && (ETH_OVERFLOW & err))
-		{
-			LWIP_DEBUGF(CORTEX_DEBUG, ("low_level_input: Ethernet overflow\n"));LINK_STATS_INC(link.drop);
-		}
 		return (NULL);
 	}
 
@@ -198,11 +302,29 @@ static struct pbuf * low_level_input(struct netif *netif)
 	 * two bytes for the length + the 4 bytes for the FCS.
 	 *
 	 */
+	ulStart = ETH_DWT_CYCCNT;
 	temp = HWREG(ETH_BASE + MAC_O_DATA);
 	len = temp & 0xFFFF;
 
-	/* We allocate a pbuf chain of pbufs from the pool. */
-	p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
+	/* Full frames get a contiguous buffer, small frames a pool pbuf. */
+	p = NULL;
+	if (len > PBUF_POOL_BUFSIZE && len <= ETH_RX_LARGE_SIZE)
+	{
+		p = ethernetif_rx_alloc(len);
+		if (p != NULL)
+		{
+			xEthRxStats.ulLarge++;
+		}
+	}
+	if (p == NULL)
+	{
+		/* We allocate a pbuf chain of pbufs from the pool. */
+		p = pbuf_alloc(PBUF_RAW, len, PBUF_POOL);
+		if (p != NULL && p->next != NULL)
+		{
+			xEthRxStats.ulChained++;
+		}
+	}
 
 	/* If a pbuf was allocated, read the packet into the pbuf. */
 	if (p != NULL)
@@ -257,115 +379,355 @@ static struct pbuf * low_level_input(struct netif *netif)
 
 		// Adjust the link statistics
 		LINK_STATS_INC(link.memerr);LINK_STATS_INC(link.drop);
+		xEthRxStats.ulDropped++;
 	}
 
+	xEthRxStats.ulReadCycles += ETH_DWT_CYCCNT - ulStart;
+
 	return (p);
 }
 
 /**
- * This function should be called when a packet is ready to be read
- * from the interface. It uses the function low_level_receive() that
- * should handle the actual reception of bytes from the network
- * interface.Then the type of the received packet is determined and
- * the appropriate input function is called.
+ * Runs in the tcpip thread: passes all frames of the batch to the stack.
+ * The flag is cleared first, a frame queued while the batch is delivered
+ * either gets delivered here or posts a new callback.
+ *
+ * @param ctx the lwip network interface structure for this ethernetif
+ */
+static void ethernetif_deliver(void *ctx)
+{
+	struct netif *netif = (struct netif *) ctx;
+	struct pbuf *p;
+	unsigned long ulStart;
+
+	bEthRxPending = false;
+
+	// frames sent meanwhile are freed here as well
+	ethernetif_tx_reclaim();
+
+	while (xQueueReceive(xEthRxQueue, &p, 0) == pdTRUE)
+	{
+		// same as tcpip_input() for a netif with NETIF_FLAG_ETHARP, the
+		// frame is freed by the stack
+		ulStart = ETH_DWT_CYCCNT;
+		ethernet_input(p, netif);
+		xEthRxStats.ulStackCycles += ETH_DWT_CYCCNT - ulStart;
+	}
+}
+
+/**
+ * Posts one callback for all queued frames to the tcpip thread, unless
+ * there is one already. If the message can't be posted, the frames stay
+ * in the queue until the next frame.
  *
  * @param netif the lwip network interface structure for this ethernetif
  */
+static void ethernetif_handoff(struct netif *netif)
+{
+	if (!bEthRxPending && uxQueueMessagesWaiting(xEthRxQueue) != 0)
+	{
+		bEthRxPending = true;
+		if (tcpip_callback_with_block(ethernetif_deliver, netif, 0) == ERR_OK)
+		{
+			xEthRxStats.ulHandoffs++;
+		}
+		else
+		{
+			bEthRxPending = false;
+		}
+	}
+}
 
+/**
+ * Task which receives the frames. Every wakeup drains all frames from the
+ * MAC FIFO into xEthRxQueue and hands them to the tcpip thread with one
+ * message, instead of one tcpip_input() message per frame. The RX
+ * interrupt is enabled again only when the FIFO is empty.
+ *
+ * @param pParams the lwip network interface structure for this ethernetif
+ */
 static void ethernetif_input(void *pParams)
 {
 	struct netif *netif;
-	//pf	struct ethernetif *ethernetif;
 	struct pbuf *p;
+	unsigned long ulFrames;
+	u16_t usBytes;
+	u8_t ucPbufs;
+	int err;
 
 	netif = (struct netif*) pParams;
-	//pf	ethernetif = netif->state;
 
 	for (;;)
 	{
-		do
+		ulFrames = 0;
+
+		while (ETHServiceTaskPacketAvail(0) > 0)
 		{
-			// move received packet into a new pbuf
+			// move received packet into a new pbuf, NULL if it was dropped
 			p = low_level_input(netif);
-
-			if ((p == NULL) && (0 == ETHServiceTaskPacketAvail(0)))
+			if (p == NULL)
 			{
-				// Actually enables only RX interrupt
-				ETHServiceTaskEnableReceive(0);
+				continue;
+			}
 
-				// No packet could be read.  Wait a for an interrupt to tell us
-				// there is more data available.
-				xSemaphoreTake(ETHRxBinSemaphore[0], ( portTickType ) (ETH_BLOCK_TIME_WAITING_FOR_INPUT_MS / portTICK_RATE_MS));
+			LWIP_DEBUGF(CORTEX_DEBUG, ("ethernetif_input: frame received\n"));
+
+			// the tcpip thread may free the frame as soon as it is queued
+			usBytes = p->tot_len;
+			ucPbufs = pbuf_clen(p);
+
+			if (xQueueSend(xEthRxQueue, &p, 0) != pdTRUE)
+			{
+				// the queue is full, let the tcpip thread catch up
+				ethernetif_handoff(netif);
+				if (xQueueSend(xEthRxQueue, &p, ETH_RX_QUEUE_WAIT_MS / portTICK_RATE_MS) != pdTRUE)
+				{
+					LWIP_DEBUGF(CORTEX_DEBUG, ("ethernetif_input: input error\n"));
+					LINK_STATS_INC(link.drop);
+					xEthRxStats.ulDropped++;
+					pbuf_free(p);
+					continue;
+				}
 			}
+			ulFrames++;
+			xEthRxStats.ulPbufs += ucPbufs;
+			xEthRxStats.ulBytes += usBytes;
+		}
 
-		} while (p == NULL);
+		ethernetif_handoff(netif);
 
-		LWIP_DEBUGF(CORTEX_DEBUG, ("ethernetif_input: frame received\n"));
+		err = ETHServiceTaskLastError(0);
+		if ((err > 0) && (ETH_ERROR & err) && (ETH_OVERFLOW & err))
+		{
+			LWIP_DEBUGF(CORTEX_DEBUG, ("ethernetif_input: Ethernet overflow\n"));
+			LINK_STATS_INC(link.drop);
+			xEthRxStats.ulOverflows++;
+		}
 
-		if (ERR_OK != netif->input(p, netif))
+		xEthRxStats.ulWakeups++;
+		xEthRxStats.ulFrames += ulFrames;
+		if (ulFrames > xEthRxStats.ulMaxBatch)
 		{
-			LWIP_DEBUGF(CORTEX_DEBUG, ("ethernetif_input: input error\n"));
-			pbuf_free(p);
-			p = NULL;
+			xEthRxStats.ulMaxBatch = ulFrames;
 		}
+
+		// The FIFO is empty, enable the RX interrupt. A frame which came in
+		// meanwhile is read without waiting.
+		ETHServiceTaskEnableReceive(0);
+		if (ETHServiceTaskPacketAvail(0) > 0)
+		{
+			continue;
+		}
+
+		// Wait for an interrupt to tell us there is more data available.
+		xSemaphoreTake(ETHRxBinSemaphore[0], ( portTickType ) (ETH_BLOCK_TIME_WAITING_FOR_INPUT_MS / portTICK_RATE_MS));
 	}
 }
 
 /**
- * This function with either place the packet into the Stellaris transmit fifo,
- * or will place the packet in the interface PBUF Queue for subsequent
- * transmission when the transmitter becomes idle.
+ * Copies the counters of the input task
  *
- * @param netif the lwip network interface structure for this ethernetif
- * @param p the MAC packet to send (e.g. IP packet including MAC addresses and type)
- * @return ERR_OK if the packet could be sent
- *         an err_t value if the packet couldn't be sent
+ * @param pxStats receives the counters
+ */
+void LWIPServiceTaskRxStats(tEthRxStats *pxStats)
+{
+	vTraceSuspendAll();
+	*pxStats = xEthRxStats;
+	vTraceResumeAll();
+}
+
+/**
+ * Counts the active and TIME_WAIT pcbs, must own the core (tcpip thread or
+ * LOCK_TCPIP_CORE()).
+ */
+static void vTcpCount(void *pvArg)
+{
+	struct tcp_pcb *pcb;
+	unsigned long ulActive = 0, ulTimeWait = 0;
+
+	(void) pvArg;
+
+	for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next)
+	{
+		ulActive++;
+	}
+	for (pcb = tcp_tw_pcbs; pcb != NULL; pcb = pcb->next)
+	{
+		ulTimeWait++;
+	}
+
+	xTcpStats.ulActive = ulActive;
+	xTcpStats.ulTimeWait = ulTimeWait;
+	if (ulTimeWait > xTcpStats.ulTimeWaitMax)
+	{
+		xTcpStats.ulTimeWaitMax = ulTimeWait;
+	}
+#if TCP_KILL_STATS
+	xTcpStats.ulKillTimeWait = tcp_kill_stats.timewait;
+	xTcpStats.ulKillClosing = tcp_kill_stats.closing;
+	xTcpStats.ulKillActive = tcp_kill_stats.active;
+	xTcpStats.ulRefused = tcp_kill_stats.refused;
+#endif
+}
+
+/**
+ * Counts the TCP pcbs and copies the counters. Without core locking the
+ * count is done by the tcpip thread and returned by the next call.
  *
+ * @param pxStats receives the counters
  */
-static err_t low_level_output(struct netif *netif, struct pbuf *p)
+void LWIPServiceTaskTcpStats(tTcpStats *pxStats)
 {
-	err_t status;
+#if LWIP_TCPIP_CORE_LOCKING
+	LOCK_TCPIP_CORE();
+	vTcpCount(NULL);
+	*pxStats = xTcpStats;
+	UNLOCK_TCPIP_CORE();
+#else
+	vTraceSuspendAll();
+	*pxStats = xTcpStats;
+	vTraceResumeAll();
+	tcpip_callback_with_block(vTcpCount, NULL, 0);
+#endif
+}
 
-	// Bump the reference count on the pbuf to prevent it from being
-	// freed till we are done with it.  
-	pbuf_ref(p);
+/**
+ * Frees the frames which the MAC has sent. Runs in the tcpip thread, the
+ * interrupt handler only moves ulEthTxLoad.
+ */
+static void ethernetif_tx_reclaim(void)
+{
+	while (ulEthTxTail != ulEthTxLoad)
+	{
+		pbuf_free(pxEthTxQueue[ulEthTxTail & (ETH_TX_QUEUE_SIZE - 1)]);
+		ulEthTxTail++;
+	}
+}
 
-	// Prevent from simultaneously writing to ETH TX FIFO    	
-	xSemaphoreTake(ETHTxAccessMutex[0], ( portTickType ) portMAX_DELAY);
+/**
+ * TX complete handler, called by ETH0IntHandler() when the MAC has sent a
+ * frame. Loads the next queued frame into the TX FIFO, the TX interrupt
+ * stays enabled while frames are queued.
+ */
+static void ethernetif_tx_isr(void)
+{
+	if ((HWREG(ETH_BASE + MAC_O_TR) & MAC_TR_NEWTX) != 0)
+	{
+		return;
+	}
 
-	// If Semaphore was given previously -> take it
-	while (xSemaphoreTake(ETHTxBinSemaphore[0], ( portTickType ) 0) == pdTRUE)
-		;
+	if (ulEthTxLoad != ulEthTxHead)
+	{
+		low_level_transmit(&lwip_netif,
+				pxEthTxQueue[ulEthTxLoad & (ETH_TX_QUEUE_SIZE - 1)]);
+		ulEthTxLoad++;
+	}
+	else
+	{
+		EthernetIntDisable(ETH_BASE, ETH_INT_TX);
+	}
+}
 
-	// If the transmitter is idle, send the pbuf now.
-	if (((HWREG(ETH_BASE + MAC_O_TR) & MAC_TR_NEWTX) == 0))
+/**
+ * This function sends the packet or puts it into the TX queue and returns.
+ * If the transmitter is idle and nothing is queued, the packet is loaded
+ * into the Stellaris transmit fifo at once, otherwise a copy is queued and
+ * the TX interrupt loads it when the frame before has been sent.
+ *
+ * The packet is copied because lwIP keeps the pbuf of a TCP segment until
+ * it is acknowledged and writes the headers of the same pbuf again when it
+ * retransmits the segment, also while the frame may still be queued here.
+ *
+ * lwIP 1.3.1 drops a segment which couldn't be sent (tcp_output_segment
+ * ignores the error), it would only be sent again by the retransmission
+ * timeout. So a full queue holds the calling thread up to ETH_TX_WAIT_MS
+ * until the frames in front have been sent instead of dropping the packet.
+ *
+ * @param netif the lwip network interface structure for this ethernetif
+ * @param p the MAC packet to send (e.g. IP packet including MAC addresses and type)
+ * @return ERR_OK if the packet was sent or queued
+ *         ERR_IF if the link is down, ERR_MEM if the queue stayed full
+ *
+ */
+static err_t low_level_output(struct netif *netif, struct pbuf *p)
+{
+	struct pbuf *q = NULL;
+	portTickType xStart;
+
+	if (0 == ETHServiceTaskLinkStatus(0))
 	{
-		// Send packet via eth controller
-		status = low_level_transmit(netif, p);
+		// ~ bitwise negation, all bit except NETIF_FLAG_LINK_UP set to 1 and AND with current flag
+		netif->flags &= ~NETIF_FLAG_LINK_UP;
+		LWIP_DEBUGF(CORTEX_DEBUG, ("low_level_output: link is down\n"));LINK_STATS_INC(link.err);
+		return (ERR_IF);
 	}
 	else
 	{
-		LWIP_DEBUGF(CORTEX_DEBUG, ("low_level_output: Ethernet transmitter busy\n"));
-		// Enable generating transmit interrupt for eth. controller
-		EthernetIntEnable(ETH_BASE, ETH_INT_TX);
+		netif->flags |= NETIF_FLAG_LINK_UP;
+	}
 
-		// Waiting for finishing transmitting from interrupt routine
-		xSemaphoreTake(ETHTxBinSemaphore[0], ( portTickType ) portMAX_DELAY);
+	xStart = xTaskGetTickCount();
+	for (;;)
+	{
+		ethernetif_tx_reclaim();
 
-		// Send packet via eth controller
-		status = low_level_transmit(netif, p);
+		// Without queued frames an idle transmitter takes the packet itself,
+		// the FIFO holds a copy then.
+		EthernetIntDisable(ETH_BASE, ETH_INT_TX | ETH_INT_TXER);
+		if (ulEthTxLoad == ulEthTxHead
+				&& (HWREG(ETH_BASE + MAC_O_TR) & MAC_TR_NEWTX) == 0)
+		{
+			low_level_transmit(netif, p);
+			EthernetIntEnable(ETH_BASE, ETH_INT_TXER);
+			return ERR_OK;
+		}
+		EthernetIntEnable(ETH_BASE, ETH_INT_TX | ETH_INT_TXER);
 
-		// Disable generating transmit interrupt for eth. controller
-		EthernetIntDisable(ETH_BASE, ETH_INT_TX);
+		if (ulEthTxHead - ulEthTxTail < ETH_TX_QUEUE_SIZE)
+		{
+			q = pbuf_alloc(PBUF_RAW, p->tot_len, PBUF_RAM);
+			if (q != NULL)
+			{
+				break;
+			}
+		}
+
+		if ((xTaskGetTickCount() - xStart) >= ETH_TX_WAIT_MS / portTICK_RATE_MS)
+		{
+			LWIP_DEBUGF(CORTEX_DEBUG, ("low_level_output: TX queue full\n"));LINK_STATS_INC(link.drop);
+			return (ERR_MEM);
+		}
+		vTaskDelay(1);
 	}
 
-	// Release mutex
-	xSemaphoreGive(ETHTxAccessMutex[0]);
-	//pf	vTaskDelay(10 / portTICK_RATE_MS);
+	pbuf_copy(q, p);
+
+	// The TX interrupts must not load frames while the queue is changed.
+	EthernetIntDisable(ETH_BASE, ETH_INT_TX | ETH_INT_TXER);
+
+	pxEthTxQueue[ulEthTxHead & (ETH_TX_QUEUE_SIZE - 1)] = q;
+	ulEthTxHead++;
 
-	pbuf_free(p);
+	// If the transmitter is idle, send the oldest frame now.
+	if ((HWREG(ETH_BASE + MAC_O_TR) & MAC_TR_NEWTX) == 0)
+	{
+		low_level_transmit(netif, pxEthTxQueue[ulEthTxLoad
+				& (ETH_TX_QUEUE_SIZE - 1)]);
+		ulEthTxLoad++;
+	}
 
-	return status;
+	// The TX interrupt loads the rest.
+	if (ulEthTxLoad != ulEthTxHead)
+	{
+		LWIP_DEBUGF(CORTEX_DEBUG, ("low_level_output: Ethernet transmitter busy\n"));
+		EthernetIntEnable(ETH_BASE, ETH_INT_TX | ETH_INT_TXER);
+	}
+	else
+	{
+		EthernetIntEnable(ETH_BASE, ETH_INT_TXER);
+	}
+
+	return ERR_OK;
 }
 
 /**
@@ -378,7 +740,8 @@ static err_t low_level_output(struct netif *netif, struct pbuf *p)
  * @return ERR_OK if the packet could be sent
  *         an err_t value if the packet couldn't be sent
  * @note This function MUST be called with interrupts disabled or with the
- *       Stellaris Ethernet transmit fifo protected.
+ *       Stellaris Ethernet transmit fifo protected. It is called from the
+ *       TX interrupt, the link is checked by low_level_output().
  */
 static err_t low_level_transmit(struct netif *netif, struct pbuf *p)
 {
@@ -390,18 +753,6 @@ static err_t low_level_transmit(struct netif *netif, struct pbuf *p)
 	unsigned long ulGather;
 	unsigned char *pucGather;
 
-	if (0 == ETHServiceTaskLinkStatus(0))
-	{
-		// ~ bitwise negation, all bit except NETIF_FLAG_LINK_UP set to 1 and AND with current flag
-		netif->flags &= ~NETIF_FLAG_LINK_UP;
-		LWIP_DEBUGF(CORTEX_DEBUG, ("low_level_transmit: link is down\n"));LINK_STATS_INC(link.err);
-		return (ERR_IF);
-	}
-	else
-	{
-		netif->flags |= NETIF_FLAG_LINK_UP;
-	}
-
 	/**
 	 * Fill in the first two bytes of the payload data (configured as padding
 	 * with ETH_PAD_SIZE = 2) with the total length of the payload data
@@ -531,6 +882,165 @@ err_t ethernetif_init(struct netif *netif)
 	return low_level_init(netif);
 }
 
+//*****************************************************************************
+//
+// Name of the config parameter which keeps the last DHCP address
+//
+//*****************************************************************************
+#define DHCP_LEASE_KEY	"DHCP_LEASE"
+
+//*****************************************************************************
+//
+// IP address mode, read from the config file
+//
+//*****************************************************************************
+static char IPState = 0;
+
+//*****************************************************************************
+//
+// Last DHCP address, asked for again with INIT-REBOOT after a reset or
+// a link change
+//
+//*****************************************************************************
+static struct ip_addr xLeaseAddr;
+
+//*****************************************************************************
+//
+//! Called by the tcpip thread as soon as it runs.
+//
+//*****************************************************************************
+static void vTcpipReady(void *pvArg)
+{
+	xSemaphoreGive((xSemaphoreHandle) pvArg);
+}
+
+//*****************************************************************************
+//
+//! Called by lwIP if the interface goes up or down, e.g. when DHCP has
+//! bound the address. Wakes the service task like a link change does.
+//
+//*****************************************************************************
+static void vNetifStatus(struct netif *netif)
+{
+	xSemaphoreGive(ETHLinkBinSemaphore[0]);
+}
+
+//*****************************************************************************
+//
+//! Follows the link state reported by the PHY interrupt, runs in the tcpip
+//! thread.
+//!
+//! On link up the address is (re)configured: DHCP asks for the previous
+//! address first, AutoIP starts probing and a static address is used
+//! directly. On link down the interface is taken down.
+//
+//*****************************************************************************
+static void vNetifLink(void *pvArg)
+{
+	struct netif *netif = (struct netif *) pvArg;
+	struct ip_addr xAddr;
+
+	if (ETHServiceTaskLinkStatus(0) == 1)
+	{
+		if (netif_is_link_up(netif))
+		{
+			return;
+		}
+		netif_set_link_up(netif);
+		vBootMark("link up");
+
+#if LWIP_DHCP
+		if (IPState == IPADDR_USE_DHCP)
+		{
+			xAddr = (netif->ip_addr.addr != 0) ? netif->ip_addr : xLeaseAddr;
+			vBootBegin("dhcp");
+			dhcp_start_reboot(netif, &xAddr);
+			return;
+		}
+#endif
+
+#if LWIP_AUTOIP
+		if (IPState == IPADDR_USE_AUTOIP)
+		{
+			autoip_start(netif);
+			return;
+		}
+#endif
+
+		netif_set_up(netif);
+	}
+	else
+	{
+		netif_set_link_down(netif);
+		netif_set_down(netif);
+	}
+}
+
+//*****************************************************************************
+//
+//! Starts the services once the first address is bound. Runs in the tcpip
+//! thread (tcpip_callback): the init functions create pcbs and SNTP and DNS
+//! start their timers, which sys_timeout() only keeps for the tcpip thread.
+//
+//*****************************************************************************
+static void vNetServicesStart(void *pvArg)
+{
+	LWIP_UNUSED_ARG(pvArg);
+
+	if (bConfigGetBool("IS_SERVER", false))
+	{
+		/* Initialize HTTP, DNS, SNTP */
+		printf("HTTPD Starten ...\n");
+		vBootBegin("httpd");
+		httpd_init();
+		vBootEnd("httpd");
+	}
+
+#if ENABLE_SNTP
+	printf("SNTP Starten ...\n");
+	sntp_init();
+#endif
+
+#if ENABLE_DNS
+	printf("DNS Starten ...\n");
+	dns_init();
+#endif
+
+#if ENABLE_NET_BIOS
+	printf("NETBIOS Starten ...\n");
+	netbios_init();
+#endif
+
+	printf("Dienste gestartet ...\n");
+}
+
+//*****************************************************************************
+//
+//! Keeps a new DHCP address in the config, the next boot asks for it with
+//! INIT-REBOOT instead of a full discovery.
+//
+//*****************************************************************************
+static void vNetLeaseSave(void)
+{
+	char pcLease[16];
+
+	if (IPState != IPADDR_USE_DHCP || lwip_netif.ip_addr.addr
+			== xLeaseAddr.addr)
+	{
+		return;
+	}
+	xLeaseAddr = lwip_netif.ip_addr;
+
+	snprintf(pcLease, sizeof(pcLease), "%d.%d.%d.%d",
+			ip4_addr1(&xLeaseAddr), ip4_addr2(&xLeaseAddr),
+			ip4_addr3(&xLeaseAddr), ip4_addr4(&xLeaseAddr));
+
+	if (iConfigSet(DHCP_LEASE_KEY, pcLease) != 0 || iConfigSave() != 0)
+	{
+		printf("DHCP lease not saved\n");
+	}
+}
+
 //*****************************************************************************
 //
 //! Initializes the lwIP TCP/IP stack.
@@ -556,31 +1066,22 @@ void LWIPServiceTaskInit(void *pvParameters)
 	struct ip_addr *ip_addr;
 	struct ip_addr *net_mask;
 	struct ip_addr *gw_addr;
-
-	//struct ip_addr ip_addr_local;
-	//struct ip_addr net_mask_local;
-
-	char IPState = 0;
-
-	char* configLoad;
-
-	IP_CONFIG * ipCfg;
+	xSemaphoreHandle xReady;
+	tBoolean bUp = false, bStarted = false;
+	unsigned long ulLease;
 
 	printf("Initialisiere IP ");
-	ipCfg = pvPortMalloc(sizeof(IP_CONFIG));
-
-	configLoad = loadFromConfig(IP_CONFIG_FILE, "USE_DHCP");
 
 #ifdef ENABLE_GRAPHIC
 	vShowBootText("load ipconfig ...");
 #endif
 
-	printf("LWIPSTACK: LOAD CONFIG: (%s)\n", configLoad);
-	if (configLoad == 0)
+	printf("LWIPSTACK: LOAD CONFIG: (%s)\n", pcConfigGet("USE_DHCP"));
+	if (pcConfigGet("USE_DHCP") == NULL)
 	{
 		IPState = IPADDR_USE_AUTOIP;
 	}
-	else if (strcmp(configLoad, "true") == 0)
+	else if (bConfigGetBool("USE_DHCP", false))
 	{
 		IPState = IPADDR_USE_DHCP;
 	}
@@ -589,12 +1090,18 @@ void LWIPServiceTaskInit(void *pvParameters)
 		IPState = IPADDR_USE_STATIC;
 	}
 
-	vPortFree(configLoad);
-
-	// Start the TCP/IP thread & init stuff
-	tcpip_init(NULL, NULL);
+	if (IPState == IPADDR_USE_DHCP && bConfigGetIPv4(DHCP_LEASE_KEY, &ulLease))
+	{
+		xLeaseAddr.addr = ulLease;
+	}
 
-	vTaskDelay(100 / portTICK_RATE_MS);
+	// Start the TCP/IP thread & init stuff, wait until it runs
+	vBootBegin("tcpip_init");
+	xReady = xSemaphoreCreateCounting( 1, 0 );
+	tcpip_init(vTcpipReady, xReady);
+	xSemaphoreTake(xReady, portMAX_DELAY);
+	vQueueDelete(xReady);
+	vBootEnd("tcpip_init");
 
 	// Setup the network address values.
 	if (IPState == IPADDR_USE_STATIC)
@@ -609,6 +1116,7 @@ void LWIPServiceTaskInit(void *pvParameters)
 		ip_addr = pvPortMalloc(sizeof(struct ip_addr));
 		net_mask = pvPortMalloc(sizeof(struct ip_addr));
 		gw_addr = pvPortMalloc(sizeof(struct ip_addr));
+		ip_addr->addr = net_mask->addr = gw_addr->addr = 0;
 	}
 #endif
 
@@ -623,149 +1131,75 @@ void LWIPServiceTaskInit(void *pvParameters)
 #ifdef ENABLE_GRAPHIC
 	vShowBootText("starting Network ...");
 #endif
+	LOCK_TCPIP_CORE();
 	netif_add(&lwip_netif, ip_addr, net_mask, gw_addr, NULL, ethernetif_init,
 			tcpip_input);
 	netif_set_default(&lwip_netif);
+	netif_set_status_callback(&lwip_netif, vNetifStatus);
+	UNLOCK_TCPIP_CORE();
 
-	printf("NETIF UP\n");
+	// DHCP, AutoIP or the static address are started as soon as the link is
+	// up, it may be up already
+	tcpip_callback(vNetifLink, &lwip_netif);
 
-	// Start DHCP, if enabled.
-#if LWIP_DHCP
-	if (IPState == IPADDR_USE_DHCP)
-	{
-#ifdef ENABLE_GRAPHIC
-		vShowBootText("waiting for DHCP ...");
-#endif
-		printf("Starte DHCP Client ...     ");
-		if (dhcp_start(&lwip_netif) == ERR_OK)
-		{
-			printf("[ok]\n");
-		}
-		else
-		{
-			printf("[fail]\n");
-		}
-	}
-#endif
-
-	// Start AutoIP, if enabled and DHCP is not.
-#if LWIP_AUTOIP
-	if (IPState == IPADDR_USE_AUTOIP)
+	// Nothing else to do than to follow link and address changes.
+	while (1)
 	{
-		printf ("Setzte Auto IP (NICHT DHCP) ...\n");
-		autoip_start(&lwip_netif);
-	}
-#endif
+		xSemaphoreTake(ETHLinkBinSemaphore[0], portMAX_DELAY);
 
-	if (IPState == IPADDR_USE_STATIC)
-	{
-		// Bring the interface up.
-		netif_set_up(&lwip_netif);
-	}
-	vTaskDelay(1000 / portTICK_RATE_MS);
+		// the interrupt only sets the link flag, the interface is changed
+		// by the tcpip thread
+		tcpip_callback(vNetifLink, &lwip_netif);
 
-	while (0 == netif_is_up(&lwip_netif))
-	{
-		vTaskDelay(5000 / portTICK_RATE_MS);
-		if (0 == netif_is_up(&lwip_netif))
+		if (netif_is_up(&lwip_netif) && !bUp)
 		{
-			dhcp_renew(&lwip_netif);
-		}
-	}
+			bUp = true;
+			printnetif(&lwip_netif);
 
-	printnetif(&lwip_netif);
-
-	configLoad = loadFromConfig(IP_CONFIG_FILE, "IS_SERVER");
-	if (strcmp(configLoad, "true") == 0)
-	{
-		/* Initialize HTTP, DNS, SNTP */
-		printf("HTTPD Starten ...\n");
-		httpd_init();
-	}
-	vPortFree(configLoad);
-
-#if ENABLE_SNTP
-	printf("SNTP Starten ...\n");
-	sntp_init();
-#endif
-
-#if ENABLE_DNS
-	printf("DNS Starten ...\n");
-	dns_init();
-#endif
-
-#if ENABLE_NET_BIOS
-	printf("NETBIOS Starten ...\n");
-	netbios_init();
-#endif
+			if (!bStarted)
+			{
+				if (IPState == IPADDR_USE_DHCP)
+				{
+					vBootEnd("dhcp");
+				}
+				vBootMark("address bound");
+				tcpip_callback(vNetServicesStart, NULL);
+			}
 
-	printf("Dienste gestartet ...\n");
+			vNetLeaseSave();
 
 #ifdef ENABLE_GRAPHIC
-	configLoad = loadFromConfig(IP_CONFIG_FILE, "IS_CLIENT");
-	if (strcmp(configLoad, "true") == 0)
-	{
-		vShowBootText("loading menu ...");
-		vLoadMenu();
-	}
-	else
-	{
-		vShowBootText("ready for requests ...");
-	}
-	vPortFree(configLoad);
+			vShowBootText("activate networkinterface ...");
+			if (bConfigGetBool("IS_CLIENT", false))
+			{
+				vShowBootText("loading menu ...");
+				vBootBegin("menu");
+				vLoadMenu();
+				vBootEnd("menu");
+			}
+			else
+			{
+				vShowBootText("ready for requests ...");
+			}
 #endif
 
-	// Nothing else to do.  No point hanging around.
-	while (1)
-	{
-		vTaskDelay(500 / portTICK_RATE_MS);
-		if (EthernetPHYRead(ETH_BASE, PHY_MR1) & ETH_PHY_LINK_UP)
-		{
-			if (!(netif_is_up(&lwip_netif)))
+			if (!bStarted)
 			{
-				// set link up flag
-				netif_set_up(&lwip_netif);
-#ifdef ENABLE_GRAPHIC
-				vShowBootText("activate networkinterface ...");
-				configLoad = loadFromConfig(IP_CONFIG_FILE, "IS_CLIENT");
-				if (strcmp(configLoad, "true") == 0)
-				{
-					vShowBootText("loading menu ...");
-					vLoadMenu();
-				}
-				else
-				{
-					vShowBootText("ready for requests ...");
-				}
-				vPortFree(configLoad);
+				bStarted = true;
+				vBootDone();
+#if ENABLE_API_BENCH
+				vApiBench();
 #endif
-				if (IPState == IPADDR_USE_DHCP)
-				{
-					printf("DHCP Adresse anfordern ...  ");
-					if (dhcp_renew(&lwip_netif) == ERR_OK)
-					{
-						printf("[ok]\n");
-						printnetif(&lwip_netif);
-					}
-					else
-					{
-						printf("[fail]\n");
-					}
-				}
 			}
 		}
-		else
+		else if (!netif_is_up(&lwip_netif) && bUp)
 		{
-			if (netif_is_up(&lwip_netif))
-			{
+			bUp = false;
 #ifdef ENABLE_GRAPHIC
-				vShowBootText("no networkconnection!!");
+			vShowBootText("no networkconnection!!");
 #endif
-				printf("Deaktiviere Netzwerkinterface ...  ");
-				netif_set_down(&lwip_netif);
-			}
+			printf("Netzwerkinterface deaktiviert\n");
 		}
-
 	}
 }
 
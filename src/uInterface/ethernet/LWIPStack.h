@@ -21,6 +21,55 @@
 #define IFNAME0 'l'
 #define IFNAME1 'm'
 #define ETH_BLOCK_TIME_WAITING_FOR_INPUT_MS (5000)
+// frames queued for the tcpip thread
+#define ETH_RX_QUEUE_SIZE (8)
+// contiguous buffers for frames larger than a pool pbuf
+#define ETH_RX_LARGE_BUFFERS (6)
+// size of these buffers: length word, 1514 byte frame and FCS
+#define ETH_RX_LARGE_SIZE (1520)
+// time the input task waits for the tcpip thread if the queue is full
+#define ETH_RX_QUEUE_WAIT_MS (10)
+// frames queued for the TX interrupt, must be a power of two
+#define ETH_TX_QUEUE_SIZE (8)
+// time a sender waits for room in the TX queue before the frame is dropped
+#define ETH_TX_WAIT_MS (20)
+
+//*****************************************************************************
+//
+// Counters of the input task
+//
+//*****************************************************************************
+typedef struct
+{
+	unsigned long ulWakeups;	// wakeups of the input task
+	unsigned long ulFrames;		// frames handed to the stack
+	unsigned long ulMaxBatch;	// most frames read in one wakeup
+	unsigned long ulHandoffs;	// callbacks posted to the tcpip thread
+	unsigned long ulDropped;	// no pbuf or the queue stayed full
+	unsigned long ulOverflows;	// RX FIFO overflows of the MAC
+	unsigned long ulLarge;		// frames read into a large buffer
+	unsigned long ulChained;	// frames read into a chain of pool pbufs
+	unsigned long ulPbufs;		// pbufs of the frames handed to the stack
+	unsigned long ulBytes;		// bytes of the frames handed to the stack
+	unsigned long ulReadCycles;	// cycles reading the FIFO
+	unsigned long ulStackCycles;	// cycles of ethernet_input() in the tcpip thread
+} tEthRxStats;
+
+//*****************************************************************************
+//
+// TCP connections, counted in the tcpip thread
+//
+//*****************************************************************************
+typedef struct
+{
+	unsigned long ulActive;		// pcbs in tcp_active_pcbs (not LISTEN)
+	unsigned long ulTimeWait;	// pcbs in TIME_WAIT
+	unsigned long ulTimeWaitMax;	// most pcbs in TIME_WAIT seen
+	unsigned long ulKillTimeWait;	// TIME_WAIT pcbs recycled by tcp_alloc()
+	unsigned long ulKillClosing;	// LAST_ACK/CLOSING pcbs dropped by tcp_alloc()
+	unsigned long ulKillActive;	// active connections aborted by tcp_alloc()
+	unsigned long ulRefused;	// SYNs dropped, no pcb left
+} tTcpStats;
 
 typedef struct
 {
@@ -50,6 +99,8 @@ typedef struct
 //
 //*****************************************************************************
 extern void LWIPServiceTaskInit(void *pvParameters);
+extern void LWIPServiceTaskRxStats(tEthRxStats *pxStats);
+extern void LWIPServiceTaskTcpStats(tTcpStats *pxStats);
 
 #if CORTEX_DEBUG
 void stellarisif_debug_print(struct pbuf *p);
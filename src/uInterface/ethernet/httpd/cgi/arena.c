@@ -0,0 +1,179 @@
+/**
+ * \addtogroup CGIandSSI
+ * @{
+ *
+ * \author Anziner, Hahn
+ * \brief Memory for the temporaries of a request
+ *
+ * Every connection has an arena for the memory it needs while a page is
+ * processed (the SSI parameters). Memory is taken from the current block by
+ * moving a pointer, nothing is freed on its own: vArenaFree() gives all
+ * blocks of the arena back at once.
+ *
+ * The blocks come from a fixed pool, so a request doesn't touch the heap.
+ * Only if the pool is empty or the memory is larger than a block, the
+ * block is allocated from the heap.
+ *
+ * The arenas are only used by the webserver in the tcpip thread, there is
+ * no locking.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+
+#include "ethernet/httpd/cgi/arena.h"
+
+/// memory is handed out aligned for pointers
+#define ARENA_ALIGN(x)		(((x) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
+/// header size, the memory behind it stays aligned
+#define ARENA_HEADER		ARENA_ALIGN(sizeof(tArenaBlock))
+
+/** the pool, blocks are aligned like their header */
+static union
+{
+	tArenaBlock header;
+	unsigned char data[ARENA_BLOCK_SIZE];
+} xArenaPool[ARENA_POOL_BLOCKS];
+
+/** free blocks of the pool */
+static tArenaBlock *pxArenaFree = NULL;
+static tBoolean bArenaPoolInit = false;
+
+/**
+ * Takes a block for at least size bytes, from the pool if possible
+ */
+static tArenaBlock* pxArenaBlock(size_t size)
+{
+	tArenaBlock *block;
+	int i;
+
+	if (!bArenaPoolInit)
+	{
+		for (i = 0; i < ARENA_POOL_BLOCKS; i++)
+		{
+			xArenaPool[i].header.next = pxArenaFree;
+			pxArenaFree = &xArenaPool[i].header;
+		}
+		bArenaPoolInit = true;
+	}
+
+	if (size <= ARENA_BLOCK_SIZE - ARENA_HEADER && pxArenaFree != NULL)
+	{
+		block = pxArenaFree;
+		pxArenaFree = block->next;
+		block->size = ARENA_BLOCK_SIZE - ARENA_HEADER;
+		block->heap = false;
+	}
+	else
+	{
+		if (size < ARENA_BLOCK_SIZE - ARENA_HEADER)
+		{
+			size = ARENA_BLOCK_SIZE - ARENA_HEADER;
+		}
+		block = (tArenaBlock *) pvPortMalloc(ARENA_HEADER + size);
+		if (block == NULL)
+		{
+			return NULL;
+		}
+		block->size = size;
+		block->heap = true;
+	}
+
+	block->used = 0;
+
+	return block;
+}
+
+/**
+ * Prepares an empty arena
+ */
+void vArenaInit(tArena *arena)
+{
+	arena->blocks = NULL;
+}
+
+/**
+ * Gets memory from the arena. It stays valid until vArenaFree().
+ *
+ * @param arena	arena of the connection
+ * @param size	number of bytes
+ * @return the memory, NULL if there is none
+ */
+void* pvArenaAlloc(tArena *arena, size_t size)
+{
+	tArenaBlock *block = arena->blocks;
+	void *ret;
+
+	size = ARENA_ALIGN(size);
+
+	if (block == NULL || block->size - block->used < size)
+	{
+		block = pxArenaBlock(size);
+		if (block == NULL)
+		{
+			return NULL;
+		}
+		block->next = arena->blocks;
+		arena->blocks = block;
+	}
+
+	ret = ((unsigned char *) block) + ARENA_HEADER + block->used;
+	block->used += size;
+
+	return ret;
+}
+
+/**
+ * Copies a string into the arena
+ *
+ * @param arena	arena of the connection
+ * @param src	string to copy
+ * @return the copy, NULL if there is no memory
+ */
+char* pcArenaStrdup(tArena *arena, const char *src)
+{
+	size_t len = strlen(src) + 1;
+	char *ret = (char *) pvArenaAlloc(arena, len);
+
+	if (ret != NULL)
+	{
+		memcpy(ret, src, len);
+	}
+
+	return ret;
+}
+
+/**
+ * Gives all memory of the arena back at once, the blocks return to the pool
+ */
+void vArenaFree(tArena *arena)
+{
+	tArenaBlock *block;
+
+	while (arena->blocks != NULL)
+	{
+		block = arena->blocks;
+		arena->blocks = block->next;
+
+		if (block->heap)
+		{
+			vPortFree(block);
+		}
+		else
+		{
+			block->next = pxArenaFree;
+			pxArenaFree = block;
+		}
+	}
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
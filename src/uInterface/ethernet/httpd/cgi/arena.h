@@ -0,0 +1,57 @@
+/**
+ * \addtogroup CGIandSSI
+ * @{
+ *
+ * \author Anziner, Hahn
+ * \brief Prototypes for the request arena
+ *
+ */
+
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+
+#include "hw_types.h"
+
+/// size of an arena block with its header
+#define ARENA_BLOCK_SIZE	256
+
+/// number of blocks in the pool, shared by all connections
+#define ARENA_POOL_BLOCKS	8
+
+/** header of an arena block, the memory follows it */
+typedef struct tArenaBlock
+{
+	struct tArenaBlock *next; ///< the block used before
+	unsigned short size; ///< bytes behind the header
+	unsigned short used; ///< bytes handed out
+	tBoolean heap; ///< allocated from the heap, the pool was empty
+} tArenaBlock;
+
+/** the memory of one connection, the newest block is used first */
+typedef struct
+{
+	tArenaBlock *blocks;
+} tArena;
+
+/// prepares an empty arena
+void vArenaInit(tArena *arena);
+
+/// gets memory from the arena, NULL if there is none
+void* pvArenaAlloc(tArena *arena, size_t size);
+
+/// copies a string into the arena
+char* pcArenaStrdup(tArena *arena, const char *src);
+
+/// gives all memory of the arena back at once
+void vArenaFree(tArena *arena);
+
+#endif
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
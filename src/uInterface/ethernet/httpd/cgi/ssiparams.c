@@ -20,78 +20,72 @@
 /**
  adds a new element to the list
 
+ @param *arena		arena of the connection, holds the element
  @param *root 		pointer to root element of list
  @param *nameValue	pointer to name-value string ($name=$value)
 
  @return 0	element not added
  */
-int SSIParamAdd(pSSIParam *root, char *nameValue)
+int SSIParamAdd(tArena *arena, pSSIParam *root, char *nameValue)
 {
 	char *value;
-	pSSIParam nParam, tmp = *(root);
+	int nameLen;
+	pSSIParam nParam;
 
 #if DEBUG_SSI_PARAMS
 	printf("SSIParamAdd: %s \n", nameValue);
 #endif
 
-	value = strstr(nameValue, "=");
+	value = strchr(nameValue, '=');
+	if (value == NULL)
+	{
+		return 0;
+	}
+	nameLen = value - nameValue;
 	value++;
 
-	nParam = pvPortMalloc(sizeof(SSIParam));
-	nParam->name = pvPortMalloc(strlen(nameValue) - strlen(value) + 1);
-	nParam->value = pvPortMalloc(strlen(value) + 1);
-
-	if (nParam != NULL && nParam->name != NULL && nParam->value != NULL)
+	//
+	// the element, name and value in one piece of the arena
+	//
+	nParam = pvArenaAlloc(arena, sizeof(SSIParam) + nameLen + 1
+			+ strlen(value) + 1);
+	if (nParam == NULL)
 	{
+#if DEBUG_SSI_PARAMS
+		printf(" ... fail\n");
+#endif
+		return 0;
+	}
 
-		snprintf(nParam->name, (strlen(nameValue) - strlen(value)), "%s",
-				nameValue);
-		sprintf(nParam->value, "%s", value);
+	nParam->name = (char *) (nParam + 1);
+	memcpy(nParam->name, nameValue, nameLen);
+	nParam->name[nameLen] = 0;
+	nParam->value = nParam->name + nameLen + 1;
+	strcpy(nParam->value, value);
 
-		nParam->name = strtrim(nParam->name);
-		nParam->value = strtrim(nParam->value);
+	nParam->name = strtrim(nParam->name);
+	nParam->value = strtrim(nParam->value);
 
 #if DEBUG_SSI
-		printf("Werte getrimmt\n");
+	printf("Werte getrimmt\n");
 #endif
 
-		if (strlen(nParam->name) > 0)
-		{
-
-			nParam->next = tmp;
-			*(root) = nParam;
-#if DEBUG_SSI_PARAMS
-			printf("SSIParamAdd: added element name: '%s' value: '%s' \n",
-					nParam->name, nParam->value);
-#endif
-		}
-		else
-		{
-
+	if (strlen(nParam->name) > 0)
+	{
+		nParam->next = *(root);
+		*(root) = nParam;
 #if DEBUG_SSI_PARAMS
-			printf("SSIParamAdd: didnt insert element, name empty\n");
+		printf("SSIParamAdd: added element name: '%s' value: '%s' \n",
+				nParam->name, nParam->value);
 #endif
-		}
-
 	}
 	else
 	{
 #if DEBUG_SSI_PARAMS
-		printf(" ... fail\n");
+		printf("SSIParamAdd: didnt insert element, name empty\n");
 #endif
-		if (nParam->name != NULL)
-		{
-			vPortFree(nParam->name);
-		}
-		if (nParam->value != NULL)
-		{
-			vPortFree(nParam->value);
-		}
-		if (nParam != NULL)
-		{
-			vPortFree(nParam);
-		}
 	}
+
 	return 0;
 }
 /**
@@ -145,36 +139,15 @@ char* SSIParamGetValue(pSSIParam root, char *name)
 	return value;
 }
 /**
- * deletes and frees all elements ot the list
+ * empties the list. The elements are in the arena of the connection, the
+ * webserver gives it back after the tag is rendered.
  *
  * @param *root	pointer to root element of list
  *
  */
 void SSIParamDeleteAll(pSSIParam *root)
 {
-	pSSIParam p = (*root), del = NULL;
-
-	while (p != NULL)
-	{
-#if DEBUG_SSI_PARAMS
-		printf("SSIParamDeleteAll: delete element : %s \n", p->name);
-#endif
-		del = p;
-		p = p->next;
-		vPortFree(del->name);
-
-#if DEBUG_SSI_PARAMS
-		printf("SSIParamDeleteAll: freed name \n");
-#endif
-
-		vPortFree(del->value);
-
-#if DEBUG_SSI_PARAMS
-		printf("SSIParamDeleteAll: freed value \n");
-#endif
-
-		vPortFree(del);
-	}
+	*root = NULL;
 
 #if DEBUG_SSI_PARAMS
 	printf("SSIParamDeleteAll: deleted all elements \n");
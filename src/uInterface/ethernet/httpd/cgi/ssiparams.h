@@ -10,6 +10,8 @@
 #ifndef __SSIPARAMS_H__
 #define __SSIPARAMS_H__
 
+#include "ethernet/httpd/cgi/arena.h"
+
 /** represents an SSI Parameter */
 typedef struct SSIParam
 {
@@ -20,13 +22,13 @@ typedef struct SSIParam
 
 typedef SSIParam * pSSIParam;
 
-///  gets an element with $name from the list
-int SSIParamAdd(pSSIParam* root, char* nameValue);
+///  adds a new element to the list, the memory comes from the arena
+int SSIParamAdd(tArena* arena, pSSIParam* root, char* nameValue);
 
 ///  gets an element with $name from the list
 pSSIParam SSIParamGet(pSSIParam root, char* name);
 
-/// deletes and frees all elements ot the list
+/// empties the list, the memory is given back with the arena
 void SSIParamDeleteAll(pSSIParam* root);
 
 /// gets a value of an element with $name from the list
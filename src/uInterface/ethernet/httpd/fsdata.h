@@ -49,6 +49,18 @@ struct fsdata_file {
   const int len;
 };
 
+/**
+ * Entry of the indexed flash image generated by tools/makefsdata.py. The
+ * entries are sorted by name, size and ETag are computed on the host. The
+ * MIME type is part of the prepended HTTP header.
+ */
+typedef struct {
+  const char *pcName;            ///< path relative to the mount, e.g. "/404.html"
+  const unsigned char *pucData;  ///< content (incl. HTTP header if built with -h)
+  int iLen;                      ///< length of pucData
+  unsigned long ulETag;          ///< CRC32 sent as ETag header, 0 = none
+} tFsRomFile;
+
 #endif /* __FSDATA_H__ */
 
 //*****************************************************************************
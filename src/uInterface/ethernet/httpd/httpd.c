@@ -96,11 +96,15 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <ctype.h>
 
 #include "setup.h" // custom debug defines
 
 #include "taglib/tags.h"
 
+#include "log/trace.h"
+#include "log/boottime.h"
+
 #ifdef INCLUDE_HTTPD_DEBUG
 #define DEBUG_PRINT printf
 #else
@@ -169,6 +173,8 @@ struct http_state {
 	u32_t left; /* Number of unsent bytes in buf. */
 	int buf_len; /* Size of file read buffer, buf. */
 	u8_t retries;
+	u8_t keepalive; /* The client closes, keep the connection after the response */
+	u8_t idle; /* Polls without a request on a kept connection */
 #ifdef INCLUDE_HTTPD_SSI
 	u8_t tag_check; /* true if we are processing a .shtml file else false */
 	u8_t tag_index; /* Counter used by tag parsing state machine */
@@ -180,6 +186,7 @@ struct http_state {
 #endif
 #ifdef INCLUDE_HTTPD_SSI_PARAMS
 	pSSIParam ssi_params;
+	tArena arena; /* Memory of the SSI parameters, given back after each tag */
 #endif
 #ifdef INCLUDE_HTTPD_CGI
 	char *params[MAX_CGI_PARAMETERS]; /* Params extracted from the request URI */
@@ -193,6 +200,9 @@ u16_t hdr_index; /* The index of the hdr string currently being sent. */
 #endif
 };
 
+/* Connection counters */
+static tHttpdStats g_sHttpdStats;
+
 #ifdef INCLUDE_HTTPD_SSI
 /* SSI insert handler function pointer. */
 tSSIHandler g_pfnSSIHandler = NULL;
@@ -312,6 +322,9 @@ static void conn_err(void *arg, err_t err) {
 		if (hs->buf) {
 			mem_free(hs->buf);
 		}
+#ifdef INCLUDE_HTTPD_SSI_PARAMS
+		vArenaFree(&hs->arena);
+#endif
 		mem_free(hs);
 	}
 }
@@ -324,6 +337,17 @@ static void close_conn(struct tcp_pcb *pcb, struct http_state *hs) {
 	tcp_arg(pcb, NULL);
 	tcp_sent(pcb, NULL);
 	tcp_recv(pcb, NULL);
+
+	/* Segments of a file from the RAM content cache reference the cache
+	 * memory. If they are not acknowledged yet, drop them together with the
+	 * connection before the file (and its memory) is released.
+	 */
+	if (hs && hs->handle && hs->handle->pcache &&
+			(pcb->unacked != NULL || pcb->unsent != NULL)) {
+		tcp_abort(pcb);
+		pcb = NULL;
+	}
+
 	if (hs) {
 		if (hs->handle) {
 			fs_close(hs->handle);
@@ -332,8 +356,14 @@ static void close_conn(struct tcp_pcb *pcb, struct http_state *hs) {
 		if (hs->buf) {
 			mem_free(hs->buf);
 		}
+#ifdef INCLUDE_HTTPD_SSI_PARAMS
+		vArenaFree(&hs->arena);
+#endif
 		mem_free(hs);
 	}
+	if (pcb == NULL) {
+		return;
+	}
 	err = tcp_close(pcb);
 	if (err != ERR_OK) {
 		DEBUG_PRINT
@@ -341,6 +371,148 @@ static void close_conn(struct tcp_pcb *pcb, struct http_state *hs) {
 	}
 }
 /*-----------------------------------------------------------------------------------*/
+/* The response is sent completely. Keeps the connection open for the next
+ * request if the client closes it, else the server closes.
+ */
+static void end_response(struct tcp_pcb *pcb, struct http_state *hs) {
+	if (hs->keepalive) {
+		if (hs->buf) {
+			mem_free(hs->buf);
+			hs->buf = NULL;
+			hs->buf_len = 0;
+		}
+		hs->file = NULL;
+		hs->left = 0;
+		hs->retries = 0;
+		hs->idle = 0;
+		g_sHttpdStats.ulKept++;
+		return;
+	}
+
+	g_sHttpdStats.ulServerClosed++;
+	close_conn(pcb, hs);
+}
+/*-----------------------------------------------------------------------------------*/
+/* Case insensitive search of str (lower case) in the first len bytes of data,
+ * which need not be terminated. Returns the position behind str or NULL.
+ */
+static char *http_find(char *data, int len, const char *str) {
+	int n = strlen(str);
+	int i, k;
+
+	for (i = 0; i + n <= len; i++) {
+		for (k = 0; k < n && tolower((unsigned char) data[i + k]) == str[k]; k++)
+			;
+		if (k == n) {
+			return &data[i + n];
+		}
+	}
+
+	return NULL;
+}
+/*-----------------------------------------------------------------------------------*/
+/* Checks the request from the protocol version on: does the client keep the
+ * connection after the response? HTTP/1.1 does unless it sends
+ * "Connection: close", HTTP/1.0 only with "Connection: keep-alive".
+ */
+static u8_t http_client_keeps(char *req, int len) {
+	char *end, *conn;
+	u8_t http11;
+
+	http11 = (len >= 8) && (strncmp(req, "HTTP/1.1", 8) == 0);
+
+	/* Only look at the headers */
+	end = http_find(req, len, "\r\n\r\n");
+	if (end) {
+		len = end - req;
+	}
+
+	conn = http_find(req, len, "\r\nconnection:");
+	if (conn == NULL) {
+		return http11;
+	}
+	len -= conn - req;
+	while (len > 0 && *conn == ' ') {
+		conn++;
+		len--;
+	}
+	if (http_find(conn, (len < 5) ? len : 5, "close")) {
+		return false;
+	}
+	if (http_find(conn, (len < 10) ? len : 10, "keep-alive")) {
+		return true;
+	}
+
+	return http11;
+}
+/*-----------------------------------------------------------------------------------*/
+/* The client can only tell the end of a response without closing if the
+ * file has its own headers with a Content-Length (the JSON files of the RAM
+ * file system).
+ */
+static u8_t http_response_keeps(struct fs_file *file) {
+	char *end;
+	int len;
+
+	if (file == NULL || file->data == NULL || file->len < 5 ||
+			strncmp(file->data, "HTTP/", 5) != 0) {
+		return false;
+	}
+
+	len = file->len;
+	end = http_find(file->data, len, "\r\n\r\n");
+	if (end) {
+		len = end - file->data;
+	}
+
+	return http_find(file->data, len, "\r\ncontent-length:") != NULL;
+}
+/*-----------------------------------------------------------------------------------*/
+/* A flash file the client already has (If-None-Match with its ETag) is
+ * answered with 304 instead of the data. The response is built in the send
+ * buffer, the read index of a flash file is at its end, so send_data closes
+ * the file after it. Returns false if the file has to be sent.
+ */
+static u8_t http_not_modified(struct http_state *hs, struct fs_file *file,
+		char *req, int len) {
+	char tag[11];
+	char *match, *eol;
+
+	if (file == NULL || file->etag == 0) {
+		return false;
+	}
+
+	match = http_find(req, len, "\r\nif-none-match:");
+	if (match == NULL) {
+		return false;
+	}
+	len -= match - req;
+	eol = http_find(match, len, "\r\n");
+	if (eol) {
+		len = eol - match;
+	}
+
+	snprintf(tag, sizeof(tag), "\"%08x\"", (unsigned int) file->etag);
+	if (!http_find(match, len, tag) && !http_find(match, len, "*")) {
+		return false;
+	}
+
+	if (hs->buf == NULL) {
+		hs->buf = mem_malloc(HTTPD_NOT_MODIFIED_LEN);
+		if (hs->buf == NULL) {
+			return false;
+		}
+		hs->buf_len = HTTPD_NOT_MODIFIED_LEN;
+	} else if (hs->buf_len < HTTPD_NOT_MODIFIED_LEN) {
+		return false;
+	}
+
+	hs->left = snprintf(hs->buf, hs->buf_len,
+			"HTTP/1.1 304 Not Modified\r\nETag: %s\r\n\r\n", tag);
+	hs->file = hs->buf;
+	return true;
+}
+/*-----------------------------------------------------------------------------------*/
 #ifdef INCLUDE_HTTPD_CGI
 static int extract_uri_parameters(struct http_state *hs, char *params) {
 	char *pair;
@@ -409,16 +581,16 @@ static void get_tag_insert(struct http_state *hs) {
 	int loop;
 
 #if DEBUG_HTTPC
-	printf("get_tag_insert %x %x\n", (unsigned int) g_pfnSSIHandler, (unsigned int)xTagList);
+	TRACE2("get_tag_insert %x %x\n", g_pfnSSIHandler, xTagList);
 #endif
 	if (g_pfnSSIHandler != NULL && xTagList != NULL && g_iNumTags > 0) {
 #if DEBUG_HTTPC
-                printf("get_tag_insert - tags vorhanden\n");
+                TRACE0("get_tag_insert - tags vorhanden\n");
 #endif
 		/* Find this tag in the list we have been provided. */
 		for (loop = 0; loop < g_iNumTags; loop++) {
 #if DEBUG_HTTPC
-                      printf("get_tag_insert: TagName %s\n",  xTagList[loop].tagname);
+                      TRACE_STR("get_tag_insert: TagName %s\n",  xTagList[loop].tagname);
 #endif
 			if (strcmp(hs->tag_name,  xTagList[loop].tagname) == 0) {
 #ifdef INCLUDE_HTTPD_SSI_PARAMS
@@ -585,6 +757,62 @@ get_http_headers(struct http_state *pState, char *pszURI)
 }
 #endif
 
+/*-----------------------------------------------------------------------------------*/
+/* Sink for fs_forward: queues data from the FatFs sector window, the only
+ * copy is the one into the pbufs of the connection.
+ */
+static unsigned int http_stream_sink(void *arg, const unsigned char *data,
+		unsigned int len) {
+	struct tcp_pcb *pcb = arg;
+	u16_t sendlen;
+	err_t err;
+
+	if (data == NULL) {
+		/* Ready as long as the send buffer and queue have room. */
+		return (tcp_sndbuf(pcb) > 0 && pcb->snd_queuelen < TCP_SND_QUEUELEN);
+	}
+
+	sendlen = (len < tcp_sndbuf(pcb)) ? len : tcp_sndbuf(pcb);
+	do {
+		err = tcp_write(pcb, data, sendlen, 1);
+		if (err == ERR_MEM) {
+			sendlen /= 2;
+		}
+	} while (err == ERR_MEM && sendlen > 0);
+
+	return (err == ERR_OK) ? sendlen : 0;
+}
+
+/*-----------------------------------------------------------------------------------*/
+/* Sends the next block of a file which supports fs_forward, closes the
+ * connection at the end of the file.
+ */
+static void send_stream(struct tcp_pcb *pcb, struct http_state *hs) {
+	int count;
+
+	count = tcp_sndbuf(pcb);
+	if (count > (2 * pcb->mss)) {
+		count = 2 * pcb->mss;
+	}
+
+	count = fs_forward(hs->handle, http_stream_sink, pcb, count);
+	if (count < 0) {
+		/* We reached the end of the file so this request is done */
+		DEBUG_PRINT
+			("End of file.\n");
+		fs_close(hs->handle);
+		hs->handle = NULL;
+		end_response(pcb, hs);
+		return;
+	}
+
+	DEBUG_PRINT
+		("Forwarded %d bytes.\n", count);
+	if (count > 0) {
+		tcp_output(pcb);
+	}
+}
+
 /*-----------------------------------------------------------------------------------*/
 static void send_data(struct tcp_pcb *pcb, struct http_state *hs) {
 
@@ -672,6 +900,19 @@ static void send_data(struct tcp_pcb *pcb, struct http_state *hs) {
 	if (hs->left == 0) {
 		int count;
 
+		/* Files on the SD Card are passed to TCP straight from the FatFs
+		 * window, they need no send buffer. SSI files are parsed in the
+		 * buffer, so they are read as usual.
+		 */
+		if (hs->handle && fs_can_forward(hs->handle)
+#ifdef INCLUDE_HTTPD_SSI
+				&& !hs->tag_check
+#endif
+				) {
+			send_stream(pcb, hs);
+			return;
+		}
+
 		/* Do we already have a send buffer allocated? */
 		if (hs->buf) {
 			/* Yes - get the length of the buffer */
@@ -701,6 +942,7 @@ static void send_data(struct tcp_pcb *pcb, struct http_state *hs) {
 			//
 			// No - close the connection.
 			//
+			g_sHttpdStats.ulServerClosed++;
 			close_conn(pcb, hs);
 			return;
 		}
@@ -711,12 +953,21 @@ static void send_data(struct tcp_pcb *pcb, struct http_state *hs) {
 
 		count = fs_read(hs->handle, hs->buf, count);
 		if (count < 0) {
+			/* Data from the RAM content cache was sent without copy, keep the
+			 * file open until everything is acknowledged (http_sent calls us
+			 * again).
+			 */
+			if (hs->handle->pcache &&
+					(pcb->unacked != NULL || pcb->unsent != NULL)) {
+				return;
+			}
+
 			/* We reached the end of the file so this request is done */
 			DEBUG_PRINT
 				("End of file.\n");
 			fs_close(hs->handle);
 			hs->handle = NULL;
-			close_conn(pcb, hs);
+			end_response(pcb, hs);
 			return;
 		}
 
@@ -757,10 +1008,12 @@ static void send_data(struct tcp_pcb *pcb, struct http_state *hs) {
 			/* If the data is being read from a buffer in RAM, we need to copy it
 			 * into the PCB. If it's in flash, however, we can avoid the copy since
 			 * the data is obviously not going to be overwritten during the life
-			 * of the connection.
+			 * of the connection. The same holds for the RAM content cache, the
+			 * file keeps its reference until the data is acknowledged.
 			 */
 			err = tcp_write(pcb, hs->file, len,
-					(hs->file < (char *) 0x20000000) ? 0 : 1);
+					((hs->file < (char *) 0x20000000) ||
+					(hs->handle && hs->handle->pcache)) ? 0 : 1);
 			if (err == ERR_MEM) {
 				len /= 2;
 			}
@@ -906,7 +1159,7 @@ static void send_data(struct tcp_pcb *pcb, struct http_state *hs) {
 					hs->parse_left--;
 					hs->parsed++;
 #if DEBUG_SSI_PARAMS
-					printf("HTTPD - SWITCH : TAG_FOUND: found space, next char: %c\n", *(hs->parsed));
+					TRACE1("HTTPD - SWITCH : TAG_FOUND: found space, next char: %c\n", *(hs->parsed));
 #endif
 #if INCLUDE_HTTPD_SSI_PARAMS
 					if (*(hs->parsed) != g_pcTagLeadOut[0] && *(hs->parsed) != ' ')
@@ -972,10 +1225,10 @@ static void send_data(struct tcp_pcb *pcb, struct http_state *hs) {
 
 						param_name[i] = '\0';
 #if DEBUG_SSI_PARAMS
-						printf("SSI param: %s\n", param_name);
+						TRACE_STR("SSI param: %s\n", param_name);
 #endif
 						if (strlen(param_name) > 0) {
-							SSIParamAdd(&(hs->ssi_params), param_name);
+							SSIParamAdd(&(hs->arena), &(hs->ssi_params), param_name);
 						}
 						/* We read a non-empty tag so go ahead and look for the
 						 * leadout string.
@@ -994,11 +1247,11 @@ static void send_data(struct tcp_pcb *pcb, struct http_state *hs) {
 						c = *hs->parsed;
 						if (c == ' ') {
 #if DEBUG_SSI_PARAMS
-							printf("Add from space SSI param : %s\n", param_name);
+							TRACE_STR("Add from space SSI param : %s\n", param_name);
 #endif
 							param_name[i] = '\0';
 							if (strlen(param_name) > 0) {
-								SSIParamAdd(&(hs->ssi_params), param_name);
+								SSIParamAdd(&(hs->arena), &(hs->ssi_params), param_name);
 							}
 							// delete parameter, ready for new
 							param_name[0] = 0;
@@ -1050,6 +1303,11 @@ static void send_data(struct tcp_pcb *pcb, struct http_state *hs) {
 						 * tag we just found.
 						 */
 						get_tag_insert(hs);
+#ifdef INCLUDE_HTTPD_SSI_PARAMS
+						/* The parameters are only needed for this tag. */
+						hs->ssi_params = NULL;
+						vArenaFree(&hs->arena);
+#endif
 
 						/* Next time through, we are going to be sending data
 						 * immediately, either the end of the block we start
@@ -1226,9 +1484,23 @@ static err_t http_poll(void *arg, struct tcp_pcb *pcb) {
 	DEBUG_PRINT
 		("http_poll 0x%08x\n", pcb);
 
-	if ((hs == NULL) && (pcb->state == ESTABLISHED)) {
-		tcp_abort(pcb);
-		return ERR_ABRT;
+	if (hs == NULL) {
+		/* Closed by us, the pcb is in a closing state */
+		if (pcb->state == ESTABLISHED) {
+			tcp_abort(pcb);
+			return ERR_ABRT;
+		}
+	} else if (hs->keepalive && (hs->handle == NULL)) {
+		/* A kept connection waiting for the next request */
+		if (++hs->idle >= HTTPD_KEEPALIVE_IDLE) {
+			g_sHttpdStats.ulIdleClosed++;
+#if HTTPD_IDLE_RESET
+			tcp_abort(pcb);
+			return ERR_ABRT;
+#else
+			close_conn(pcb, hs);
+#endif
+		}
 	} else {
 		++hs->retries;
 		if (hs->retries == 4) {
@@ -1263,6 +1535,11 @@ static err_t http_sent(void *arg, struct tcp_pcb *pcb, u16_t len) {
 
 	hs->retries = 0;
 
+	/* A kept connection has nothing to send until the next request */
+	if (hs->keepalive && (hs->handle == NULL)) {
+		return ERR_OK;
+	}
+
 	/* Temporarily disable send notifications */
 	tcp_sent(pcb, NULL);
 
@@ -1306,8 +1583,8 @@ get_404_file(char **ppURI) {
 		}
 	}
 
-	// fh : prints every request uri!
-	printf("HTTPD: Opening uri '%s' - file: '%s' \n", *ppURI, path_to_file);
+	// fh : records every 404, the uri is a string literal
+	TRACE1("HTTPD: 404, sending uri '%s'\n", *ppURI);
 
 	path_to_file[0] = 0; /* clean path */
 
@@ -1321,6 +1598,7 @@ static err_t http_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p,
 	int loop;
 	char *data;
 	char *uri;
+	char *end;
 	struct fs_file *file;
 	struct http_state *hs;
 #ifdef INCLUDE_HTTPD_CGI
@@ -1371,10 +1649,22 @@ static err_t http_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p,
 					DEBUG_PRINT
 						("Invalid GET request. Closing.\n");
 					pbuf_free(p);
+					g_sHttpdStats.ulServerClosed++;
 					close_conn(pcb, hs);
 					return (ERR_OK);
 				}
 
+				/* Will the client close the connection after the response? The
+				 * connection is only kept if p holds exactly one request. Data
+				 * behind it (a pipelined request or the rest of a split one)
+				 * is not parsed, the server closes after the response then and
+				 * the client sends the request again on a new connection. */
+				end = http_find(&data[i + 1], p->len - (i + 1), "\r\n\r\n");
+				hs->keepalive = http_client_keeps(&data[i + 1], p->len - (i + 1))
+						&& (end == &data[p->tot_len]);
+				hs->idle = 0;
+				g_sHttpdStats.ulRequests++;
+
 #ifdef INCLUDE_HTTPD_SSI
 				/*
 				 * By default, assume we will not be processing server-side-includes
@@ -1496,7 +1786,6 @@ static err_t http_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p,
 					LWIP_ASSERT("File length must be positive!", (file->len >= 0));
 					hs->left = file->len;
 					hs->retries = 0;
-					pbuf_free(p);
 				} else {
 					hs->handle = NULL;
 					hs->file = NULL;
@@ -1504,6 +1793,17 @@ static err_t http_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p,
 					hs->retries = 0;
 				}
 
+				/* The client has the flash file already, a 304 has no body and
+				 * doesn't end the connection */
+				if (http_not_modified(hs, file, &data[i + 1], p->len - (i + 1))) {
+#ifdef INCLUDE_HTTPD_SSI
+					hs->tag_check = false;
+#endif
+				} else {
+					/* Keep the connection only if the response tells its length */
+					hs->keepalive = hs->keepalive && http_response_keeps(file);
+				}
+
 #ifdef DYNAMIC_HTTP_HEADERS
 				/* Determine the HTTP headers to send based on the file extension of
 				 * the requested URI. */
@@ -1514,24 +1814,38 @@ static err_t http_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p,
 				 successfully sent by a call to the http_sent() function. */
 				tcp_sent(pcb, http_sent);
 
+				// fh : records every request uri!
+				TRACE_STR1("HTTPD: GET '%s' - found: %d\n", uri, file != NULL);
+
+				/* The uri may point into the request */
+				pbuf_free(p);
+
 				/* Start sending the headers and file data. */
 				send_data(pcb, hs);
+
+				/* completes the boot timeline */
+				vBootRequestServed();
 			} else {
 				pbuf_free(p);
+				g_sHttpdStats.ulServerClosed++;
 				close_conn(pcb, hs);
 			}
 		} else {
+			/* A request before the response is complete (pipelining) isn't
+			 * parsed, close after the response so the client sends it again */
+			hs->keepalive = false;
 			pbuf_free(p);
 		}
 	}
 
 	if ((err == ERR_OK) && (p == NULL)) {
+		/* The client closed first, the TIME_WAIT pcb stays with it */
+		if (hs) {
+			g_sHttpdStats.ulClientClosed++;
+		}
 		close_conn(pcb, hs);
 	}
 
-	// fh : prints every request uri!
-	printf("HTTPD: Opening uri '%s' - file: '%s' \n", uri, path_to_file);
-
 	path_to_file[0] = 0; /* clean path */
 
 	return ERR_OK;
@@ -1553,8 +1867,10 @@ static err_t http_accept(void *arg, struct tcp_pcb *pcb, err_t err) {
 	if (hs == NULL) {
 		DEBUG_PRINT
 			("http_accept: Out of memory\n");
+		g_sHttpdStats.ulRefused++;
 		return ERR_MEM;
 	}
+	g_sHttpdStats.ulAccepted++;
 
 	/* Initialize the structure. */
 	hs->handle = NULL;
@@ -1563,6 +1879,12 @@ static err_t http_accept(void *arg, struct tcp_pcb *pcb, err_t err) {
 	hs->buf_len = 0;
 	hs->left = 0;
 	hs->retries = 0;
+	hs->keepalive = false;
+	hs->idle = 0;
+#ifdef INCLUDE_HTTPD_SSI_PARAMS
+	hs->ssi_params = NULL;
+	vArenaInit(&hs->arena);
+#endif
 #ifdef DYNAMIC_HTTP_HEADERS
 	/* Indicate that the headers are not yet valid */
 	hs->hdr_index = NUM_FILE_HDR_STRINGS;
@@ -1604,6 +1926,11 @@ void httpd_init(void) {
 #endif
 }
 
+/*-----------------------------------------------------------------------------------*/
+const tHttpdStats *http_get_stats(void) {
+	return &g_sHttpdStats;
+}
+
 #ifdef INCLUDE_HTTPD_SSI
 /*-----------------------------------------------------------------------------------*/
 void http_set_ssi_handler(tSSIHandler pfnSSIHandler) {
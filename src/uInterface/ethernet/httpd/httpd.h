@@ -50,6 +50,52 @@
 
 void httpd_init(void);
 
+/*
+ * Persistent connections: if the client asks to keep the connection (HTTP/1.1
+ * without "Connection: close", or "Connection: keep-alive") and the response
+ * has a Content-Length, the server doesn't close after the response but
+ * waits for the next request or for the client to close. The side closing
+ * first keeps the TIME_WAIT pcb, so this way it stays with the client.
+ *
+ * Requests are not pipelined: if the client sends the next request before
+ * the response is complete, the server closes after the response and the
+ * client repeats the request on a new connection.
+ *
+ * A kept connection without a request for HTTPD_KEEPALIVE_IDLE polls (2 s
+ * each) is closed, or reset if HTTPD_IDLE_RESET is 1: a reset frees the pcb
+ * at once on both sides, no TIME_WAIT.
+ */
+#ifndef HTTPD_KEEPALIVE_IDLE
+#define HTTPD_KEEPALIVE_IDLE 3
+#endif
+
+#ifndef HTTPD_IDLE_RESET
+#define HTTPD_IDLE_RESET 0
+#endif
+
+/*
+ * Files of the flash image carry an ETag (tools/makefsdata.py). A request
+ * with a matching If-None-Match gets "304 Not Modified" with the ETag and
+ * no body, which also keeps the connection.
+ */
+#define HTTPD_NOT_MODIFIED_LEN 48
+
+/*
+ * Counters of the connections of the server.
+ */
+typedef struct
+{
+	unsigned long ulAccepted; /* connections accepted */
+	unsigned long ulRefused; /* accepts failed, no memory for the state */
+	unsigned long ulRequests; /* GET requests answered */
+	unsigned long ulKept; /* responses after which the connection stayed open */
+	unsigned long ulClientClosed; /* connections closed by the client first */
+	unsigned long ulServerClosed; /* connections closed by the server first */
+	unsigned long ulIdleClosed; /* kept connections closed or reset when idle */
+} tHttpdStats;
+
+const tHttpdStats *http_get_stats(void);
+
 #ifdef INCLUDE_HTTPD_CGI
 
 /*
@@ -11,42 +11,42 @@
 //
 // File System Image.
 //
-// This file was automatically generated using the makefsfile utility.
+// This file was automatically generated using tools/makefsdata.py, the
+// index is sorted by name (binary search in lmi_fs.c).
 //
 //***************************************************************************
 
-static const unsigned char data_404_html[] =
+static const unsigned char data_404_htm[] =
 {
-/* /404.html */
-0x2F, 0x34, 0x30, 0x34, 0x2E, 0x68, 0x74, 0x6D, 0x6C, 0x00, 0x48, 0x54, 0x54,
-		0x50, 0x2F, 0x31, 0x2E, 0x30, 0x20, 0x34, 0x30, 0x34, 0x20, 0x46, 0x69,
-		0x6C, 0x65, 0x20, 0x6E, 0x6F, 0x74, 0x20, 0x66, 0x6F, 0x75, 0x6E, 0x64,
-		0x0D, 0x0A, 0x53, 0x65, 0x72, 0x76, 0x65, 0x72, 0x3A, 0x20, 0x6C, 0x77,
-		0x49, 0x50, 0x2F, 0x31, 0x2E, 0x33, 0x2E, 0x30, 0x20, 0x28, 0x68, 0x74,
-		0x74, 0x70, 0x3A, 0x2F, 0x2F, 0x77, 0x77, 0x77, 0x2E, 0x73, 0x69, 0x63,
-		0x73, 0x2E, 0x73, 0x65, 0x2F, 0x7E, 0x61, 0x64, 0x61, 0x6D, 0x2F, 0x6C,
-		0x77, 0x69, 0x70, 0x2F, 0x29, 0x0D, 0x0A, 0x43, 0x6F, 0x6E, 0x74, 0x65,
-		0x6E, 0x74, 0x2D, 0x74, 0x79, 0x70, 0x65, 0x3A, 0x20, 0x74, 0x65, 0x78,
-		0x74, 0x2F, 0x68, 0x74, 0x6D, 0x6C, 0x0D, 0x0A, 0x0D, 0x0A, 0x3C, 0x68,
-		0x74, 0x6D, 0x6C, 0x3E, 0x0A, 0x3C, 0x62, 0x6F, 0x64, 0x79, 0x20, 0x62,
-		0x67, 0x63, 0x6F, 0x6C, 0x6F, 0x72, 0x3D, 0x22, 0x77, 0x68, 0x69, 0x74,
-		0x65, 0x22, 0x3E, 0x0A, 0x3C, 0x63, 0x65, 0x6E, 0x74, 0x65, 0x72, 0x3E,
-		0x0A, 0x3C, 0x68, 0x31, 0x3E, 0x50, 0x6C, 0x65, 0x61, 0x73, 0x65, 0x20,
-		0x69, 0x6E, 0x73, 0x65, 0x72, 0x74, 0x20, 0x4D, 0x69, 0x63, 0x72, 0x6F,
-		0x53, 0x44, 0x2D, 0x43, 0x61, 0x72, 0x64, 0x20, 0x61, 0x6E, 0x64, 0x20,
-		0x72, 0x65, 0x73, 0x74, 0x61, 0x72, 0x74, 0x20, 0x74, 0x68, 0x65, 0x20,
-		0x42, 0x6F, 0x61, 0x72, 0x64, 0x3C, 0x2F, 0x68, 0x31, 0x3E, 0x0A, 0x3C,
-		0x2F, 0x63, 0x65, 0x6E, 0x74, 0x65, 0x72, 0x3E, 0x0A, 0x3C, 0x2F, 0x62,
-		0x6F, 0x64, 0x79, 0x3E, 0x0A, 0x3C, 0x2F, 0x68, 0x74, 0x6D, 0x6C, 0x3E,
-		0x0A, 0x0A, };
-
-const struct fsdata_file file_404_html[] =
+/* /404.htm */
+0x48, 0x54, 0x54, 0x50, 0x2F, 0x31, 0x2E, 0x30, 0x20, 0x34, 0x30, 0x34,
+		0x20, 0x46, 0x69, 0x6C, 0x65, 0x20, 0x6E, 0x6F, 0x74, 0x20, 0x66, 0x6F,
+		0x75, 0x6E, 0x64, 0x0D, 0x0A, 0x53, 0x65, 0x72, 0x76, 0x65, 0x72, 0x3A,
+		0x20, 0x6C, 0x77, 0x49, 0x50, 0x2F, 0x31, 0x2E, 0x33, 0x2E, 0x30, 0x20,
+		0x28, 0x68, 0x74, 0x74, 0x70, 0x3A, 0x2F, 0x2F, 0x77, 0x77, 0x77, 0x2E,
+		0x73, 0x69, 0x63, 0x73, 0x2E, 0x73, 0x65, 0x2F, 0x7E, 0x61, 0x64, 0x61,
+		0x6D, 0x2F, 0x6C, 0x77, 0x69, 0x70, 0x2F, 0x29, 0x0D, 0x0A, 0x43, 0x6F,
+		0x6E, 0x74, 0x65, 0x6E, 0x74, 0x2D, 0x74, 0x79, 0x70, 0x65, 0x3A, 0x20,
+		0x74, 0x65, 0x78, 0x74, 0x2F, 0x68, 0x74, 0x6D, 0x6C, 0x0D, 0x0A, 0x0D,
+		0x0A, 0x3C, 0x68, 0x74, 0x6D, 0x6C, 0x3E, 0x0A, 0x3C, 0x62, 0x6F, 0x64,
+		0x79, 0x20, 0x62, 0x67, 0x63, 0x6F, 0x6C, 0x6F, 0x72, 0x3D, 0x22, 0x77,
+		0x68, 0x69, 0x74, 0x65, 0x22, 0x3E, 0x0A, 0x3C, 0x63, 0x65, 0x6E, 0x74,
+		0x65, 0x72, 0x3E, 0x0A, 0x3C, 0x68, 0x31, 0x3E, 0x50, 0x6C, 0x65, 0x61,
+		0x73, 0x65, 0x20, 0x69, 0x6E, 0x73, 0x65, 0x72, 0x74, 0x20, 0x4D, 0x69,
+		0x63, 0x72, 0x6F, 0x53, 0x44, 0x2D, 0x43, 0x61, 0x72, 0x64, 0x20, 0x61,
+		0x6E, 0x64, 0x20, 0x72, 0x65, 0x73, 0x74, 0x61, 0x72, 0x74, 0x20, 0x74,
+		0x68, 0x65, 0x20, 0x42, 0x6F, 0x61, 0x72, 0x64, 0x3C, 0x2F, 0x68, 0x31,
+		0x3E, 0x0A, 0x3C, 0x2F, 0x63, 0x65, 0x6E, 0x74, 0x65, 0x72, 0x3E, 0x0A,
+		0x3C, 0x2F, 0x62, 0x6F, 0x64, 0x79, 0x3E, 0x0A, 0x3C, 0x2F, 0x68, 0x74,
+		0x6D, 0x6C, 0x3E, 0x0A, 0x0A,
+};
+
+const tFsRomFile g_psFsRomFiles[] =
 {
-{ NULL, data_404_html, data_404_html + 10, sizeof(data_404_html) - 10 } };
-
-#define FS_ROOT file_404_html
+{ "/404.htm", data_404_htm, 233, 0x00000000UL },
+};
 
-#define FS_NUMFILES 1
+#define FS_ROM_NUMFILES 1
 
 //*****************************************************************************
 //
@@ -54,5 +54,3 @@ const struct fsdata_file file_404_html[] =
 //! @}
 //
 //*****************************************************************************
-
-
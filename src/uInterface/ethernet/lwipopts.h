@@ -89,7 +89,7 @@
 //#define MEMP_NUM_NETCONN                4
 //#define MEMP_NUM_TCPIP_MSG_API          8
 //#define MEMP_NUM_TCPIP_MSG_INPKT        8
-#define PBUF_POOL_SIZE                    24    // Default 16, was 36
+#define PBUF_POOL_SIZE                    16    // Default 16, was 24, full frames use the RX buffers of LWIPStack.c
 //*****************************************************************************
 //
 // ---------- ARP options ----------
@@ -205,6 +205,11 @@
 
 #define INCLUDE_HTTPD_SSI_PARAMS 	1
 
+// Kept connections (see httpd.h) without a request for this many polls of
+// 2 s are reset instead of closed, so no TIME_WAIT pcb is left.
+#define HTTPD_KEEPALIVE_IDLE 		3	// default 3
+#define HTTPD_IDLE_RESET 			1	// default 0
+
 //#define DYNAMIC_HTTP_HEADERS 		1
 //*****************************************************************************
 //
@@ -251,6 +256,7 @@
 //*****************************************************************************
 #define PBUF_LINK_HLEN                  16          // default is 14
 #define PBUF_POOL_BUFSIZE               256
+#define LWIP_SUPPORT_CUSTOM_PBUF        1           // default is 0
 // default is LWIP_MEM_ALIGN_SIZE(TCP_MSS+40+PBUF_LINK_HLEN)
 #define ETH_PAD_SIZE                    2           // default is 0
 //*****************************************************************************
@@ -260,8 +266,8 @@
 //*****************************************************************************
 //#define LWIP_NETIF_HOSTNAME             0
 //#define LWIP_NETIF_API                  0
-//#define LWIP_NETIF_STATUS_CALLBACK      0
-//#define LWIP_NETIF_LINK_CALLBACK        0
+#define LWIP_NETIF_STATUS_CALLBACK      1           // default is 0
+#define LWIP_NETIF_LINK_CALLBACK        1           // default is 0
 //#define LWIP_NETIF_HWADDRHINT           0
 
 //*****************************************************************************
@@ -300,7 +306,12 @@
 // ---------- Sequential layer options ----------
 //
 //*****************************************************************************
-//#define LWIP_TCPIP_CORE_LOCKING         0
+// netconn_* calls lock the lwIP core (a FreeRTOS mutex) and run in the
+// calling task instead of being posted to tcpip_thread, which saves two
+// context switches and a semaphore per call (log/apibench.h measures both).
+// netconn_connect is still posted, calls which start lwIP timeouts
+// (sys_timeout) must run in tcpip_thread
+#define LWIP_TCPIP_CORE_LOCKING         1           // default is 0
 #define LWIP_NETCONN                    1           // default is 1
 //*****************************************************************************
 //
@@ -312,7 +323,7 @@
 //#define LWIP_COMPAT_SOCKETS             1
 //#define LWIP_POSIX_SOCKETS_IO_NAMES     1
 //#define LWIP_TCP_KEEPALIVE              0
-//#define LWIP_SO_RCVTIMEO                0
+#define LWIP_SO_RCVTIMEO                1           // default is 0
 //#define LWIP_SO_RCVBUF                  0
 //#define SO_REUSE                        0
 
@@ -323,6 +334,7 @@
 //*****************************************************************************
 #define LWIP_STATS                      0
 #define LWIP_STATS_DISPLAY              0
+#define TCP_KILL_STATS                  1           // default is 0
 //#define LINK_STATS                      1
 #define ETHARP_STATS                    (LWIP_ARP)
 //#define IP_STATS                        1
@@ -380,6 +392,7 @@
 //#define CHECKSUM_CHECK_IP               1
 //#define CHECKSUM_CHECK_UDP              1
 //#define CHECKSUM_CHECK_TCP              1
+#define TCP_CHECKSUM_ON_COPY            1   // default is 0
 
 //*****************************************************************************
 //
@@ -177,7 +177,7 @@ void vDeleteDisplayLine(basicDisplayLine *toDelete)
  */
 void vLoadMenu(void)
 {
-	char* configLoad = loadFromConfig(IP_CONFIG_FILE, "DEFAULT_MENU_PAGE");
+	char configLoad[CONFIG_VALUE_LEN];
 
 	vInitDisplay();
 
@@ -185,8 +185,10 @@ void vLoadMenu(void)
 	printf("vLoadMenu: Display deleted\nLoad new Page\n");
 #endif
 
-	vLoadWebPage(configLoad, NULL);
-	vPortFree(configLoad);
+	if (bConfigGetString("DEFAULT_MENU_PAGE", configLoad, sizeof(configLoad)))
+	{
+		vLoadWebPage(configLoad, NULL);
+	}
 	xDisplayRoot.menue = false;
 	vDrawElementsOnDisplay();
 }
@@ -28,6 +28,8 @@
 
 #include "drivers/kitronix320x240x16_ssd2119_8bit.h"
 
+#include "log/trace.h"
+
 int elementOffset = 0;
 
 tWidget* xGetLabelWidget(void*line, int row);
@@ -39,7 +41,7 @@ void vDrawElementsOnDisplay(void)
 	int i;
 	basicDisplayLine *toDraw;
 
-	vTaskSuspendAll();
+	vTraceSuspendAll();
 	{
 
 		if (xDisplayRoot.menue == true)
@@ -153,7 +155,7 @@ void vDrawElementsOnDisplay(void)
 		printf("finished\n");
 #endif
 	}
-	xTaskResumeAll();
+	vTraceResumeAll();
 }
 
 tWidget* xGetLabelWidget(void *akt, int row)
@@ -35,11 +35,13 @@ void vTouchLoadMenu(tWidget *pWidget)
 
 void vTouchStoreValues(tWidget *pWidget)
 {
-	char* configLoad = loadFromConfig(IP_CONFIG_FILE, "DEFAULT_SET_PAGE");
+	char configLoad[CONFIG_VALUE_LEN];
 
 	vInitDisplay();
-	vLoadWebPage(configLoad, xDisplayRoot.entities);
-	vPortFree(configLoad);
+	if (bConfigGetString("DEFAULT_SET_PAGE", configLoad, sizeof(configLoad)))
+	{
+		vLoadWebPage(configLoad, xDisplayRoot.entities);
+	}
 	vDrawElementsOnDisplay();
 	vInitializeSaveButton();
 }
@@ -5,12 +5,23 @@
  * \author Anziner, Hahn
  * \brief
  *
+ * The pages of the panel are loaded from REMOTE_IP over one HTTP/1.1
+ * connection, which stays open from page to page as long as the server
+ * keeps it. The response is parsed while it arrives: the headers give the
+ * end of the body (Content-Length, chunked or the close of the server), the
+ * $...$ blocks of the body go to vParseParameter(). A block may be split
+ * across any number of netbufs. A server which sends no headers is read up
+ * to its close.
+ *
  */
 
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
 
 #include "FreeRTOS.h"
+#include "semphr.h"
 
 #include "utils.h"
 #include "setup.h"
@@ -18,6 +29,8 @@
 #include "graphic/gui/displayBasics.h"
 #include "graphic/httpc/webClient.h"
 
+#include "log/apibench.h"
+
 #include "lwip/api.h"
 #include "lwip/ip_addr.h"
 #include "lwip/netbuf.h"
@@ -27,50 +40,420 @@
 
 #define DELIMITOR_CHAR '$'
 
+/**
+ * Parts of the response
+ */
+typedef enum
+{
+	HTTPC_STATUS, ///< status line, the body if it doesn't start with "HTTP/"
+	HTTPC_HEADER, ///< header lines up to the empty line
+	HTTPC_CHUNK_SIZE, ///< size line of a chunk
+	HTTPC_CHUNK_DATA, ///< data of a chunk
+	HTTPC_CHUNK_END, ///< CRLF behind the data of a chunk
+	HTTPC_TRAILER, ///< lines behind the last chunk up to the empty line
+	HTTPC_BODY, ///< body, ulLeft bytes or up to the close
+	HTTPC_DONE ///< response complete
+} tHttpcState;
+
+/**
+ * State of the response parser, kept across netbufs
+ */
+typedef struct
+{
+	tHttpcState eState;
+	char pcLine[HTTPC_LINE_LEN]; ///< current header line, lower case
+	unsigned short usLine;
+	tBoolean bLength; ///< body length known, else it ends with the close
+	unsigned long ulLeft; ///< bytes left of the body or the chunk
+	tBoolean bChunked;
+	tBoolean bClose; ///< the server closes after the response
+	tBoolean bData; ///< any byte of the response received
+	tBoolean bBlock; ///< inside a $...$ block
+	tBoolean bOverflow; ///< block longer than pcBlock, it is dropped
+	unsigned short usBlock;
+	char pcBlock[HTTPC_BUFFER_LEN];
+} tHttpcParser;
+
 struct ip_addr *remoteIP = NULL;
 
+/** connection to REMOTE_IP, kept from page to page */
+static struct netconn *xWebConn = NULL;
+
+static tHttpcParser xHttpcParser;
+
+/**
+ * Pages are loaded by the touch actions (graphic task) and by the LWIP task
+ * (vLoadMenu), the connection and the parser are used by one at a time
+ */
+static xSemaphoreHandle xWebMutex = NULL;
+
+#if ENABLE_API_BENCH
+static unsigned long ulWebStart, ulWebRequest, ulWebFirst, ulWebCalls;
+#endif
+
 void vParseParameter(char* html, u16_t len);
 
-void vLoadWebPage(char* page, basicDisplayLine* paramsParameter)
+/**
+ * Passes the $...$ blocks of a piece of the body to vParseParameter()
+ */
+static void vHttpcBlocks(tHttpcParser *px, const char *pcData,
+		unsigned long ulLen)
 {
+	unsigned long i;
 
-	basicDisplayLine *params = paramsParameter;
-	struct netconn *conn;
-	struct netbuf *inBuf;
-	char *pageData;
+	for (i = 0; i < ulLen; i++)
+	{
+		if (pcData[i] == DELIMITOR_CHAR)
+		{
+			if (px->bBlock && !px->bOverflow)
+			{
+				px->pcBlock[px->usBlock] = 0;
+				vParseParameter(px->pcBlock, px->usBlock);
+			}
+			px->bBlock = !px->bBlock;
+			px->bOverflow = false;
+			px->usBlock = 0;
+		}
+		else if (px->bBlock)
+		{
+			if (px->usBlock < HTTPC_BUFFER_LEN - 1)
+			{
+				px->pcBlock[px->usBlock++] = pcData[i];
+			}
+			else
+			{
+				px->bOverflow = true;
+			}
+		}
+	}
+}
 
-	u16_t connErr, writeErr, length, i = 0, bufferpos = 0;
+/**
+ * Returns the value of a header line if it is the field pcName (lower
+ * case, with the colon), else NULL
+ */
+static const char* pcHttpcField(const char *pcLine, const char *pcName)
+{
+	int iLen = strlen(pcName);
 
-	char buffer[HTTPC_BUFFER_LEN];
-	char valBuffer[8];
-	tBoolean first = true, output = false;
+	if (strncmp(pcLine, pcName, iLen) != 0)
+	{
+		return NULL;
+	}
+	for (pcLine += iLen; *pcLine == ' ' || *pcLine == '\t'; pcLine++)
+	{
+		;
+	}
+
+	return pcLine;
+}
 
-	strcpy(buffer, "GET /");
-	strcat(buffer, page);
-	while (params != NULL)
+/**
+ * Handles a complete line of the status, the headers or the chunks
+ */
+static void vHttpcLine(tHttpcParser *px)
+{
+	const char *pcValue;
+
+	switch (px->eState)
 	{
-		if (params->id != NULL)
+	case HTTPC_STATUS:
+		// HTTP/1.0 closes unless it says keep-alive
+		px->bClose = strncmp(px->pcLine, "http/1.1", 8) != 0;
+		px->eState = HTTPC_HEADER;
+		break;
+
+	case HTTPC_HEADER:
+		if (px->usLine == 0)
 		{
-			if (first == true)
+			if (px->bChunked)
+			{
+				px->eState = HTTPC_CHUNK_SIZE;
+			}
+			else if (px->bLength)
 			{
-				strcat(buffer, "?");
-				first = false;
+				px->eState = px->ulLeft ? HTTPC_BODY : HTTPC_DONE;
 			}
 			else
 			{
-				strcat(buffer, "&");
+				px->eState = HTTPC_BODY;
+				px->bClose = true;
 			}
-			strcat(buffer, params->id);
-			snprintf(valBuffer, 8, "=%d", params->value);
-			strcat(buffer, valBuffer);
 		}
-		params = params->next;
+		else if ((pcValue = pcHttpcField(px->pcLine, "content-length:"))
+				!= NULL)
+		{
+			px->ulLeft = strtoul(pcValue, NULL, 10);
+			px->bLength = true;
+		}
+		else if ((pcValue = pcHttpcField(px->pcLine, "transfer-encoding:"))
+				!= NULL)
+		{
+			px->bChunked = strstr(pcValue, "chunked") != NULL;
+		}
+		else if ((pcValue = pcHttpcField(px->pcLine, "connection:")) != NULL)
+		{
+			if (strstr(pcValue, "close") != NULL)
+			{
+				px->bClose = true;
+			}
+			else if (strstr(pcValue, "keep-alive") != NULL)
+			{
+				px->bClose = false;
+			}
+		}
+		break;
+
+	case HTTPC_CHUNK_SIZE:
+		px->ulLeft = strtoul(px->pcLine, NULL, 16);
+		px->eState = px->ulLeft ? HTTPC_CHUNK_DATA : HTTPC_TRAILER;
+		break;
+
+	case HTTPC_CHUNK_END:
+		px->eState = HTTPC_CHUNK_SIZE;
+		break;
+
+	case HTTPC_TRAILER:
+		if (px->usLine == 0)
+		{
+			px->eState = HTTPC_DONE;
+		}
+		break;
 
+	default:
+		break;
 	}
-	strcat(buffer, " HTTP1.0\r\n\r\n");
-#if DEBUG_HTTPC
-	printf(buffer);
+
+	px->usLine = 0;
+}
+
+/**
+ * Parses the next piece of the response, it may end anywhere
+ */
+static void vHttpcFeed(tHttpcParser *px, const char *pcData,
+		unsigned short usLen)
+{
+	unsigned short i = 0;
+	unsigned long ulTake;
+	char c;
+
+	if (usLen > 0)
+	{
+		px->bData = true;
+	}
+
+	while (i < usLen && px->eState != HTTPC_DONE)
+	{
+		switch (px->eState)
+		{
+		case HTTPC_BODY:
+		case HTTPC_CHUNK_DATA:
+			ulTake = usLen - i;
+			if ((px->bLength || px->eState == HTTPC_CHUNK_DATA) && ulTake
+					> px->ulLeft)
+			{
+				ulTake = px->ulLeft;
+			}
+			vHttpcBlocks(px, pcData + i, ulTake);
+			i += ulTake;
+
+			if (px->eState == HTTPC_CHUNK_DATA)
+			{
+				px->ulLeft -= ulTake;
+				if (px->ulLeft == 0)
+				{
+					px->eState = HTTPC_CHUNK_END;
+				}
+			}
+			else if (px->bLength)
+			{
+				px->ulLeft -= ulTake;
+				if (px->ulLeft == 0)
+				{
+					px->eState = HTTPC_DONE;
+				}
+			}
+			break;
+
+		default:
+			c = tolower((unsigned char) pcData[i]);
+
+			// no status line: the server sends the body only and closes
+			if (px->eState == HTTPC_STATUS && px->usLine < 5 && c
+					!= "http/"[px->usLine])
+			{
+				px->eState = HTTPC_BODY;
+				px->bLength = false;
+				px->bClose = true;
+				vHttpcBlocks(px, px->pcLine, px->usLine);
+				break;
+			}
+
+			i++;
+			if (c == '\n')
+			{
+				vHttpcLine(px);
+			}
+			else if (c != '\r' && px->usLine < HTTPC_LINE_LEN - 1)
+			{
+				px->pcLine[px->usLine++] = c;
+				px->pcLine[px->usLine] = 0;
+			}
+			break;
+		}
+	}
+}
+
+/**
+ * Writes the request for a page and its parameters
+ *
+ * @return length of the request, -1 if it doesn't fit into the buffer
+ */
+static int iWebRequest(char *pcBuf, const char *page,
+		basicDisplayLine *params)
+{
+	char cSeparator = '?';
+	int iLen;
+
+	iLen = snprintf(pcBuf, HTTPC_BUFFER_LEN, "GET /%s", page);
+	for (; params != NULL && iLen < HTTPC_BUFFER_LEN; params = params->next)
+	{
+		if (params->id != NULL)
+		{
+			iLen += snprintf(pcBuf + iLen, HTTPC_BUFFER_LEN - iLen, "%c%s=%d",
+					cSeparator, params->id, params->value);
+			cSeparator = '&';
+		}
+	}
+	if (iLen < HTTPC_BUFFER_LEN)
+	{
+		iLen += snprintf(pcBuf + iLen, HTTPC_BUFFER_LEN - iLen,
+				" HTTP/1.1\r\nHost: %d.%d.%d.%d\r\n\r\n", ip4_addr1(remoteIP),
+				ip4_addr2(remoteIP), ip4_addr3(remoteIP), ip4_addr4(remoteIP));
+	}
+
+	return (iLen < HTTPC_BUFFER_LEN) ? iLen : -1;
+}
+
+/**
+ * Drops the connection
+ */
+static void vWebClose(void)
+{
+	netconn_delete(xWebConn);
+	xWebConn = NULL;
+#if ENABLE_API_BENCH
+	ulWebCalls++;
+#endif
+}
+
+/**
+ * Opens the connection to REMOTE_IP
+ */
+static err_t xWebConnect(void)
+{
+	err_t err;
+
+	xWebConn = netconn_new(NETCONN_TCP);
+	if (xWebConn == NULL)
+	{
+		return ERR_MEM;
+	}
+#if LWIP_SO_RCVTIMEO
+	xWebConn->recv_timeout = HTTPC_RECV_TIMEOUT;
+#endif
+
+	err = netconn_connect(xWebConn, remoteIP, 80);
+#if ENABLE_API_BENCH
+	ulWebCalls += 2;
+#endif
+	if (err != ERR_OK)
+	{
+		vWebClose();
+	}
+
+	return err;
+}
+
+/**
+ * Sends the request and parses the response
+ *
+ * @return ERR_OK if the response is complete, else the error of the
+ * connection (ERR_CLSD if the server closed it)
+ */
+static err_t xWebRequest(const char *pcRequest, int iLen)
+{
+	struct netbuf *inBuf;
+	char *pageData;
+	u16_t length;
+	err_t err;
+
+	memset(&xHttpcParser, 0, sizeof(xHttpcParser));
+	xHttpcParser.eState = HTTPC_STATUS;
+
+	err = netconn_write(xWebConn, pcRequest, iLen, NETCONN_COPY);
+#if ENABLE_API_BENCH
+	ulWebRequest = API_BENCH_CYCCNT - ulWebStart;
+	ulWebCalls++;
+#endif
+	if (err != ERR_OK)
+	{
+		return err;
+	}
+
+	while (xHttpcParser.eState != HTTPC_DONE)
+	{
+		inBuf = netconn_recv(xWebConn);
+#if ENABLE_API_BENCH
+		if (ulWebFirst == 0)
+		{
+			ulWebFirst = API_BENCH_CYCCNT - ulWebStart;
+		}
+		ulWebCalls++;
 #endif
+		if (inBuf == NULL)
+		{
+			// a body without length ends with the close
+			if (xWebConn->err == ERR_CLSD && xHttpcParser.eState == HTTPC_BODY
+					&& !xHttpcParser.bLength)
+			{
+				return ERR_OK;
+			}
+			return xWebConn->err != ERR_OK ? xWebConn->err : ERR_CLSD;
+		}
+
+		do
+		{
+			netbuf_data(inBuf, (void**) &pageData, &length);
+			vHttpcFeed(&xHttpcParser, pageData, length);
+		} while (netbuf_next(inBuf) >= 0);
+
+		netbuf_delete(inBuf);
+	}
+
+	return ERR_OK;
+}
+
+/**
+ * Creates the mutex of the web client, called before the tasks start
+ */
+void vWebClientInit(void)
+{
+	if (xWebMutex == NULL)
+	{
+		xWebMutex = xSemaphoreCreateMutex();
+	}
+}
+
+/**
+ * Loads a page, the caller owns xWebMutex
+ */
+static void vWebLoadPage(char* page, basicDisplayLine* params)
+{
+	char buffer[HTTPC_BUFFER_LEN];
+	int iLen, iTry;
+	tBoolean bReused = false;
+	err_t err = ERR_OK;
 
 	vClearDisplay();
 
@@ -90,100 +473,70 @@ void vLoadWebPage(char* page, basicDisplayLine* paramsParameter)
 #endif
 	}
 
-	// create new connection
-	conn = netconn_new(NETCONN_TCP);
-
-	// create a connection
-	connErr = netconn_connect(conn, remoteIP, 80);
-
-	if (conn != NULL && connErr == 0)
+	iLen = iWebRequest(buffer, page, params);
+	if (iLen < 0)
 	{
+		vShowBootText("WEBCLIENT: REQUEST TOO LONG");
+		return;
+	}
+#if DEBUG_HTTPC
+	printf(buffer);
+#endif
 
-		// send request
-		writeErr = netconn_write(conn, &buffer, sizeof(buffer), NETCONN_NOCOPY);
+#if ENABLE_API_BENCH
+	ulWebStart = API_BENCH_CYCCNT;
+	ulWebRequest = ulWebFirst = ulWebCalls = 0;
+#endif
 
-		if (writeErr == 0)
+	for (iTry = 0; iTry < 2; iTry++)
+	{
+		bReused = (xWebConn != NULL);
+		if (!bReused)
 		{
-
-			do
+			err = xWebConnect();
+			if (err != ERR_OK)
 			{
-				// fetch next data
-				inBuf = netconn_recv(conn);
-				do
-				{
-					vTaskSuspendAll();
-					{
-						// read data
-						netbuf_data(inBuf, (void**) &pageData, &length);
-
-						for (i = 0; i < length && bufferpos < HTTPC_BUFFER_LEN; i++)
-						{
-							if (pageData[i] == DELIMITOR_CHAR)
-							{
-								if (output == true)
-								{
-									output = false;
-									buffer[bufferpos] = 0;
-									vParseParameter(buffer, bufferpos);
-								}
-								else
-								{
-									output = true;
-									bufferpos = 0;
-									continue;
-								}
-							}
-
-							if (output == true)
-							{
-								buffer[bufferpos] = pageData[i];
-								bufferpos++;
-							}
-
-						}
-
-					}
-					xTaskResumeAll();
-
-				} while (netbuf_next(inBuf) >= 0);
-
-				// delete buffer
-				if (inBuf != NULL)
-				{
-					netbuf_delete(inBuf);
-				}
-
-			} while (inBuf != NULL);
+				break;
+			}
 		}
-		else
+
+		err = xWebRequest(buffer, iLen);
+		if (err != ERR_OK || xHttpcParser.bClose)
 		{
-			snprintf(buffer, HTTPC_BUFFER_LEN, "WEBCLIENT: READ ERROR: %d\n",
-					connErr);
-			printf(buffer);
-			vShowBootText(buffer);
+			vWebClose();
 		}
 
+		// the server may have closed the kept connection while it was idle,
+		// the request is sent once more on a new one
+		if (err == ERR_OK || !bReused || xHttpcParser.bData)
+		{
+			break;
+		}
 	}
-	else
+
+	if (err != ERR_OK)
 	{
-		snprintf(buffer, HTTPC_BUFFER_LEN, "WEBCLIENT: ERROR: %d\n", connErr);
+		snprintf(buffer, HTTPC_BUFFER_LEN, "WEBCLIENT: ERROR: %d\n", err);
 		printf(buffer);
 		vShowBootText(buffer);
 	}
 
-	// close connection
-	if (conn != NULL)
-	{
-		while (netconn_delete(conn) != ERR_OK)
-		{
-			vTaskDelay(1);
-		}
-	}
+#if ENABLE_API_BENCH
+	vApiBenchPage(page, bReused, ulWebRequest, ulWebFirst,
+			API_BENCH_CYCCNT - ulWebStart, ulWebCalls);
+#endif
 #if DEBUG_HTTPC
 	printf("\n");
 #endif
 }
 
+void vLoadWebPage(char* page, basicDisplayLine* params)
+{
+	xSemaphoreTake(xWebMutex, portMAX_DELAY);
+	vWebLoadPage(page, params);
+	xSemaphoreGive(xWebMutex);
+}
+
 /**
  * Parse the Special Comments for the GUI
  */
@@ -194,7 +547,7 @@ void vParseParameter(char* html, u16_t len)
 	nrOfTags = NUM_CONFIG_TAGS;
 	basicDisplayLine* newLine = NULL;
 
-	char* buffer = (char*) pvPortMalloc(len * sizeof(char));
+	char* buffer = (char*) pvPortMalloc((len + 1) * sizeof(char));
 
 #if DEBUG_HTTPC
 	printf("vParseParameter\n");
@@ -239,4 +592,3 @@ void vParseParameter(char* html, u16_t len)
 //! @}
 //
 //*****************************************************************************
-
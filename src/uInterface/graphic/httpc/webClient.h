@@ -12,8 +12,24 @@
 
 #include "graphic/gui/displayBasics.h"
 
+/// size of the request and of the buffer of one $...$ block
 #define HTTPC_BUFFER_LEN 255
 
+/// header lines are read up to this length, the rest is ignored
+#define HTTPC_LINE_LEN 64
+
+/// time in ms a response may pause before the connection is dropped
+#define HTTPC_RECV_TIMEOUT 5000
+
+/**
+ * Creates the mutex of the web client, must be called before the tasks start
+ */
+void vWebClientInit(void);
+
+/**
+ * Loads a page from REMOTE_IP and passes its $...$ blocks to the display.
+ * Callers in different tasks are serialized.
+ */
 void vLoadWebPage(char* page, basicDisplayLine* params);
 
 #endif /* WEBCLIENT_H_ */
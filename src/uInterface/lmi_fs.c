@@ -35,6 +35,8 @@
  *
  */
 #include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
 #include <string.h>
 #include "lmi_fs.h"
 #include "inc/hw_memmap.h"
@@ -47,15 +49,22 @@
 #include "ethernet/httpd/fsdata.h"
 #include "fatfs/ff.h"
 #include "fatfs/diskio.h"
+#include "fatfs/diskcache.h"
 
 #include "fatfs/mmc.h"
 
+#include "setup.h"
+#include "log/trace.h"
+#include "log/boottime.h"
+#include "log/stats.h"
+#include "log/heaptrace.h"
+
 //*****************************************************************************
 //
 // Include the file system data for this application.  This file is generated
-// by the makefsfile utility, using the following command:
+// by tools/makefsdata.py, using the following command (in uInterface/ethernet):
 //
-//     makefsfile -i fs -o lmi-fsdata.h -r -h
+//     makefsdata.py -i fs -o lmi-fsdata.h -h
 //
 // If any changes are made to the static content of the web pages served by the
 // application, this command must be used to regenerate lmi-fsdata.h in order
@@ -64,6 +73,9 @@
 //*****************************************************************************
 #include "lmi-fsdata.h"
 
+/// files of the flash image are mounted below this path
+#define FS_ROM_PREFIX			"httpd-fs"
+
 //*****************************************************************************
 //
 // The following are data structures used by FatFs.
@@ -72,29 +84,649 @@
 static FATFS g_sFatFs;
 static volatile tBoolean g_bFatFsEnabled = false;
 
+#if ENABLE_FS_FORWARD
+#if !_USE_FORWARD || !_FS_TINY
+#error "ENABLE_FS_FORWARD needs _USE_FORWARD and _FS_TINY in fatfs/ff.h"
+#endif
+
+//*****************************************************************************
+//
+// The stream function of f_forward has no argument, the sink of the running
+// transfer is kept here. The mutex serializes the transfers.
+//
+//*****************************************************************************
+static xSemaphoreHandle g_xFsForwardMutex = NULL;
+static tFsSink g_pfnFsSink;
+static void *g_pvFsSinkArg;
+static tBoolean g_bFsSinkFull;
+#endif
+
+//*****************************************************************************
+//
+// Open files are taken from a pool. The fs_file and the FatFs object are one
+// block, so an open needs no heap allocation as long as the pool lasts.
+//
+//*****************************************************************************
+#define FS_HANDLE_POOL_SIZE		4
+
+typedef struct
+{
+	struct fs_file sFile;		// must be the first member
+	FIL sFatFile;
+	char *pcCopy;				// own copy of a RAM file, freed by fs_close
+	tBoolean bUsed;
+} tFsHandle;
+
+static tFsHandle g_psFsHandles[FS_HANDLE_POOL_SIZE];
+
+static tFsCacheStats g_sFsCacheStats;
+
+/// max. path length of the lookup and content cache
+#define FS_CACHE_NAME_LEN		48
+
+#if ENABLE_FS_CACHE
+//*****************************************************************************
+//
+// Cache of the directory lookups done by f_open. A hit holds everything
+// f_open takes from the directory entry, misses are cached too (404 probes,
+// default file names). An entry is dropped if the sector with its directory
+// entry is written. A miss is dropped if its directory is written (the file
+// may have been created there) or the FAT is written (a directory grew or a
+// missing directory was created), so appending to the log keeps the misses.
+//
+//*****************************************************************************
+#define FS_CACHE_ENTRIES		16
+
+/// ulDirClust of a miss whose directory is missing, only a FAT write counts
+#define FS_CACHE_DIR_FAT		0xFFFFFFFFUL
+
+/// ulDirClust of a miss in a directory of several clusters, every write counts
+#define FS_CACHE_DIR_ANY		0xFFFFFFFEUL
+
+typedef struct
+{
+	unsigned long ulHash;		// 0 = unused
+	char pcName[FS_CACHE_NAME_LEN];
+	WORD usMountId;				// entry is only valid for this mount
+	tBoolean bExists;
+	DWORD ulStartClust;
+	DWORD ulSize;
+	DWORD ulDirSect;
+	WORD usDirOffset;
+	DWORD ulDirClust;			// miss: cluster of the directory, 0 = FAT12/16 root
+	unsigned long ulUsed;
+} tFsCacheEntry;
+
+static tFsCacheEntry g_psFsCache[FS_CACHE_ENTRIES];
+static unsigned long g_ulFsCacheClock = 0;
+#endif
+
+#if ENABLE_FS_CONTENT_CACHE
+//*****************************************************************************
+//
+// RAM content cache for small web files. Files below FS_CONTENT_MAX_FILE are
+// read once and kept while they fit into FS_CONTENT_BUDGET, the least
+// recently used unreferenced file is dropped first. Every open file holds a
+// reference, the webserver passes the data to tcp_write without copying and
+// closes the file only after the data was acknowledged.
+//
+//*****************************************************************************
+#define FS_CONTENT_PREFIX		"httpd-fs/"
+#define FS_CONTENT_ENTRIES		8
+#define FS_CONTENT_MAX_FILE		2048
+#define FS_CONTENT_BUDGET		8192
+
+typedef struct
+{
+	unsigned long ulHash;		// 0 = not findable (unused or invalidated)
+	char pcName[FS_CACHE_NAME_LEN];
+	WORD usMountId;
+	DWORD ulDirSect;			// sector of the directory entry
+	char *pcData;				// NULL = slot is free
+	int iLen;
+	int iRefs;					// open files using pcData
+	unsigned long ulUsed;
+} tFsContent;
+
+static tFsContent g_psFsContent[FS_CONTENT_ENTRIES];
+static unsigned long g_ulFsContentClock = 0;
+#endif
+
+//*****************************************************************************
+//
+// Takes a handle from the pool, or from the heap if the pool is empty.
+//
+//*****************************************************************************
+static tFsHandle *
+fs_handle_alloc(void)
+{
+	tFsHandle *psHandle = NULL;
+	int i;
+
+	taskENTER_CRITICAL();
+	for (i = 0; i < FS_HANDLE_POOL_SIZE; i++)
+	{
+		if (!g_psFsHandles[i].bUsed)
+		{
+			psHandle = &g_psFsHandles[i];
+			psHandle->bUsed = true;
+			break;
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	if (psHandle == NULL)
+	{
+		psHandle = (tFsHandle *) pvPortMalloc(sizeof(tFsHandle));
+		g_sFsCacheStats.ulHeapOpens++;
+	}
+
+	return (psHandle);
+}
+
+//*****************************************************************************
+//
+// Gives a handle back to the pool or the heap.
+//
+//*****************************************************************************
+static void
+fs_handle_free(tFsHandle *psHandle)
+{
+	if (psHandle >= &g_psFsHandles[0]
+			&& psHandle < &g_psFsHandles[FS_HANDLE_POOL_SIZE])
+	{
+		psHandle->bUsed = false;
+	}
+	else
+	{
+		vPortFree(psHandle);
+	}
+}
+
+#if ENABLE_FS_CACHE || ENABLE_FS_CONTENT_CACHE
+//*****************************************************************************
+//
+// Hash of a path, never 0.
+//
+//*****************************************************************************
+static unsigned long
+fs_cache_hash(const char *pcName)
+{
+	unsigned long ulHash = 5381;
+
+	while (*pcName)
+	{
+		ulHash = (ulHash * 33) ^ (unsigned char) *pcName++;
+	}
+
+	return (ulHash ? ulHash : 1);
+}
+#endif
+
+#if ENABLE_FS_CACHE
+
+//*****************************************************************************
+//
+// Finds the entry of a path, must be called in a critical section.
+//
+//*****************************************************************************
+static tFsCacheEntry *
+fs_cache_find(const char *pcName, unsigned long ulHash)
+{
+	int i;
+
+	for (i = 0; i < FS_CACHE_ENTRIES; i++)
+	{
+		if (g_psFsCache[i].ulHash == ulHash
+				&& g_psFsCache[i].usMountId == g_sFatFs.id
+				&& strcmp(g_psFsCache[i].pcName, pcName) == 0)
+		{
+			return (&g_psFsCache[i]);
+		}
+	}
+
+	return (NULL);
+}
+
+//*****************************************************************************
+//
+// Looks a path up. Returns 1 and fills in the FatFs object like f_open
+// (read only) on a hit, 0 if the file is known to be missing and -1 if the
+// path isn't cached.
+//
+//*****************************************************************************
+static int
+fs_cache_lookup(const char *pcName, FIL *psFatFile)
+{
+	tFsCacheEntry *psEntry;
+	unsigned long ulHash;
+	int iResult = -1;
+
+	if (strlen(pcName) >= FS_CACHE_NAME_LEN)
+	{
+		return (-1);
+	}
+	ulHash = fs_cache_hash(pcName);
+
+	taskENTER_CRITICAL();
+	psEntry = fs_cache_find(pcName, ulHash);
+	if (psEntry != NULL)
+	{
+		psEntry->ulUsed = ++g_ulFsCacheClock;
+		iResult = psEntry->bExists ? 1 : 0;
+
+		if (iResult)
+		{
+			psFatFile->fs = &g_sFatFs;
+			psFatFile->id = g_sFatFs.id;
+			psFatFile->flag = FA_READ;
+			psFatFile->csect = 255;
+			psFatFile->fptr = 0;
+			psFatFile->fsize = psEntry->ulSize;
+			psFatFile->org_clust = psEntry->ulStartClust;
+			psFatFile->curr_clust = 0;
+			psFatFile->dsect = 0;
+			psFatFile->dir_sect = psEntry->ulDirSect;
+			psFatFile->dir_ptr = g_sFatFs.win + psEntry->usDirOffset;
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	return (iResult);
+}
+
+//*****************************************************************************
+//
+// Returns the cluster of the directory a missing file would be created in.
+// FatFs puts a new entry into the first free slot in front of the end of the
+// directory, or appends a cluster. So only the clusters up to the end can
+// get the file without a FAT write, this must be the first one.
+//
+//*****************************************************************************
+static DWORD
+fs_cache_miss_dir(const char *pcName)
+{
+	char pcDir[FS_CACHE_NAME_LEN];
+	char *pcSlash;
+	FILINFO sInfo;
+	FRESULT fresult;
+	DIR sDir;
+	DWORD ulFirst;
+
+	strcpy(pcDir, pcName);
+	pcSlash = strrchr(pcDir, '/');
+	*(pcSlash ? pcSlash : pcDir) = 0;
+
+	fresult = f_opendir(&sDir, pcDir);
+	if (fresult == FR_NO_PATH)
+	{
+		//
+		// creating the directory allocates its cluster
+		//
+		return (FS_CACHE_DIR_FAT);
+	}
+
+	ulFirst = sDir.clust;
+	while (fresult == FR_OK)
+	{
+		fresult = f_readdir(&sDir, &sInfo);
+		if (fresult != FR_OK || sInfo.fname[0] == 0)
+		{
+			break;
+		}
+	}
+
+	return ((fresult == FR_OK && sDir.clust == ulFirst) ? ulFirst
+			: FS_CACHE_DIR_ANY);
+}
+
+//*****************************************************************************
+//
+// Stores the result of f_open, psFatFile is NULL for a missing file.
+//
+//*****************************************************************************
+static void
+fs_cache_store(const char *pcName, FIL *psFatFile)
+{
+	tFsCacheEntry *psEntry;
+	unsigned long ulHash;
+	DWORD ulDirClust = 0;
+	int i;
+
+	if (strlen(pcName) >= FS_CACHE_NAME_LEN)
+	{
+		return;
+	}
+	ulHash = fs_cache_hash(pcName);
+	if (psFatFile == NULL)
+	{
+		ulDirClust = fs_cache_miss_dir(pcName);
+	}
+
+	taskENTER_CRITICAL();
+	psEntry = fs_cache_find(pcName, ulHash);
+	if (psEntry == NULL)
+	{
+		//
+		// take a free entry or the least recently used one
+		//
+		psEntry = &g_psFsCache[0];
+		for (i = 0; i < FS_CACHE_ENTRIES; i++)
+		{
+			if (g_psFsCache[i].ulHash == 0)
+			{
+				psEntry = &g_psFsCache[i];
+				break;
+			}
+			if (g_psFsCache[i].ulUsed < psEntry->ulUsed)
+			{
+				psEntry = &g_psFsCache[i];
+			}
+		}
+	}
+
+	strcpy(psEntry->pcName, pcName);
+	psEntry->ulHash = ulHash;
+	psEntry->usMountId = g_sFatFs.id;
+	psEntry->ulUsed = ++g_ulFsCacheClock;
+	psEntry->bExists = (psFatFile != NULL);
+	psEntry->ulDirClust = ulDirClust;
+	if (psFatFile != NULL)
+	{
+		psEntry->ulStartClust = psFatFile->org_clust;
+		psEntry->ulSize = psFatFile->fsize;
+		psEntry->ulDirSect = psFatFile->dir_sect;
+		psEntry->usDirOffset = psFatFile->dir_ptr - g_sFatFs.win;
+	}
+	taskEXIT_CRITICAL();
+}
+
+#endif
+
+#if ENABLE_FS_CONTENT_CACHE
+//*****************************************************************************
+//
+// Frees the data of one unreferenced content entry which is invalidated
+// (or of the least recently used one if bEvict is set). Returns false if
+// there was nothing to free.
+//
+//*****************************************************************************
+static tBoolean
+fs_content_free_one(tBoolean bEvict)
+{
+	tFsContent *psVictim = NULL;
+	char *pcData = NULL;
+	int i;
+
+	taskENTER_CRITICAL();
+	for (i = 0; i < FS_CONTENT_ENTRIES; i++)
+	{
+		if (g_psFsContent[i].pcData == NULL || g_psFsContent[i].iRefs)
+		{
+			continue;
+		}
+		if (g_psFsContent[i].ulHash == 0)
+		{
+			psVictim = &g_psFsContent[i];
+			break;
+		}
+		if (bEvict && (psVictim == NULL
+				|| g_psFsContent[i].ulUsed < psVictim->ulUsed))
+		{
+			psVictim = &g_psFsContent[i];
+		}
+	}
+	if (psVictim != NULL)
+	{
+		if (psVictim->ulHash)
+		{
+			g_sFsCacheStats.ulContentEvictions++;
+		}
+		pcData = psVictim->pcData;
+		g_sFsCacheStats.ulContentBytes -= psVictim->iLen;
+		psVictim->ulHash = 0;
+		psVictim->pcData = NULL;
+	}
+	taskEXIT_CRITICAL();
+
+	if (pcData == NULL)
+	{
+		return (false);
+	}
+
+	vPortFree(pcData);
+	return (true);
+}
+
+//*****************************************************************************
+//
+// Serves a file from the content cache. Returns true and takes a reference
+// on a hit.
+//
+//*****************************************************************************
+static tBoolean
+fs_content_open(const char *pcName, struct fs_file *ptFile)
+{
+	unsigned long ulHash;
+	int i;
+
+	if (strncmp(pcName, FS_CONTENT_PREFIX, sizeof(FS_CONTENT_PREFIX) - 1)
+			|| strlen(pcName) >= FS_CACHE_NAME_LEN)
+	{
+		return (false);
+	}
+	ulHash = fs_cache_hash(pcName);
+
+	taskENTER_CRITICAL();
+	for (i = 0; i < FS_CONTENT_ENTRIES; i++)
+	{
+		if (g_psFsContent[i].ulHash == ulHash
+				&& g_psFsContent[i].usMountId == g_sFatFs.id
+				&& strcmp(g_psFsContent[i].pcName, pcName) == 0)
+		{
+			g_psFsContent[i].iRefs++;
+			g_psFsContent[i].ulUsed = ++g_ulFsContentClock;
+
+			ptFile->data = g_psFsContent[i].pcData;
+			ptFile->len = g_psFsContent[i].iLen;
+			ptFile->index = ptFile->len;
+			ptFile->pextension = NULL;
+			ptFile->pcache = &g_psFsContent[i];
+			break;
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	return (i < FS_CONTENT_ENTRIES);
+}
+
+//*****************************************************************************
+//
+// Loads a freshly opened small web file into the content cache and switches
+// the handle over to the RAM copy. Returns false if the file isn't cached,
+// the handle is unchanged then.
+//
+//*****************************************************************************
+static tBoolean
+fs_content_load(const char *pcName, struct fs_file *ptFile, FIL *psFatFile)
+{
+	tFsContent *psEntry = NULL;
+	char *pcData;
+	UINT uiRead;
+	int i, iLen = psFatFile->fsize;
+
+	if (strncmp(pcName, FS_CONTENT_PREFIX, sizeof(FS_CONTENT_PREFIX) - 1)
+			|| strlen(pcName) >= FS_CACHE_NAME_LEN
+			|| iLen > FS_CONTENT_MAX_FILE)
+	{
+		return (false);
+	}
+
+	//
+	// free invalidated entries, then evict until the file and a slot fit
+	//
+	while (fs_content_free_one(false))
+	{
+	}
+	for (;;)
+	{
+		for (i = 0; i < FS_CONTENT_ENTRIES; i++)
+		{
+			if (g_psFsContent[i].pcData == NULL)
+			{
+				break;
+			}
+		}
+		if (i < FS_CONTENT_ENTRIES && g_sFsCacheStats.ulContentBytes + iLen
+				<= FS_CONTENT_BUDGET)
+		{
+			break;
+		}
+		if (!fs_content_free_one(true))
+		{
+			return (false);
+		}
+	}
+
+	pcData = (char *) pvPortMalloc(iLen ? iLen : 1);
+	if (pcData == NULL)
+	{
+		return (false);
+	}
+
+	if (f_read(psFatFile, pcData, iLen, &uiRead) != FR_OK
+			|| uiRead != (UINT) iLen)
+	{
+		vPortFree(pcData);
+		f_lseek(psFatFile, 0);
+		return (false);
+	}
+
+	taskENTER_CRITICAL();
+	for (i = 0; i < FS_CONTENT_ENTRIES; i++)
+	{
+		if (g_psFsContent[i].pcData == NULL)
+		{
+			psEntry = &g_psFsContent[i];
+			strcpy(psEntry->pcName, pcName);
+			psEntry->ulHash = fs_cache_hash(pcName);
+			psEntry->usMountId = g_sFatFs.id;
+			psEntry->ulDirSect = psFatFile->dir_sect;
+			psEntry->pcData = pcData;
+			psEntry->iLen = iLen;
+			psEntry->iRefs = 1;
+			psEntry->ulUsed = ++g_ulFsContentClock;
+			g_sFsCacheStats.ulContentBytes += iLen;
+			g_sFsCacheStats.ulContentLoads++;
+			break;
+		}
+	}
+	taskEXIT_CRITICAL();
+
+	if (psEntry == NULL)
+	{
+		//
+		// all slots are referenced, send this one from the file
+		//
+		vPortFree(pcData);
+		f_lseek(psFatFile, 0);
+		return (false);
+	}
+
+	ptFile->data = pcData;
+	ptFile->len = iLen;
+	ptFile->index = iLen;
+	ptFile->pextension = NULL;
+	ptFile->pcache = psEntry;
+
+	return (true);
+}
+
 //*****************************************************************************
 //
-// Enable the SSI Port for FatFs usage.
+// Drops the reference of a closed file.
 //
 //*****************************************************************************
-void fs_enable(unsigned long ulFrequency)
+static void
+fs_content_release(tFsContent *psEntry)
 {
+	taskENTER_CRITICAL();
+	psEntry->iRefs--;
+	taskEXIT_CRITICAL();
+
 	//
-	// Disable the SSI Port.
+	// the entry may have been invalidated while it was sent
 	//
-	SSIDisable(SSI0_BASE);
+	while (fs_content_free_one(false))
+	{
+	}
+}
+#endif
+
+#if ENABLE_FS_CACHE || ENABLE_FS_CONTENT_CACHE
+//*****************************************************************************
+//
+// Write hook of the sector cache, drops the entries which may have changed.
+//
+//*****************************************************************************
+static void
+fs_cache_sector_written(DWORD ulSector)
+{
+	int i;
+#if ENABLE_FS_CACHE
+	DWORD ulClust;
 
 	//
-	// Reconfigure the SSI Port for Fat FS operation.
+	// cluster of the sector, 0 in the root directory of FAT12/16 and
+	// FS_CACHE_DIR_FAT in front of the directories
 	//
-	SSIConfigSetExpClk(SSI0_BASE, SysCtlClockGet(), SSI_FRF_MOTO_MODE_0,
-			SSI_MODE_MASTER, ulFrequency, 8);
+	if (g_sFatFs.fs_type && ulSector >= g_sFatFs.database)
+	{
+		ulClust = (ulSector - g_sFatFs.database) / g_sFatFs.csize + 2;
+	}
+	else if (g_sFatFs.fs_type && g_sFatFs.fs_type != FS_FAT32
+			&& ulSector >= g_sFatFs.dirbase)
+	{
+		ulClust = 0;
+	}
+	else
+	{
+		ulClust = FS_CACHE_DIR_FAT;
+	}
+#endif
 
+	taskENTER_CRITICAL();
+#if ENABLE_FS_CACHE
+	for (i = 0; i < FS_CACHE_ENTRIES; i++)
+	{
+		if (g_psFsCache[i].ulHash == 0)
+		{
+			continue;
+		}
+		if (g_psFsCache[i].bExists ? g_psFsCache[i].ulDirSect == ulSector
+				: (ulClust == FS_CACHE_DIR_FAT
+						|| g_psFsCache[i].ulDirClust == ulClust
+						|| g_psFsCache[i].ulDirClust == FS_CACHE_DIR_ANY))
+		{
+			g_psFsCache[i].ulHash = 0;
+		}
+	}
+#endif
+#if ENABLE_FS_CONTENT_CACHE
 	//
-	// Eanble the SSI Port.
+	// the data is freed by the next open or close, not in the hook
 	//
-	SSIEnable(SSI0_BASE);
+	for (i = 0; i < FS_CONTENT_ENTRIES; i++)
+	{
+		if (g_psFsContent[i].ulHash && g_psFsContent[i].ulDirSect == ulSector)
+		{
+			g_psFsContent[i].ulHash = 0;
+		}
+	}
+#endif
+	taskEXIT_CRITICAL();
 }
+#endif
 
 //*****************************************************************************
 //
@@ -111,9 +743,21 @@ void fs_init(void)
 	//
 	g_bFatFsEnabled = false;
 
+#if ENABLE_FS_FORWARD
+	if (g_xFsForwardMutex == NULL)
+	{
+		g_xFsForwardMutex = xSemaphoreCreateMutex();
+	}
+#endif
+
 	//
-	// Initialize and mount the Fat File System.
+	// Initialize and mount the Fat File System, FAT and directory sectors
+	// of this file system are pinned in the sector cache.
 	//
+	disk_cache_register(&g_sFatFs);
+#if ENABLE_FS_CACHE || ENABLE_FS_CONTENT_CACHE
+	disk_cache_set_write_hook(fs_cache_sector_written);
+#endif
 	fresult = f_mount(0, &g_sFatFs);
 	if (fresult != FR_OK)
 	{
@@ -177,131 +821,309 @@ void fs_tick(unsigned long ulTickMS)
 
 //*****************************************************************************
 //
-// Open a file and return a handle to the file, if found.  Otherwise,
-// return NULL.
+// Files of the RAM file system, their content is created on open.
 //
 //*****************************************************************************
-struct fs_file *
-fs_open(char *name)
+typedef struct
 {
-	const struct fsdata_file *ptTree;
-	struct fs_file *ptFile = NULL;
-	FIL *ptFatFile = NULL;
-	FRESULT fresult = FR_OK;
+	const char *pcName;
+	char *(*pfnGet)(int *piLen);
+} tFsRamFile;
 
-	//
-	// Allocate memory for the file system structure.
-	//
-	ptFile = (struct fs_file *) pvPortMalloc(sizeof(struct fs_file));
-	if (NULL == ptFile)
+static const tFsRamFile g_psFsRamFiles[] =
+{
+#if ENABLE_TRACE
+	{ TRACE_HTTP_FILE, pcTraceSnapshot },
+#endif
+	{ BOOT_HTTP_FILE, pcBootJson },
+#if ENABLE_STATS
+	{ STATS_HTTP_FILE, pcStatsJson },
+	{ STATS_SITES_HTTP_FILE, pcStatsSitesJson },
+#endif
+#if ENABLE_HEAP_TRACE
+	{ HEAP_TRACE_HTTP_FILE, pcHeapTraceSnapshot },
+#endif
+};
+
+#define FS_RAM_NUMFILES		(sizeof(g_psFsRamFiles) / sizeof(g_psFsRamFiles[0]))
+
+//*****************************************************************************
+//
+// Writes the length of the body into the Content-Length field of a response
+// built with FS_HTTP_JSON_HEADER.
+//
+//*****************************************************************************
+static void
+fs_ram_content_length(char *pcData, int iLen)
+{
+	char *pcField, *pcBody;
+	int iBody, i;
+
+	if (pcData == NULL || strncmp(pcData, "HTTP/", 5) != 0)
 	{
-		return (NULL);
+		return;
 	}
 
-	//
-	// Check to see if the Fat File System has been enabled.
-	//
-	if (g_bFatFsEnabled)
+	pcBody = strstr(pcData, "\r\n\r\n");
+	pcField = strstr(pcData, FS_HTTP_LENGTH_FIELD);
+	if (pcBody == NULL || pcField == NULL || pcField > pcBody)
 	{
-		//
-		// Ensure that the file system access to the SSI port is active.
-		//
-		fs_enable(400000);
+		return;
+	}
 
-		//
-		// Allocate memory for the Fat File system handle.
-		//
-		ptFatFile = (FIL*) pvPortMalloc(sizeof(FIL));
-		if (NULL == ptFatFile)
-		{
-			vPortFree(ptFile);
-			return (NULL);
-		}
+	iBody = iLen - (pcBody + 4 - pcData);
+	pcField += sizeof(FS_HTTP_LENGTH_FIELD) - 1;
+	for (i = FS_HTTP_LENGTH_DIGITS - 1; i >= 0; i--)
+	{
+		pcField[i] = '0' + (iBody % 10);
+		iBody /= 10;
+	}
+}
 
-		//
-		// Attempt to open the file on the Fat File System.
-		//
-		fresult = f_open(ptFatFile, name, FA_READ);
-		if (FR_OK == fresult)
+//*****************************************************************************
+//
+// Open a file of the RAM file system. The generators build the content in
+// one static buffer, the next open would change it while an earlier
+// response is still sent. So every handle gets its own copy, if there is
+// no memory for it the file is not opened.
+//
+//*****************************************************************************
+static tBoolean
+fs_open_ram(const char *name, tFsHandle *psHandle)
+{
+	struct fs_file *ptFile = &psHandle->sFile;
+	unsigned int i;
+	char *pcData;
+	int iLen;
+
+	for (i = 0; i < FS_RAM_NUMFILES; i++)
+	{
+		if (strcmp(name, g_psFsRamFiles[i].pcName) == 0)
 		{
-			ptFile->data = NULL;
-			ptFile->len = 0;
-			ptFile->index = 0;
-			ptFile->pextension = ptFatFile;
-			return (ptFile);
+			pcData = g_psFsRamFiles[i].pfnGet(&iLen);
+			if (pcData != NULL)
+			{
+				psHandle->pcCopy = (char *) pvPortMalloc(iLen ? iLen : 1);
+				if (psHandle->pcCopy == NULL)
+				{
+					return (false);
+				}
+				memcpy(psHandle->pcCopy, pcData, iLen);
+				pcData = psHandle->pcCopy;
+			}
+
+			ptFile->data = pcData;
+			ptFile->len = iLen;
+			fs_ram_content_length(ptFile->data, ptFile->len);
+			ptFile->index = ptFile->len;
+			ptFile->pextension = NULL;
+			return (true);
 		}
+	}
 
-		//
-		// If we get here, we failed to find the file on the Fat File System,
-		// so free up the Fat File system handle/object.
-		//
-		vPortFree(ptFatFile);
-		vPortFree(ptFile);
-		return (NULL);
+	return (false);
+}
+
+//*****************************************************************************
+//
+// Open a file on the SD Card. The RAM content cache and the lookup cache are
+// tried first, a cached miss doesn't touch the card.
+//
+//*****************************************************************************
+static tBoolean
+fs_open_sd(const char *name, tFsHandle *psHandle)
+{
+	struct fs_file *ptFile = &psHandle->sFile;
+	FIL *ptFatFile = &psHandle->sFatFile;
+	FRESULT fresult;
+
+	//
+	// Check to see if the Fat File System has been enabled.
+	//
+	if (!g_bFatFsEnabled)
+	{
+		return (false);
 	}
 
+	ptFile->data = NULL;
+	ptFile->len = 0;
+	ptFile->index = 0;
+	ptFile->pextension = ptFatFile;
+	g_sFsCacheStats.ulLookups++;
+
+#if ENABLE_FS_CONTENT_CACHE
 	//
-	// Initialize the file system tree pointer to the root of the linked list.
+	// Small web files may be in RAM already.
 	//
-	ptTree = FS_ROOT;
+	if (fs_content_open(name, ptFile))
+	{
+		g_sFsCacheStats.ulContentHits++;
+		return (true);
+	}
+#endif
 
+#if ENABLE_FS_CACHE
 	//
-	// Begin processing the linked list, looking for the requested file name.
+	// Try the lookup cache first, this avoids the directory walk.
 	//
-	while (NULL != ptTree)
+	switch (fs_cache_lookup(name, ptFatFile))
 	{
-		//
-		// Compare the requested file "name" to the file name in the
-		// current node.
-		//
-		if (strncmp(name, (char *) ptTree->name, ptTree->len) == 0)
-		{
-			//
-			// Fill in the data pointer and length values from the
-			// linked list node.
-			//
-			ptFile->data = (char *) ptTree->data;
-			ptFile->len = ptTree->len;
+		case 1:
+			g_sFsCacheStats.ulHits++;
+#if ENABLE_FS_CONTENT_CACHE
+			fs_content_load(name, ptFile, ptFatFile);
+#endif
+			return (true);
 
-			//
-			// For now, we setup the read index to the end of the file,
-			// indicating that all data has been read.
-			//
-			ptFile->index = ptTree->len;
+		case 0:
+			g_sFsCacheStats.ulNegHits++;
+			return (false);
 
-			//
-			// We are not using any file system extensions in this
-			// application, so set the pointer to NULL.
-			//
-			ptFile->pextension = NULL;
+		default:
+			break;
+	}
+#endif
+	g_sFsCacheStats.ulMisses++;
 
+	//
+	// Attempt to open the file on the Fat File System.
+	//
+	fresult = f_open(ptFatFile, name, FA_READ);
+	if (FR_OK == fresult)
+	{
+#if ENABLE_FS_CACHE
+		fs_cache_store(name, ptFatFile);
+#endif
+#if ENABLE_FS_CONTENT_CACHE
+		fs_content_load(name, ptFile, ptFatFile);
+#endif
+		return (true);
+	}
+
+#if ENABLE_FS_CACHE
+	if (FR_NO_FILE == fresult || FR_NO_PATH == fresult)
+	{
+		fs_cache_store(name, NULL);
+	}
+#endif
+
+	return (false);
+}
+
+//*****************************************************************************
+//
+// Open a file of the internal flash image. The index is sorted by name, so
+// a binary search finds the file.
+//
+//*****************************************************************************
+static tBoolean
+fs_open_rom(const char *name, tFsHandle *psHandle)
+{
+	struct fs_file *ptFile = &psHandle->sFile;
+	int iLow = 0, iHigh = FS_ROM_NUMFILES - 1, iMid, iCmp;
+
+	while (iLow <= iHigh)
+	{
+		iMid = (iLow + iHigh) / 2;
+		iCmp = strcmp(name, g_psFsRomFiles[iMid].pcName);
+		if (iCmp == 0)
+		{
 			//
-			// Exit the loop and return the file system pointer.
+			// The whole file is in flash, so the read index is already at
+			// the end and no Fat File object is used.
 			//
-			break;
+			ptFile->data = (char *) g_psFsRomFiles[iMid].pucData;
+			ptFile->len = g_psFsRomFiles[iMid].iLen;
+			ptFile->index = ptFile->len;
+			ptFile->pextension = NULL;
+			ptFile->etag = g_psFsRomFiles[iMid].ulETag;
+			return (true);
+		}
+		if (iCmp < 0)
+		{
+			iHigh = iMid - 1;
+		}
+		else
+		{
+			iLow = iMid + 1;
 		}
-
-		//
-		// If we get here, we did not find the file at this node of the linked
-		// list.  Get the next element in the list.
-		//
-		ptTree = ptTree->next;
 	}
 
+	return (false);
+}
+
+//*****************************************************************************
+//
+// Mount table. A name is looked up on every mount whose prefix matches, in
+// the order of the table, the first mount which has the file wins. The
+// prefix is removed before the name is passed to the mount.
+//
+// The SD Card comes before the flash image, so files on the card replace the
+// built-in ones. The built-in files are only found on the card once, after
+// that the lookup cache answers the miss.
+//
+//*****************************************************************************
+typedef struct
+{
+	const char *pcPrefix;
+	tBoolean (*pfnOpen)(const char *name, tFsHandle *psHandle);
+} tFsMount;
+
+static const tFsMount g_psFsMounts[] =
+{
+	{ "", fs_open_ram },
+	{ "", fs_open_sd },
+	{ FS_ROM_PREFIX, fs_open_rom },
+};
+
+#define FS_NUMMOUNTS		(sizeof(g_psFsMounts) / sizeof(g_psFsMounts[0]))
+
+//*****************************************************************************
+//
+// Open a file and return a handle to the file, if found.  Otherwise,
+// return NULL.
+//
+//*****************************************************************************
+struct fs_file *
+fs_open(char *name)
+{
+	tFsHandle *psHandle;
+	unsigned int i;
+	int iPrefixLen;
+
 	//
-	// If we didn't find the file, ptTee will be NULL.  Make sure we
-	// return a NULL pointer if this happens.
+	// Take a handle (file system structure and Fat File object).
 	//
-	if (NULL == ptTree)
+	psHandle = fs_handle_alloc();
+	if (NULL == psHandle)
+	{
+		return (NULL);
+	}
+	psHandle->sFile.pcache = NULL;
+	psHandle->sFile.etag = 0;
+	psHandle->pcCopy = NULL;
+
+	for (i = 0; i < FS_NUMMOUNTS; i++)
 	{
-		vPortFree(ptFile);
-		ptFile = NULL;
+		//
+		// the prefix must be a whole path component, "httpd-fs" doesn't
+		// match "httpd-fsx/..."
+		//
+		iPrefixLen = strlen(g_psFsMounts[i].pcPrefix);
+		if (strncmp(name, g_psFsMounts[i].pcPrefix, iPrefixLen) == 0
+				&& (iPrefixLen == 0 || name[iPrefixLen] == '/'
+						|| name[iPrefixLen] == 0)
+				&& g_psFsMounts[i].pfnOpen(name + iPrefixLen, psHandle))
+		{
+			return (&psHandle->sFile);
+		}
 	}
 
 	//
-	// Return the file system pointer.
+	// If we get here, no mount has the file, so give the handle back.
 	//
-	return (ptFile);
+	fs_handle_free(psHandle);
+	return (NULL);
 }
 
 //*****************************************************************************
@@ -311,18 +1133,132 @@ fs_open(char *name)
 //*****************************************************************************
 void fs_close(struct fs_file *file)
 {
+#if ENABLE_FS_CONTENT_CACHE
 	//
-	// If a Fat file was opened, free its object.
+	// Release the RAM copy of a cached file.
 	//
-	if (file->pextension)
+	if (file->pcache)
 	{
-		vPortFree(file->pextension);
+		fs_content_release((tFsContent *) file->pcache);
 	}
+#endif
 
 	//
-	// Free the main file system object.
+	// Free the snapshot of a RAM file.
 	//
-	vPortFree(file);
+	if (((tFsHandle *) file)->pcCopy)
+	{
+		vPortFree(((tFsHandle *) file)->pcCopy);
+	}
+
+	//
+	// The Fat file object is part of the handle, give both back.
+	//
+	fs_handle_free((tFsHandle *) file);
+}
+
+//*****************************************************************************
+//
+// Return the counters of the handle pool and the lookup cache.
+//
+//*****************************************************************************
+const tFsCacheStats *
+fs_cache_stats(void)
+{
+	return (&g_sFsCacheStats);
+}
+
+#if ENABLE_FS_FORWARD
+//*****************************************************************************
+//
+// Stream function of f_forward, passes the data to the sink of the running
+// transfer.
+//
+//*****************************************************************************
+static UINT
+fs_forward_stream(const BYTE *pucData, UINT uiLen)
+{
+	UINT uiSent;
+
+	uiSent = g_pfnFsSink(g_pvFsSinkArg, pucData, uiLen);
+	if (pucData != NULL && uiSent == 0)
+	{
+		g_bFsSinkFull = true;
+	}
+
+	return (uiSent);
+}
+#endif
+
+//*****************************************************************************
+//
+// Check if the data of a file can be passed on with fs_forward. This holds
+// for files on the SD Card which are not in the RAM content cache.
+//
+//*****************************************************************************
+int fs_can_forward(struct fs_file *file)
+{
+#if ENABLE_FS_FORWARD
+	return (file->pextension != NULL);
+#else
+	return (0);
+#endif
+}
+
+//*****************************************************************************
+//
+// Pass up to count bytes of the file to the sink. The data is taken from the
+// sector window of FatFs, so there is no copy into a file or send buffer.
+// Return the count of bytes passed, 0 if the sink takes no data right now,
+// or -1 at the end of the file.
+//
+//*****************************************************************************
+int fs_forward(struct fs_file *file, tFsSink pfnSink, void *pvArg, int count)
+{
+#if ENABLE_FS_FORWARD
+	FIL *ptFatFile = file->pextension;
+	FRESULT fresult;
+	UINT uiSent;
+
+	if (ptFatFile->fptr >= ptFatFile->fsize)
+	{
+		return (-1);
+	}
+
+	xSemaphoreTake(g_xFsForwardMutex, portMAX_DELAY);
+	g_pfnFsSink = pfnSink;
+	g_pvFsSinkArg = pvArg;
+	g_bFsSinkFull = false;
+
+	fresult = f_forward(ptFatFile, fs_forward_stream, count, &uiSent);
+
+	//
+	// A sink which takes no data stops f_forward with an error, but the file
+	// pointer is still valid (it's only moved for data the sink took), so
+	// the transfer can go on later.
+	//
+	if (FR_INT_ERR == fresult && g_bFsSinkFull)
+	{
+		ptFatFile->flag &= ~FA__ERROR;
+		fresult = FR_OK;
+	}
+	xSemaphoreGive(g_xFsForwardMutex);
+
+	if (fresult != FR_OK)
+	{
+		return (-1);
+	}
+	g_sFsCacheStats.ulForwardBytes += uiSent;
+
+	return ((int) uiSent);
+#else
+	(void) file;
+	(void) pfnSink;
+	(void) pvArg;
+	(void) count;
+
+	return (-1);
+#endif
 }
 
 //*****************************************************************************
@@ -344,11 +1280,6 @@ int fs_read(struct fs_file *file, char *buffer, int count)
 		UINT usBytesRead;
 		FRESULT fresult;
 
-		//
-		// Ensure that the file system access to the SSI port is active.
-		//
-		fs_enable(400000);
-
 		//
 		// Read the data.
 		//
@@ -384,7 +1315,7 @@ int fs_read(struct fs_file *file, char *buffer, int count)
 	//
 	// Copy the data.
 	//
-	memcpy(buffer, file->data + iAvailable, iAvailable);
+	memcpy(buffer, file->data + file->index, iAvailable);
 	file->index += iAvailable;
 
 	//
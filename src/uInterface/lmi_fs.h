@@ -51,16 +51,60 @@ struct fs_file
 	int len;
 	int index;
 	void *pextension;
+	void *pcache;		///< RAM content cache entry, data stays valid until fs_close
+	unsigned long etag;	///< ETag of a flash file (tools/makefsdata.py), 0 = none
 };
 
+/**
+ * Header of the JSON files of the RAM file system. fs_open fills in the
+ * length of the body, so the client knows where the response ends and the
+ * webserver can leave the close to it.
+ */
+#define FS_HTTP_JSON_HEADER		"HTTP/1.1 200 OK\r\n" \
+		"Content-type: application/json\r\n" \
+		FS_HTTP_LENGTH_FIELD "000000\r\n\r\n"
+#define FS_HTTP_LENGTH_FIELD	"Content-Length: "
+#define FS_HTTP_LENGTH_DIGITS	6
+
 /* file will be allocated and filled in by the fs_open function. file will
  * be freed by the fs_close function. */
 struct fs_file *fs_open(char *name);
 void fs_close(struct fs_file *file);
 int fs_read(struct fs_file *file, char *buffer, int count);
-void fs_enable(unsigned long ulFrequency);
 void fs_init(void);
 
+/**
+ * Counters of the open handle pool and the path lookup cache
+ */
+typedef struct
+{
+	unsigned long ulLookups;	///< fs_open calls on the SD Card
+	unsigned long ulHits;		///< opened without directory lookup
+	unsigned long ulNegHits;	///< misses answered from the cache
+	unsigned long ulMisses;		///< lookups done by f_open
+	unsigned long ulHeapOpens;	///< handles allocated because the pool was empty
+	unsigned long ulContentHits;	///< opens served from the RAM content cache
+	unsigned long ulContentLoads;	///< files loaded into the RAM content cache
+	unsigned long ulContentEvictions;	///< files dropped to stay in the budget
+	unsigned long ulContentBytes;	///< bytes resident in the RAM content cache
+	unsigned long ulForwardBytes;	///< bytes sent with fs_forward
+} tFsCacheStats;
+
+const tFsCacheStats* fs_cache_stats(void);
+
+/**
+ * Sink of fs_forward. Called with pucData == NULL to ask if the stream
+ * takes data (returns non-zero then), otherwise it returns the number of
+ * bytes taken from pucData, 0 if it can't take any.
+ */
+typedef unsigned int (*tFsSink)(void *pvArg, const unsigned char *pucData,
+		unsigned int uiLen);
+
+/* fs_forward passes the data of SD Card files to the sink directly from the
+ * sector window of FatFs, fs_can_forward tells if a file supports this. */
+int fs_can_forward(struct fs_file *file);
+int fs_forward(struct fs_file *file, tFsSink pfnSink, void *pvArg, int count);
+
 #endif /* __FS_H__ */
 
 //*****************************************************************************
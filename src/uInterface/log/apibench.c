@@ -0,0 +1,262 @@
+/**
+ * \addtogroup logging
+ * @{
+ *
+ * \author Anziner, Hahn
+ * \brief netconn API benchmark
+ *
+ * If ENABLE_API_BENCH is set, the LWIP task measures the cycles
+ * (DWT_CYCCNT) of netconn calls which don't wait for the network, once the
+ * address is bound:
+ *
+ * - new:     netconn_new(NETCONN_UDP)
+ * - bind:    netconn_bind() to a free port
+ * - getaddr: netconn_addr(), nothing but the call itself
+ * - delete:  netconn_delete()
+ * - lock:    LOCK_TCPIP_CORE() and UNLOCK_TCPIP_CORE() (core locking only)
+ *
+ * and of TCP connections to a listening netconn on the own address. The
+ * segments go over the loopback through tcpip_thread, so these calls wait
+ * for the handshake:
+ *
+ * - connect: netconn_connect(), always posted to tcpip_thread
+ * - close:   netconn_close() of the connecting side
+ *
+ * Without LWIP_TCPIP_CORE_LOCKING every call is posted to tcpip_thread and
+ * the caller waits for op_completed, with core locking the call runs in the
+ * calling task. Build both (lwipopts.h) and compare the lines.
+ *
+ * vLoadWebPage() also prints the time of every page: request written
+ * (including the connect on a new connection), first data received and
+ * response parsed, all since the start of the request, and the number of
+ * netconn calls. Pages on the kept connection show the time saved by not
+ * connecting.
+ *
+ */
+
+//*****************************************************************************
+//
+// apibench.c - netconn API benchmark
+//
+//*****************************************************************************
+
+/* std lib includes */
+#include <stdio.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+
+#include "lwip/opt.h"
+#include "lwip/api.h"
+#include "lwip/tcpip.h"
+#include "lwip/netif.h"
+
+#include "log/apibench.h"
+
+#include "setup.h"
+
+#if ENABLE_API_BENCH
+
+#if LWIP_TCPIP_CORE_LOCKING
+#define API_BENCH_MODE			"core locking"
+#else
+#define API_BENCH_MODE			"tcpip_thread"
+#endif
+
+/** cycles per us */
+#define API_BENCH_US(c)			((c) / (configCPU_CLOCK_HZ / 1000000))
+
+/**
+ * Fastest and total cycles of one call
+ */
+typedef struct
+{
+	unsigned long ulMin;
+	unsigned long ulSum;
+} tApiBenchTime;
+
+/** pages loaded and their total time in us */
+static unsigned long ulApiBenchPages, ulApiBenchPageUs;
+
+static void vApiBenchAdd(tApiBenchTime *pxTime, unsigned long ulCycles)
+{
+	pxTime->ulMin = ulCycles < pxTime->ulMin ? ulCycles : pxTime->ulMin;
+	pxTime->ulSum += ulCycles;
+}
+
+static void vApiBenchPrint(const char *pcName, tApiBenchTime *pxTime)
+{
+	static const char pcPad[] = "        ";
+	int iLen = strlen(pcName);
+
+	//
+	// UARTprintf has no '-' flag, the names are padded to 8 characters here
+	//
+	printf("api %s%s min %5d avg %5d cycles\n", pcName,
+			pcPad + (iLen < 8 ? iLen : 8), (int) pxTime->ulMin,
+			(int) (pxTime->ulSum / API_BENCH_RUNS));
+}
+
+/**
+ * Measures netconn_connect() and netconn_close() of TCP connections to a
+ * listener on the own address and prints them, nothing if a run fails.
+ */
+static void vApiBenchTcp(void)
+{
+	tApiBenchTime xConnect = { 0xFFFFFFFF, 0 }, xClose = { 0xFFFFFFFF, 0 };
+	struct netconn *pxListen, *pxConn, *pxAccepted;
+	struct ip_addr xAddr;
+	unsigned long ulStart;
+	err_t xErr;
+	int i;
+
+	pxListen = netconn_new(NETCONN_TCP);
+	if (pxListen == NULL)
+	{
+		printf("api bench: no netconn\n");
+		return;
+	}
+	if (netconn_bind(pxListen, IP_ADDR_ANY, API_BENCH_TCP_PORT) != ERR_OK
+			|| netconn_listen(pxListen) != ERR_OK)
+	{
+		printf("api bench: no listener on port %d\n", API_BENCH_TCP_PORT);
+		netconn_delete(pxListen);
+		return;
+	}
+	xAddr = netif_default->ip_addr;
+
+	for (i = 0; i < API_BENCH_RUNS; i++)
+	{
+		pxConn = netconn_new(NETCONN_TCP);
+		if (pxConn == NULL)
+		{
+			break;
+		}
+
+		ulStart = API_BENCH_CYCCNT;
+		xErr = netconn_connect(pxConn, &xAddr, API_BENCH_TCP_PORT);
+		vApiBenchAdd(&xConnect, API_BENCH_CYCCNT - ulStart);
+		if (xErr != ERR_OK)
+		{
+			netconn_delete(pxConn);
+			break;
+		}
+
+		pxAccepted = netconn_accept(pxListen);
+
+		ulStart = API_BENCH_CYCCNT;
+		netconn_close(pxConn);
+		vApiBenchAdd(&xClose, API_BENCH_CYCCNT - ulStart);
+
+		if (pxAccepted != NULL)
+		{
+			netconn_delete(pxAccepted);
+		}
+		netconn_delete(pxConn);
+	}
+
+	netconn_delete(pxListen);
+
+	if (i < API_BENCH_RUNS)
+	{
+		printf("api bench: tcp failed in run %d\n", i);
+		return;
+	}
+
+	vApiBenchPrint("connect", &xConnect);
+	vApiBenchPrint("close", &xClose);
+}
+
+/**
+ * Measures the cycles of netconn calls and prints them. The task can be
+ * preempted, so the fastest run is the cost of the call and the average
+ * shows the disturbance.
+ */
+void vApiBench(void)
+{
+	tApiBenchTime xNew = { 0xFFFFFFFF, 0 }, xBind = { 0xFFFFFFFF, 0 },
+			xGetAddr = { 0xFFFFFFFF, 0 }, xDelete = { 0xFFFFFFFF, 0 };
+#if LWIP_TCPIP_CORE_LOCKING
+	tApiBenchTime xLock = { 0xFFFFFFFF, 0 };
+#endif
+	struct netconn *pxConn;
+	struct ip_addr xAddr;
+	u16_t usPort;
+	unsigned long ulStart;
+	int i;
+
+	for (i = 0; i < API_BENCH_RUNS; i++)
+	{
+		ulStart = API_BENCH_CYCCNT;
+		pxConn = netconn_new(NETCONN_UDP);
+		vApiBenchAdd(&xNew, API_BENCH_CYCCNT - ulStart);
+		if (pxConn == NULL)
+		{
+			printf("api bench: no netconn\n");
+			return;
+		}
+
+		ulStart = API_BENCH_CYCCNT;
+		netconn_bind(pxConn, IP_ADDR_ANY, 0);
+		vApiBenchAdd(&xBind, API_BENCH_CYCCNT - ulStart);
+
+		ulStart = API_BENCH_CYCCNT;
+		netconn_addr(pxConn, &xAddr, &usPort);
+		vApiBenchAdd(&xGetAddr, API_BENCH_CYCCNT - ulStart);
+
+		ulStart = API_BENCH_CYCCNT;
+		netconn_delete(pxConn);
+		vApiBenchAdd(&xDelete, API_BENCH_CYCCNT - ulStart);
+
+#if LWIP_TCPIP_CORE_LOCKING
+		ulStart = API_BENCH_CYCCNT;
+		LOCK_TCPIP_CORE();
+		UNLOCK_TCPIP_CORE();
+		vApiBenchAdd(&xLock, API_BENCH_CYCCNT - ulStart);
+#endif
+	}
+
+	printf("api calls (%s, %d runs)\n", API_BENCH_MODE, API_BENCH_RUNS);
+	vApiBenchPrint("new", &xNew);
+	vApiBenchPrint("bind", &xBind);
+	vApiBenchPrint("getaddr", &xGetAddr);
+	vApiBenchPrint("delete", &xDelete);
+#if LWIP_TCPIP_CORE_LOCKING
+	vApiBenchPrint("lock", &xLock);
+#endif
+
+	vApiBenchTcp();
+}
+
+/**
+ * Prints the time of a page loaded by vLoadWebPage()
+ *
+ * @param pcPage the requested page
+ * @param iKept the page was loaded over the kept connection
+ * @param ulRequest cycles until netconn_write() returned
+ * @param ulFirst cycles until the first netconn_recv() returned
+ * @param ulTotal cycles until the response was parsed
+ * @param ulCalls number of netconn calls for the page
+ */
+void vApiBenchPage(const char *pcPage, int iKept, unsigned long ulRequest,
+		unsigned long ulFirst, unsigned long ulTotal, unsigned long ulCalls)
+{
+	ulApiBenchPages++;
+	ulApiBenchPageUs += API_BENCH_US(ulTotal);
+
+	printf("httpc %s (%s, %s conn): request %d us, first %d us, "
+		"total %d us, %d calls, avg %d us of %d pages\n", pcPage,
+			API_BENCH_MODE, iKept ? "kept" : "new",
+			(int) API_BENCH_US(ulRequest), (int) API_BENCH_US(ulFirst),
+			(int) API_BENCH_US(ulTotal), (int) ulCalls,
+			(int) (ulApiBenchPageUs / ulApiBenchPages), (int) ulApiBenchPages);
+}
+
+#endif
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
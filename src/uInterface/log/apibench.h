@@ -0,0 +1,61 @@
+/**
+ * \addtogroup logging
+ * @{
+ *
+ * \author Anziner, Hahn
+ * \brief Prototypes for the netconn API benchmark
+ *
+ *
+ */
+
+//*****************************************************************************
+//
+// apibench.h - Prototypes for the netconn API benchmark
+//
+//*****************************************************************************
+
+#ifndef APIBENCH_H_
+#define APIBENCH_H_
+
+//*****************************************************************************
+//
+/// Number of runs per call, the fastest and the average one are printed
+//
+//*****************************************************************************
+#define API_BENCH_RUNS			32
+
+//*****************************************************************************
+//
+/// Port of the listener the TCP connect and close runs connect to
+//
+//*****************************************************************************
+#define API_BENCH_TCP_PORT		5001
+
+//*****************************************************************************
+//
+/// Cycle counter, started by vTraceInit()
+//
+//*****************************************************************************
+#define API_BENCH_CYCCNT		(*((volatile unsigned long *) 0xE0001004))
+
+/**
+ * Measures the cycles of netconn calls which don't wait for the network and
+ * prints them to the UART, call from a task once tcpip_thread runs
+ */
+void vApiBench(void);
+
+/**
+ * Prints the time of a page loaded by vLoadWebPage() (cycles since the start
+ * of the request) and the average of all pages
+ */
+void vApiBenchPage(const char *pcPage, int iKept, unsigned long ulRequest,
+		unsigned long ulFirst, unsigned long ulTotal, unsigned long ulCalls);
+
+#endif
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
@@ -0,0 +1,259 @@
+/**
+ * \addtogroup logging
+ * @{
+ *
+ * \author Anziner, Hahn
+ * \brief Boot timeline
+ *
+ * Records begin and end of the boot stages in a fixed array, from the clock
+ * setup in prvSetupHardware to the end of the boot (address bound, services
+ * and menu loaded) and the first request served by the webserver. The
+ * timeline is printed to the UART at the end of the boot and served as JSON
+ * (BOOT_HTTP_FILE).
+ *
+ * The time comes from the free running timer 1 (timer.c) with cycle
+ * resolution. It wraps every 86 s, after the scheduler start the tick count
+ * tells how often it wrapped.
+ *
+ */
+
+//*****************************************************************************
+//
+// boottime.c - Boot timeline
+//
+//*****************************************************************************
+
+/* std lib includes */
+#include <stdio.h>
+#include <string.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "hw_types.h"
+#include "sysctl.h"
+
+#include "log/boottime.h"
+#include "lmi_fs.h"
+
+#include "setup.h"
+
+static tBootEvent xBootEvents[BOOT_MAX_EVENTS];
+static int iBootEvents = 0;
+
+/** time of the scheduler start, 0 while it isn't running */
+static unsigned long ulBootSchedulerUs = 0;
+
+/** the timeline is complete, only the first request is added */
+static tBoolean bBootDone = false;
+static tBoolean bBootServed = false;
+
+static char pcBootJsonBuf[BOOT_JSON_LEN];
+
+static const char * const pcBootTypes[] =
+{ "begin", "end", "mark" };
+
+/**
+ * Returns the us since the free running timer started
+ */
+static unsigned long ulBootUs(void)
+{
+	unsigned long ulCycles = ulFreeRunningTimerCycles();
+	unsigned long ulMhz = SysCtlClockGet() / 1000000;
+	unsigned long long ullCycles = ulCycles;
+	unsigned long long ullExpected;
+
+	//
+	// the timer wraps every 2^32 cycles, the tick count is accurate enough
+	// to tell how often
+	//
+	if (ulBootSchedulerUs != 0)
+	{
+		ullExpected = ((unsigned long long) ulBootSchedulerUs
+				+ (unsigned long long) xTaskGetTickCount() * portTICK_RATE_MS
+						* 1000) * ulMhz;
+		ullCycles += ((ullExpected + 0x80000000ULL - ulCycles) >> 32) << 32;
+	}
+
+	return (unsigned long) (ullCycles / ulMhz);
+}
+
+/**
+ * Appends an event to the timeline
+ */
+static void vBootRecord(const char *pcStage, unsigned char ucType,
+		tBoolean bAfterDone)
+{
+	unsigned long ulUs = ulBootUs();
+	tBoolean bScheduler = (ulBootSchedulerUs != 0);
+
+	//
+	// before the scheduler runs main is the only caller, a critical section
+	// would leave the interrupts masked until the scheduler starts
+	//
+	if (bScheduler)
+	{
+		taskENTER_CRITICAL();
+	}
+	if (iBootEvents < BOOT_MAX_EVENTS && (!bBootDone || bAfterDone))
+	{
+		xBootEvents[iBootEvents].pcStage = pcStage;
+		xBootEvents[iBootEvents].ulUs = ulUs;
+		xBootEvents[iBootEvents].ucType = ucType;
+		iBootEvents++;
+	}
+	if (bScheduler)
+	{
+		taskEXIT_CRITICAL();
+	}
+}
+
+/**
+ * Returns the duration of a stage which ends with event i, -1 if there is no
+ * begin for it
+ */
+static long lBootDuration(int i)
+{
+	int j;
+
+	for (j = i - 1; j >= 0; j--)
+	{
+		if (xBootEvents[j].ucType == BOOT_EVENT_BEGIN && strcmp(
+				xBootEvents[j].pcStage, xBootEvents[i].pcStage) == 0)
+		{
+			return (long) (xBootEvents[i].ulUs - xBootEvents[j].ulUs);
+		}
+	}
+
+	return -1;
+}
+
+/**
+ * Records the begin of a boot stage
+ */
+void vBootBegin(const char *pcStage)
+{
+	vBootRecord(pcStage, BOOT_EVENT_BEGIN, false);
+}
+
+/**
+ * Records the end of a boot stage
+ */
+void vBootEnd(const char *pcStage)
+{
+	vBootRecord(pcStage, BOOT_EVENT_END, false);
+}
+
+/**
+ * Records that a point of the boot was reached
+ */
+void vBootMark(const char *pcStage)
+{
+	vBootRecord(pcStage, BOOT_EVENT_MARK, false);
+}
+
+/**
+ * Records the start of the scheduler, from now on the tick count is used to
+ * extend the timer
+ */
+void vBootSchedulerStart(void)
+{
+	vBootMark("scheduler");
+	ulBootSchedulerUs = ulBootUs() | 1;
+}
+
+/**
+ * Ends the timeline and prints it to the UART
+ */
+void vBootDone(void)
+{
+	if (bBootDone)
+	{
+		return;
+	}
+
+	vBootMark("boot done");
+	bBootDone = true;
+
+	vBootReport();
+}
+
+/**
+ * Records the first served request
+ */
+void vBootRequestServed(void)
+{
+	if (bBootServed)
+	{
+		return;
+	}
+	bBootServed = true;
+
+	vBootRecord("first request", BOOT_EVENT_MARK, true);
+}
+
+/**
+ * Prints the timeline to the UART
+ */
+void vBootReport(void)
+{
+	int i;
+
+	printf("Boot timeline (us):\n");
+	for (i = 0; i < iBootEvents; i++)
+	{
+		printf("%10d  %s  %s", (int) xBootEvents[i].ulUs,
+				pcBootTypes[xBootEvents[i].ucType], xBootEvents[i].pcStage);
+		if (xBootEvents[i].ucType == BOOT_EVENT_END)
+		{
+			printf(" (%d us)", (int) lBootDuration(i));
+		}
+		printf("\n");
+	}
+}
+
+/**
+ * Formats the timeline as JSON. The URI has no extension, so the webserver
+ * sends no headers, they are part of the response.
+ *
+ * @param piLen returns the length of the response
+ * @return pointer to the response, valid until the next call
+ */
+char* pcBootJson(int *piLen)
+{
+	int i, iLen;
+
+	iLen = snprintf(pcBootJsonBuf, BOOT_JSON_LEN, FS_HTTP_JSON_HEADER
+		"{\"done\":%s,\"events\":[",
+			bBootDone ? "true" : "false");
+
+	//
+	// an event takes less than 96 characters, the rest stays for the end
+	//
+	for (i = 0; i < iBootEvents && iLen < BOOT_JSON_LEN - 96; i++)
+	{
+		iLen += snprintf(pcBootJsonBuf + iLen, BOOT_JSON_LEN - iLen,
+				"%s{\"stage\":\"%s\",\"type\":\"%s\",\"us\":%d", i ? "," : "",
+				xBootEvents[i].pcStage, pcBootTypes[xBootEvents[i].ucType],
+				(int) xBootEvents[i].ulUs);
+		if (xBootEvents[i].ucType == BOOT_EVENT_END)
+		{
+			iLen += snprintf(pcBootJsonBuf + iLen, BOOT_JSON_LEN - iLen,
+					",\"dur\":%d", (int) lBootDuration(i));
+		}
+		iLen += snprintf(pcBootJsonBuf + iLen, BOOT_JSON_LEN - iLen, "}");
+	}
+
+	iLen += snprintf(pcBootJsonBuf + iLen, BOOT_JSON_LEN - iLen, "]}\n");
+
+	*piLen = iLen;
+	return pcBootJsonBuf;
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
@@ -0,0 +1,105 @@
+/**
+ * \addtogroup logging
+ * @{
+ *
+ * \author Anziner, Hahn
+ * \brief Prototypes for the boot timeline
+ *
+ *
+ */
+
+//*****************************************************************************
+//
+// boottime.h - Prototypes for the boot timeline
+//
+//*****************************************************************************
+
+#ifndef BOOTTIME_H_
+#define BOOTTIME_H_
+
+//*****************************************************************************
+//
+/// Maximum number of events kept in the timeline, later events are dropped
+//
+//*****************************************************************************
+#define BOOT_MAX_EVENTS			32
+
+//*****************************************************************************
+//
+/// Size of the buffer for the JSON report
+//
+//*****************************************************************************
+#define BOOT_JSON_LEN			2048
+
+//*****************************************************************************
+//
+/// Path served by the webserver with the timeline as JSON
+//
+//*****************************************************************************
+#define BOOT_HTTP_FILE			"httpd-fs/api/boot"
+
+/// types of the events
+#define BOOT_EVENT_BEGIN		0
+#define BOOT_EVENT_END			1
+#define BOOT_EVENT_MARK			2
+
+/**
+ * One event of the timeline
+ */
+typedef struct
+{
+	const char *pcStage; ///< name of the stage, must be a constant string
+	unsigned long ulUs; ///< time in us since the free running timer started
+	unsigned char ucType; ///< BOOT_EVENT_BEGIN, _END or _MARK
+} tBootEvent;
+
+/**
+ * Records the begin of a boot stage
+ */
+void vBootBegin(const char *pcStage);
+
+/**
+ * Records the end of a boot stage, pcStage must be the same as for the
+ * begin
+ */
+void vBootEnd(const char *pcStage);
+
+/**
+ * Records that a point of the boot was reached
+ */
+void vBootMark(const char *pcStage);
+
+/**
+ * Records the start of the scheduler, call right before
+ * vTaskStartScheduler()
+ */
+void vBootSchedulerStart(void);
+
+/**
+ * Ends the timeline and prints it to the UART, later events are ignored
+ */
+void vBootDone(void);
+
+/**
+ * Records the first served request
+ */
+void vBootRequestServed(void);
+
+/**
+ * Prints the timeline to the UART
+ */
+void vBootReport(void);
+
+/**
+ * Formats the timeline as JSON response (for the webserver)
+ */
+char* pcBootJson(int *piLen);
+
+#endif
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
@@ -0,0 +1,158 @@
+/**
+ * \addtogroup logging
+ * @{
+ *
+ * \author Anziner, Hahn
+ * \brief Checksum benchmark
+ *
+ * If ENABLE_CHKSUM_BENCH is set, main() measures the Internet checksum
+ * before the scheduler starts and prints the cycles (DWT_CYCCNT) for the
+ * usual segment sizes:
+ *
+ * - ref:  16 bit at a time in C, like lwip_standard_chksum()
+ * - sum:  lm3s_chksum(), 32 bit at a time with adcs (LWIP_CHKSUM)
+ * - copy: memcpy() followed by lm3s_chksum(), what TCP did before
+ * - fused: lm3s_chksum_copy() (LWIP_CHKSUM_COPY, TCP_CHECKSUM_ON_COPY)
+ *
+ * Every size is measured with an aligned and an unaligned source. The
+ * results of the routines are compared, a mismatch is printed.
+ *
+ * tools/chksumbench.c tests the routines on the host against the
+ * reference.
+ *
+ */
+
+//*****************************************************************************
+//
+// chksumbench.c - Checksum benchmark
+//
+//*****************************************************************************
+
+/* std lib includes */
+#include <string.h>
+#include <stdio.h>
+
+#include "lwip/opt.h"
+#include "lwip/inet.h"
+
+#include "uart/uartstdio.h"
+#include "log/chksumbench.h"
+
+#include "setup.h"
+
+#if ENABLE_CHKSUM_BENCH
+
+//*****************************************************************************
+//
+// Cycle counter, started by vTraceInit()
+//
+//*****************************************************************************
+#define CHKSUM_BENCH_CYCCNT		(*((volatile unsigned long *) 0xE0001004))
+
+/** largest measured size, the MSS */
+#define CHKSUM_BENCH_MAX		1460
+
+/** sizes of the measured segments */
+static const unsigned short pusChksumBenchSizes[] =
+{ 64, 256, 536, 1024, 1460 };
+
+/** source and destination, one word more for the unaligned source */
+static unsigned long pulChksumBenchSrc[(CHKSUM_BENCH_MAX + 4) / 4 + 1];
+static unsigned long pulChksumBenchDst[(CHKSUM_BENCH_MAX + 4) / 4 + 1];
+
+/**
+ * Reference, the 16-bit loop of lwip_standard_chksum() (algorithm 1)
+ */
+static u16_t usChksumBenchRef(void *pvData, u16_t usLen)
+{
+	u32_t acc = 0;
+	u8_t *pb = (u8_t *) pvData;
+
+	while (usLen > 1)
+	{
+		acc += ((u16_t) pb[0] << 8) | pb[1];
+		pb += 2;
+		usLen -= 2;
+	}
+	if (usLen > 0)
+	{
+		acc += (u16_t) pb[0] << 8;
+	}
+
+	acc = (acc >> 16) + (acc & 0xffffUL);
+	acc = (acc >> 16) + (acc & 0xffffUL);
+
+	return htons((u16_t) acc);
+}
+
+/**
+ * Measures the four routines for one size and source alignment
+ */
+static void vChksumBenchSize(u16_t usLen, unsigned long ulOffset)
+{
+	unsigned char *pucSrc = ((unsigned char *) pulChksumBenchSrc) + ulOffset;
+	unsigned long ulStart, ulRef, ulSum, ulCopy, ulFused, ulCycles;
+	u16_t usRef = 0, usSum = 0, usFused = 0;
+	int i;
+
+	ulRef = ulSum = ulCopy = ulFused = 0xFFFFFFFF;
+
+	for (i = 0; i < CHKSUM_BENCH_RUNS; i++)
+	{
+		ulStart = CHKSUM_BENCH_CYCCNT;
+		usRef = usChksumBenchRef(pucSrc, usLen);
+		ulCycles = CHKSUM_BENCH_CYCCNT - ulStart;
+		ulRef = ulCycles < ulRef ? ulCycles : ulRef;
+
+		ulStart = CHKSUM_BENCH_CYCCNT;
+		usSum = LWIP_CHKSUM(pucSrc, usLen);
+		ulCycles = CHKSUM_BENCH_CYCCNT - ulStart;
+		ulSum = ulCycles < ulSum ? ulCycles : ulSum;
+
+		ulStart = CHKSUM_BENCH_CYCCNT;
+		memcpy(pulChksumBenchDst, pucSrc, usLen);
+		LWIP_CHKSUM(pulChksumBenchDst, usLen);
+		ulCycles = CHKSUM_BENCH_CYCCNT - ulStart;
+		ulCopy = ulCycles < ulCopy ? ulCycles : ulCopy;
+
+		ulStart = CHKSUM_BENCH_CYCCNT;
+		usFused = LWIP_CHKSUM_COPY(pulChksumBenchDst, pucSrc, usLen);
+		ulCycles = CHKSUM_BENCH_CYCCNT - ulStart;
+		ulFused = ulCycles < ulFused ? ulCycles : ulFused;
+	}
+
+	UARTprintf("chksum %4u +%u: ref %5u sum %5u copy %5u fused %5u%s\n",
+			usLen, ulOffset, ulRef, ulSum, ulCopy, ulFused,
+			(usRef != usSum || usRef != usFused) ? " MISMATCH" : "");
+}
+
+/**
+ * Measures the cycles of the checksum routines and prints them to the
+ * UART. The cycle counter must run (vTraceInit()), interrupts would
+ * disturb the measurement, so it is called before the scheduler starts.
+ */
+void vChksumBench(void)
+{
+	unsigned long i;
+
+	for (i = 0; i < sizeof(pulChksumBenchSrc); i++)
+	{
+		((unsigned char *) pulChksumBenchSrc)[i] = (unsigned char) (i * 7 + 3);
+	}
+
+	UARTprintf("checksum cycles (best of %u)\n", CHKSUM_BENCH_RUNS);
+	for (i = 0; i < sizeof(pusChksumBenchSizes) / sizeof(pusChksumBenchSizes[0]); i++)
+	{
+		vChksumBenchSize(pusChksumBenchSizes[i], 0);
+		vChksumBenchSize(pusChksumBenchSizes[i], 1);
+	}
+}
+
+#endif
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
@@ -0,0 +1,40 @@
+/**
+ * \addtogroup logging
+ * @{
+ *
+ * \author Anziner, Hahn
+ * \brief Prototypes for the checksum benchmark
+ *
+ *
+ */
+
+//*****************************************************************************
+//
+// chksumbench.h - Prototypes for the checksum benchmark
+//
+//*****************************************************************************
+
+#ifndef CHKSUMBENCH_H_
+#define CHKSUMBENCH_H_
+
+//*****************************************************************************
+//
+/// Number of runs per measurement, the fastest one is printed
+//
+//*****************************************************************************
+#define CHKSUM_BENCH_RUNS		8
+
+/**
+ * Measures the cycles of the checksum routines and prints them to the
+ * UART, call before the scheduler starts (needs vTraceInit())
+ */
+void vChksumBench(void);
+
+#endif
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
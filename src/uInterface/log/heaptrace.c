@@ -0,0 +1,217 @@
+/**
+ * \addtogroup logging
+ * @{
+ *
+ * \author Anziner, Hahn
+ * \brief Allocation trace
+ *
+ * If ENABLE_HEAP_TRACE is set, the heap (heap_tlsf.c) records every call of
+ * pvPortMalloc() and vPortFree() with size, block address, return address,
+ * task and tick count into a RAM ring. The trace task writes the calls to
+ * the UART ("#H" lines), the webserver sends a snapshot of the ring
+ * (HEAP_TRACE_HTTP_FILE).
+ *
+ * tools/heaptrace.py resolves the callers with the .axf or map file, sums
+ * them up per subsystem and replays the calls against the heaps with
+ * tools/heapbench.c.
+ *
+ */
+
+//*****************************************************************************
+//
+// heaptrace.c - Allocation trace
+//
+//*****************************************************************************
+
+/* std lib includes */
+#include <string.h>
+#include <stdio.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "uart/uartstdio.h"
+#include "log/heaptrace.h"
+#include "log/trace.h"
+
+#include "setup.h"
+
+/**
+ * Header, task table and ring, kept in one block so that the webserver can
+ * send it without copying.
+ */
+static struct
+{
+	tHeapTraceHeader xHeader;
+	tHeapTraceTask xTasks[HEAP_TRACE_MAX_TASKS];
+	tHeapTraceEvent xEvents[HEAP_TRACE_RING_SIZE];
+} g_sHeapTrace =
+{
+	{ HEAP_TRACE_MAGIC, 0, 0, HEAP_TRACE_RING_SIZE, sizeof(tHeapTraceEvent),
+			HEAP_TRACE_MAX_TASKS, sizeof(tHeapTraceTask) } };
+
+/** number of used entries of the task table */
+static unsigned long ulHeapTraceTasks = 0;
+
+/** number of task names already written to the UART */
+static unsigned long ulHeapTraceTasksDrained = 0;
+
+/** number of calls already written to the UART */
+static unsigned long ulHeapTraceTail = 0;
+
+/** task of the last call, most calls come from the same task */
+static xTaskHandle xHeapTraceLastTask = NULL;
+static unsigned char ucHeapTraceLastIndex = HEAP_TRACE_NO_TASK;
+
+/**
+ * Returns the index of the calling task in the task table, a new task is
+ * added with its name
+ */
+static unsigned char ucHeapTraceTask(void)
+{
+	xTaskHandle xTask;
+	unsigned long i;
+
+	xTask = xTaskGetCurrentTaskHandle();
+	if (xTask == NULL)
+	{
+		return HEAP_TRACE_NO_TASK;
+	}
+	if (xTask == xHeapTraceLastTask)
+	{
+		return ucHeapTraceLastIndex;
+	}
+
+	for (i = 0; i < ulHeapTraceTasks; i++)
+	{
+		if (g_sHeapTrace.xTasks[i].pvHandle == xTask)
+		{
+			break;
+		}
+	}
+
+	if (i == ulHeapTraceTasks)
+	{
+		if (i == HEAP_TRACE_MAX_TASKS)
+		{
+			return HEAP_TRACE_NO_TASK;
+		}
+
+		g_sHeapTrace.xTasks[i].pvHandle = xTask;
+		strncpy(g_sHeapTrace.xTasks[i].pcName,
+				(const char *) pcTaskGetTaskName(xTask), configMAX_TASK_NAME_LEN);
+		ulHeapTraceTasks++;
+	}
+
+	xHeapTraceLastTask = xTask;
+	ucHeapTraceLastIndex = (unsigned char) i;
+
+	return ucHeapTraceLastIndex;
+}
+
+/**
+ * Records one call. The heap calls it with the scheduler suspended, that
+ * protects the ring as long as the heap isn't used by interrupts.
+ *
+ * @param ucType HEAP_TRACE_MALLOC, HEAP_TRACE_FREE or HEAP_TRACE_FAILED
+ * @param pvAddress returned or freed block
+ * @param xSize requested or freed bytes
+ * @param pvCaller return address of pvPortMalloc() or vPortFree()
+ */
+void vHeapTraceRecord(unsigned char ucType, void *pvAddress, size_t xSize,
+		void *pvCaller)
+{
+	tHeapTraceEvent *pxEvent;
+
+	pxEvent = &g_sHeapTrace.xEvents[g_sHeapTrace.xHeader.ulHead
+			& (HEAP_TRACE_RING_SIZE - 1)];
+	pxEvent->ulTime = xTaskGetTickCount();
+	pxEvent->pvAddress = pvAddress;
+	pxEvent->pvCaller = pvCaller;
+	pxEvent->usSeq = (unsigned short) g_sHeapTrace.xHeader.ulHead;
+	pxEvent->usSize = (unsigned short) xSize;
+	pxEvent->ucType = ucType;
+	pxEvent->ucTask = ucHeapTraceTask();
+
+	g_sHeapTrace.xHeader.ulHead++;
+}
+
+/**
+ * Writes up to ulMax pending calls to the UART. New tasks are written
+ * before the calls as "#N <index> <handle> <name>", the calls as
+ * "#H <seq> <time> <type> <task> <size> <address> <caller>".
+ * UARTprintf() doesn't use the heap, the drain doesn't record itself.
+ *
+ * @param ulMax maximum number of calls
+ * @return number of calls written
+ */
+unsigned long ulHeapTraceDrain(unsigned long ulMax)
+{
+	tHeapTraceEvent xEvent;
+	unsigned long ulCount = 0;
+
+	while (ulHeapTraceTasksDrained < ulHeapTraceTasks)
+	{
+		UARTprintf("#N %02x %08x %s\n", ulHeapTraceTasksDrained,
+				(unsigned long) g_sHeapTrace.xTasks[ulHeapTraceTasksDrained].pvHandle,
+				g_sHeapTrace.xTasks[ulHeapTraceTasksDrained].pcName);
+		ulHeapTraceTasksDrained++;
+	}
+
+	while (ulCount < ulMax)
+	{
+		vTraceSuspendAll();
+
+		//
+		// calls overwritten before we got them are counted as lost, the
+		// replay on the host needs the whole sequence
+		//
+		if (g_sHeapTrace.xHeader.ulHead - ulHeapTraceTail > HEAP_TRACE_RING_SIZE)
+		{
+			g_sHeapTrace.xHeader.ulLost += g_sHeapTrace.xHeader.ulHead
+					- ulHeapTraceTail - HEAP_TRACE_RING_SIZE;
+			ulHeapTraceTail = g_sHeapTrace.xHeader.ulHead - HEAP_TRACE_RING_SIZE;
+		}
+
+		if (ulHeapTraceTail == g_sHeapTrace.xHeader.ulHead)
+		{
+			vTraceResumeAll();
+			break;
+		}
+
+		xEvent = g_sHeapTrace.xEvents[ulHeapTraceTail & (HEAP_TRACE_RING_SIZE - 1)];
+		ulHeapTraceTail++;
+
+		vTraceResumeAll();
+
+		UARTprintf("#H %04x %08x %x %02x %04x %08x %08x\n", xEvent.usSeq,
+				xEvent.ulTime, xEvent.ucType, xEvent.ucTask, xEvent.usSize,
+				(unsigned long) xEvent.pvAddress, (unsigned long) xEvent.pvCaller);
+		ulCount++;
+	}
+
+	return ulCount;
+}
+
+/**
+ * Returns the header, the task table and the ring as one block. The
+ * webserver sends it while new calls are recorded, the host tool sorts
+ * the calls by their sequence number.
+ *
+ * @param piLen returns the length of the block
+ * @return pointer to the block
+ */
+char* pcHeapTraceSnapshot(int *piLen)
+{
+	*piLen = sizeof(g_sHeapTrace);
+
+	return (char *) &g_sHeapTrace;
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
@@ -0,0 +1,136 @@
+/**
+ * \addtogroup logging
+ * @{
+ *
+ * \author Anziner, Hahn
+ * \brief Prototypes for the allocation trace
+ *
+ *
+ */
+
+//*****************************************************************************
+//
+// heaptrace.h - Prototypes for the allocation trace
+//
+//*****************************************************************************
+
+#ifndef HEAPTRACE_H_
+#define HEAPTRACE_H_
+
+#include <stddef.h>
+
+#include "FreeRTOS.h"
+#include "setup.h"
+
+//*****************************************************************************
+//
+/// Number of calls kept in the RAM ring, must be a power of two
+//
+//*****************************************************************************
+#define HEAP_TRACE_RING_SIZE	256
+
+//*****************************************************************************
+//
+/// Number of tasks whose names are kept for the dump
+//
+//*****************************************************************************
+#define HEAP_TRACE_MAX_TASKS	16
+
+//*****************************************************************************
+//
+/// Maximum number of calls written to the UART on every drain cycle
+//
+//*****************************************************************************
+#define HEAP_TRACE_DRAIN_BATCH	16
+
+//*****************************************************************************
+//
+/// Path served by the webserver with a snapshot of the ring
+//
+//*****************************************************************************
+#define HEAP_TRACE_HTTP_FILE	"httpd-fs/heaptrace.bin"
+
+//*****************************************************************************
+//
+/// Magic number at the start of every dump ("HEAP")
+//
+//*****************************************************************************
+#define HEAP_TRACE_MAGIC		0x50414548UL
+
+//*****************************************************************************
+//
+// Types of the recorded calls
+//
+//*****************************************************************************
+#define HEAP_TRACE_MALLOC		0	///< pvPortMalloc() returned a block
+#define HEAP_TRACE_FREE			1	///< vPortFree()
+#define HEAP_TRACE_FAILED		2	///< pvPortMalloc() returned NULL
+
+/// task index of calls made before the scheduler has a task
+#define HEAP_TRACE_NO_TASK		0xFF
+
+/**
+ * One call of pvPortMalloc() or vPortFree().
+ *
+ * The caller is the return address, tools/heaptrace.py looks the function
+ * up in the .axf or map file.
+ */
+typedef struct
+{
+	unsigned long ulTime;				///< tick count (ms)
+	void *pvAddress;					///< returned or freed block
+	void *pvCaller;						///< return address of the call
+	unsigned short usSeq;				///< sequence number of the call
+	unsigned short usSize;				///< requested or freed bytes
+	unsigned char ucType;				///< HEAP_TRACE_*
+	unsigned char ucTask;				///< index in the task table
+	unsigned short usReserved;
+} tHeapTraceEvent;
+
+/**
+ * A task which called the heap, the index is used in the events
+ */
+typedef struct
+{
+	void *pvHandle;						///< task handle
+	char pcName[configMAX_TASK_NAME_LEN];	///< name of the task
+} tHeapTraceTask;
+
+/**
+ * Header of the HTTP snapshot, followed by the task table and the ring
+ */
+typedef struct
+{
+	unsigned long ulMagic;				///< HEAP_TRACE_MAGIC
+	unsigned long ulHead;				///< number of calls recorded so far
+	unsigned long ulLost;				///< calls overwritten before draining
+	unsigned short usRingSize;			///< HEAP_TRACE_RING_SIZE
+	unsigned short usEventSize;			///< sizeof(tHeapTraceEvent)
+	unsigned short usTasks;				///< HEAP_TRACE_MAX_TASKS
+	unsigned short usTaskSize;			///< sizeof(tHeapTraceTask)
+} tHeapTraceHeader;
+
+/**
+ * Records one call, called by the heap with the scheduler suspended
+ */
+void vHeapTraceRecord(unsigned char ucType, void *pvAddress, size_t xSize,
+		void *pvCaller);
+
+/**
+ * Writes up to ulMax pending calls to the UART
+ */
+unsigned long ulHeapTraceDrain(unsigned long ulMax);
+
+/**
+ * Returns a pointer to the header, task table and ring (for the webserver)
+ */
+char* pcHeapTraceSnapshot(int *piLen);
+
+#endif
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
@@ -21,6 +21,7 @@
 /* FreeRTOS includes. */
 #include "FreeRTOS.h"
 #include "task.h"
+#include "semphr.h"
 
 /* FatFs includes */
 #include "lmi_fs.h"
@@ -31,7 +32,11 @@
 
 #include "setup.h"
 
-char buf[128], time_buf[30];
+/// length of one log line
+#define LOG_LINE_LEN	128
+
+/// serializes the writes to log_file, FatFs only protects the volume
+static xSemaphoreHandle xLogMutex = NULL;
 
 /**
  Opens the log file (path defined as LOG_FILE_PATH) and
@@ -47,11 +52,12 @@ FRESULT initLog()
 	FRESULT rc = FR_NO_FILE;
 	log_file = (FIL*) pvPortMalloc(sizeof(FIL));
 
-	vTaskSuspendAll();
-
-	fs_enable(400000);
+	if (xLogMutex == NULL)
+	{
+		xLogMutex = xSemaphoreCreateMutex();
+	}
 
-	if (log_file != NULL)
+	if (log_file != NULL && xLogMutex != NULL)
 	{
 #if DEBUG_LOG
 		printf("Opening file, memory OK \n");
@@ -63,8 +69,6 @@ FRESULT initLog()
 		f_lseek(log_file, log_file->fsize);
 	}
 
-	xTaskResumeAll();
-
 	return rc;
 #else
 	return -1;
@@ -87,6 +91,12 @@ FRESULT appendToLog(char *msg)
 #if ENABLE_LOG
 	FRESULT rc = FR_NO_FILE;
 	unsigned int bw, i = 0;
+	char buf[LOG_LINE_LEN], time_buf[30];
+
+	if (log_file == NULL || xLogMutex == NULL)
+	{
+		return rc;
+	}
 
 	buf[0] = 0;
 	time_buf[0] = 0;
@@ -95,10 +105,11 @@ FRESULT appendToLog(char *msg)
 	i = strlen(time_buf);
 	time_buf[i-1] = 0;
 
-	// suspend all other tasks
-	vTaskSuspendAll();
+	snprintf(buf, LOG_LINE_LEN - 1, "%s : %s\n", time_buf, msg);
+
+	// only one task may append to the file at a time
+	xSemaphoreTake(xLogMutex, portMAX_DELAY);
 
-	snprintf(buf, 127, "%s : %s\n", time_buf, msg);
 	rc = f_write(log_file, buf, strlen(buf), &bw);
 
 	if (rc == FR_OK)
@@ -109,8 +120,7 @@ FRESULT appendToLog(char *msg)
 		f_sync(log_file);
 	}
 
-	// resumes all tasks
-	xTaskResumeAll();
+	xSemaphoreGive(xLogMutex);
 
 	return rc;
 #else
@@ -0,0 +1,593 @@
+/**
+ * \addtogroup logging
+ * @{
+ *
+ * \author Anziner, Hahn
+ * \brief Runtime statistics
+ *
+ * Samples the CPU share and the stack high water mark of every task, the
+ * free heap (now and the minimum since the start), its fragmentation and
+ * the depth of the queues. The samples are served as JSON (STATS_HTTP_FILE)
+ * and printed to the UART every STATS_UART_PERIOD s, to size the stacks and
+ * find the tasks which use the CPU. The allocations per call site of the
+ * heap are served as JSON too (STATS_SITES_HTTP_FILE). The counters of the
+ * Ethernet input task show the frames per wakeup and the drops. The TCP
+ * pcbs in TIME_WAIT, the pcbs taken back by lwIP and the SYNs it dropped
+ * show if the pcbs run out, the webserver counters who closed the
+ * connections and the connections per second of the last window.
+ *
+ * The run time counters come from the 20 kHz timer (timer.c). FreeRTOS
+ * only gives them as text, vTaskList and vTaskGetRunTimeStats are parsed
+ * into the task table.
+ *
+ */
+
+//*****************************************************************************
+//
+// stats.c - Runtime statistics
+//
+//*****************************************************************************
+
+/* std lib includes */
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+#include "log/stats.h"
+#include "ethernet/LWIPStack.h"
+#include "ethernet/httpd/httpd.h"
+#include "lmi_fs.h"
+#include "log/trace.h"
+
+#include "queueConfig.h"
+#include "setup.h"
+
+static tStatsTask xStatsTasks[STATS_MAX_TASKS];
+
+/** run time counter of the timer at the last sample */
+static unsigned long ulStatsRunTime = 0;
+
+/** heap and queues at the last sample */
+static xHeapStats xStatsHeap;
+static unsigned portBASE_TYPE uxStatsComQueue, uxStatsHttpdQueue;
+
+/** Ethernet input task at the last sample */
+static tEthRxStats xStatsEthRx;
+
+/** per received KB in the last window: cycles reading the FIFO and in the stack */
+static unsigned long ulStatsRxReadPerKB, ulStatsRxStackPerKB;
+
+/** pbufs per received frame in the last window, in 1/10 */
+static unsigned short usStatsRxChain;
+
+/** TCP pcbs and webserver connections at the last sample */
+static tTcpStats xStatsTcp;
+static tHttpdStats xStatsHttpd;
+
+/** connections accepted by the webserver per second in the last window */
+static unsigned long ulStatsConnPerSec;
+
+#if configMAX_TASK_NAME_LEN > 12
+#error "STATS_TEXT_LEN allows task names of 11 characters"
+#endif
+static char pcStatsText[STATS_TEXT_LEN];
+static char pcStatsJsonBuf[STATS_JSON_LEN];
+
+/** copy of the last sample which pcStatsJson formats outside the lock */
+typedef struct
+{
+	tStatsTask xTasks[STATS_MAX_TASKS];
+	xHeapStats xHeap;
+	unsigned short usFragmentation;
+	unsigned portBASE_TYPE uxComQueue, uxHttpdQueue;
+	tEthRxStats xEthRx;
+	unsigned short usRxChain;
+	unsigned long ulRxReadPerKB, ulRxStackPerKB;
+	tTcpStats xTcp;
+	tHttpdStats xHttpd;
+	unsigned long ulConnPerSec;
+	portTickType xTicks;
+	unsigned long ulLockMaxCycles;
+} tStatsJsonSample;
+
+static tStatsJsonSample xStatsJsonSample;
+static char pcStatsSitesBuf[STATS_SITES_JSON_LEN];
+
+/**
+ * Returns the next field of a line of vTaskList or vTaskGetRunTimeStats,
+ * the fields are separated by tabs. The field is terminated in the buffer.
+ *
+ * @param ppcText current position, moved behind the field
+ * @return the field, "" at the end of the line
+ */
+static char* pcStatsField(char **ppcText)
+{
+	char *pcField, *pcEnd;
+
+	pcField = *ppcText;
+	while (*pcField == '\t')
+	{
+		pcField++;
+	}
+
+	pcEnd = pcField;
+	while (*pcEnd && *pcEnd != '\t' && *pcEnd != '\r' && *pcEnd != '\n')
+	{
+		pcEnd++;
+	}
+
+	*ppcText = pcEnd;
+	if (*pcEnd == '\t')
+	{
+		*pcEnd = 0;
+		*ppcText = pcEnd + 1;
+	}
+
+	return pcField;
+}
+
+/**
+ * Returns the next line of the text and terminates it, NULL at the end
+ */
+static char* pcStatsLine(char **ppcText)
+{
+	char *pcLine, *pcEnd;
+
+	pcLine = *ppcText;
+	while (*pcLine == '\r' || *pcLine == '\n')
+	{
+		pcLine++;
+	}
+	if (*pcLine == 0)
+	{
+		return NULL;
+	}
+
+	pcEnd = pcLine;
+	while (*pcEnd && *pcEnd != '\r' && *pcEnd != '\n')
+	{
+		pcEnd++;
+	}
+
+	*ppcText = pcEnd;
+	if (*pcEnd)
+	{
+		*pcEnd = 0;
+		*ppcText = pcEnd + 1;
+	}
+
+	return pcLine;
+}
+
+/**
+ * Returns the table entry of a task, a free entry if the task is new. NULL
+ * if the table is full.
+ */
+static tStatsTask* pxStatsTask(const char *pcName)
+{
+	tStatsTask *pxFree = NULL;
+	int i;
+
+	for (i = 0; i < STATS_MAX_TASKS; i++)
+	{
+		if (xStatsTasks[i].pcName[0] == 0)
+		{
+			if (pxFree == NULL)
+			{
+				pxFree = &xStatsTasks[i];
+			}
+		}
+		else if (strcmp(xStatsTasks[i].pcName, pcName) == 0)
+		{
+			return &xStatsTasks[i];
+		}
+	}
+
+	if (pxFree != NULL)
+	{
+		memset(pxFree, 0, sizeof(tStatsTask));
+		strncpy(pxFree->pcName, pcName, configMAX_TASK_NAME_LEN - 1);
+	}
+
+	return pxFree;
+}
+
+/**
+ * Share of ulPart in ulTotal in 0.1 %
+ */
+static unsigned short usStatsPermille(unsigned long ulPart,
+		unsigned long ulTotal)
+{
+	if (ulTotal == 0)
+	{
+		return 0;
+	}
+
+	return (unsigned short) (((unsigned long long) ulPart * 1000) / ulTotal);
+}
+
+/**
+ * Fragmentation of the free heap in 0.1 %: the part which can't be
+ * allocated in one piece
+ */
+static unsigned short usStatsFragmentation(void)
+{
+	if (xStatsHeap.xFreeBytes == 0)
+	{
+		return 0;
+	}
+
+	return 1000 - usStatsPermille(xStatsHeap.xLargestFreeBlock,
+			xStatsHeap.xFreeBytes);
+}
+
+/**
+ * Samples the tasks: state and stack from vTaskList, the run time from
+ * vTaskGetRunTimeStats. The CPU share of the last window is the difference
+ * to the previous sample. Called with the scheduler suspended.
+ */
+static void vStatsSampleTasks(void)
+{
+	tStatsTask *pxTask;
+	char *pcText, *pcLine, *pcName, *pcState;
+	unsigned long ulRunTime, ulWindow, ulTask;
+	int i;
+
+	for (i = 0; i < STATS_MAX_TASKS; i++)
+	{
+		xStatsTasks[i].bSeen = false;
+	}
+
+	//
+	// "name\t\tstate\tpriority\tstack\tnumber\r\n"
+	//
+	vTaskList((signed char *) pcStatsText);
+	pcText = pcStatsText;
+	while ((pcLine = pcStatsLine(&pcText)) != NULL)
+	{
+		pcName = pcStatsField(&pcLine);
+		pcState = pcStatsField(&pcLine);
+		pxTask = pxStatsTask(pcName);
+		if (pxTask == NULL)
+		{
+			continue;
+		}
+		pxTask->bSeen = true;
+		pxTask->cState = pcState[0];
+		pxTask->ucPriority = atoi(pcStatsField(&pcLine));
+		pxTask->usStackFree = atoi(pcStatsField(&pcLine));
+	}
+
+	//
+	// "name\t\tcounter\t\tpercent\r\n", the total is read first like
+	// vTaskGetRunTimeStats does
+	//
+	ulRunTime = portGET_RUN_TIME_COUNTER_VALUE();
+	ulWindow = ulRunTime - ulStatsRunTime;
+	vTaskGetRunTimeStats((signed char *) pcStatsText);
+	pcText = pcStatsText;
+	while ((pcLine = pcStatsLine(&pcText)) != NULL)
+	{
+		pcName = pcStatsField(&pcLine);
+		pxTask = pxStatsTask(pcName);
+		if (pxTask == NULL)
+		{
+			continue;
+		}
+		ulTask = strtoul(pcStatsField(&pcLine), NULL, 10);
+		pxTask->usCpu = usStatsPermille(ulTask - pxTask->ulRunTime, ulWindow);
+		pxTask->usCpuTotal = usStatsPermille(ulTask, ulRunTime);
+		pxTask->ulRunTime = ulTask;
+	}
+	ulStatsRunTime = ulRunTime;
+
+	//
+	// deleted tasks leave the table
+	//
+	for (i = 0; i < STATS_MAX_TASKS; i++)
+	{
+		if (!xStatsTasks[i].bSeen)
+		{
+			xStatsTasks[i].pcName[0] = 0;
+		}
+	}
+}
+
+/**
+ * Takes a sample of the tasks, the heap, the queues and the network
+ */
+void vStatsSample(void)
+{
+	unsigned long ulFrames, ulKBytes;
+	tEthRxStats xEthRx;
+	unsigned long ulAccepted;
+
+	vTraceSuspendAll();
+
+	//
+	// vTaskList writes a line per task without a limit, pcStatsText has
+	// room for STATS_MAX_TASKS, with more the tasks keep the last sample
+	//
+	if (uxTaskGetNumberOfTasks() <= STATS_MAX_TASKS)
+	{
+		vStatsSampleTasks();
+	}
+
+	vPortGetHeapStats(&xStatsHeap);
+	uxStatsComQueue = xComQueue ? uxQueueMessagesWaiting(xComQueue) : 0;
+	uxStatsHttpdQueue = xHttpdQueue ? uxQueueMessagesWaiting(xHttpdQueue) : 0;
+
+	vTraceResumeAll();
+
+	xEthRx = xStatsEthRx;
+	LWIPServiceTaskRxStats(&xStatsEthRx);
+
+	//
+	// chain length and CPU per received KB since the last sample
+	//
+	ulFrames = xStatsEthRx.ulFrames - xEthRx.ulFrames;
+	ulKBytes = (xStatsEthRx.ulBytes - xEthRx.ulBytes) / 1024;
+	usStatsRxChain = ulFrames ? (unsigned short) ((xStatsEthRx.ulPbufs
+			- xEthRx.ulPbufs) * 10 / ulFrames) : 0;
+	ulStatsRxReadPerKB = ulKBytes ? (xStatsEthRx.ulReadCycles
+			- xEthRx.ulReadCycles) / ulKBytes : 0;
+	ulStatsRxStackPerKB = ulKBytes ? (xStatsEthRx.ulStackCycles
+			- xEthRx.ulStackCycles) / ulKBytes : 0;
+
+	LWIPServiceTaskTcpStats(&xStatsTcp);
+	ulAccepted = xStatsHttpd.ulAccepted;
+	xStatsHttpd = *http_get_stats();
+	ulStatsConnPerSec = (xStatsHttpd.ulAccepted - ulAccepted) * 1000
+			/ STATS_SAMPLE_PERIOD;
+}
+
+/**
+ * Prints the last sample to the UART
+ */
+void vStatsReport(void)
+{
+	int i;
+
+	printf("Stats: heap %d free, %d min free of %d\n",
+			(int) xStatsHeap.xFreeBytes, (int) xStatsHeap.xMinimumEverFreeBytes,
+			(int) configTOTAL_HEAP_SIZE);
+	printf("Stats: heap largest %d, %d free blocks, fragmentation %d.%d%%, "
+		"%d failed\n", (int) xStatsHeap.xLargestFreeBlock,
+			(int) xStatsHeap.ulFreeBlocks, usStatsFragmentation() / 10,
+			usStatsFragmentation() % 10, (int) xStatsHeap.ulFailed);
+	printf("Stats: queues com %d/%d, httpd %d/%d\n", (int) uxStatsComQueue,
+			COM_QUEUE_SIZE, (int) uxStatsHttpdQueue, HTTPD_QUEUE_SIZE);
+	printf("Stats: scheduler locked %d us max\n", (int) (ulTraceMaxLockCycles()
+			/ (configCPU_CLOCK_HZ / 1000000)));
+	printf("Stats: eth rx %d frames in %d wakeups (max %d), %d handoffs, "
+		"%d dropped, %d overflows\n", (int) xStatsEthRx.ulFrames,
+			(int) xStatsEthRx.ulWakeups, (int) xStatsEthRx.ulMaxBatch,
+			(int) xStatsEthRx.ulHandoffs, (int) xStatsEthRx.ulDropped,
+			(int) xStatsEthRx.ulOverflows);
+	printf("Stats: eth rx %d large, %d chained, %d.%d pbufs/frame, "
+		"%d cycles/KB read, %d cycles/KB stack\n", (int) xStatsEthRx.ulLarge,
+			(int) xStatsEthRx.ulChained, usStatsRxChain / 10,
+			usStatsRxChain % 10, (int) ulStatsRxReadPerKB,
+			(int) ulStatsRxStackPerKB);
+	printf("Stats: tcp %d active, %d time_wait (max %d), recycled %d "
+		"time_wait, %d closing, %d active, %d refused\n",
+			(int) xStatsTcp.ulActive, (int) xStatsTcp.ulTimeWait,
+			(int) xStatsTcp.ulTimeWaitMax, (int) xStatsTcp.ulKillTimeWait,
+			(int) xStatsTcp.ulKillClosing, (int) xStatsTcp.ulKillActive,
+			(int) xStatsTcp.ulRefused);
+	printf("Stats: httpd %d conns (%d/s), %d refused, %d requests, %d kept, "
+		"closed by client %d, server %d, idle %d\n",
+			(int) xStatsHttpd.ulAccepted, (int) ulStatsConnPerSec,
+			(int) xStatsHttpd.ulRefused, (int) xStatsHttpd.ulRequests,
+			(int) xStatsHttpd.ulKept, (int) xStatsHttpd.ulClientClosed,
+			(int) xStatsHttpd.ulServerClosed, (int) xStatsHttpd.ulIdleClosed);
+	printf("task\t\tstate\tprio\tstack\tcpu\ttotal\n");
+	for (i = 0; i < STATS_MAX_TASKS; i++)
+	{
+		if (xStatsTasks[i].pcName[0] == 0)
+		{
+			continue;
+		}
+		printf("%s\t\t%c\t%d\t%d\t%d.%d%%\t%d.%d%%\n", xStatsTasks[i].pcName,
+				xStatsTasks[i].cState, xStatsTasks[i].ucPriority,
+				xStatsTasks[i].usStackFree, xStatsTasks[i].usCpu / 10,
+				xStatsTasks[i].usCpu % 10, xStatsTasks[i].usCpuTotal / 10,
+				xStatsTasks[i].usCpuTotal % 10);
+	}
+}
+
+/**
+ * Formats the last sample as JSON. The URI has no extension, so the
+ * webserver sends no headers, they are part of the response. The CPU shares
+ * are in 0.1 %, the free stack in words. The sample is copied under the
+ * lock, the formatting runs with the scheduler going.
+ *
+ * @param piLen returns the length of the response
+ * @return pointer to the response, valid until the next call
+ */
+char* pcStatsJson(int *piLen)
+{
+	tStatsJsonSample *pxS = &xStatsJsonSample;
+	tBoolean bFirst = true;
+	int i, iLen;
+
+	vTraceSuspendAll();
+
+	memcpy(pxS->xTasks, xStatsTasks, sizeof(pxS->xTasks));
+	pxS->xHeap = xStatsHeap;
+	pxS->usFragmentation = usStatsFragmentation();
+	pxS->uxComQueue = uxStatsComQueue;
+	pxS->uxHttpdQueue = uxStatsHttpdQueue;
+	pxS->xEthRx = xStatsEthRx;
+	pxS->usRxChain = usStatsRxChain;
+	pxS->ulRxReadPerKB = ulStatsRxReadPerKB;
+	pxS->ulRxStackPerKB = ulStatsRxStackPerKB;
+	pxS->xTcp = xStatsTcp;
+	pxS->xHttpd = xStatsHttpd;
+	pxS->ulConnPerSec = ulStatsConnPerSec;
+	pxS->xTicks = xTaskGetTickCount();
+	pxS->ulLockMaxCycles = ulTraceMaxLockCycles();
+
+	vTraceResumeAll();
+
+	iLen = snprintf(pcStatsJsonBuf, STATS_JSON_LEN, FS_HTTP_JSON_HEADER
+		"{\"uptime\":%d,\"sched_lock_max_us\":%d,"
+		"\"heap\":{\"size\":%d,\"free\":%d,\"min_free\":%d,",
+			(int) (pxS->xTicks / (1000 / portTICK_RATE_MS)),
+			(int) (pxS->ulLockMaxCycles / (configCPU_CLOCK_HZ / 1000000)),
+			(int) configTOTAL_HEAP_SIZE, (int) pxS->xHeap.xFreeBytes,
+			(int) pxS->xHeap.xMinimumEverFreeBytes);
+	iLen += snprintf(pcStatsJsonBuf + iLen, STATS_JSON_LEN - iLen,
+			"\"largest\":%d,\"free_blocks\":%d,\"used_blocks\":%d,"
+			"\"failed\":%d,\"fragmentation\":%d},",
+			(int) pxS->xHeap.xLargestFreeBlock, (int) pxS->xHeap.ulFreeBlocks,
+			(int) pxS->xHeap.ulUsedBlocks, (int) pxS->xHeap.ulFailed,
+			pxS->usFragmentation);
+	iLen += snprintf(pcStatsJsonBuf + iLen, STATS_JSON_LEN - iLen,
+			"\"queues\":{\"com\":{\"used\":%d,\"size\":%d},"
+			"\"httpd\":{\"used\":%d,\"size\":%d}},",
+			(int) pxS->uxComQueue, COM_QUEUE_SIZE, (int) pxS->uxHttpdQueue,
+			HTTPD_QUEUE_SIZE);
+	iLen += snprintf(pcStatsJsonBuf + iLen, STATS_JSON_LEN - iLen,
+			"\"eth_rx\":{\"wakeups\":%d,\"frames\":%d,\"max_batch\":%d,"
+			"\"handoffs\":%d,\"dropped\":%d,\"overflows\":%d,"
+			"\"large\":%d,\"chained\":%d,\"chain\":%d,\"read_per_kb\":%d,"
+			"\"stack_per_kb\":%d},",
+			(int) pxS->xEthRx.ulWakeups, (int) pxS->xEthRx.ulFrames,
+			(int) pxS->xEthRx.ulMaxBatch, (int) pxS->xEthRx.ulHandoffs,
+			(int) pxS->xEthRx.ulDropped, (int) pxS->xEthRx.ulOverflows,
+			(int) pxS->xEthRx.ulLarge, (int) pxS->xEthRx.ulChained,
+			(int) pxS->usRxChain, (int) pxS->ulRxReadPerKB,
+			(int) pxS->ulRxStackPerKB);
+	iLen += snprintf(pcStatsJsonBuf + iLen, STATS_JSON_LEN - iLen,
+			"\"tcp\":{\"active\":%d,\"time_wait\":%d,\"time_wait_max\":%d,"
+			"\"recycled_time_wait\":%d,\"recycled_closing\":%d,"
+			"\"aborted\":%d,\"refused\":%d},",
+			(int) pxS->xTcp.ulActive, (int) pxS->xTcp.ulTimeWait,
+			(int) pxS->xTcp.ulTimeWaitMax, (int) pxS->xTcp.ulKillTimeWait,
+			(int) pxS->xTcp.ulKillClosing, (int) pxS->xTcp.ulKillActive,
+			(int) pxS->xTcp.ulRefused);
+	iLen += snprintf(pcStatsJsonBuf + iLen, STATS_JSON_LEN - iLen,
+			"\"httpd\":{\"conns\":%d,\"conns_per_s\":%d,\"refused\":%d,"
+			"\"requests\":%d,\"kept\":%d,\"client_closed\":%d,"
+			"\"server_closed\":%d,\"idle_closed\":%d},\"tasks\":[",
+			(int) pxS->xHttpd.ulAccepted, (int) pxS->ulConnPerSec,
+			(int) pxS->xHttpd.ulRefused, (int) pxS->xHttpd.ulRequests,
+			(int) pxS->xHttpd.ulKept, (int) pxS->xHttpd.ulClientClosed,
+			(int) pxS->xHttpd.ulServerClosed, (int) pxS->xHttpd.ulIdleClosed);
+
+	//
+	// a task takes less than 112 characters, the rest stays for the end
+	//
+	for (i = 0; i < STATS_MAX_TASKS && iLen < STATS_JSON_LEN - 112; i++)
+	{
+		if (pxS->xTasks[i].pcName[0] == 0)
+		{
+			continue;
+		}
+		iLen += snprintf(pcStatsJsonBuf + iLen, STATS_JSON_LEN - iLen,
+				"%s{\"name\":\"%s\",\"state\":\"%c\",\"prio\":%d,"
+				"\"stack_free\":%d,\"cpu\":%d,\"cpu_total\":%d}",
+				bFirst ? "" : ",", pxS->xTasks[i].pcName,
+				pxS->xTasks[i].cState, pxS->xTasks[i].ucPriority,
+				pxS->xTasks[i].usStackFree, pxS->xTasks[i].usCpu,
+				pxS->xTasks[i].usCpuTotal);
+		bFirst = false;
+	}
+
+	iLen += snprintf(pcStatsJsonBuf + iLen, STATS_JSON_LEN - iLen, "]}\n");
+
+	*piLen = iLen;
+	return pcStatsJsonBuf;
+}
+
+/**
+ * Formats the allocations per call site of the heap as JSON. The caller is
+ * the return address of pvPortMalloc(), 0 collects the sites which didn't
+ * fit into the table. The bytes include the block headers. Every site is
+ * copied under the lock on its own, the formatting runs outside.
+ *
+ * @param piLen returns the length of the response
+ * @return pointer to the response, valid until the next call
+ */
+char* pcStatsSitesJson(int *piLen)
+{
+	const xHeapSite *pxSites;
+	xHeapSite xSite;
+	unsigned portBASE_TYPE uxSites, ux;
+	tBoolean bFirst = true;
+	int iLen;
+
+	pxSites = pxPortGetHeapSites(&uxSites);
+
+	iLen = snprintf(pcStatsSitesBuf, STATS_SITES_JSON_LEN, FS_HTTP_JSON_HEADER
+		"{\"sites\":[");
+
+	//
+	// a site takes less than 112 characters, the rest stays for the end
+	//
+	for (ux = 0; ux < uxSites && iLen < STATS_SITES_JSON_LEN - 112; ux++)
+	{
+		vTraceSuspendAll();
+		xSite = pxSites[ux];
+		vTraceResumeAll();
+
+		if (xSite.ulAllocations == 0 && xSite.ulFailed == 0)
+		{
+			continue;
+		}
+		iLen += snprintf(pcStatsSitesBuf + iLen, STATS_SITES_JSON_LEN - iLen,
+				"%s{\"caller\":\"0x%08x\",\"allocs\":%d,\"frees\":%d,"
+				"\"failed\":%d,\"bytes\":%d,\"peak\":%d}", bFirst ? "" : ",",
+				(unsigned int) xSite.pvCaller,
+				(int) xSite.ulAllocations, (int) xSite.ulFrees,
+				(int) xSite.ulFailed, (int) xSite.xBytes,
+				(int) xSite.xPeakBytes);
+		bFirst = false;
+	}
+
+	iLen += snprintf(pcStatsSitesBuf + iLen, STATS_SITES_JSON_LEN - iLen,
+			"]}\n");
+
+	*piLen = iLen;
+	return pcStatsSitesBuf;
+}
+
+/**
+ * Samples the statistics every STATS_SAMPLE_PERIOD ms and prints them every
+ * STATS_UART_PERIOD s
+ */
+void vStatsTask(void *pvParameters)
+{
+	portTickType xLastWakeTime = xTaskGetTickCount();
+#if STATS_UART_PERIOD
+	int iReport = 0;
+#endif
+
+	for (;;)
+	{
+		vStatsSample();
+
+#if STATS_UART_PERIOD
+		if (++iReport >= STATS_UART_PERIOD * 1000 / STATS_SAMPLE_PERIOD)
+		{
+			iReport = 0;
+			vStatsReport();
+		}
+#endif
+
+		vTaskDelayUntil(&xLastWakeTime, STATS_SAMPLE_PERIOD / portTICK_RATE_MS);
+	}
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
@@ -0,0 +1,123 @@
+/**
+ * \addtogroup logging
+ * @{
+ *
+ * \author Anziner, Hahn
+ * \brief Prototypes for the runtime statistics
+ *
+ *
+ */
+
+//*****************************************************************************
+//
+// stats.h - Prototypes for the runtime statistics
+//
+//*****************************************************************************
+
+#ifndef STATS_H_
+#define STATS_H_
+
+#include "FreeRTOS.h"
+#include "hw_types.h"
+
+//*****************************************************************************
+//
+/// Maximum number of tasks in the table, further tasks are not shown
+//
+//*****************************************************************************
+#define STATS_MAX_TASKS			12
+
+//*****************************************************************************
+//
+/// Size of the buffer for the text of vTaskList and vTaskGetRunTimeStats,
+/// a line takes at most 44 characters (11 of the name, configMAX_TASK_NAME_LEN
+/// is 12, and three 32 bit numbers), plus the leading CR LF and the 0
+//
+//*****************************************************************************
+#define STATS_TEXT_LEN			(STATS_MAX_TASKS * 44 + 3)
+
+//*****************************************************************************
+//
+/// Size of the buffer for the JSON report
+//
+//*****************************************************************************
+#define STATS_JSON_LEN			2560
+
+//*****************************************************************************
+//
+/// Time between two samples in ms, the CPU share is measured over this window
+//
+//*****************************************************************************
+#define STATS_SAMPLE_PERIOD		1000
+
+//*****************************************************************************
+//
+/// Path served by the webserver with the statistics as JSON
+//
+//*****************************************************************************
+#define STATS_HTTP_FILE			"httpd-fs/api/stats"
+
+//*****************************************************************************
+//
+/// Size of the buffer for the JSON report of the heap call sites
+//
+//*****************************************************************************
+#define STATS_SITES_JSON_LEN	2560
+
+//*****************************************************************************
+//
+/// Path served by the webserver with the heap call sites as JSON
+//
+//*****************************************************************************
+#define STATS_SITES_HTTP_FILE	"httpd-fs/api/heap"
+
+/**
+ * Statistics of one task
+ */
+typedef struct
+{
+	char pcName[configMAX_TASK_NAME_LEN]; ///< pcName[0] == 0: unused
+	char cState; ///< R(eady), B(locked), S(uspended) or D(eleted)
+	unsigned char ucPriority;
+	unsigned short usStackFree; ///< stack high water mark in words
+	unsigned long ulRunTime; ///< run time counter at the last sample
+	unsigned short usCpu; ///< CPU share of the last window in 0.1 %
+	unsigned short usCpuTotal; ///< CPU share since the start in 0.1 %
+	tBoolean bSeen; ///< found in the current sample
+} tStatsTask;
+
+/**
+ * Takes a sample of the task, heap and queue statistics
+ */
+void vStatsSample(void);
+
+/**
+ * Prints the last sample to the UART
+ */
+void vStatsReport(void);
+
+/**
+ * Formats the last sample as JSON response (for the webserver)
+ */
+char* pcStatsJson(int *piLen);
+
+/**
+ * Formats the allocations per call site of the heap as JSON response (for
+ * the webserver)
+ */
+char* pcStatsSitesJson(int *piLen);
+
+/**
+ * Task which samples the statistics every STATS_SAMPLE_PERIOD ms and prints
+ * them every STATS_UART_PERIOD s
+ */
+void vStatsTask(void *pvParameters);
+
+#endif
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
@@ -0,0 +1,393 @@
+/**
+ * \addtogroup logging
+ * @{
+ *
+ * \author Anziner, Hahn
+ * \brief Deferred binary trace
+ *
+ * Instead of formatting messages on the target (which costs milliseconds
+ * of UART time in the hot path), only the address of the format string,
+ * a timestamp and the raw argument words are stored into a RAM ring.
+ * The ring is drained in the background by vTraceTask (UART or SD Card)
+ * and can be fetched over HTTP (TRACE_HTTP_FILE). The text is rebuilt on
+ * the host with tools/tracedecode.py and the .axf file.
+ *
+ */
+
+//*****************************************************************************
+//
+// trace.c - Deferred binary trace
+//
+//*****************************************************************************
+
+/* std lib includes */
+#include <string.h>
+#include <stdio.h>
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* FatFs includes */
+#include "lmi_fs.h"
+#include "fatfs/ff.h"
+
+#include "uart/uartstdio.h"
+#include "log/trace.h"
+#include "log/heaptrace.h"
+
+#include "setup.h"
+
+//*****************************************************************************
+//
+// Cortex-M3 debug registers for the cycle counter
+//
+//*****************************************************************************
+#define TRACE_DEMCR				(*((volatile unsigned long *) 0xE000EDFC))
+#define TRACE_DWT_CTRL			(*((volatile unsigned long *) 0xE0001000))
+#define TRACE_DWT_CYCCNT		(*((volatile unsigned long *) 0xE0001004))
+
+#define TRACE_DEMCR_TRCENA		0x01000000
+#define TRACE_DWT_CYCCNTENA		0x00000001
+
+/**
+ * Header and event ring, kept in one block so that the webserver can send
+ * it without copying.
+ */
+static struct
+{
+	tTraceHeader xHeader;
+	tTraceEvent xEvents[TRACE_RING_SIZE];
+} g_sTrace;
+
+/** number of events already written to the sink */
+static unsigned long ulTraceTail = 0;
+
+/** nesting depth and start time of the current scheduler lock */
+static unsigned long ulLockDepth = 0;
+static unsigned long ulLockStart = 0;
+
+/** longest scheduler lock in CPU cycles */
+static unsigned long ulLockMax = 0;
+
+#if ENABLE_TRACE && (TRACE_SINK == TRACE_SINK_SD)
+static FIL xTraceFile;
+static int iTraceFileOpen = 0;
+#endif
+
+/**
+ * Masks all interrupts and returns the previous PRIMASK, usable from
+ * tasks and ISRs.
+ */
+static unsigned long ulTraceLock(void)
+{
+	unsigned long ulState;
+
+	__asm volatile ("mrs %0, primask\n"
+			"cpsid i" : "=r" (ulState) :: "memory");
+
+	return ulState;
+}
+
+/**
+ * Restores the PRIMASK saved by ulTraceLock()
+ */
+static void vTraceUnlock(unsigned long ulState)
+{
+	__asm volatile ("msr primask, %0" :: "r" (ulState) : "memory");
+}
+
+/**
+ * Starts the cycle counter used for the timestamps and initializes the
+ * ring header
+ */
+void vTraceInit(void)
+{
+	TRACE_DEMCR |= TRACE_DEMCR_TRCENA;
+	TRACE_DWT_CYCCNT = 0;
+	TRACE_DWT_CTRL |= TRACE_DWT_CYCCNTENA;
+
+	g_sTrace.xHeader.ulMagic = TRACE_MAGIC;
+	g_sTrace.xHeader.ulHead = 0;
+	g_sTrace.xHeader.ulLost = 0;
+	g_sTrace.xHeader.usRingSize = TRACE_RING_SIZE;
+	g_sTrace.xHeader.usEventSize = sizeof(tTraceEvent);
+}
+
+/**
+ * Reserves the next slot in the ring and fills in the common fields.
+ * Must be called with interrupts masked.
+ */
+static tTraceEvent* pxTraceReserve(const char *pcFormat, unsigned char ucArgs,
+		unsigned char ucFlags)
+{
+	tTraceEvent *pxEvent;
+
+	pxEvent = &g_sTrace.xEvents[g_sTrace.xHeader.ulHead & (TRACE_RING_SIZE - 1)];
+	pxEvent->pcFormat = pcFormat;
+	pxEvent->ulTime = TRACE_DWT_CYCCNT;
+	pxEvent->usSeq = (unsigned short) g_sTrace.xHeader.ulHead;
+	pxEvent->ucArgs = ucArgs;
+	pxEvent->ucFlags = ucFlags;
+
+	g_sTrace.xHeader.ulHead++;
+
+	return pxEvent;
+}
+
+/**
+ * Records one event with up to TRACE_MAX_ARGS argument words.
+ * Use the TRACEx macros instead of calling this function directly, the
+ * format string has to be a string literal (it's resolved on the host).
+ *
+ * @param pcFormat printf format string (literal)
+ * @param ucArgs number of used argument words
+ * @param ulArg0 .. ulArg3 argument words
+ */
+void vTraceEvent(const char *pcFormat, unsigned char ucArgs,
+		unsigned long ulArg0, unsigned long ulArg1, unsigned long ulArg2,
+		unsigned long ulArg3)
+{
+	tTraceEvent *pxEvent;
+	unsigned long ulState;
+
+	ulState = ulTraceLock();
+
+	pxEvent = pxTraceReserve(pcFormat, ucArgs, 0);
+	pxEvent->ulArg[0] = ulArg0;
+	pxEvent->ulArg[1] = ulArg1;
+	pxEvent->ulArg[2] = ulArg2;
+	pxEvent->ulArg[3] = ulArg3;
+
+	vTraceUnlock(ulState);
+}
+
+/**
+ * Records one event with a copy of a string (e.g. an URI in a RAM buffer).
+ * The string is truncated to the argument words not used by numbers.
+ *
+ * @param pcFormat printf format string (literal), the first %s is the string
+ * @param pcString string to copy
+ * @param ucArgs number of numeric arguments (0 or 1)
+ * @param ulArg0 numeric argument
+ */
+void vTraceString(const char *pcFormat, const char *pcString,
+		unsigned char ucArgs, unsigned long ulArg0)
+{
+	tTraceEvent *pxEvent;
+	unsigned long ulState;
+	char *pcDst;
+	int iLen, i;
+
+	ulState = ulTraceLock();
+
+	pxEvent = pxTraceReserve(pcFormat, ucArgs, TRACE_FLAG_STRING);
+	pxEvent->ulArg[0] = ulArg0;
+
+	//
+	// copy the string behind the numeric arguments, a full slot is not
+	// terminated
+	//
+	pcDst = (char *) &pxEvent->ulArg[ucArgs];
+	iLen = (TRACE_MAX_ARGS - ucArgs) * sizeof(unsigned long);
+
+	for (i = 0; i < iLen && pcString != NULL && pcString[i] != 0; i++)
+	{
+		pcDst[i] = pcString[i];
+	}
+	if (i < iLen)
+	{
+		pcDst[i] = 0;
+	}
+
+	vTraceUnlock(ulState);
+}
+
+/**
+ * Writes one event to the configured sink
+ */
+static void vTraceWrite(tTraceEvent *pxEvent)
+{
+#if TRACE_SINK == TRACE_SINK_UART
+	UARTprintf("#T %04x %08x %08x %02x%02x %08x %08x %08x %08x\n",
+			pxEvent->usSeq, pxEvent->ulTime, (unsigned long) pxEvent->pcFormat,
+			pxEvent->ucArgs, pxEvent->ucFlags, pxEvent->ulArg[0],
+			pxEvent->ulArg[1], pxEvent->ulArg[2], pxEvent->ulArg[3]);
+#elif TRACE_SINK == TRACE_SINK_SD
+	unsigned int bw;
+	tTraceHeader xHeader;
+
+	//
+	// FatFs is reentrant, the file is only used by the trace task
+	//
+	if (!iTraceFileOpen)
+	{
+		if (f_open(&xTraceFile, TRACE_FILE_PATH, FA_OPEN_ALWAYS | FA_WRITE)
+				== FR_OK)
+		{
+			iTraceFileOpen = 1;
+
+			//
+			// a new file starts with the header, otherwise append
+			//
+			if (xTraceFile.fsize == 0)
+			{
+				xHeader = g_sTrace.xHeader;
+				xHeader.usRingSize = 0;
+				f_write(&xTraceFile, &xHeader, sizeof(xHeader), &bw);
+			}
+			else
+			{
+				f_lseek(&xTraceFile, xTraceFile.fsize);
+			}
+		}
+	}
+
+	if (iTraceFileOpen)
+	{
+		f_write(&xTraceFile, pxEvent, sizeof(tTraceEvent), &bw);
+	}
+#else
+	(void) pxEvent;
+#endif
+}
+
+/**
+ * Writes up to ulMax pending events to the configured sink (TRACE_SINK)
+ *
+ * @param ulMax maximum number of events
+ * @return number of events written
+ */
+unsigned long ulTraceDrain(unsigned long ulMax)
+{
+	tTraceEvent xEvent;
+	unsigned long ulState, ulCount = 0;
+
+	while (ulCount < ulMax)
+	{
+		ulState = ulTraceLock();
+
+		//
+		// events overwritten before we got them are counted as lost
+		//
+		if (g_sTrace.xHeader.ulHead - ulTraceTail > TRACE_RING_SIZE)
+		{
+			g_sTrace.xHeader.ulLost += g_sTrace.xHeader.ulHead - ulTraceTail
+					- TRACE_RING_SIZE;
+			ulTraceTail = g_sTrace.xHeader.ulHead - TRACE_RING_SIZE;
+		}
+
+		if (ulTraceTail == g_sTrace.xHeader.ulHead)
+		{
+			vTraceUnlock(ulState);
+			break;
+		}
+
+		xEvent = g_sTrace.xEvents[ulTraceTail & (TRACE_RING_SIZE - 1)];
+		ulTraceTail++;
+
+		vTraceUnlock(ulState);
+
+		vTraceWrite(&xEvent);
+		ulCount++;
+	}
+
+#if ENABLE_TRACE && (TRACE_SINK == TRACE_SINK_SD)
+	if (ulCount && iTraceFileOpen)
+	{
+		f_sync(&xTraceFile);
+	}
+#endif
+
+	return ulCount;
+}
+
+/**
+ * Returns the header and the ring as one block. The webserver sends it
+ * while new events are recorded, the decoder sorts the events by their
+ * sequence number.
+ *
+ * @param piLen returns the length of the block
+ * @return pointer to the block
+ */
+char* pcTraceSnapshot(int *piLen)
+{
+	*piLen = sizeof(g_sTrace);
+
+	return (char *) &g_sTrace;
+}
+
+/**
+ * Task which drains the ring in the background. It runs with the lowest
+ * priority, so it only gets the CPU if all other tasks are blocked.
+ *
+ * @param pvParameters not used
+ */
+void vTraceTask(void *pvParameters)
+{
+	for (;;)
+	{
+		ulTraceDrain(TRACE_DRAIN_BATCH);
+#if ENABLE_HEAP_TRACE
+		ulHeapTraceDrain(HEAP_TRACE_DRAIN_BATCH);
+#endif
+
+		vTaskDelay(TRACE_DRAIN_DELAY / portTICK_RATE_MS);
+	}
+}
+
+/**
+ * Suspends the scheduler like vTaskSuspendAll() and starts measuring the
+ * lock time. Calls can be nested, the outermost pair is measured.
+ */
+void vTraceSuspendAll(void)
+{
+	vTaskSuspendAll();
+
+	if (ulLockDepth++ == 0)
+	{
+		ulLockStart = TRACE_DWT_CYCCNT;
+	}
+}
+
+/**
+ * Resumes the scheduler like xTaskResumeAll(). A new maximum of the lock
+ * time is recorded as trace event. Without the trace ring nothing is
+ * printed, the heap takes these locks before the UART is set up.
+ */
+void vTraceResumeAll(void)
+{
+	unsigned long ulCycles;
+
+	if (--ulLockDepth == 0)
+	{
+		ulCycles = TRACE_DWT_CYCCNT - ulLockStart;
+		if (ulCycles > ulLockMax)
+		{
+			ulLockMax = ulCycles;
+#if ENABLE_TRACE
+			TRACE1("SCHED: longest lock %u cycles\n", ulCycles);
+#endif
+		}
+	}
+
+	xTaskResumeAll();
+}
+
+/**
+ * Returns the longest time the scheduler was suspended with
+ * vTraceSuspendAll()
+ *
+ * @return lock time in CPU cycles
+ */
+unsigned long ulTraceMaxLockCycles(void)
+{
+	return ulLockMax;
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
@@ -0,0 +1,189 @@
+/**
+ * \addtogroup logging
+ * @{
+ *
+ * \author Anziner, Hahn
+ * \brief Prototypes for the deferred binary trace
+ *
+ *
+ */
+
+//*****************************************************************************
+//
+// trace.h - Prototypes for the deferred binary trace
+//
+//*****************************************************************************
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include "setup.h"
+
+//*****************************************************************************
+//
+/// Number of events kept in the RAM ring, must be a power of two
+//
+//*****************************************************************************
+#define TRACE_RING_SIZE			64
+
+//*****************************************************************************
+//
+/// Maximum number of argument words stored per event
+//
+//*****************************************************************************
+#define TRACE_MAX_ARGS			4
+
+//*****************************************************************************
+//
+/// Maximum number of events written to the sink on every drain cycle
+//
+//*****************************************************************************
+#define TRACE_DRAIN_BATCH		8
+
+//*****************************************************************************
+//
+/// Delay between two drain cycles of the trace task in ms
+//
+//*****************************************************************************
+#define TRACE_DRAIN_DELAY		100
+
+//*****************************************************************************
+//
+/// Path of the binary trace file on the SD Card (TRACE_SINK_SD)
+//
+//*****************************************************************************
+#define TRACE_FILE_PATH			"log/trace.bin"
+
+//*****************************************************************************
+//
+/// Path served by the webserver with a snapshot of the ring
+//
+//*****************************************************************************
+#define TRACE_HTTP_FILE			"httpd-fs/trace.bin"
+
+//*****************************************************************************
+//
+/// Magic number at the beginning of every binary trace dump ("TRCE")
+//
+//*****************************************************************************
+#define TRACE_MAGIC				0x45435254UL
+
+/// Event flag: the argument words behind the numeric arguments hold a string
+#define TRACE_FLAG_STRING		0x01
+
+/// Trace sinks (select one with TRACE_SINK in setup.h)
+#define TRACE_SINK_NONE			0
+#define TRACE_SINK_UART			1
+#define TRACE_SINK_SD			2
+
+/**
+ * One trace event.
+ *
+ * Only the address of the format string is recorded, the host tool
+ * (tools/tracedecode.py) looks the string up in the .axf file.
+ */
+typedef struct
+{
+	const char *pcFormat;				///< address of the format string
+	unsigned long ulTime;				///< cycle counter (DWT_CYCCNT)
+	unsigned short usSeq;				///< sequence number of the event
+	unsigned char ucArgs;				///< number of numeric argument words
+	unsigned char ucFlags;				///< TRACE_FLAG_*
+	unsigned long ulArg[TRACE_MAX_ARGS];	///< raw argument words
+} tTraceEvent;
+
+/**
+ * Header of every binary trace dump (SD file and HTTP snapshot)
+ */
+typedef struct
+{
+	unsigned long ulMagic;				///< TRACE_MAGIC
+	unsigned long ulHead;				///< number of events recorded so far
+	unsigned long ulLost;				///< events overwritten before draining
+	unsigned short usRingSize;			///< TRACE_RING_SIZE (0 for streams)
+	unsigned short usEventSize;			///< sizeof(tTraceEvent)
+} tTraceHeader;
+
+#if ENABLE_TRACE
+
+#define TRACE0(f)				vTraceEvent(f, 0, 0, 0, 0, 0)
+#define TRACE1(f, a)			vTraceEvent(f, 1, (unsigned long)(a), 0, 0, 0)
+#define TRACE2(f, a, b)			vTraceEvent(f, 2, (unsigned long)(a), \
+									(unsigned long)(b), 0, 0)
+#define TRACE3(f, a, b, c)		vTraceEvent(f, 3, (unsigned long)(a), \
+									(unsigned long)(b), (unsigned long)(c), 0)
+#define TRACE4(f, a, b, c, d)	vTraceEvent(f, 4, (unsigned long)(a), \
+									(unsigned long)(b), (unsigned long)(c), \
+									(unsigned long)(d))
+#define TRACE_STR(f, s)			vTraceString(f, s, 0, 0)
+#define TRACE_STR1(f, s, a)		vTraceString(f, s, 1, (unsigned long)(a))
+
+#else
+
+/* without the trace the events are printed immediately, as before */
+#define TRACE0(f)				printf(f)
+#define TRACE1(f, a)			printf(f, a)
+#define TRACE2(f, a, b)			printf(f, a, b)
+#define TRACE3(f, a, b, c)		printf(f, a, b, c)
+#define TRACE4(f, a, b, c, d)	printf(f, a, b, c, d)
+#define TRACE_STR(f, s)			printf(f, s)
+#define TRACE_STR1(f, s, a)		printf(f, s, a)
+
+#endif
+
+/**
+ * Starts the cycle counter used for the timestamps
+ */
+void vTraceInit(void);
+
+/**
+ * Records one event with up to TRACE_MAX_ARGS argument words
+ */
+void vTraceEvent(const char *pcFormat, unsigned char ucArgs,
+		unsigned long ulArg0, unsigned long ulArg1, unsigned long ulArg2,
+		unsigned long ulArg3);
+
+/**
+ * Records one event with a copy of a (RAM) string and up to one number
+ */
+void vTraceString(const char *pcFormat, const char *pcString,
+		unsigned char ucArgs, unsigned long ulArg0);
+
+/**
+ * Writes up to ulMax pending events to the configured sink
+ */
+unsigned long ulTraceDrain(unsigned long ulMax);
+
+/**
+ * Returns a pointer to the header and ring (for the webserver)
+ */
+char* pcTraceSnapshot(int *piLen);
+
+/**
+ * Task which drains the ring in the background
+ */
+void vTraceTask(void *pvParameters);
+
+/**
+ * vTaskSuspendAll() which measures how long the scheduler is locked
+ */
+void vTraceSuspendAll(void);
+
+/**
+ * xTaskResumeAll() counterpart of vTraceSuspendAll()
+ */
+void vTraceResumeAll(void);
+
+/**
+ * Returns the longest scheduler lock in CPU cycles
+ */
+unsigned long ulTraceMaxLockCycles(void);
+
+#endif
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
@@ -33,7 +33,12 @@
 #include "communication/comTask.h"
 #include "ethernet/LWIPStack.h"
 #include "graphic/graphicTask.h"
+#include "graphic/httpc/webClient.h"
 #include "log/logging.h"
+#include "log/trace.h"
+#include "log/boottime.h"
+#include "log/stats.h"
+#include "log/chksumbench.h"
 
 #include "taglib/tags.h"
 
@@ -51,12 +56,19 @@ int main(void)
 	//
 	prvSetupHardware();
 
+	//
+	// start the cycle counter for the trace timestamps
+	//
+	vTraceInit();
+
 	//
 	// start Logging
 	//
+	vBootBegin("log file");
 	UARTprintf("Init log file: Status = %d\n", initLog());
 	appendToLog("Starting Firmware");
 	appendToLog("Universelles Interface von Anzinger Martin und Hahn Florian");
+	vBootEnd("log file");
 
 	//
 	// write welcome text to the debug console
@@ -65,13 +77,24 @@ int main(void)
 	printf("Universelles Interface von Anzinger Martin und Hahn Florian\n");
 	printf("Starting Firmware ...\n");
 
+#if ENABLE_CHKSUM_BENCH
+	vChksumBench();
+#endif
+
 	//
 	// initialize Taglibrary
 	//
 	printf("Initialisiere Taglib ...");
+	vBootBegin("taglib");
 	vInitTagLibrary();
+	vBootEnd("taglib");
 	printf(" done\n");
 
+	//
+	// web client, loads pages for the graphic and the LWIP task
+	//
+	vWebClientInit();
+
 	//
 	// Queue Definition
 	// The main Communication between COMM-, GRAPH and HTTPD Task
@@ -124,9 +147,28 @@ int main(void)
 	printf("ok\n");
 #endif
 
+#if ENABLE_TRACE
+	//
+	// Trace Task, drains the trace ring in the background
+	//
+	printf("Starting Trace Task ... ");
+	xTaskCreate( vTraceTask, (const signed char * const)TRACE_TASK_NAME, TRACE_STACK_SIZE, NULL, TRACE_TASK_PRIORITY, &xTraceTaskHandle );
+	printf("ok\n");
+#endif
+
+#if ENABLE_STATS
+	//
+	// Stats Task, samples the CPU share, stacks, heap and queues
+	//
+	printf("Starting Stats Task ... ");
+	xTaskCreate( vStatsTask, (const signed char * const)STATS_TASK_NAME, STATS_STACK_SIZE, NULL, STATS_TASK_PRIORITY, &xStatsTaskHandle );
+	printf("ok\n");
+#endif
+
 	//
 	// Starting the scheduler.
 	//
+	vBootSchedulerStart();
 	vTaskStartScheduler();
 
 	//
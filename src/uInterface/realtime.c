@@ -70,43 +70,21 @@ void vRealTimeClockTask(void * pvParameters)
  */
 void vSetRealTimeClock(time_t t_new)
 {
+	int addSec = 0;
+
 	//
-	// Suspend all Task (synchronize Tasks)
+	// fetch the Timezone value from the configuration table and transform
+	// it to seconds
 	//
-	vTaskSuspendAll();
-	{
-		int addSec = 0;
-
-		//
-		// Open Config file and fetch the Timezone value
-		//
-		char *configLoad = loadFromConfig(IP_CONFIG_FILE, "TIME_ZONE");
+	addSec = iConfigGetInt("TIME_ZONE", 0) * 3600;
 
-		//
-		// Check if Value is available
-		//
-		if (configLoad != NULL)
-		{
-			//
-			// transform the config value to seconds
-			//
-			addSec = atoi(configLoad) * 3600;
-
-			//
-			// free the configuration file
-			//
-			vPortFree(configLoad);
-		}
-
-		//
-		// set the new systemtime
-		//
-		systemtime = t_new + addSec;
-	}
-	xTaskResumeAll();
 	//
-	// resume all Tasks
+	// set the new systemtime, only the store is protected against the
+	// clock task
 	//
+	taskENTER_CRITICAL();
+	systemtime = t_new + addSec;
+	taskEXIT_CRITICAL();
 }
 
 /**
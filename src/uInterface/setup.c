@@ -25,6 +25,9 @@
 
 #include "drivers/touch.h"
 #include "lmi_fs.h"
+#include "ssiBus.h"
+#include "configuration/configloader.h"
+#include "log/boottime.h"
 
 #include "setup.h"
 #include "uart/uartstdio.h"
@@ -51,9 +54,21 @@ void prvSetupHardware(void) {
 	SysCtlClockSet(SYSCTL_SYSDIV_4 | SYSCTL_USE_PLL | SYSCTL_OSC_MAIN
 			| SYSCTL_XTAL_16MHZ);
 
+	//
+	// Start the timer for the boot timeline
+	//
+	vSetupFreeRunningTimer();
+	vBootBegin("hardware");
+
 	PinoutSet();
 
 	UARTStdioInit(0);
+
+	//
+	// The UART carries the machine protocol, received bytes must not be
+	// echoed back into it
+	//
+	UARTEchoSet(false);
 	ETHServiceTaskInit(0);
 	IntMasterEnable();
 
@@ -62,15 +77,19 @@ void prvSetupHardware(void) {
 	// priority than the Ethernet interrupt to ensure that the file system
 	// tick is processed if SysTick occurs while the Ethernet handler is being
 	// processed.  This is very likely since all the TCP/IP and HTTP work is
-	// done in the context of the Ethernet interrupt.
+	// done in the context of the Ethernet interrupt.  The UART interrupt
+	// must stay below configMAX_SYSCALL_INTERRUPT_PRIORITY, it gives a
+	// semaphore and is masked by the critical sections of uartstdio.
 	//
 	IntPriorityGroupingSet(4);
 	IntPrioritySet(INT_ETH, ETHERNET_INT_PRIORITY);
+	IntPrioritySet(INT_UART0, UART_INT_PRIORITY);
 	IntPrioritySet(FAULT_SYSTICK, SYSTICK_INT_PRIORITY);
 
 	//
 	// Initialize GUI
 	//
+	vBootBegin("display");
 	Kitronix320x240x16_SSD2119Init();
 
 	//
@@ -79,11 +98,19 @@ void prvSetupHardware(void) {
 	//
 	TouchScreenInit();
 	TouchScreenCallbackSet(WidgetPointerMessage);
+	vBootEnd("display");
 
 	//
-	// Initialize the file system.
+	// Initialize the SSI0 bus manager (SD Card) and the
+	// file system, the configuration is parsed once here.
 	//
+	vBootBegin("fs mount");
+	vSSIBusInit();
 	fs_init();
+	vBootEnd("fs mount");
+	vBootBegin("config");
+	vConfigInit();
+	vBootEnd("config");
 
 	//
 	// Enable the peripherals used by this example.
@@ -110,6 +137,7 @@ void prvSetupHardware(void) {
 	//
 	WatchdogEnable(WATCHDOG0_BASE);
 
+	vBootEnd("hardware");
 }
 
 //*****************************************************************************
@@ -14,6 +14,7 @@
 
 #define SYSTICK_INT_PRIORITY    0x80
 #define ETHERNET_INT_PRIORITY   0xC0
+#define UART_INT_PRIORITY       0xC0
 
 /// Enable logging in /log/sys.log on the SD Card
 
@@ -30,6 +31,42 @@
 /// enable net bios client
 #define	ENABLE_NET_BIOS 	 0 // default 0
 
+/// enable the runtime statistics task (log/stats.h), served as /api/stats
+#define ENABLE_STATS		 1 // default 1
+
+/// seconds between two runtime statistics reports on the UART, 0 = HTTP only
+#define STATS_UART_PERIOD	60 // default 60
+
+/// enable the deferred binary trace (log/trace.h), otherwise TRACEx prints
+#define ENABLE_TRACE		 1 // default 1
+
+/// sink for the trace task: 0 = none (HTTP only), 1 = UART, 2 = SD Card
+#define TRACE_SINK			 1 // default 1
+
+/// record every pvPortMalloc/vPortFree (log/heaptrace.h), drained on the UART by the trace task
+#define ENABLE_HEAP_TRACE	 0 // default 0
+
+/// print the cycles of the checksum routines at startup (log/chksumbench.h)
+#define ENABLE_CHKSUM_BENCH	 0 // default 0
+
+/// print the cycles of netconn calls and the time of every webclient page (log/apibench.h)
+#define ENABLE_API_BENCH	 0 // default 0
+
+/// cache SD Card sectors (fatfs/diskcache.h), otherwise every read goes to the card
+#define ENABLE_DISK_CACHE	 1 // default 1
+
+/// cache path lookups of fs_open (also misses), otherwise every open runs f_open
+#define ENABLE_FS_CACHE		 1 // default 1
+
+/// keep small web files in RAM and send them without copy (lmi_fs.c)
+#define ENABLE_FS_CONTENT_CACHE 1 // default 1
+
+/// send SD files with f_forward straight from the FatFs window (needs _FS_TINY)
+#define ENABLE_FS_FORWARD	 1 // default 1
+
+/// keep a copy of ipconfig.cnf in internal flash, the network starts without SD Card
+#define ENABLE_CONFIG_FLASH	 1 // default 1
+
 
 /// enable debugging messages for memory ususage
 #define DEBUG_MEMORY 		 0 // default 0
@@ -65,6 +102,12 @@
 /// initialize hardware
 void prvSetupHardware(void);
 
+/// start timer 1 as free running cycle counter (timer.c)
+void vSetupFreeRunningTimer(void);
+
+/// CPU cycles since vSetupFreeRunningTimer, wraps after 2^32 cycles
+unsigned long ulFreeRunningTimerCycles(void);
+
 //*****************************************************************************
 //
 // Close the Doxygen group.
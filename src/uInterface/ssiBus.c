@@ -0,0 +1,176 @@
+/**
+ * \addtogroup System
+ * @{
+ *
+ * \author Anziner, Hahn
+ * \brief SSI0 bus manager
+ *
+ * SSI0 is wired to the SD Card and the serial flash, only the SD Card is
+ * used. Its identification and data phases have their own clock and frame
+ * profile, the port is only reconfigured if the profile changes. The access
+ * is serialized with a recursive mutex, so the FatFs driver can take the bus
+ * in every disk function.
+ *
+ */
+
+/* FreeRTOS includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* Hardware library includes. */
+#include "hw_memmap.h"
+#include "hw_types.h"
+#include "ssi.h"
+#include "sysctl.h"
+
+#include "ssiBus.h"
+
+/** registered profiles */
+static tSSIProfile xSSIProfiles[SSI_NUM_DEVICES];
+
+/** profile the port is currently configured for, -1 = not configured */
+static int iSSIConfigured = -1;
+
+/** serializes the access to the bus */
+static xSemaphoreHandle xSSIBusMutex = NULL;
+
+/** number of reconfigurations */
+static unsigned long ulSSIReconfig = 0;
+
+/**
+ * Clocks the port, creates the bus mutex and sets the default profiles.
+ * Has to be called before the first SD Card access (fs_init).
+ */
+void vSSIBusInit(void)
+{
+	unsigned long ulMaxRate;
+
+	//
+	// The first vSSIBusSelect() writes the port registers, an unclocked
+	// peripheral would raise a bus fault. The pins are set up by the driver.
+	//
+	SysCtlPeripheralEnable(SYSCTL_PERIPH_SSI0);
+	SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOA);
+
+	//
+	// SD Card: half the system clock, with a max of 12.5 MHz
+	//
+	ulMaxRate = SysCtlClockGet() / 2;
+	if (ulMaxRate > SSI_SD_MAX_BITRATE)
+	{
+		ulMaxRate = SSI_SD_MAX_BITRATE;
+	}
+
+	vSSIBusSetProfile(SSI_DEVICE_SD_INIT, SSI_SD_INIT_BITRATE,
+			SSI_FRF_MOTO_MODE_0, 8);
+	vSSIBusSetProfile(SSI_DEVICE_SD_DATA, ulMaxRate, SSI_FRF_MOTO_MODE_0, 8);
+
+	if (xSSIBusMutex == NULL)
+	{
+		xSSIBusMutex = xSemaphoreCreateRecursiveMutex();
+	}
+}
+
+/**
+ * Changes the profile of a device
+ *
+ * @param iDevice SSI_DEVICE_*
+ * @param ulBitRate clock in Hz
+ * @param ulProtocol frame format (SSI_FRF_*)
+ * @param ulDataWidth bits per frame
+ */
+void vSSIBusSetProfile(int iDevice, unsigned long ulBitRate,
+		unsigned long ulProtocol, unsigned long ulDataWidth)
+{
+	xSSIProfiles[iDevice].ulBitRate = ulBitRate;
+	xSSIProfiles[iDevice].ulProtocol = ulProtocol;
+	xSSIProfiles[iDevice].ulDataWidth = ulDataWidth;
+
+	//
+	// force a reconfiguration on the next access
+	//
+	if (iSSIConfigured == iDevice)
+	{
+		iSSIConfigured = -1;
+	}
+}
+
+/**
+ * Configures the port for a device, the caller must own the bus.
+ * Nothing is done if the port is already set up with the same profile.
+ *
+ * @param iDevice SSI_DEVICE_*
+ */
+void vSSIBusSelect(int iDevice)
+{
+	tSSIProfile *pxProfile = &xSSIProfiles[iDevice];
+
+	if (iSSIConfigured == iDevice)
+	{
+		return;
+	}
+
+	if (iSSIConfigured >= 0
+			&& xSSIProfiles[iSSIConfigured].ulBitRate == pxProfile->ulBitRate
+			&& xSSIProfiles[iSSIConfigured].ulProtocol == pxProfile->ulProtocol
+			&& xSSIProfiles[iSSIConfigured].ulDataWidth
+					== pxProfile->ulDataWidth)
+	{
+		iSSIConfigured = iDevice;
+		return;
+	}
+
+	SSIDisable(SSI0_BASE);
+	SSIConfigSetExpClk(SSI0_BASE, SysCtlClockGet(), pxProfile->ulProtocol,
+			SSI_MODE_MASTER, pxProfile->ulBitRate, pxProfile->ulDataWidth);
+	SSIEnable(SSI0_BASE);
+
+	iSSIConfigured = iDevice;
+	ulSSIReconfig++;
+}
+
+/**
+ * Takes the bus for a device and configures it if needed.
+ * Calls can be nested (recursive mutex).
+ *
+ * @param iDevice SSI_DEVICE_*
+ */
+void vSSIBusAcquire(int iDevice)
+{
+	if (xSSIBusMutex != NULL)
+	{
+		xSemaphoreTakeRecursive(xSSIBusMutex, portMAX_DELAY);
+	}
+
+	vSSIBusSelect(iDevice);
+}
+
+/**
+ * Gives the bus back. The configuration is kept, so the next access of the
+ * same device doesn't touch the port.
+ */
+void vSSIBusRelease(void)
+{
+	if (xSSIBusMutex != NULL)
+	{
+		xSemaphoreGiveRecursive(xSSIBusMutex);
+	}
+}
+
+/**
+ * Returns the number of SSI reconfigurations since startup
+ *
+ * @return number of reconfigurations
+ */
+unsigned long ulSSIBusReconfigurations(void)
+{
+	return ulSSIReconfig;
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
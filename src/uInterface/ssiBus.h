@@ -0,0 +1,78 @@
+/**
+ * \addtogroup System
+ * @{
+ *
+ * \author Anziner, Hahn
+ * \brief Prototypes for the SSI0 bus manager
+ *
+ */
+
+#ifndef SSIBUS_H_
+#define SSIBUS_H_
+
+//*****************************************************************************
+//
+// Devices on SSI0, every device has its own clock and frame profile
+//
+//*****************************************************************************
+/// SD Card during card identification (max. 400 kHz)
+#define SSI_DEVICE_SD_INIT		0
+/// SD Card after the initialization (full speed)
+#define SSI_DEVICE_SD_DATA		1
+/// Number of devices
+#define SSI_NUM_DEVICES			2
+
+/// SD Card clock during card identification
+#define SSI_SD_INIT_BITRATE		400000
+/// Upper limit for the SD Card data clock
+#define SSI_SD_MAX_BITRATE		12500000
+
+/**
+ * Clock and frame profile of one device
+ */
+typedef struct
+{
+	unsigned long ulBitRate;		///< SSI clock in Hz
+	unsigned long ulProtocol;		///< frame format, e.g. SSI_FRF_MOTO_MODE_0
+	unsigned long ulDataWidth;		///< bits per frame
+} tSSIProfile;
+
+/**
+ * Creates the bus mutex and sets the default profiles
+ */
+void vSSIBusInit(void);
+
+/**
+ * Changes the profile of a device
+ */
+void vSSIBusSetProfile(int iDevice, unsigned long ulBitRate,
+		unsigned long ulProtocol, unsigned long ulDataWidth);
+
+/**
+ * Takes the bus for a device and configures it if needed
+ */
+void vSSIBusAcquire(int iDevice);
+
+/**
+ * Changes the profile while the bus is owned (e.g. SD init -> SD data)
+ */
+void vSSIBusSelect(int iDevice);
+
+/**
+ * Gives the bus back
+ */
+void vSSIBusRelease(void);
+
+/**
+ * Returns the number of SSI reconfigurations since startup
+ */
+unsigned long ulSSIBusReconfigurations(void);
+
+#endif /* SSIBUS_H_ */
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
@@ -29,8 +29,10 @@ void vHyperlinkOnLoad(char* param, int len, void* this)
 	name = pcGetParamFromString(param, "name");
 	value = pcGetParamFromString(param, "value");
 
-	char* configLoad = loadFromConfig(IP_CONFIG_FILE, "DEFAULT_MENU_PAGE");
-	if (strcmp(configLoad, value) != 0)
+	char configLoad[CONFIG_VALUE_LEN];
+
+	if (!bConfigGetString("DEFAULT_MENU_PAGE", configLoad, sizeof(configLoad))
+			|| strcmp(configLoad, value) != 0)
 	{
 		if (name != NULL)
 		{
@@ -57,7 +59,6 @@ void vHyperlinkOnLoad(char* param, int len, void* this)
 	{
 		xDisplayRoot.menue = true;
 	}
-	vPortFree(configLoad);
 }
 
 void vHyperlinkRenderSSI(char * pcBuf, int iBufLen, pSSIParam *params)
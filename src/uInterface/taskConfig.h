@@ -87,6 +87,34 @@ xTaskHandle xComTaskHandle;
 /// Task handler for the Clock Task
 xTaskHandle xRealtimeTaskHandle;
 
+//*****************************************************************************
+//
+// Trace Task
+//
+//*****************************************************************************
+/// Stack size for the Trace Task
+#define TRACE_STACK_SIZE	128 * 2
+/// Task name for the Trace Task
+#define TRACE_TASK_NAME		"trace"
+/// Task priority for the Trace Task, runs only if the other tasks are blocked
+#define TRACE_TASK_PRIORITY  (tskIDLE_PRIORITY + 1)
+/// Task handler for the Trace Task
+xTaskHandle xTraceTaskHandle;
+
+//*****************************************************************************
+//
+// Stats Task
+//
+//*****************************************************************************
+/// Stack size for the Stats Task
+#define STATS_STACK_SIZE	128 * 2
+/// Task name for the Stats Task
+#define STATS_TASK_NAME		"stats"
+/// Task priority for the Stats Task, runs only if the other tasks are blocked
+#define STATS_TASK_PRIORITY  (tskIDLE_PRIORITY + 1)
+/// Task handler for the Stats Task
+xTaskHandle xStatsTaskHandle;
+
 //*****************************************************************************
 //
 // Close the Doxygen group.
@@ -96,6 +96,47 @@ volatile unsigned portLONG ulMaxJitter = 0UL;
 This value is used by the run time stats function to work out what percentage
 of CPU time each task is taking. */
 volatile unsigned portLONG ulHighFrequencyTimerTicks = 0UL;
+
+/** Set once timer 1 runs, its registers must not be read before. */
+static volatile tBoolean bFreeRunningTimer = false;
+/*-----------------------------------------------------------*/
+
+/**
+ * Starts timer 1 as free running counter of CPU cycles. It is started right
+ * after the clock setup, so the boot stages can be timed from reset on.
+ */
+void vSetupFreeRunningTimer( void )
+{
+	if( bFreeRunningTimer )
+	{
+		return;
+	}
+
+    SysCtlPeripheralEnable( SYSCTL_PERIPH_TIMER1 );
+    TimerConfigure( TIMER1_BASE, TIMER_CFG_32_BIT_PER );
+
+	/* Just used to measure time. */
+    TimerLoadSet(TIMER1_BASE, TIMER_A, timerMAX_32BIT_VALUE );
+    TimerEnable( TIMER1_BASE, TIMER_A );
+
+	bFreeRunningTimer = true;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * Returns the CPU cycles since vSetupFreeRunningTimer, wraps after 2^32
+ * cycles (86 s at 50 MHz). 0 while the timer isn't running.
+ */
+unsigned long ulFreeRunningTimerCycles( void )
+{
+	if( !bFreeRunningTimer )
+	{
+		return 0;
+	}
+
+	/* timer 1 counts down */
+	return timerMAX_32BIT_VALUE - timerTIMER_1_COUNT_VALUE;
+}
 /*-----------------------------------------------------------*/
 
 /**
@@ -106,18 +147,14 @@ void vSetupHighFrequencyTimer( void )
 unsigned long ulFrequency;
 
 	/* Timer zero is used to generate the interrupts, and timer 1 is used
-	to measure the jitter. */
+	to measure the jitter. Timer 1 may run since the boot already. */
 	SysCtlPeripheralEnable( SYSCTL_PERIPH_TIMER0 );
-    SysCtlPeripheralEnable( SYSCTL_PERIPH_TIMER1 );
     TimerConfigure( TIMER0_BASE, TIMER_CFG_32_BIT_PER );
-    TimerConfigure( TIMER1_BASE, TIMER_CFG_32_BIT_PER );
+	vSetupFreeRunningTimer();
 
 	/* Set the timer interrupt to be above the kernel - highest. */
 	IntPrioritySet( INT_TIMER0A, timerHIGHEST_PRIORITY );
 
-	/* Just used to measure time. */
-    TimerLoadSet(TIMER1_BASE, TIMER_A, timerMAX_32BIT_VALUE );
-
 	/* Ensure interrupts do not start until the scheduler is running. */
 	portDISABLE_INTERRUPTS();
 
@@ -127,9 +164,8 @@ unsigned long ulFrequency;
     IntEnable( INT_TIMER0A );
     TimerIntEnable( TIMER0_BASE, TIMER_TIMA_TIMEOUT );
 
-	/* Enable both timers. */
+	/* Enable the interrupt timer, timer 1 runs already. */
     TimerEnable( TIMER0_BASE, TIMER_A );
-    TimerEnable( TIMER1_BASE, TIMER_A );
 }
 /*-----------------------------------------------------------*/
 
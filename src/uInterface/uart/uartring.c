@@ -0,0 +1,260 @@
+//*****************************************************************************
+//
+// uartring.c - Ring buffers for the UART channels.
+//
+// The functions only work on memory, so they can be compiled and exercised
+// on the host against a simulated UART.
+//
+//*****************************************************************************
+
+/**
+ * \addtogroup DebugUART
+ * @{
+ *
+ * \author Anziner, Hahn
+ * \brief Ring buffers for the UART channels
+ *
+ */
+#include "uartring.h"
+
+//*****************************************************************************
+//
+//! Initializes a ring buffer.
+//!
+//! \param psRing is the ring to initialize.
+//! \param pucBuf points to the storage for the ring.
+//! \param ulSize is the size of pucBuf in bytes.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+UARTRingInit(tUARTRing *psRing, unsigned char *pucBuf, unsigned long ulSize)
+{
+	psRing->pucBuf = pucBuf;
+	psRing->ulSize = ulSize;
+	psRing->ulDropped = 0;
+	psRing->ulDropEvents = 0;
+
+	UARTRingFlush(psRing);
+}
+
+//*****************************************************************************
+//
+//! Discards the content of a ring buffer.
+//!
+//! \param psRing is the ring to flush.
+//!
+//! \return None.
+//
+//*****************************************************************************
+void
+UARTRingFlush(tUARTRing *psRing)
+{
+	psRing->ulRead = 0;
+	psRing->ulWrite = 0;
+	psRing->ucLast = '\n';
+}
+
+//*****************************************************************************
+//
+//! Determines the number of bytes stored in a ring buffer.
+//!
+//! \param psRing is the ring.
+//!
+//! \return Returns the number of bytes in the ring.
+//
+//*****************************************************************************
+unsigned long
+UARTRingUsed(tUARTRing *psRing)
+{
+	unsigned long ulWrite;
+	unsigned long ulRead;
+
+	ulWrite = psRing->ulWrite;
+	ulRead = psRing->ulRead;
+
+	return((ulWrite >= ulRead) ? (ulWrite - ulRead) :
+			(psRing->ulSize - (ulRead - ulWrite)));
+}
+
+//*****************************************************************************
+//
+//! Determines the number of bytes which can still be written to a ring.
+//!
+//! \param psRing is the ring.
+//!
+//! \return Returns the number of free bytes.
+//
+//*****************************************************************************
+unsigned long
+UARTRingFree(tUARTRing *psRing)
+{
+	return(psRing->ulSize - 1 - UARTRingUsed(psRing));
+}
+
+//*****************************************************************************
+//
+//! Determines whether a ring buffer is empty.
+//!
+//! \param psRing is the ring.
+//!
+//! \return Returns 1 if the ring is empty, 0 otherwise.
+//
+//*****************************************************************************
+int
+UARTRingEmpty(tUARTRing *psRing)
+{
+	return((psRing->ulRead == psRing->ulWrite) ? 1 : 0);
+}
+
+//*****************************************************************************
+//
+//! Writes one byte to a ring buffer.
+//!
+//! \param psRing is the ring.
+//! \param ucChar is the byte to write.
+//!
+//! \return Returns 1 if the byte was stored, 0 if the ring is full.
+//
+//*****************************************************************************
+int
+UARTRingPut(tUARTRing *psRing, unsigned char ucChar)
+{
+	unsigned long ulNext;
+
+	ulNext = (psRing->ulWrite + 1) % psRing->ulSize;
+	if(ulNext == psRing->ulRead)
+	{
+		return(0);
+	}
+
+	psRing->pucBuf[psRing->ulWrite] = ucChar;
+	psRing->ulWrite = ulNext;
+
+	return(1);
+}
+
+//*****************************************************************************
+//
+//! Reads one byte from a ring buffer.
+//!
+//! \param psRing is the ring.
+//! \param pucChar returns the byte.
+//!
+//! \return Returns 1 if a byte was read, 0 if the ring is empty.
+//
+//*****************************************************************************
+int
+UARTRingGet(tUARTRing *psRing, unsigned char *pucChar)
+{
+	if(psRing->ulRead == psRing->ulWrite)
+	{
+		return(0);
+	}
+
+	*pucChar = psRing->pucBuf[psRing->ulRead];
+	psRing->ucLast = *pucChar;
+	psRing->ulRead = (psRing->ulRead + 1) % psRing->ulSize;
+
+	return(1);
+}
+
+//*****************************************************************************
+//
+//! Drops the oldest data from a ring buffer until ulLen bytes are free.
+//!
+//! \param psRing is the ring.
+//! \param ulLen is the number of bytes the caller wants to write.
+//!
+//! Whole lines are dropped, so the output resumes at the start of a line.
+//! If the consumer has already read the start of the first dropped line,
+//! that line is ended with a CR LF (or the LF after a CR) in front of the
+//! next one.  The dropped bytes are counted in ulDropped.  The consumer must
+//! not run while this function moves the read index.
+//!
+//! \return Returns the number of bytes which can be written, this is less
+//! than ulLen if ulLen is larger than the ring.
+//
+//*****************************************************************************
+unsigned long
+UARTRingMakeRoom(tUARTRing *psRing, unsigned long ulLen)
+{
+	unsigned char ucChar, ucLast;
+	unsigned long ulDropped = 0;
+	unsigned long ulEnd, ulKept;
+
+	if(ulLen > psRing->ulSize - 1)
+	{
+		ulLen = psRing->ulSize - 1;
+	}
+
+	if(UARTRingFree(psRing) >= ulLen)
+	{
+		return(ulLen);
+	}
+
+	//
+	// Keep room for the end of the line if the consumer stopped in a line,
+	// unless the ring is too small for it.
+	//
+	ucLast = psRing->ucLast;
+	ulEnd = (ucLast == '\n') ? 0 : ((ucLast == '\r') ? 1 : 2);
+	if(ulLen + ulEnd > psRing->ulSize - 1)
+	{
+		ulEnd = 0;
+	}
+
+	//
+	// The end of the line may already be the next data in the ring (a CR is
+	// always stored together with its LF), then it is dropped and put back
+	// below and does not count as dropped.
+	//
+	ulKept = 0;
+	if(psRing->pucBuf[psRing->ulRead] == ((ulEnd == 1) ? '\n' : '\r'))
+	{
+		ulKept = ulEnd;
+	}
+
+	//
+	// Drop bytes until there is enough room, then continue up to the end
+	// of the line.
+	//
+	while(UARTRingGet(psRing, &ucChar))
+	{
+		ulDropped++;
+
+		if((UARTRingFree(psRing) >= ulLen + ulEnd) && (ucChar == '\n'))
+		{
+			break;
+		}
+	}
+
+	//
+	// End the line the consumer has started.  The read index moves back into
+	// the room made above.
+	//
+	psRing->ucLast = ucLast;
+	psRing->ulRead = (psRing->ulRead + psRing->ulSize - ulEnd) %
+					 psRing->ulSize;
+	if(ulEnd == 2)
+	{
+		psRing->pucBuf[psRing->ulRead] = '\r';
+	}
+	if(ulEnd != 0)
+	{
+		psRing->pucBuf[(psRing->ulRead + ulEnd - 1) % psRing->ulSize] = '\n';
+	}
+
+	psRing->ulDropped += ulDropped - ulKept;
+	psRing->ulDropEvents++;
+
+	return(ulLen);
+}
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
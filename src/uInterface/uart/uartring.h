@@ -0,0 +1,88 @@
+//*****************************************************************************
+//
+// uartring.h - Prototypes for the UART transmit ring buffers.
+//
+//*****************************************************************************
+
+/**
+ * \addtogroup DebugUART
+ * @{
+ *
+ * \author Anziner, Hahn
+ * \brief Ring buffers for the UART channels
+ *
+ */
+#ifndef __UARTRING_H__
+#define __UARTRING_H__
+
+//*****************************************************************************
+//
+//! One ring buffer.  The buffer is empty if ulRead equals ulWrite and full if
+//! ulWrite is one behind ulRead, so ulSize - 1 bytes can be stored.
+//!
+//! The ring has no hardware dependencies, the caller is responsible for the
+//! locking (the producer runs in a task, the consumer in the UART interrupt).
+//
+//*****************************************************************************
+typedef struct
+{
+	//
+	//! The storage for the ring.
+	//
+	unsigned char *pucBuf;
+
+	//
+	//! The size of pucBuf in bytes.
+	//
+	unsigned long ulSize;
+
+	//
+	//! The index of the next byte to read.
+	//
+	volatile unsigned long ulRead;
+
+	//
+	//! The index of the next byte to write.
+	//
+	volatile unsigned long ulWrite;
+
+	//
+	//! The last byte read, tells whether the consumer stopped in a line.
+	//
+	volatile unsigned char ucLast;
+
+	//
+	//! Number of bytes dropped to make room for new data.
+	//
+	unsigned long ulDropped;
+
+	//
+	//! Number of writes which had to drop data.
+	//
+	unsigned long ulDropEvents;
+}
+tUARTRing;
+
+//*****************************************************************************
+//
+// Prototypes for the APIs.
+//
+//*****************************************************************************
+extern void UARTRingInit(tUARTRing *psRing, unsigned char *pucBuf,
+						 unsigned long ulSize);
+extern void UARTRingFlush(tUARTRing *psRing);
+extern unsigned long UARTRingUsed(tUARTRing *psRing);
+extern unsigned long UARTRingFree(tUARTRing *psRing);
+extern int UARTRingEmpty(tUARTRing *psRing);
+extern int UARTRingPut(tUARTRing *psRing, unsigned char ucChar);
+extern int UARTRingGet(tUARTRing *psRing, unsigned char *pucChar);
+extern unsigned long UARTRingMakeRoom(tUARTRing *psRing, unsigned long ulLen);
+
+#endif // __UARTRING_H__
+
+//*****************************************************************************
+//
+// Close the Doxygen group.
+//! @}
+//
+//*****************************************************************************
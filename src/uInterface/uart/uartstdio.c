@@ -31,6 +31,7 @@
 #include "hw_memmap.h"
 #include "hw_uart.h"
 #include "hw_ints.h"
+#include "hw_nvic.h"
 #include "uart.h"
 #include "debug.h"
 #include "rom.h"
@@ -38,8 +39,13 @@
 #include "sysctl.h"
 #include "interrupt.h"
 #include "uartstdio.h"
+#include "uartring.h"
 #include "gpio.h"
 
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
 //*****************************************************************************
 //
 //! \addtogroup uartstdio_api
@@ -68,13 +74,59 @@ static tBoolean g_bDisableEcho;
 
 //*****************************************************************************
 //
-// Output ring buffer.  Buffer is full if g_ulUARTTxReadIndex is one ahead of
-// g_ulUARTTxWriteIndex.  Buffer is empty if the two indices are the same.
+// Output ring buffers.  The console channel (UARTprintf, UARTwrite) never
+// blocks and drops its oldest lines if the ring is full.  The machine channel
+// (UARTMachinePrintf, UARTMachineWrite) never drops data and is sent before
+// the console text.
 //
 //*****************************************************************************
 static unsigned char g_pcUARTTxBuffer[UART_TX_BUFFER_SIZE];
-static volatile unsigned long g_ulUARTTxWriteIndex = 0;
-static volatile unsigned long g_ulUARTTxReadIndex = 0;
+static unsigned char g_pcUARTMachineBuffer[UART_MACHINE_BUFFER_SIZE];
+static tUARTRing g_sConsoleRing;
+static tUARTRing g_sMachineRing;
+
+//*****************************************************************************
+//
+// The channel currently on the wire.  Channels are only switched at the end
+// of a line (NULL), so machine frames are never mixed with console text.
+//
+//*****************************************************************************
+static tUARTRing * volatile g_psTxActive = 0;
+
+//*****************************************************************************
+//
+// A character which has to be sent before the next one from the rings (used
+// to terminate a console line interrupted by a machine frame).
+//
+//*****************************************************************************
+static volatile unsigned char g_ucTxPending = 0;
+
+//*****************************************************************************
+//
+// Writers of the machine channel hold g_xMachineMutex for a whole frame and
+// block on g_xMachineRoom, which the TX interrupt gives after it has moved
+// bytes out of the rings.  Both are created by UARTStdioInit().
+//
+//*****************************************************************************
+static xSemaphoreHandle g_xMachineMutex = 0;
+static xSemaphoreHandle g_xMachineRoom = 0;
+
+//*****************************************************************************
+//
+// Ticks a machine writer waits for the TX interrupt before it checks the
+// ring again.
+//
+//*****************************************************************************
+#define UART_ROOM_WAIT          (10 / portTICK_RATE_MS)
+
+//*****************************************************************************
+//
+// True while an exception handler runs (the echo of UARTStdioIntHandler
+// writes the console ring).
+//
+//*****************************************************************************
+#define UART_IN_ISR()           ((HWREG(NVIC_INT_CTRL) &                      \
+                                  NVIC_INT_CTRL_VEC_ACT_M) != 0)
 
 //*****************************************************************************
 //
@@ -82,26 +134,18 @@ static volatile unsigned long g_ulUARTTxReadIndex = 0;
 // g_ulUARTTxWriteIndex.  Buffer is empty if the two indices are the same.
 //
 //*****************************************************************************
-static unsigned char g_pcUARTRxBuffer[UART_TX_BUFFER_SIZE];
+static unsigned char g_pcUARTRxBuffer[UART_RX_BUFFER_SIZE];
 static volatile unsigned long g_ulUARTRxWriteIndex = 0;
 static volatile unsigned long g_ulUARTRxReadIndex = 0;
 
 //*****************************************************************************
 //
-// Macros to determine number of free and used bytes in the transmit buffer.
+// Macro to determine whether all transmit channels are empty.
 //
 //*****************************************************************************
-#define TX_BUFFER_USED          (GetBufferCount(&g_ulUARTTxReadIndex,  \
-                                                &g_ulUARTTxWriteIndex, \
-                                                UART_TX_BUFFER_SIZE))
-#define TX_BUFFER_FREE          (UART_TX_BUFFER_SIZE - TX_BUFFER_USED)
-#define TX_BUFFER_EMPTY         (IsBufferEmpty(&g_ulUARTTxReadIndex,   \
-                                               &g_ulUARTTxWriteIndex))
-#define TX_BUFFER_FULL          (IsBufferFull(&g_ulUARTTxReadIndex,  \
-                                              &g_ulUARTTxWriteIndex, \
-                                              UART_TX_BUFFER_SIZE))
-#define ADVANCE_TX_BUFFER_INDEX(Index) \
-                                (Index) = ((Index) + 1) % UART_TX_BUFFER_SIZE
+#define TX_BUFFER_EMPTY         (UARTRingEmpty(&g_sConsoleRing) &&        \
+                                 UARTRingEmpty(&g_sMachineRing) &&        \
+                                 !g_ucTxPending)
 
 //*****************************************************************************
 //
@@ -276,6 +320,8 @@ GetBufferCount(volatile unsigned long *pulRead,
 static void
 UARTPrimeTransmit(unsigned long ulBase)
 {
+	unsigned char ucChar;
+
 	//
 	// Do we have any data to transmit?
 	//
@@ -288,14 +334,68 @@ UARTPrimeTransmit(unsigned long ulBase)
 		MAP_IntDisable(g_ulUARTInt[g_ulPortNum]);
 
 		//
-		// Yes - take some characters out of the transmit buffer and feed
+		// Yes - take some characters out of the transmit buffers and feed
 		// them to the UART transmit FIFO.
 		//
-		while(MAP_UARTSpaceAvail(ulBase) && !TX_BUFFER_EMPTY)
+		while(MAP_UARTSpaceAvail(ulBase))
 		{
-			MAP_UARTCharPutNonBlocking(ulBase,
-					g_pcUARTTxBuffer[g_ulUARTTxReadIndex]);
-			ADVANCE_TX_BUFFER_INDEX(g_ulUARTTxReadIndex);
+			//
+			// Finish the line end of an interrupted console line first.
+			//
+			if(g_ucTxPending)
+			{
+				MAP_UARTCharPutNonBlocking(ulBase, g_ucTxPending);
+				g_ucTxPending = 0;
+				continue;
+			}
+
+			//
+			// A machine frame is waiting - end the current console line
+			// so the frame starts on a line of its own.
+			//
+			if((g_psTxActive == &g_sConsoleRing) &&
+			   !UARTRingEmpty(&g_sMachineRing))
+			{
+				MAP_UARTCharPutNonBlocking(ulBase, '\r');
+				g_ucTxPending = '\n';
+				g_psTxActive = 0;
+				continue;
+			}
+
+			//
+			// At the start of a line select the next channel, the machine
+			// channel has priority.
+			//
+			if(g_psTxActive == 0)
+			{
+				if(!UARTRingEmpty(&g_sMachineRing))
+				{
+					g_psTxActive = &g_sMachineRing;
+				}
+				else if(!UARTRingEmpty(&g_sConsoleRing))
+				{
+					g_psTxActive = &g_sConsoleRing;
+				}
+				else
+				{
+					break;
+				}
+			}
+
+			//
+			// The rest of the line has not been written yet.
+			//
+			if(!UARTRingGet(g_psTxActive, &ucChar))
+			{
+				break;
+			}
+
+			MAP_UARTCharPutNonBlocking(ulBase, ucChar);
+
+			if(ucChar == '\n')
+			{
+				g_psTxActive = 0;
+			}
 		}
 
 		//
@@ -304,6 +404,157 @@ UARTPrimeTransmit(unsigned long ulBase)
 		MAP_IntEnable(g_ulUARTInt[g_ulPortNum]);
 	}
 }
+
+//*****************************************************************************
+//
+// Writes a string to one of the transmit rings and starts the transmission.
+// LF characters are translated to CRLF pairs.  If bDrop is true, the oldest
+// lines are dropped if there is not enough room, otherwise the function
+// waits until the UART interrupt has made room.
+//
+//*****************************************************************************
+static int
+UARTRingWrite(tUARTRing *psRing, const char *pcBuf, unsigned long ulLen,
+			  tBoolean bDrop)
+{
+	unsigned long ulIdx, ulNeeded, ulRoom;
+	tBoolean bLocked = false;
+
+	//
+	// Check for valid arguments.
+	//
+	ASSERT(pcBuf != 0);
+	ASSERT(g_ulBase != 0);
+
+	//
+	// Count the bytes including the CR in front of every LF.
+	//
+	for(ulIdx = 0, ulNeeded = ulLen; ulIdx < ulLen; ulIdx++)
+	{
+		if(pcBuf[ulIdx] == '\n')
+		{
+			ulNeeded++;
+		}
+	}
+
+	if(bDrop)
+	{
+		//
+		// Two tasks must not move the write index at the same time, so the
+		// console channel is updated in a critical section.  It never waits
+		// and is short.  The echo of the UART interrupt writes from the
+		// handler itself, which the critical section already excludes.
+		//
+		if(!UART_IN_ISR())
+		{
+			taskENTER_CRITICAL();
+			bLocked = true;
+		}
+
+		//
+		// The interrupt must not read while we move the read index, and it
+		// writes the console ring itself when echo is enabled, so it stays
+		// masked until all characters are stored.  After making room the
+		// loop below never waits.
+		//
+		MAP_IntDisable(g_ulUARTInt[g_ulPortNum]);
+		ulRoom = UARTRingMakeRoom(psRing, ulNeeded);
+
+		//
+		// Truncate strings which are larger than the whole ring.
+		//
+		if(ulRoom < ulNeeded)
+		{
+			psRing->ulDropped += ulNeeded - ulRoom;
+		}
+	}
+	else if((g_xMachineMutex != 0) &&
+			(xTaskGetSchedulerState() == taskSCHEDULER_RUNNING))
+	{
+		//
+		// One machine frame at a time, a frame is never interleaved with
+		// another task's frame.
+		//
+		xSemaphoreTake(g_xMachineMutex, portMAX_DELAY);
+		bLocked = true;
+	}
+
+	//
+	// Send the characters
+	//
+	for(ulIdx = 0; ulIdx < ulLen; ulIdx++)
+	{
+		//
+		// Wait for room in the machine channel, the console channel has
+		// already made room above.
+		//
+		while(!bDrop && (UARTRingFree(psRing) < 2))
+		{
+			UARTPrimeTransmit(g_ulBase);
+			MAP_UARTIntEnable(g_ulBase, UART_INT_TX);
+
+			//
+			// Sleep until the TX interrupt has made room.  Before the
+			// scheduler runs (or while it is suspended) there is nothing
+			// else to do, so the loop just polls.
+			//
+			if(bLocked)
+			{
+				xSemaphoreTake(g_xMachineRoom, UART_ROOM_WAIT);
+			}
+		}
+
+		//
+		// If the character to the UART is \n, then add a \r before it so that
+		// \n is translated to \n\r in the output.
+		//
+		if(pcBuf[ulIdx] == '\n')
+		{
+			if(!UARTRingPut(psRing, '\r'))
+			{
+				break;
+			}
+		}
+
+		//
+		// Send the character to the UART output.
+		//
+		if(!UARTRingPut(psRing, pcBuf[ulIdx]))
+		{
+			break;
+		}
+	}
+
+	if(bDrop)
+	{
+		MAP_IntEnable(g_ulUARTInt[g_ulPortNum]);
+
+		if(bLocked)
+		{
+			taskEXIT_CRITICAL();
+		}
+	}
+
+	//
+	// If we have anything in the buffer, make sure that the UART is set
+	// up to transmit it.
+	//
+	if(!TX_BUFFER_EMPTY)
+	{
+		UARTPrimeTransmit(g_ulBase);
+		MAP_UARTIntEnable(g_ulBase, UART_INT_TX);
+	}
+
+	if(!bDrop && bLocked)
+	{
+		xSemaphoreGive(g_xMachineMutex);
+	}
+
+	//
+	// Return the number of characters written.
+	//
+	return(ulIdx);
+}
 #endif
 
 //*****************************************************************************
@@ -357,6 +608,15 @@ void UARTStdioInit(unsigned long ulPortNum)
 	// In buffered mode, we only allow a single instance to be opened.
 	//
 	ASSERT(g_ulBase == 0);
+
+	//
+	// Set up the console and the machine channel.
+	//
+	UARTRingInit(&g_sConsoleRing, g_pcUARTTxBuffer, UART_TX_BUFFER_SIZE);
+	UARTRingInit(&g_sMachineRing, g_pcUARTMachineBuffer,
+				 UART_MACHINE_BUFFER_SIZE);
+	g_xMachineMutex = xSemaphoreCreateMutex();
+	vSemaphoreCreateBinary(g_xMachineRoom);
 #endif
 
 	//
@@ -437,9 +697,9 @@ void UARTStdioInit(unsigned long ulPortNum)
 //!
 //! In non-buffered mode, this function is blocking and will not return until
 //! all the characters have been written to the output FIFO.  In buffered mode,
-//! the characters are written to the UART transmit buffer and the call returns
-//! immediately.  If insufficient space remains in the transmit buffer,
-//! additional characters are discarded.
+//! the characters are written to the console transmit buffer and the call
+//! returns immediately.  If insufficient space remains in the transmit buffer,
+//! the oldest lines are discarded and counted (see UARTTxDropped()).
 //!
 //! \return Returns the count of characters written.
 //
@@ -447,70 +707,7 @@ void UARTStdioInit(unsigned long ulPortNum)
 int UARTwrite(const char *pcBuf, unsigned long ulLen)
 {
 #ifdef UART_BUFFERED
-	unsigned int uIdx;
-
-	//
-	// Check for valid arguments.
-	//
-	ASSERT(pcBuf != 0);
-	ASSERT(g_ulBase != 0);
-
-	//
-	// Send the characters
-	//
-	for(uIdx = 0; uIdx < ulLen; uIdx++)
-	{
-		//
-		// If the character to the UART is \n, then add a \r before it so that
-		// \n is translated to \n\r in the output.
-		//
-		if(pcBuf[uIdx] == '\n')
-		{
-			if(!TX_BUFFER_FULL)
-			{
-				g_pcUARTTxBuffer[g_ulUARTTxWriteIndex] = '\r';
-				ADVANCE_TX_BUFFER_INDEX(g_ulUARTTxWriteIndex);
-			}
-			else
-			{
-				//
-				// Buffer is full - discard remaining characters and return.
-				//
-				break;
-			}
-		}
-
-		//
-		// Send the character to the UART output.
-		//
-		if(!TX_BUFFER_FULL)
-		{
-			g_pcUARTTxBuffer[g_ulUARTTxWriteIndex] = pcBuf[uIdx];
-			ADVANCE_TX_BUFFER_INDEX(g_ulUARTTxWriteIndex);
-		}
-		else
-		{
-			//
-			// Buffer is full - discard remaining characters and return.
-			//
-			break;
-		}
-	}
-
-	//
-	// If we have anything in the buffer, make sure that the UART is set
-	// up to transmit it.
-	//
-	if(!TX_BUFFER_EMPTY)
-	{
-		UARTPrimeTransmit(g_ulBase);
-		MAP_UARTIntEnable(g_ulBase, UART_INT_TX);
-	}
-
-	//
-	// Return the number of characters written.
-	//
-	return(uIdx);
+	return(UARTRingWrite(&g_sConsoleRing, pcBuf, ulLen, true));
 #else
 	unsigned int uIdx;
 
@@ -579,21 +776,16 @@ int sendchar(int pcChar)
 	//
 	//    if(pcChar == '\n')
 	//    {
-	//        if(!TX_BUFFER_FULL)
-	//        {
-	//            g_pcUARTTxBuffer[g_ulUARTTxWriteIndex] = '\r';
-	//            ADVANCE_TX_BUFFER_INDEX(g_ulUARTTxWriteIndex);
-	//        }
+	//        UARTRingPut(&g_sConsoleRing, '\r');
 	//    }
 
 	//
 	// Send the character to the UART output.
 	//
-	if(!TX_BUFFER_FULL)
-	{
-		g_pcUARTTxBuffer[g_ulUARTTxWriteIndex] = pcChar;
-		ADVANCE_TX_BUFFER_INDEX(g_ulUARTTxWriteIndex);
-	}
+	MAP_IntDisable(g_ulUARTInt[g_ulPortNum]);
+	UARTRingMakeRoom(&g_sConsoleRing, 1);
+	UARTRingPut(&g_sConsoleRing, pcChar);
+	MAP_IntEnable(g_ulUARTInt[g_ulPortNum]);
 
 	//
 	// If we have anything in the buffer, make sure that the UART is set
@@ -916,11 +1108,12 @@ int getkey(void)
 
 //*****************************************************************************
 //
-//! A simple UART based printf function supporting \%c, \%d, \%p, \%s, \%u,
+//! A simple UART based vprintf function supporting \%c, \%d, \%p, \%s, \%u,
 //! \%x, and \%X.
 //!
+//! \param pfnWrite is the function which writes the output to a channel.
 //! \param pcString is the format string.
-//! \param ... are the optional arguments, which depend on the contents of the
+//! \param vaArgP are the arguments, which depend on the contents of the
 //! format string.
 //!
 //! This function is very similar to the C library <tt>fprintf()</tt> function.
@@ -952,22 +1145,18 @@ int getkey(void)
 //! \return None.
 //
 //*****************************************************************************
-int UARTprintf(const char *pcString, ...)
+static int
+UARTvprintf(int (*pfnWrite)(const char *pcBuf, unsigned long ulLen),
+			const char *pcString, va_list vaArgP)
 {
 	unsigned long ulIdx, ulValue, ulPos, ulCount, ulBase, ulNeg;
 	char *pcStr, pcBuf[16], cFill;
-	va_list vaArgP;
 
 	//
 	// Check the arguments.
 	//
 	ASSERT(pcString != 0);
 
-	//
-	// Start the varargs processing.
-	//
-	va_start(vaArgP, pcString);
-
 	//
 	// Loop while there are more characters in the string.
 	//
@@ -983,7 +1172,7 @@ int UARTprintf(const char *pcString, ...)
 		//
 		// Write this portion of the string.
 		//
-		UARTwrite(pcString, ulIdx);
+		pfnWrite(pcString, ulIdx);
 
 		//
 		// Skip the portion of the string that was written.
@@ -1067,7 +1256,7 @@ int UARTprintf(const char *pcString, ...)
 				//
 				// Print out the character.
 				//
-				UARTwrite((char *) &ulValue, 1);
+				pfnWrite((char *) &ulValue, 1);
 
 				//
 				// This command has been handled.
@@ -1146,7 +1335,7 @@ int UARTprintf(const char *pcString, ...)
 				//
 				// Write the string.
 				//
-				UARTwrite(pcStr, ulIdx);
+				pfnWrite(pcStr, ulIdx);
 
 				//
 				// Write any required padding spaces
@@ -1156,7 +1345,7 @@ int UARTprintf(const char *pcString, ...)
 					ulCount -= ulIdx;
 					while (ulCount--)
 					{
-						UARTwrite(" ", 1);
+						pfnWrite(" ", 1);
 					}
 				}
 				//
@@ -1300,7 +1489,7 @@ int UARTprintf(const char *pcString, ...)
 				//
 				// Write the string.
 				//
-				UARTwrite(pcBuf, ulPos);
+				pfnWrite(pcBuf, ulPos);
 
 				//
 				// This command has been handled.
@@ -1316,7 +1505,7 @@ int UARTprintf(const char *pcString, ...)
 				//
 				// Simply write a single %.
 				//
-				UARTwrite(pcString - 1, 1);
+				pfnWrite(pcString - 1, 1);
 
 				//
 				// This command has been handled.
@@ -1332,7 +1521,7 @@ int UARTprintf(const char *pcString, ...)
 				//
 				// Indicate an error.
 				//
-				UARTwrite("ERROR", 5);
+				pfnWrite("ERROR", 5);
 
 				//
 				// This command has been handled.
@@ -1343,13 +1532,108 @@ int UARTprintf(const char *pcString, ...)
 		}
 	}
 
+	return 0;
+}
+
+//*****************************************************************************
+//
+//! A simple UART based printf function for the console channel.
+//!
+//! \param pcString is the format string.
+//! \param ... are the optional arguments, which depend on the contents of the
+//! format string.
+//!
+//! See UARTvprintf() for the supported formatting characters.  In buffered
+//! mode the call never blocks, see UARTwrite().
+//!
+//! \return None.
+//
+//*****************************************************************************
+int UARTprintf(const char *pcString, ...)
+{
+	va_list vaArgP;
+	int iRet;
+
+	//
+	// Start the varargs processing.
+	//
+	va_start(vaArgP, pcString);
+
+	iRet = UARTvprintf(UARTwrite, pcString, vaArgP);
+
 	//
 	// End the varargs processing.
 	//
 	va_end(vaArgP);
-	return 0;
+	return iRet;
+}
+
+//*****************************************************************************
+//
+//! Writes a frame to the machine channel.
+//!
+//! \param pcBuf points to a buffer containing the frame to transmit.
+//! \param ulLen is the length of the frame.
+//!
+//! In buffered mode machine frames are sent before any pending console text
+//! and are never dropped: if the machine ring is full, the call waits until
+//! the UART interrupt has made room.  In non-buffered mode this is the same
+//! as UARTwrite().
+//!
+//! \return Returns the count of characters written.
+//
+//*****************************************************************************
+int UARTMachineWrite(const char *pcBuf, unsigned long ulLen)
+{
+#ifdef UART_BUFFERED
+	return(UARTRingWrite(&g_sMachineRing, pcBuf, ulLen, false));
+#else
+	return(UARTwrite(pcBuf, ulLen));
+#endif
 }
 
+//*****************************************************************************
+//
+//! A simple UART based printf function for the machine channel.
+//!
+//! \param pcString is the format string.
+//! \param ... are the optional arguments, which depend on the contents of the
+//! format string.
+//!
+//! Same as UARTprintf(), but the output is sent with UARTMachineWrite().
+//!
+//! \return None.
+//
+//*****************************************************************************
+int UARTMachinePrintf(const char *pcString, ...)
+{
+	va_list vaArgP;
+	int iRet;
+
+	va_start(vaArgP, pcString);
+
+	iRet = UARTvprintf(UARTMachineWrite, pcString, vaArgP);
+
+	va_end(vaArgP);
+	return iRet;
+}
+
+//*****************************************************************************
+//
+//! Returns the number of console bytes dropped because the console transmit
+//! buffer was full.
+//!
+//! \return Returns the number of dropped bytes.
+//
+//*****************************************************************************
+#if defined(UART_BUFFERED) || defined(DOXYGEN)
+unsigned long
+UARTTxDropped(void)
+{
+	return(g_sConsoleRing.ulDropped);
+}
+#endif
+
 //*****************************************************************************
 //
 //! Returns the number of bytes available in the receive buffer.
@@ -1384,7 +1668,7 @@ UARTRxBytesAvail(void)
 int
 UARTTxBytesFree(void)
 {
-	return(TX_BUFFER_FREE);
+	return(UARTRingFree(&g_sConsoleRing));
 }
 #endif
 
@@ -1523,10 +1807,12 @@ UARTFlushTx(tBoolean bDiscard)
 		ulInt = IntMasterDisable();
 
 		//
-		// Flush the transmit buffer.
+		// Flush the transmit buffers.
 		//
-		g_ulUARTTxReadIndex = 0;
-		g_ulUARTTxWriteIndex = 0;
+		UARTRingFlush(&g_sConsoleRing);
+		UARTRingFlush(&g_sMachineRing);
+		g_psTxActive = 0;
+		g_ucTxPending = 0;
 
 		//
 		// If interrupts were enabled when we turned them off, turn them
@@ -1597,6 +1883,7 @@ UARTStdioIntHandler(void)
 	char cChar;
 	long lChar;
 	static tBoolean bLastWasCR = false;
+	portBASE_TYPE xWoken = pdFALSE;
 
 	//
 	// Get and clear the current interrupt source(s)
@@ -1614,6 +1901,14 @@ UARTStdioIntHandler(void)
 		//
 		UARTPrimeTransmit(g_ulBase);
 
+		//
+		// Wake a machine writer waiting for room.
+		//
+		if(g_xMachineRoom != 0)
+		{
+			xSemaphoreGiveFromISR(g_xMachineRoom, &xWoken);
+		}
+
 		//
 		// If the output buffer is empty, turn off the transmit interrupt.
 		//
@@ -1751,6 +2046,8 @@ UARTStdioIntHandler(void)
 		UARTPrimeTransmit(g_ulBase);
 		MAP_UARTIntEnable(g_ulBase, UART_INT_TX);
 	}
+
+	portEND_SWITCHING_ISR(xWoken);
 }
 #endif
 //*****************************************************************************
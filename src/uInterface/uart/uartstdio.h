@@ -57,9 +57,9 @@ extern "C"
 //
 //*****************************************************************************
 
-//#ifndef UART_BUFFERED
-//#define UART_BUFFERED 1
-//#endif
+#ifndef UART_BUFFERED
+#define UART_BUFFERED 1
+#endif
 
 #ifdef UART_BUFFERED
 #ifndef UART_RX_BUFFER_SIZE
@@ -68,6 +68,9 @@ extern "C"
 #ifndef UART_TX_BUFFER_SIZE
 #define UART_TX_BUFFER_SIZE     1024
 #endif
+#ifndef UART_MACHINE_BUFFER_SIZE
+#define UART_MACHINE_BUFFER_SIZE 128
+#endif
 #endif
 
 //*****************************************************************************
@@ -80,7 +83,11 @@ extern int UARTgets(char *pcBuf, unsigned long ulLen);
 extern unsigned char UARTgetc(void);
 extern int UARTprintf(const char *pcString, ...);
 extern int UARTwrite(const char *pcBuf, unsigned long ulLen);
+extern int UARTMachinePrintf(const char *pcString, ...);
+extern int UARTMachineWrite(const char *pcBuf, unsigned long ulLen);
 #ifdef UART_BUFFERED
+extern unsigned long UARTTxDropped(void);
+extern void UARTStdioIntHandler(void);
 extern int UARTPeek(unsigned char ucChar);
 extern void UARTFlushTx(tBoolean bDiscard);
 extern void UARTFlushRx(void);
@@ -72,74 +72,29 @@ void printnetif(struct netif *netif)
  */
 struct ip_addr* getAddresFromConfig(char* config)
 {
-	char buffer[4][4];
-	int i, j, pos = 0;
-	struct ip_addr *retAddr = NULL;
+	struct ip_addr *retAddr;
+	unsigned long ulAddr;
 
 	//
-	// open the config file
+	// the parameter is taken from the parsed configuration table
 	//
-	char* configLoad = loadFromConfig(IP_CONFIG_FILE, config);
-
-	//
-	// Check if first character is not a number
-	//
-	if (configLoad[0] < '0' && configLoad[0] > '9')
+	if (!bConfigGetIPv4(config, &ulAddr))
 	{
 		//
 		// Return with NULL, because it's not a valid IP
 		//
 		vShowBootText("IP is not Valid!");
-		retAddr = NULL;
-	}
-	else
-	{
-		//
-		// Iterate the Configuration String and parse the IP
-		//
-		for (i = 0; i < 4; i++)
-		{
-			for (j = 0; j < 4; j++)
-			{
-				buffer[i][j] = configLoad[pos];
-				pos++;
-				if (configLoad[pos] == '.')
-				{
-					//
-					// If a '.' occurs, jump to the next block
-					//
-					j++;
-					pos++;
-					buffer[i][j] = 0;
-					break;
-				}
-			}
-			//
-			// Terminate the string with a 0
-			//
-			buffer[i][j] = 0;
-		}
-
-		//
-		// Allocate new Space for the ipaddress structure
-		//
-		retAddr = (struct ip_addr*) pvPortMalloc(sizeof(struct ip_addr));
-		retAddr->addr = 0;
-
-		//
-		// convert the string to numbers and shift them into a long value
-		//
-		for (i = 0; i < 4; i++)
-		{
-			retAddr->addr = retAddr->addr | ((atoi(buffer[i]) & 0xFF)
-					<< (i * 8));
-		}
+		return NULL;
 	}
 
 	//
-	// free configuration file
+	// Allocate new Space for the ipaddress structure
 	//
-	vPortFree(configLoad);
+	retAddr = (struct ip_addr*) pvPortMalloc(sizeof(struct ip_addr));
+	if (retAddr != NULL)
+	{
+		retAddr->addr = ulAddr;
+	}
 
 	//
 	// return the new Address